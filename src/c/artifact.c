@@ -0,0 +1,689 @@
+#include "artifact.h"
+
+#include <ovarray.h>
+#include <ovutil/win32.h>
+
+#include "hash.h"
+#include "i18n.h"
+#include "jsoncommon.h"
+#include "strutil.h"
+
+enum {
+  artifact_index_version = 1,
+  hash_buffer_size = 64 * 1024,
+  // The index is locked only while it is rewritten, so waiting up to a few seconds is more than enough.
+  lock_retries = 200,
+  lock_retry_wait = 10,
+};
+
+static wchar_t const index_name[] = L"index.json";
+
+struct entry {
+  wchar_t *name;
+  uint64_t size;
+  uint64_t used; /**< FILETIME of the last use. */
+  bool busy;     /**< The file could not be deleted, so it is skipped by the eviction. Not saved. */
+};
+
+struct artifact {
+  wchar_t *directory;
+  wchar_t *index_path;
+  uint64_t max_size;
+  uint64_t total_size;
+  struct entry *entries;
+};
+
+static inline uint64_t filetime_to_uint64(FILETIME const ft) {
+  return ((uint64_t)ft.dwHighDateTime << 32) | (uint64_t)ft.dwLowDateTime;
+}
+
+static void clear(struct artifact *const a) {
+  for (size_t i = 0, n = OV_ARRAY_LENGTH(a->entries); i < n; ++i) {
+    OV_ARRAY_DESTROY(&a->entries[i].name);
+  }
+  if (a->entries) {
+    OV_ARRAY_SET_LENGTH(a->entries, 0);
+  }
+}
+
+static struct entry *find(struct artifact const *const a, wchar_t const *const name) {
+  for (size_t i = 0, n = OV_ARRAY_LENGTH(a->entries); i < n; ++i) {
+    if (_wcsicmp(a->entries[i].name, name) == 0) {
+      return &a->entries[i];
+    }
+  }
+  return NULL;
+}
+
+static void remove_entry(struct artifact *const a, struct entry *const e) {
+  size_t const n = OV_ARRAY_LENGTH(a->entries);
+  OV_ARRAY_DESTROY(&e->name);
+  *e = a->entries[n - 1];
+  OV_ARRAY_SET_LENGTH(a->entries, n - 1);
+}
+
+static NODISCARD error add_entry(struct artifact *const a, wchar_t const *const name, struct entry **const e) {
+  size_t const n = OV_ARRAY_LENGTH(a->entries);
+  error err = OV_ARRAY_GROW(&a->entries, n + 1);
+  if (efailed(err)) {
+    return ethru(err);
+  }
+  a->entries[n] = (struct entry){0};
+  err = strutil_copy(&a->entries[n].name, name);
+  if (efailed(err)) {
+    OV_ARRAY_DESTROY(&a->entries[n].name);
+    return ethru(err);
+  }
+  OV_ARRAY_SET_LENGTH(a->entries, n + 1);
+  *e = &a->entries[n];
+  return eok();
+}
+
+/**
+ * Returns a use time later than any recorded one, so the order of uses is kept even within a clock tick.
+ */
+static uint64_t next_used(struct artifact const *const a) {
+  FILETIME ft;
+  GetSystemTimeAsFileTime(&ft);
+  uint64_t used = filetime_to_uint64(ft);
+  for (size_t i = 0, n = OV_ARRAY_LENGTH(a->entries); i < n; ++i) {
+    if (a->entries[i].used >= used) {
+      used = a->entries[i].used + 1;
+    }
+  }
+  return used;
+}
+
+static bool get_file_size(wchar_t const *const path, uint64_t *const size) {
+  WIN32_FILE_ATTRIBUTE_DATA fad;
+  if (!GetFileAttributesExW(path, GetFileExInfoStandard, &fad) || (fad.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)) {
+    return false;
+  }
+  *size = ((uint64_t)fad.nFileSizeHigh << 32) | (uint64_t)fad.nFileSizeLow;
+  return true;
+}
+
+static NODISCARD error lock_index(struct artifact const *const a, HANDLE *const h) {
+  for (int i = 0;; ++i) {
+    *h = CreateFileW(
+        a->index_path, GENERIC_READ | GENERIC_WRITE, 0, NULL, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (*h != INVALID_HANDLE_VALUE) {
+      return eok();
+    }
+    DWORD const e = GetLastError();
+    if (e != ERROR_SHARING_VIOLATION || i >= lock_retries) {
+      return errhr(HRESULT_FROM_WIN32(e));
+    }
+    Sleep(lock_retry_wait);
+  }
+}
+
+/**
+ * Loads the entries from the locked index, dropping the files that no longer exist.
+ * A broken index is treated as empty, its files are just left unmanaged.
+ */
+static NODISCARD error read_index(struct artifact *const a, HANDLE const h) {
+  error err = eok();
+  char *json = NULL;
+  wchar_t *name = NULL;
+  wchar_t *path = NULL;
+  struct yyjson_doc *doc = NULL;
+  clear(a);
+  a->total_size = 0;
+  LARGE_INTEGER size;
+  if (!GetFileSizeEx(h, &size)) {
+    err = errhr(HRESULT_FROM_WIN32(GetLastError()));
+    goto cleanup;
+  }
+  if (size.QuadPart == 0) {
+    goto cleanup;
+  }
+  if (size.QuadPart > INT_MAX) {
+    err = emsg_i18n(err_type_generic, err_fail, gettext("The file is too large."));
+    goto cleanup;
+  }
+  err = mem(&json, (size_t)size.QuadPart + 1, sizeof(char));
+  if (efailed(err)) {
+    err = ethru(err);
+    goto cleanup;
+  }
+  DWORD read;
+  if (!ReadFile(h, json, (DWORD)size.QuadPart, &read, NULL)) {
+    err = errhr(HRESULT_FROM_WIN32(GetLastError()));
+    goto cleanup;
+  }
+  if (read != (DWORD)size.QuadPart) {
+    err = emsg_i18n(err_type_generic, err_fail, gettext("Unable to read the entire file."));
+    goto cleanup;
+  }
+  doc = yyjson_read_opts(json, (size_t)read, 0, jsoncommon_get_json_alc(), NULL);
+  if (!doc) {
+    goto cleanup;
+  }
+  struct yyjson_val *const root = yyjson_doc_get_root(doc);
+  struct yyjson_val *const version = yyjson_obj_get(root, "version");
+  if (!yyjson_is_int(version) || yyjson_get_int(version) != artifact_index_version) {
+    goto cleanup;
+  }
+  struct yyjson_val *const files = yyjson_obj_get(root, "files");
+  if (!yyjson_is_arr(files)) {
+    goto cleanup;
+  }
+  size_t idx, max;
+  struct yyjson_val *v;
+  yyjson_arr_foreach(files, idx, max, v) {
+    struct yyjson_val *const n = yyjson_obj_get(v, "name");
+    struct yyjson_val *const u = yyjson_obj_get(v, "used");
+    if (!yyjson_is_str(n) || !yyjson_is_uint(u)) {
+      continue;
+    }
+    err = strutil_utf8_to_wide(yyjson_get_str(n), &name);
+    if (efailed(err)) {
+      err = ethru(err);
+      goto cleanup;
+    }
+    err = artifact_get_path(a, name, &path);
+    if (efailed(err)) {
+      err = ethru(err);
+      goto cleanup;
+    }
+    uint64_t file_size;
+    if (find(a, name) || !get_file_size(path, &file_size)) {
+      continue;
+    }
+    struct entry *e = NULL;
+    err = add_entry(a, name, &e);
+    if (efailed(err)) {
+      err = ethru(err);
+      goto cleanup;
+    }
+    e->size = file_size;
+    e->used = yyjson_get_uint(u);
+    a->total_size += file_size;
+  }
+cleanup:
+  if (doc) {
+    yyjson_doc_free(doc);
+    doc = NULL;
+  }
+  OV_ARRAY_DESTROY(&path);
+  OV_ARRAY_DESTROY(&name);
+  if (json) {
+    ereport(mem_free(&json));
+  }
+  return err;
+}
+
+static NODISCARD error write_index(struct artifact const *const a, HANDLE const h) {
+  error err = eok();
+  char *s = NULL;
+  char *json = NULL;
+  size_t json_len = 0;
+  struct yyjson_mut_doc *doc = yyjson_mut_doc_new(jsoncommon_get_json_alc());
+  if (!doc) {
+    err = errg(err_out_of_memory);
+    goto cleanup;
+  }
+  struct yyjson_mut_val *const root = yyjson_mut_obj(doc);
+  struct yyjson_mut_val *const files = yyjson_mut_arr(doc);
+  if (!root || !files) {
+    err = errg(err_out_of_memory);
+    goto cleanup;
+  }
+  yyjson_mut_doc_set_root(doc, root);
+  yyjson_mut_obj_add_int(doc, root, "version", artifact_index_version);
+  yyjson_mut_obj_add_val(doc, root, "files", files);
+  for (size_t i = 0, n = OV_ARRAY_LENGTH(a->entries); i < n; ++i) {
+    struct entry const *const e = &a->entries[i];
+    struct yyjson_mut_val *const v = yyjson_mut_arr_add_obj(doc, files);
+    if (!v) {
+      err = errg(err_out_of_memory);
+      goto cleanup;
+    }
+    err = strutil_wide_to_utf8(e->name, &s);
+    if (efailed(err)) {
+      err = ethru(err);
+      goto cleanup;
+    }
+    yyjson_mut_obj_add_strcpy(doc, v, "name", s);
+    yyjson_mut_obj_add_uint(doc, v, "size", e->size);
+    yyjson_mut_obj_add_uint(doc, v, "used", e->used);
+  }
+  struct yyjson_write_err jsonerr;
+  json = yyjson_mut_write_opts(doc, 0, jsoncommon_get_json_alc(), &json_len, &jsonerr);
+  if (!json) {
+    err = emsg_i18nf(err_type_generic, err_fail, L"%1$hs", gettext("Unable to write JSON: %1$hs"), jsonerr.msg);
+    goto cleanup;
+  }
+  if (!SetFilePointerEx(h, (LARGE_INTEGER){0}, NULL, FILE_BEGIN)) {
+    err = errhr(HRESULT_FROM_WIN32(GetLastError()));
+    goto cleanup;
+  }
+  DWORD written;
+  if (!WriteFile(h, json, (DWORD)json_len, &written, NULL)) {
+    err = errhr(HRESULT_FROM_WIN32(GetLastError()));
+    goto cleanup;
+  }
+  if (written != json_len) {
+    err = emsg_i18n(err_type_generic, err_fail, gettext("Unable to write the entire file."));
+    goto cleanup;
+  }
+  if (!SetEndOfFile(h)) {
+    err = errhr(HRESULT_FROM_WIN32(GetLastError()));
+    goto cleanup;
+  }
+cleanup:
+  if (json) {
+    ereport(mem_free(&json));
+  }
+  OV_ARRAY_DESTROY(&s);
+  if (doc) {
+    yyjson_mut_doc_free(doc);
+    doc = NULL;
+  }
+  return err;
+}
+
+/**
+ * Deletes the least recently used files except keep until the total size fits in the budget.
+ * A file that cannot be deleted, for example because another process is reading it, is skipped.
+ */
+static NODISCARD error evict(struct artifact *const a, wchar_t const *const keep) {
+  error err = eok();
+  wchar_t *path = NULL;
+  while (a->total_size > a->max_size) {
+    struct entry *oldest = NULL;
+    for (size_t i = 0, n = OV_ARRAY_LENGTH(a->entries); i < n; ++i) {
+      struct entry *const e = &a->entries[i];
+      if (e->busy || (keep && _wcsicmp(e->name, keep) == 0)) {
+        continue;
+      }
+      if (!oldest || e->used < oldest->used) {
+        oldest = e;
+      }
+    }
+    if (!oldest) {
+      break;
+    }
+    err = artifact_get_path(a, oldest->name, &path);
+    if (efailed(err)) {
+      err = ethru(err);
+      goto cleanup;
+    }
+    if (!DeleteFileW(path) && GetLastError() != ERROR_FILE_NOT_FOUND) {
+      oldest->busy = true;
+      continue;
+    }
+    a->total_size -= oldest->size;
+    remove_entry(a, oldest);
+  }
+cleanup:
+  OV_ARRAY_DESTROY(&path);
+  return err;
+}
+
+/**
+ * Updates the entry of name under the lock of the index.
+ * If register_file is true, the entry follows the file on disk and the budget is enforced.
+ * Otherwise only an existing entry is marked as used.
+ */
+static NODISCARD error
+update(struct artifact *const a, wchar_t const *const name, bool const register_file, bool *const found) {
+  error err = eok();
+  wchar_t *path = NULL;
+  HANDLE h = INVALID_HANDLE_VALUE;
+  err = lock_index(a, &h);
+  if (efailed(err)) {
+    err = ethru(err);
+    goto cleanup;
+  }
+  err = read_index(a, h);
+  if (efailed(err)) {
+    err = ethru(err);
+    goto cleanup;
+  }
+  struct entry *e = find(a, name);
+  if (register_file) {
+    err = artifact_get_path(a, name, &path);
+    if (efailed(err)) {
+      err = ethru(err);
+      goto cleanup;
+    }
+    uint64_t size;
+    if (!get_file_size(path, &size)) {
+      if (e) {
+        a->total_size -= e->size;
+        remove_entry(a, e);
+        e = NULL;
+      }
+    } else {
+      if (!e) {
+        err = add_entry(a, name, &e);
+        if (efailed(err)) {
+          err = ethru(err);
+          goto cleanup;
+        }
+      } else {
+        a->total_size -= e->size;
+      }
+      e->size = size;
+      a->total_size += size;
+    }
+  }
+  if (e) {
+    e->used = next_used(a);
+  }
+  if (found) {
+    *found = e != NULL;
+  }
+  if (register_file) {
+    err = evict(a, name);
+    if (efailed(err)) {
+      err = ethru(err);
+      goto cleanup;
+    }
+  }
+  err = write_index(a, h);
+  if (efailed(err)) {
+    err = ethru(err);
+    goto cleanup;
+  }
+cleanup:
+  if (h != INVALID_HANDLE_VALUE) {
+    CloseHandle(h);
+    h = INVALID_HANDLE_VALUE;
+  }
+  OV_ARRAY_DESTROY(&path);
+  return err;
+}
+
+/**
+ * Parses the decimal process ID in s[0..len), or returns 0 if it is not one.
+ */
+static DWORD parse_pid(wchar_t const *const s, size_t const len) {
+  if (!len || len > 10) {
+    return 0;
+  }
+  uint64_t pid = 0;
+  for (size_t i = 0; i < len; ++i) {
+    if (s[i] < L'0' || s[i] > L'9') {
+      return 0;
+    }
+    pid = pid * 10 + (uint64_t)(s[i] - L'0');
+  }
+  return pid <= MAXDWORD ? (DWORD)pid : 0;
+}
+
+/**
+ * Returns the process that left the file, or 0 if the file does not belong to a single process.
+ * Such files are the temporary copies "<key>.<ext>.<pid>.tmp" made by artifact_put_file,
+ * and the work files "<work_prefix>_<pid>.*" of a run, including their temporary files.
+ */
+static DWORD get_owner_pid(wchar_t const *const name, wchar_t const *const work_prefix) {
+  size_t const len = wcslen(name);
+  if (work_prefix) {
+    size_t const prefix_len = wcslen(work_prefix);
+    if (_wcsnicmp(name, work_prefix, prefix_len) == 0 && name[prefix_len] == L'_') {
+      wchar_t const *const pid = name + prefix_len + 1;
+      wchar_t const *const dot = wcschr(pid, L'.');
+      return dot ? parse_pid(pid, (size_t)(dot - pid)) : 0;
+    }
+  }
+  static wchar_t const tmp_ext[] = L".tmp";
+  size_t const tmp_ext_len = sizeof(tmp_ext) / sizeof(tmp_ext[0]) - 1;
+  if (len <= artifact_key_chars + tmp_ext_len || name[artifact_key_chars] != L'.' ||
+      _wcsicmp(name + len - tmp_ext_len, tmp_ext) != 0 || wcsspn(name, L"0123456789abcdef") != artifact_key_chars) {
+    return 0;
+  }
+  size_t const end = len - tmp_ext_len;
+  size_t begin = end;
+  while (begin > artifact_key_chars && name[begin - 1] != L'.') {
+    --begin;
+  }
+  return begin > artifact_key_chars ? parse_pid(name + begin, end - begin) : 0;
+}
+
+static bool is_process_running(DWORD const pid) {
+  if (pid == GetCurrentProcessId()) {
+    return true;
+  }
+  HANDLE const h = OpenProcess(PROCESS_QUERY_LIMITED_INFORMATION, FALSE, pid);
+  if (!h) {
+    // The process exists but belongs to someone else.
+    return GetLastError() == ERROR_ACCESS_DENIED;
+  }
+  DWORD code = 0;
+  bool const running = GetExitCodeProcess(h, &code) && code == STILL_ACTIVE;
+  CloseHandle(h);
+  return running;
+}
+
+/**
+ * Deletes the files left by processes that are no longer running, for example after a crash.
+ * They are never registered, so they would otherwise stay outside the budget forever.
+ */
+static NODISCARD error sweep(struct artifact const *const a, wchar_t const *const work_prefix) {
+  wchar_t *path = NULL;
+  HANDLE h = INVALID_HANDLE_VALUE;
+  error err = artifact_get_path(a, L"*", &path);
+  if (efailed(err)) {
+    err = ethru(err);
+    goto cleanup;
+  }
+  WIN32_FIND_DATAW fd;
+  h = FindFirstFileW(path, &fd);
+  if (h == INVALID_HANDLE_VALUE) {
+    goto cleanup;
+  }
+  do {
+    if (fd.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) {
+      continue;
+    }
+    DWORD const pid = get_owner_pid(fd.cFileName, work_prefix);
+    if (!pid || is_process_running(pid)) {
+      continue;
+    }
+    err = artifact_get_path(a, fd.cFileName, &path);
+    if (efailed(err)) {
+      err = ethru(err);
+      goto cleanup;
+    }
+    DeleteFileW(path);
+  } while (FindNextFileW(h, &fd));
+cleanup:
+  if (h != INVALID_HANDLE_VALUE) {
+    FindClose(h);
+    h = INVALID_HANDLE_VALUE;
+  }
+  OV_ARRAY_DESTROY(&path);
+  return err;
+}
+
+NODISCARD error artifact_create(struct artifact **const ap,
+                                wchar_t const *const directory,
+                                uint64_t const max_size,
+                                wchar_t const *const work_prefix) {
+  if (!ap || *ap || !directory || !*directory) {
+    return errg(err_invalid_arugment);
+  }
+  struct artifact *a = NULL;
+  error err = mem(&a, 1, sizeof(struct artifact));
+  if (efailed(err)) {
+    err = ethru(err);
+    goto cleanup;
+  }
+  *a = (struct artifact){
+      .max_size = max_size,
+  };
+  err = strutil_copy(&a->directory, directory);
+  if (efailed(err)) {
+    err = ethru(err);
+    goto cleanup;
+  }
+  if (!CreateDirectoryW(a->directory, NULL) && GetLastError() != ERROR_ALREADY_EXISTS) {
+    err = errhr(HRESULT_FROM_WIN32(GetLastError()));
+    goto cleanup;
+  }
+  err = artifact_get_path(a, index_name, &a->index_path);
+  if (efailed(err)) {
+    err = ethru(err);
+    goto cleanup;
+  }
+  err = sweep(a, work_prefix);
+  if (efailed(err)) {
+    err = ethru(err);
+    goto cleanup;
+  }
+  *ap = a;
+  a = NULL;
+cleanup:
+  if (a) {
+    artifact_destroy(&a);
+  }
+  return err;
+}
+
+void artifact_destroy(struct artifact **const ap) {
+  if (!ap || !*ap) {
+    return;
+  }
+  struct artifact *const a = *ap;
+  clear(a);
+  OV_ARRAY_DESTROY(&a->entries);
+  OV_ARRAY_DESTROY(&a->index_path);
+  OV_ARRAY_DESTROY(&a->directory);
+  ereport(mem_free(ap));
+}
+
+void artifact_make_name(uint64_t const key, wchar_t const *const ext, wchar_t *const name) {
+  static wchar_t const digits[] = L"0123456789abcdef";
+  for (int i = 0; i < artifact_key_chars; ++i) {
+    name[i] = digits[(key >> ((artifact_key_chars - 1 - i) * 4)) & 0xf];
+  }
+  wcscpy(name + artifact_key_chars, ext);
+}
+
+NODISCARD error artifact_hash_file(wchar_t const *const path, uint64_t const seed, uint64_t *const hash) {
+  if (!path || !hash) {
+    return errg(err_invalid_arugment);
+  }
+  error err = eok();
+  char *buf = NULL;
+  HANDLE h = CreateFileW(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+  if (h == INVALID_HANDLE_VALUE) {
+    err = errhr(HRESULT_FROM_WIN32(GetLastError()));
+    goto cleanup;
+  }
+  err = mem(&buf, hash_buffer_size, sizeof(char));
+  if (efailed(err)) {
+    err = ethru(err);
+    goto cleanup;
+  }
+  uint64_t v = hash_fnv1a(buf, 0, seed);
+  for (;;) {
+    DWORD read;
+    if (!ReadFile(h, buf, hash_buffer_size, &read, NULL)) {
+      err = errhr(HRESULT_FROM_WIN32(GetLastError()));
+      goto cleanup;
+    }
+    if (read == 0) {
+      break;
+    }
+    v = hash_fnv1a(buf, read, v);
+  }
+  *hash = v;
+cleanup:
+  if (buf) {
+    ereport(mem_free(&buf));
+  }
+  if (h != INVALID_HANDLE_VALUE) {
+    CloseHandle(h);
+    h = INVALID_HANDLE_VALUE;
+  }
+  return err;
+}
+
+NODISCARD error artifact_get_path(struct artifact const *const a, wchar_t const *const name, wchar_t **const path) {
+  if (!a || !name || !path) {
+    return errg(err_invalid_arugment);
+  }
+  size_t const dirlen = OV_ARRAY_LENGTH(a->directory);
+  size_t const namelen = wcslen(name);
+  error err = OV_ARRAY_GROW(path, dirlen + namelen + 2);
+  if (efailed(err)) {
+    return ethru(err);
+  }
+  wcscpy(*path, a->directory);
+  size_t len = dirlen;
+  if (len && (*path)[len - 1] != L'\\' && (*path)[len - 1] != L'/') {
+    (*path)[len++] = L'\\';
+  }
+  wcscpy(*path + len, name);
+  OV_ARRAY_SET_LENGTH(*path, len + namelen);
+  return eok();
+}
+
+NODISCARD error artifact_find(struct artifact *const a, wchar_t const *const name, bool *const found) {
+  if (!a || !name || !found) {
+    return errg(err_invalid_arugment);
+  }
+  *found = false;
+  error err = update(a, name, false, found);
+  if (efailed(err)) {
+    return ethru(err);
+  }
+  return eok();
+}
+
+NODISCARD error artifact_put_file(struct artifact *const a, wchar_t const *const name, wchar_t const *const src_path) {
+  if (!a || !name || !src_path || _wcsicmp(name, index_name) == 0) {
+    return errg(err_invalid_arugment);
+  }
+  wchar_t *path = NULL;
+  wchar_t *tmp = NULL;
+  error err = artifact_get_path(a, name, &path);
+  if (efailed(err)) {
+    err = ethru(err);
+    goto cleanup;
+  }
+  err = OV_ARRAY_GROW(&tmp, OV_ARRAY_LENGTH(path) + 32);
+  if (efailed(err)) {
+    err = ethru(err);
+    goto cleanup;
+  }
+  // Another process may put the same file at the same time, so the temporary file is per process.
+  wsprintfW(tmp, L"%s.%lu.tmp", path, GetCurrentProcessId());
+  if (!CopyFileW(src_path, tmp, FALSE)) {
+    err = errhr(HRESULT_FROM_WIN32(GetLastError()));
+    goto cleanup;
+  }
+  if (!MoveFileExW(tmp, path, MOVEFILE_REPLACE_EXISTING)) {
+    err = errhr(HRESULT_FROM_WIN32(GetLastError()));
+    goto cleanup;
+  }
+  err = update(a, name, true, NULL);
+  if (efailed(err)) {
+    err = ethru(err);
+    goto cleanup;
+  }
+cleanup:
+  if (efailed(err) && tmp) {
+    DeleteFileW(tmp);
+  }
+  OV_ARRAY_DESTROY(&tmp);
+  OV_ARRAY_DESTROY(&path);
+  return err;
+}
+
+NODISCARD error artifact_touch(struct artifact *const a, wchar_t const *const name) {
+  if (!a || !name || _wcsicmp(name, index_name) == 0) {
+    return errg(err_invalid_arugment);
+  }
+  error err = update(a, name, true, NULL);
+  if (efailed(err)) {
+    return ethru(err);
+  }
+  return eok();
+}
+
+uint64_t artifact_get_total_size(struct artifact const *const a) { return a ? a->total_size : 0; }
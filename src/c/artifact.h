@@ -0,0 +1,102 @@
+#pragma once
+
+#include <ovbase.h>
+
+struct artifact;
+
+enum {
+  // Length of a name made by artifact_make_name without the extension.
+  artifact_key_chars = 16,
+};
+
+/**
+ * @brief Opens a directory of files that are kept across runs within a total size budget.
+ *
+ * The files in the directory that are registered by artifact_put_file or artifact_touch are recorded in index.json
+ * with their size and the last time they were used. Whenever a file is registered, the least recently used files
+ * are deleted until the total size fits in the budget. Other files in the directory are left alone.
+ *
+ * The index is locked while it is updated, so the directory can be shared by multiple processes.
+ *
+ * Files that belong to a single process are deleted when the process is no longer running, which happens when a run
+ * is killed before it cleans up. They are the temporary files of artifact_put_file and the work files named
+ * "<work_prefix>_<pid>.*".
+ *
+ * @param ap A pointer to receive the artifact directory.
+ * @param directory Path of the directory, created if it does not exist.
+ * @param max_size Total size budget in bytes.
+ * @param work_prefix Prefix of the per-process work files written in the directory, can be NULL.
+ * @return An error code indicating success or failure.
+ */
+NODISCARD error artifact_create(struct artifact **const ap,
+                                wchar_t const *const directory,
+                                uint64_t const max_size,
+                                wchar_t const *const work_prefix);
+void artifact_destroy(struct artifact **const ap);
+
+/**
+ * @brief Makes a content-addressed name, the key in hexadecimal followed by ext.
+ *
+ * @param key Hash of everything the content depends on.
+ * @param ext Extension including the dot.
+ * @param name Destination buffer, artifact_key_chars + wcslen(ext) + 1 characters at least.
+ */
+void artifact_make_name(uint64_t const key, wchar_t const *const ext, wchar_t *const name);
+
+/**
+ * @brief Calculates the 64-bit FNV-1a hash of the file, the same as hash_fnv1a.
+ *
+ * @param path Path to the file.
+ * @param seed 0 to start a new hash, or the previous result to continue.
+ * @param hash A pointer to receive the hash.
+ * @return An error code indicating success or failure.
+ */
+NODISCARD error artifact_hash_file(wchar_t const *const path, uint64_t const seed, uint64_t *const hash);
+
+/**
+ * @brief Gets the path of a file in the directory.
+ *
+ * @param a The artifact directory.
+ * @param name Name of the file.
+ * @param path A pointer to receive the path as an ovarray.
+ * @return An error code indicating success or failure.
+ */
+NODISCARD error artifact_get_path(struct artifact const *const a, wchar_t const *const name, wchar_t **const path);
+
+/**
+ * @brief Finds a registered file and marks it as used.
+ *
+ * @param a The artifact directory.
+ * @param name Name of the file.
+ * @param found A pointer to receive whether the file exists.
+ * @return An error code indicating success or failure.
+ */
+NODISCARD error artifact_find(struct artifact *const a, wchar_t const *const name, bool *const found);
+
+/**
+ * @brief Copies a file into the directory and registers it.
+ *
+ * The copy is moved into place only after it is complete, so a file found by artifact_find is never partial.
+ *
+ * @param a The artifact directory.
+ * @param name Name of the file in the directory.
+ * @param src_path Path of the file to copy.
+ * @return An error code indicating success or failure.
+ */
+NODISCARD error artifact_put_file(struct artifact *const a, wchar_t const *const name, wchar_t const *const src_path);
+
+/**
+ * @brief Registers a file already written in the directory, or marks it as used.
+ *
+ * If the file does not exist, it is unregistered.
+ *
+ * @param a The artifact directory.
+ * @param name Name of the file.
+ * @return An error code indicating success or failure.
+ */
+NODISCARD error artifact_touch(struct artifact *const a, wchar_t const *const name);
+
+/**
+ * @brief Returns the total size of the registered files as of the last update.
+ */
+uint64_t artifact_get_total_size(struct artifact const *const a);
@@ -0,0 +1,218 @@
+#include <ovtest.h>
+
+#include <ovarray.h>
+#include <ovutil/win32.h>
+
+#include <string.h>
+
+#include "artifact.h"
+#include "hash.h"
+#include "path.h"
+
+static bool write_file(wchar_t const *const path, char const fill, size_t const size) {
+  char buf[64];
+  memset(buf, fill, sizeof(buf));
+  HANDLE h = CreateFileW(path, GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+  if (h == INVALID_HANDLE_VALUE) {
+    return false;
+  }
+  DWORD written = 0;
+  BOOL const r = WriteFile(h, buf, (DWORD)size, &written, NULL);
+  CloseHandle(h);
+  return r && written == size;
+}
+
+static bool exists(struct artifact const *const a, wchar_t const *const name) {
+  wchar_t *path = NULL;
+  if (!TEST_SUCCEEDED_F(artifact_get_path(a, name, &path))) {
+    return false;
+  }
+  bool const r = GetFileAttributesW(path) != INVALID_FILE_ATTRIBUTES;
+  OV_ARRAY_DESTROY(&path);
+  return r;
+}
+
+static void remove_directory(wchar_t const *const dir) {
+  static wchar_t const *const names[] = {
+      L"a.bin",
+      L"b.bin",
+      L"c.bin",
+      L"index.json",
+      L"work_4294967292.opus",
+      L"work_4294967292.chunk1.exo",
+      L"work_4294967295.json",
+      L"other_4294967292.opus",
+      L"0123456789abcdef.json.4294967292.tmp",
+      L"0123456789abcdef.json.tmp",
+  };
+  wchar_t path[MAX_PATH];
+  for (size_t i = 0; i < sizeof(names) / sizeof(names[0]); ++i) {
+    swprintf(path, MAX_PATH, L"%ls\\%ls", dir, names[i]);
+    DeleteFileW(path);
+  }
+  RemoveDirectoryW(dir);
+}
+
+static void test_artifact_make_name(void) {
+  wchar_t name[artifact_key_chars + 8];
+  artifact_make_name(UINT64_C(0x0123456789abcdef), L".json", name);
+  TEST_CHECK(wcscmp(name, L"0123456789abcdef.json") == 0);
+  artifact_make_name(0, L"", name);
+  TEST_CHECK(wcscmp(name, L"0000000000000000") == 0);
+}
+
+static void test_artifact_hash_file(void) {
+  wchar_t *path = NULL;
+  if (!TEST_SUCCEEDED_F(path_get_temp_file(&path, L"artifact_test.bin"))) {
+    goto cleanup;
+  }
+  if (!TEST_CHECK(write_file(path, 'x', 40))) {
+    goto cleanup;
+  }
+  char expected[40];
+  memset(expected, 'x', sizeof(expected));
+  uint64_t hash = 0;
+  TEST_SUCCEEDED_F(artifact_hash_file(path, 0, &hash));
+  TEST_CHECK(hash == hash_fnv1a(expected, sizeof(expected), 0));
+  TEST_SUCCEEDED_F(artifact_hash_file(path, 123, &hash));
+  TEST_CHECK(hash == hash_fnv1a(expected, sizeof(expected), 123));
+cleanup:
+  if (path) {
+    DeleteFileW(path);
+    OV_ARRAY_DESTROY(&path);
+  }
+}
+
+static void test_artifact_evict(void) {
+  wchar_t *dir = NULL;
+  wchar_t *src = NULL;
+  struct artifact *a = NULL;
+  bool found = false;
+  if (!TEST_SUCCEEDED_F(path_get_temp_file(&dir, L"artifact_test"))) {
+    goto cleanup;
+  }
+  remove_directory(dir);
+  if (!TEST_SUCCEEDED_F(path_get_temp_file(&src, L"artifact_test.bin"))) {
+    goto cleanup;
+  }
+  if (!TEST_CHECK(write_file(src, 'x', 40))) {
+    goto cleanup;
+  }
+  if (!TEST_SUCCEEDED_F(artifact_create(&a, dir, 100, NULL))) {
+    goto cleanup;
+  }
+  TEST_SUCCEEDED_F(artifact_find(a, L"a.bin", &found));
+  TEST_CHECK(!found);
+  TEST_SUCCEEDED_F(artifact_put_file(a, L"a.bin", src));
+  TEST_SUCCEEDED_F(artifact_put_file(a, L"b.bin", src));
+  TEST_CHECK(artifact_get_total_size(a) == 80);
+  // Using a.bin makes b.bin the least recently used one.
+  TEST_SUCCEEDED_F(artifact_find(a, L"a.bin", &found));
+  TEST_CHECK(found);
+  TEST_SUCCEEDED_F(artifact_put_file(a, L"c.bin", src));
+  TEST_CHECK(artifact_get_total_size(a) == 80);
+  TEST_CHECK(exists(a, L"a.bin"));
+  TEST_CHECK(!exists(a, L"b.bin"));
+  TEST_CHECK(exists(a, L"c.bin"));
+  artifact_destroy(&a);
+  TEST_CHECK(a == NULL);
+
+  // The index is kept in the directory.
+  if (!TEST_SUCCEEDED_F(artifact_create(&a, dir, 100, NULL))) {
+    goto cleanup;
+  }
+  TEST_SUCCEEDED_F(artifact_find(a, L"c.bin", &found));
+  TEST_CHECK(found);
+  TEST_CHECK(artifact_get_total_size(a) == 80);
+  TEST_SUCCEEDED_F(artifact_find(a, L"b.bin", &found));
+  TEST_CHECK(!found);
+
+  // A file written in place is registered by touch, and a deleted one is unregistered.
+  wchar_t *path = NULL;
+  if (TEST_SUCCEEDED_F(artifact_get_path(a, L"b.bin", &path))) {
+    TEST_CHECK(write_file(path, 'y', 10));
+    TEST_SUCCEEDED_F(artifact_touch(a, L"b.bin"));
+    TEST_CHECK(artifact_get_total_size(a) == 90);
+    DeleteFileW(path);
+    TEST_SUCCEEDED_F(artifact_touch(a, L"b.bin"));
+    TEST_CHECK(artifact_get_total_size(a) == 80);
+    OV_ARRAY_DESTROY(&path);
+  }
+  TEST_EISG_F(artifact_touch(a, L"index.json"), err_invalid_arugment);
+cleanup:
+  artifact_destroy(&a);
+  if (dir) {
+    remove_directory(dir);
+    OV_ARRAY_DESTROY(&dir);
+  }
+  if (src) {
+    DeleteFileW(src);
+    OV_ARRAY_DESTROY(&src);
+  }
+}
+
+static void test_artifact_sweep(void) {
+  wchar_t *dir = NULL;
+  struct artifact *a = NULL;
+  wchar_t path[MAX_PATH];
+  wchar_t own[64];
+  // Process IDs this large are never handed out, so the files belong to no running process.
+  static wchar_t const *const stale[] = {
+      L"work_4294967292.opus",
+      L"work_4294967292.chunk1.exo",
+      L"work_4294967295.json",
+      L"0123456789abcdef.json.4294967292.tmp",
+  };
+  static wchar_t const *const kept[] = {
+      L"other_4294967292.opus",
+      L"0123456789abcdef.json.tmp",
+  };
+  if (!TEST_SUCCEEDED_F(path_get_temp_file(&dir, L"artifact_test"))) {
+    goto cleanup;
+  }
+  remove_directory(dir);
+  if (!TEST_CHECK(CreateDirectoryW(dir, NULL))) {
+    goto cleanup;
+  }
+  for (size_t i = 0; i < sizeof(stale) / sizeof(stale[0]); ++i) {
+    swprintf(path, MAX_PATH, L"%ls\\%ls", dir, stale[i]);
+    TEST_CHECK(write_file(path, 'x', 10));
+  }
+  for (size_t i = 0; i < sizeof(kept) / sizeof(kept[0]); ++i) {
+    swprintf(path, MAX_PATH, L"%ls\\%ls", dir, kept[i]);
+    TEST_CHECK(write_file(path, 'x', 10));
+  }
+  // The files of this process are in use.
+  swprintf(own, 64, L"work_%lu.opus", GetCurrentProcessId());
+  swprintf(path, MAX_PATH, L"%ls\\%ls", dir, own);
+  TEST_CHECK(write_file(path, 'x', 10));
+
+  if (!TEST_SUCCEEDED_F(artifact_create(&a, dir, 100, L"work"))) {
+    goto cleanup;
+  }
+  for (size_t i = 0; i < sizeof(stale) / sizeof(stale[0]); ++i) {
+    TEST_CHECK(!exists(a, stale[i]));
+    TEST_MSG("%ls", stale[i]);
+  }
+  for (size_t i = 0; i < sizeof(kept) / sizeof(kept[0]); ++i) {
+    TEST_CHECK(exists(a, kept[i]));
+    TEST_MSG("%ls", kept[i]);
+  }
+  TEST_CHECK(exists(a, own));
+cleanup:
+  artifact_destroy(&a);
+  if (dir) {
+    swprintf(path, MAX_PATH, L"%ls\\work_%lu.opus", dir, GetCurrentProcessId());
+    DeleteFileW(path);
+    remove_directory(dir);
+    OV_ARRAY_DESTROY(&dir);
+  }
+}
+
+TEST_LIST = {
+    {"test_artifact_make_name", test_artifact_make_name},
+    {"test_artifact_hash_file", test_artifact_hash_file},
+    {"test_artifact_evict", test_artifact_evict},
+    {"test_artifact_sweep", test_artifact_sweep},
+    {NULL, NULL},
+};
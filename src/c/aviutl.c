@@ -6,7 +6,9 @@
 
 #include <string.h>
 
+#include "exedit.h"
 #include "i18n.h"
+#include "layerindex.h"
 #include "path.h"
 
 static FILTER *g_fp = NULL;
@@ -291,14 +293,6 @@ NODISCARD error aviutl_drop_exo(char const *const exo_path, int frame, int layer
 
 #define DEBUG_OUTPUT 0
 
-enum {
-  layer_length = 100,
-  display_name_length = 64,
-  filter_length = 12,
-  track_length = 64,
-  check_length = 48,
-};
-
 struct exedit_filter {
   uint32_t flag;
   int32_t x; // 0x10000=出力フィルタなら変更時にカメラ制御対象フラグがon(グループ制御にもついている)
@@ -382,38 +376,6 @@ struct exedit_filter {
   int32_t scene_set;         // 配置シーン
 };
 
-struct exedit_object {
-  uint32_t flag;
-  int32_t layer_disp; // 表示レイヤー、別シーン表示中は-1
-  int32_t frame_begin;
-  int32_t frame_end;
-  char display_name[display_name_length]; // タイムライン上の表示名(最初のバイトがヌル文字の場合はデフォルト名が表示)
-  int32_t
-      index_midpt_leader; // 中間点を持つオブジェクトの構成要素の場合、先頭オブジェクトのインデックス、中間点を持たないなら-1
-  struct filter_param {
-    int32_t id;
-    int16_t track_begin; // このフィルタの先頭のトラックバー番号
-    int16_t check_begin;
-    uint32_t exdata_offset;
-  } filter_param[filter_length];
-  uint8_t filter_status[filter_length];
-  int16_t track_sum;
-  int16_t check_sum;
-  uint32_t exdata_sum;
-  int32_t track_value_left[track_length];
-  int32_t track_value_right[track_length];
-  struct track_mode {
-    int16_t num;
-    int16_t script_num;
-  } track_mode[track_length];
-  int32_t check_value[check_length];
-  uint32_t exdata_offset;
-  int32_t group_belong;
-  int32_t track_param[track_length];
-  int32_t layer_set;
-  int32_t scene_set;
-};
-
 struct exedit {
   HMODULE module;
 
@@ -465,37 +427,65 @@ static bool get_exedit(struct exedit *const e) {
   return true;
 }
 
+NODISCARD error aviutl_create_layerindex(struct layerindex **const lipp) {
+  struct exedit ex;
+  if (!get_exedit(&ex)) {
+    return errg(err_fail);
+  }
+  error err = layerindex_create(lipp,
+                                ex.active_scene_sorted_object,
+                                ex.active_scene_sorted_object_layer_begin_index,
+                                ex.active_scene_sorted_object_layer_end_index);
+  if (efailed(err)) {
+    return ethru(err);
+  }
+  return eok();
+}
+
 NODISCARD error aviutl_find_space(int start_frame,
                                   int end_frame,
                                   int const required_spaces,
                                   int const search_offset,
                                   bool const last,
                                   int *const found_target) {
-#if DEBUG_OUTPUT
-  wchar_t buf[1024];
-  wchar_t namebuf[256];
-#endif
-  error err = eok();
-  struct exedit ex;
-  if (!get_exedit(&ex)) {
-    err = errg(err_fail);
+  struct layerindex *li = NULL;
+  error err = aviutl_create_layerindex(&li);
+  if (efailed(err)) {
+    err = ethru(err);
     goto cleanup;
   }
+  err = aviutl_find_space_in_index(li, start_frame, end_frame, required_spaces, search_offset, last, found_target);
+  if (efailed(err)) {
+    err = ethru(err);
+    goto cleanup;
+  }
+cleanup:
+  layerindex_destroy(&li);
+  return err;
+}
 
+NODISCARD error aviutl_find_space_in_index(struct layerindex const *const li,
+                                           int start_frame,
+                                           int end_frame,
+                                           int const required_spaces,
+                                           int const search_offset,
+                                           bool const last,
+                                           int *const found_target) {
+  if (!li) {
+    return errg(err_invalid_arugment);
+  }
 #if DEBUG_OUTPUT
+  wchar_t buf[1024];
+  wchar_t namebuf[256];
   mo_snprintf_wchar(buf, sizeof(buf) / sizeof(wchar_t), NULL, "start_frame: %d end_frame: %d", start_frame, end_frame);
   OutputDebugStringW(buf);
-#endif
-
-  int target_layer = -1;
-  int found_spaces = 0;
-  for (int layer = search_offset; layer < 100; ++layer) {
+  struct exedit ex;
+  get_exedit(&ex);
+  for (int layer = search_offset; layer < layer_length; ++layer) {
     int32_t const sidx = ex.active_scene_sorted_object_layer_begin_index[layer];
     int32_t const eidx = ex.active_scene_sorted_object_layer_end_index[layer];
-    bool blocked = false;
     for (int32_t oidx = sidx; oidx <= eidx; ++oidx) {
       struct exedit_object const *o = ex.active_scene_sorted_object[oidx];
-#if DEBUG_OUTPUT
       get_display_name(namebuf, sizeof(namebuf) / sizeof(wchar_t), &ex, o);
       mo_snprintf_wchar(buf,
                         sizeof(buf) / sizeof(wchar_t),
@@ -507,36 +497,21 @@ NODISCARD error aviutl_find_space(int start_frame,
                         o->frame_end,
                         namebuf);
       OutputDebugStringW(buf);
-#endif
-      int const obegin = o->frame_begin;
-      int const oend = o->frame_end;
-      if ((start_frame <= obegin && obegin <= end_frame) || (start_frame <= oend && oend <= end_frame) ||
-          (obegin <= start_frame && end_frame <= oend)) {
-#if DEBUG_OUTPUT
-        mo_snprintf_wchar(buf, sizeof(buf) / sizeof(wchar_t), NULL, "blocked: layer %d", layer + 1);
-        OutputDebugStringW(buf);
-#endif
-        blocked = true;
-        found_spaces = 0;
-        break;
-      }
     }
-    if (!blocked) {
-      if (++found_spaces == required_spaces) {
-        target_layer = layer - required_spaces;
-        if (!last) {
-          break;
-        }
-      }
+    if (!layerindex_is_free(li, layer, start_frame, end_frame)) {
+      mo_snprintf_wchar(buf, sizeof(buf) / sizeof(wchar_t), NULL, "blocked: layer %d", layer + 1);
+      OutputDebugStringW(buf);
     }
   }
+#endif
+
+  int const target = layerindex_find_space(li, start_frame, end_frame, required_spaces, search_offset, last);
 #if DEBUG_OUTPUT
-  mo_snprintf_wchar(buf, sizeof(buf) / sizeof(wchar_t), L"%1$d", "target_layer: %d", target_layer + 1 + 1);
+  mo_snprintf_wchar(buf, sizeof(buf) / sizeof(wchar_t), L"%1$d", "target_layer: %d", target + 1);
   OutputDebugStringW(buf);
 #endif
   if (found_target) {
-    *found_target = target_layer + 1;
+    *found_target = target;
   }
-cleanup:
-  return err;
+  return eok();
 }
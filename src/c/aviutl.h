@@ -38,6 +38,8 @@ NODISCARD error aviutl_exit(void);
 NODISCARD error aviutl_get_patch(enum aviutl_patched *const patched);
 NODISCARD HWND aviutl_get_my_window(void);
 
+struct layerindex;
+
 NODISCARD error aviutl_drop_exo(char const *const exo_path, int frame, int layer, int frames);
 NODISCARD error aviutl_find_space(int start_frame,
                                   int end_frame,
@@ -45,3 +47,11 @@ NODISCARD error aviutl_find_space(int start_frame,
                                   int const search_offset,
                                   bool const last,
                                   int *const found_target);
+NODISCARD error aviutl_find_space_in_index(struct layerindex const *const li,
+                                           int start_frame,
+                                           int end_frame,
+                                           int const required_spaces,
+                                           int const search_offset,
+                                           bool const last,
+                                           int *const found_target);
+NODISCARD error aviutl_create_layerindex(struct layerindex **const lipp);
@@ -4,52 +4,7 @@
 
 #include "i18n.h"
 #include "jsoncommon.h"
-
-static NODISCARD error wide_to_utf8(wchar_t const *const src, char **const dest) {
-  if (!src || !dest) {
-    return errg(err_invalid_arugment);
-  }
-  error err = eok();
-  size_t const slen = wcslen(src);
-  int const dlen = slen == 0 ? 0 : WideCharToMultiByte(CP_UTF8, 0, src, (int)slen, NULL, 0, NULL, NULL);
-  err = OV_ARRAY_GROW(dest, (size_t)(dlen + 1));
-  if (efailed(err)) {
-    err = ethru(err);
-    goto cleanup;
-  }
-  if (slen != 0) {
-    if (WideCharToMultiByte(CP_UTF8, 0, src, (int)slen, *dest, dlen, NULL, NULL) == 0) {
-      err = errhr(HRESULT_FROM_WIN32(GetLastError()));
-      goto cleanup;
-    }
-  }
-  (*dest)[dlen] = '\0';
-cleanup:
-  return err;
-}
-
-static NODISCARD error utf8_to_wide(char const *const src, wchar_t **const dest) {
-  if (!src || !dest) {
-    return errg(err_invalid_arugment);
-  }
-  error err = eok();
-  size_t const slen = strlen(src);
-  int const dlen = slen == 0 ? 0 : MultiByteToWideChar(CP_UTF8, 0, src, (int)slen, NULL, 0);
-  err = OV_ARRAY_GROW(dest, (size_t)(dlen + 1));
-  if (efailed(err)) {
-    err = ethru(err);
-    goto cleanup;
-  }
-  if (slen != 0) {
-    if (MultiByteToWideChar(CP_UTF8, 0, src, (int)slen, *dest, dlen) == 0) {
-      err = errhr(HRESULT_FROM_WIN32(GetLastError()));
-      goto cleanup;
-    }
-  }
-  (*dest)[dlen] = L'\0';
-cleanup:
-  return err;
-}
+#include "strutil.h"
 
 struct config {
   wchar_t *whisper_path;
@@ -59,8 +14,17 @@ struct config {
   wchar_t *initial_prompt;
   wchar_t *model_dir;
   wchar_t *additional_args;
+  wchar_t *artifact_dir;
   int insert_position;
   int insert_mode;
+  int sidecar_formats;
+  int reflow_max_width;
+  int reflow_max_duration;
+  int reflow_min_duration;
+  int reflow_min_gap;
+  int reflow_max_merge_gap;
+  int exo_chunk_objects;
+  int artifact_max_size;
 };
 
 NODISCARD error config_create(struct config **const cfgpp) {
@@ -95,6 +59,7 @@ void config_destroy(struct config **const cfgpp) {
   OV_ARRAY_DESTROY(&cfg->initial_prompt);
   OV_ARRAY_DESTROY(&cfg->model_dir);
   OV_ARRAY_DESTROY(&cfg->additional_args);
+  OV_ARRAY_DESTROY(&cfg->artifact_dir);
   ereport(mem_free(cfgpp));
 }
 
@@ -114,8 +79,17 @@ void config_reset(struct config *const cfg) {
   DEFINE_RESET_STRING_PROPERTY(initial_prompt)
   DEFINE_RESET_STRING_PROPERTY(model_dir)
   DEFINE_RESET_STRING_PROPERTY(additional_args)
+  DEFINE_RESET_STRING_PROPERTY(artifact_dir)
   DEFINE_RESET_INT_PROPERTY(insert_position)
   DEFINE_RESET_INT_PROPERTY(insert_mode)
+  DEFINE_RESET_INT_PROPERTY(sidecar_formats)
+  DEFINE_RESET_INT_PROPERTY(reflow_max_width)
+  DEFINE_RESET_INT_PROPERTY(reflow_max_duration)
+  DEFINE_RESET_INT_PROPERTY(reflow_min_duration)
+  DEFINE_RESET_INT_PROPERTY(reflow_min_gap)
+  DEFINE_RESET_INT_PROPERTY(reflow_max_merge_gap)
+  DEFINE_RESET_INT_PROPERTY(exo_chunk_objects)
+  DEFINE_RESET_INT_PROPERTY(artifact_max_size)
 #undef DEFINE_RESET_STRING_PROPERTY
 #undef DEFINE_RESET_INT_PROPERTY
 }
@@ -127,9 +101,15 @@ NODISCARD error config_load(struct config *const cfg, char const *const buf, siz
   error err = eok();
   wchar_t *s = NULL;
   struct yyjson_doc *doc = NULL;
+  struct jsoncommon_arena arena = {0};
 
+  err = jsoncommon_arena_init(&arena, buflen, 0);
+  if (efailed(err)) {
+    err = ethru(err);
+    goto cleanup;
+  }
   struct yyjson_read_err read_err;
-  doc = yyjson_read_opts(ov_deconster_(buf), buflen, 0, jsoncommon_get_json_alc(), &read_err);
+  doc = yyjson_read_opts(ov_deconster_(buf), buflen, 0, &arena.alc, &read_err);
   if (!doc) {
     err = emsg_i18nf(err_type_generic,
                      err_fail,
@@ -150,7 +130,7 @@ NODISCARD error config_load(struct config *const cfg, char const *const buf, siz
   {                                                                                                                    \
     struct yyjson_val *const v = yyjson_obj_get(root, #NAME);                                                          \
     if (v && yyjson_is_str(v)) {                                                                                       \
-      err = utf8_to_wide(yyjson_get_str(v), &s);                                                                       \
+      err = strutil_utf8_to_wide(yyjson_get_str(v), &s);                                                               \
       if (efailed(err)) {                                                                                              \
         err = ethru(err);                                                                                              \
         goto cleanup;                                                                                                  \
@@ -181,8 +161,17 @@ NODISCARD error config_load(struct config *const cfg, char const *const buf, siz
   GET_STRING_PROPERTY(initial_prompt)
   GET_STRING_PROPERTY(model_dir)
   GET_STRING_PROPERTY(additional_args)
+  GET_STRING_PROPERTY(artifact_dir)
   GET_INT_PROPERTY(insert_position)
   GET_INT_PROPERTY(insert_mode)
+  GET_INT_PROPERTY(sidecar_formats)
+  GET_INT_PROPERTY(reflow_max_width)
+  GET_INT_PROPERTY(reflow_max_duration)
+  GET_INT_PROPERTY(reflow_min_duration)
+  GET_INT_PROPERTY(reflow_min_gap)
+  GET_INT_PROPERTY(reflow_max_merge_gap)
+  GET_INT_PROPERTY(exo_chunk_objects)
+  GET_INT_PROPERTY(artifact_max_size)
 #undef GET_STRING_PROPERTY
 #undef GET_INT_PROPERTY
 
@@ -192,6 +181,7 @@ cleanup:
     yyjson_doc_free(doc);
     doc = NULL;
   }
+  jsoncommon_arena_destroy(&arena);
   return err;
 }
 
@@ -267,7 +257,7 @@ NODISCARD error config_save(struct config *const cfg, char **const buf, size_t *
   yyjson_mut_doc_set_root(doc, root);
 
 #define ADD_STRING_PROPERTY(NAME)                                                                                      \
-  err = wide_to_utf8(config_get_##NAME(cfg), &s);                                                                      \
+  err = strutil_wide_to_utf8(config_get_##NAME(cfg), &s);                                                              \
   if (efailed(err)) {                                                                                                  \
     err = ethru(err);                                                                                                  \
     goto cleanup;                                                                                                      \
@@ -282,8 +272,17 @@ NODISCARD error config_save(struct config *const cfg, char **const buf, size_t *
   ADD_STRING_PROPERTY(initial_prompt)
   ADD_STRING_PROPERTY(model_dir)
   ADD_STRING_PROPERTY(additional_args)
+  ADD_STRING_PROPERTY(artifact_dir)
   ADD_INT_PROPERTY(insert_position)
   ADD_INT_PROPERTY(insert_mode)
+  ADD_INT_PROPERTY(sidecar_formats)
+  ADD_INT_PROPERTY(reflow_max_width)
+  ADD_INT_PROPERTY(reflow_max_duration)
+  ADD_INT_PROPERTY(reflow_min_duration)
+  ADD_INT_PROPERTY(reflow_min_gap)
+  ADD_INT_PROPERTY(reflow_max_merge_gap)
+  ADD_INT_PROPERTY(exo_chunk_objects)
+  ADD_INT_PROPERTY(artifact_max_size)
 #undef ADD_STRING_PROPERTY
 #undef ADD_INT_PROPERTY
 
@@ -429,7 +428,16 @@ DEFINE_STRING_PROPERTY(module, L"text")
 DEFINE_STRING_PROPERTY(initial_prompt, L"")
 DEFINE_STRING_PROPERTY(model_dir, L"")
 DEFINE_STRING_PROPERTY(additional_args, L"")
+DEFINE_STRING_PROPERTY(artifact_dir, L"")
 DEFINE_INT_PROPERTY(insert_position, 1)
 DEFINE_INT_PROPERTY(insert_mode, 1)
+DEFINE_INT_PROPERTY(sidecar_formats, 0)
+DEFINE_INT_PROPERTY(reflow_max_width, 0)
+DEFINE_INT_PROPERTY(reflow_max_duration, 0)
+DEFINE_INT_PROPERTY(reflow_min_duration, 0)
+DEFINE_INT_PROPERTY(reflow_min_gap, 0)
+DEFINE_INT_PROPERTY(reflow_max_merge_gap, 0)
+DEFINE_INT_PROPERTY(exo_chunk_objects, 0)
+DEFINE_INT_PROPERTY(artifact_max_size, 0)
 #undef DEFINE_STRING_PROPERTY
 #undef DEFINE_INT_PROPERTY
@@ -30,7 +30,16 @@ DEFINE_STRING_PROPERTY(module)
 DEFINE_STRING_PROPERTY(initial_prompt)
 DEFINE_STRING_PROPERTY(model_dir)
 DEFINE_STRING_PROPERTY(additional_args)
+DEFINE_STRING_PROPERTY(artifact_dir)
 DEFINE_INT_PROPERTY(insert_position)
 DEFINE_INT_PROPERTY(insert_mode)
+DEFINE_INT_PROPERTY(sidecar_formats)
+DEFINE_INT_PROPERTY(reflow_max_width)
+DEFINE_INT_PROPERTY(reflow_max_duration)
+DEFINE_INT_PROPERTY(reflow_min_duration)
+DEFINE_INT_PROPERTY(reflow_min_gap)
+DEFINE_INT_PROPERTY(reflow_max_merge_gap)
+DEFINE_INT_PROPERTY(exo_chunk_objects)
+DEFINE_INT_PROPERTY(artifact_max_size)
 #undef DEFINE_STRING_PROPERTY
 #undef DEFINE_INT_PROPERTY
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <ovbase.h>
+
+// Internal structures of exedit.auf 0.92, shared by aviutl.c and the code that works on the timeline.
+
+enum {
+  layer_length = 100,
+  display_name_length = 64,
+  filter_length = 12,
+  track_length = 64,
+  check_length = 48,
+};
+
+struct exedit_object {
+  uint32_t flag;
+  int32_t layer_disp; // 表示レイヤー、別シーン表示中は-1
+  int32_t frame_begin;
+  int32_t frame_end;
+  char display_name[display_name_length]; // タイムライン上の表示名(最初のバイトがヌル文字の場合はデフォルト名が表示)
+  int32_t
+      index_midpt_leader; // 中間点を持つオブジェクトの構成要素の場合、先頭オブジェクトのインデックス、中間点を持たないなら-1
+  struct filter_param {
+    int32_t id;
+    int16_t track_begin; // このフィルタの先頭のトラックバー番号
+    int16_t check_begin;
+    uint32_t exdata_offset;
+  } filter_param[filter_length];
+  uint8_t filter_status[filter_length];
+  int16_t track_sum;
+  int16_t check_sum;
+  uint32_t exdata_sum;
+  int32_t track_value_left[track_length];
+  int32_t track_value_right[track_length];
+  struct track_mode {
+    int16_t num;
+    int16_t script_num;
+  } track_mode[track_length];
+  int32_t check_value[check_length];
+  uint32_t exdata_offset;
+  int32_t group_belong;
+  int32_t track_param[track_length];
+  int32_t layer_set;
+  int32_t scene_set;
+};
@@ -0,0 +1,360 @@
+#include "exobuilder.h"
+
+#include <ovarray.h>
+
+#include <limits.h>
+#include <string.h>
+
+#include "i18n.h"
+
+struct section {
+  size_t offset;
+  size_t header_len;
+  int object;
+  int filter; // -1 for the object section itself
+};
+
+struct exobuilder {
+  char *buf;
+  size_t len;
+  size_t cap;
+  struct section *sections;
+  size_t sections_cap;
+  int current_object;
+  int num_filters;
+  struct exobuilder_stats stats;
+};
+
+static NODISCARD error reserve(struct exobuilder *const eb, size_t const n) {
+  size_t const required = eb->len + n + 1;
+  if (required <= eb->cap) {
+    return eok();
+  }
+  size_t cap = eb->cap ? eb->cap : 4096;
+  while (cap < required) {
+    cap *= 2;
+  }
+  error err = OV_ARRAY_GROW(&eb->buf, cap);
+  if (efailed(err)) {
+    return ethru(err);
+  }
+  eb->cap = cap;
+  return eok();
+}
+
+static void put(struct exobuilder *const eb, char const *const s, size_t const len) {
+  memcpy(eb->buf + eb->len, s, len);
+  eb->len += len;
+}
+
+static void put_int(struct exobuilder *const eb, int const v) {
+  char tmp[16];
+  size_t n = 0;
+  unsigned int u = v < 0 ? 0u - (unsigned int)v : (unsigned int)v;
+  do {
+    tmp[n++] = (char)('0' + u % 10);
+    u /= 10;
+  } while (u);
+  if (v < 0) {
+    eb->buf[eb->len++] = '-';
+  }
+  while (n) {
+    eb->buf[eb->len++] = tmp[--n];
+  }
+}
+
+#define PUT_LITERAL(eb, s) put((eb), (s), sizeof(s) - 1)
+
+/**
+ * Writes "[object]" or "[object.filter]" and records where it is.
+ * The caller must have reserved enough space.
+ */
+static NODISCARD error put_section(struct exobuilder *const eb, int const object, int const filter) {
+  size_t const n = OV_ARRAY_LENGTH(eb->sections);
+  if (n == eb->sections_cap) {
+    size_t const cap = eb->sections_cap ? eb->sections_cap * 2 : 256;
+    error err = OV_ARRAY_GROW(&eb->sections, cap);
+    if (efailed(err)) {
+      return ethru(err);
+    }
+    eb->sections_cap = cap;
+  }
+  size_t const offset = eb->len;
+  PUT_LITERAL(eb, "[");
+  put_int(eb, object);
+  if (filter >= 0) {
+    PUT_LITERAL(eb, ".");
+    put_int(eb, filter);
+  }
+  PUT_LITERAL(eb, "]\r\n");
+  eb->sections[n] = (struct section){
+      .offset = offset,
+      .header_len = eb->len - offset,
+      .object = object,
+      .filter = filter,
+  };
+  OV_ARRAY_SET_LENGTH(eb->sections, n + 1);
+  return eok();
+}
+
+static void terminate(struct exobuilder *const eb) {
+  eb->buf[eb->len] = '\0';
+  OV_ARRAY_SET_LENGTH(eb->buf, eb->len);
+}
+
+NODISCARD error exobuilder_create(struct exobuilder **const ebpp) {
+  if (!ebpp || *ebpp) {
+    return errg(err_invalid_arugment);
+  }
+  struct exobuilder *eb = NULL;
+  error err = mem(&eb, 1, sizeof(struct exobuilder));
+  if (efailed(err)) {
+    err = ethru(err);
+    goto cleanup;
+  }
+  *eb = (struct exobuilder){0};
+  exobuilder_reset(eb);
+  *ebpp = eb;
+  eb = NULL;
+cleanup:
+  if (eb) {
+    exobuilder_destroy(&eb);
+  }
+  return err;
+}
+
+void exobuilder_destroy(struct exobuilder **const ebpp) {
+  if (!ebpp || !*ebpp) {
+    return;
+  }
+  struct exobuilder *eb = *ebpp;
+  OV_ARRAY_DESTROY(&eb->buf);
+  OV_ARRAY_DESTROY(&eb->sections);
+  ereport(mem_free(ebpp));
+}
+
+void exobuilder_reset(struct exobuilder *const eb) {
+  if (!eb) {
+    return;
+  }
+  eb->len = 0;
+  if (eb->buf) {
+    terminate(eb);
+  }
+  if (eb->sections) {
+    OV_ARRAY_SET_LENGTH(eb->sections, 0);
+  }
+  eb->current_object = -1;
+  eb->num_filters = 0;
+  eb->stats = (struct exobuilder_stats){
+      .num_objects = 0,
+      .layer_min = INT_MAX,
+      .layer_max = INT_MIN,
+      .frames = INT_MIN,
+  };
+}
+
+NODISCARD error exobuilder_header(struct exobuilder *const eb, struct exobuilder_header const *const header) {
+  if (!eb || !header) {
+    return errg(err_invalid_arugment);
+  }
+  error err = reserve(eb, 128 + 7 * 11);
+  if (efailed(err)) {
+    return ethru(err);
+  }
+  PUT_LITERAL(eb, "[exedit]\r\nwidth=");
+  put_int(eb, header->width);
+  PUT_LITERAL(eb, "\r\nheight=");
+  put_int(eb, header->height);
+  PUT_LITERAL(eb, "\r\nrate=");
+  put_int(eb, header->rate);
+  PUT_LITERAL(eb, "\r\nscale=");
+  put_int(eb, header->scale);
+  PUT_LITERAL(eb, "\r\nlength=");
+  put_int(eb, header->length);
+  PUT_LITERAL(eb, "\r\naudio_rate=");
+  put_int(eb, header->audio_rate);
+  PUT_LITERAL(eb, "\r\naudio_ch=");
+  put_int(eb, header->audio_ch);
+  PUT_LITERAL(eb, "\r\n");
+  terminate(eb);
+  if (header->length > eb->stats.frames) {
+    eb->stats.frames = header->length;
+  }
+  return eok();
+}
+
+NODISCARD error exobuilder_object(struct exobuilder *const eb,
+                                  struct exobuilder_object const *const obj,
+                                  int *const index) {
+  if (!eb || !obj) {
+    return errg(err_invalid_arugment);
+  }
+  error err = reserve(eb, 128 + 10 * 11);
+  if (efailed(err)) {
+    return ethru(err);
+  }
+  int const idx = eb->stats.num_objects;
+  err = put_section(eb, idx, -1);
+  if (efailed(err)) {
+    return ethru(err);
+  }
+  PUT_LITERAL(eb, "start=");
+  put_int(eb, obj->start);
+  PUT_LITERAL(eb, "\r\nend=");
+  put_int(eb, obj->end);
+  PUT_LITERAL(eb, "\r\nlayer=");
+  put_int(eb, obj->layer);
+  PUT_LITERAL(eb, "\r\n");
+#define PUT_OPTIONAL(NAME)                                                                                             \
+  if (obj->NAME >= 0) {                                                                                                \
+    PUT_LITERAL(eb, #NAME "=");                                                                                        \
+    put_int(eb, obj->NAME);                                                                                            \
+    PUT_LITERAL(eb, "\r\n");                                                                                           \
+  }
+  PUT_OPTIONAL(group)
+  PUT_OPTIONAL(overlay)
+  PUT_OPTIONAL(clipping)
+  PUT_OPTIONAL(camera)
+  PUT_OPTIONAL(chain)
+  PUT_OPTIONAL(audio)
+#undef PUT_OPTIONAL
+  terminate(eb);
+
+  eb->current_object = idx;
+  eb->num_filters = 0;
+  ++eb->stats.num_objects;
+  if (obj->layer < eb->stats.layer_min) {
+    eb->stats.layer_min = obj->layer;
+  }
+  if (obj->layer > eb->stats.layer_max) {
+    eb->stats.layer_max = obj->layer;
+  }
+  if (obj->end > eb->stats.frames) {
+    eb->stats.frames = obj->end;
+  }
+  if (index) {
+    *index = idx;
+  }
+  return eok();
+}
+
+NODISCARD error exobuilder_filter(struct exobuilder *const eb, char const *const name, size_t const name_len) {
+  if (!eb || !name) {
+    return errg(err_invalid_arugment);
+  }
+  if (eb->current_object < 0) {
+    return emsg_i18n(err_type_generic, err_fail, gettext("No object has been written yet."));
+  }
+  error err = reserve(eb, 32 + 2 * 11 + name_len);
+  if (efailed(err)) {
+    return ethru(err);
+  }
+  err = put_section(eb, eb->current_object, eb->num_filters);
+  if (efailed(err)) {
+    return ethru(err);
+  }
+  PUT_LITERAL(eb, "_name=");
+  put(eb, name, name_len);
+  PUT_LITERAL(eb, "\r\n");
+  terminate(eb);
+  ++eb->num_filters;
+  return eok();
+}
+
+NODISCARD error exobuilder_item(struct exobuilder *const eb,
+                                char const *const key,
+                                size_t const key_len,
+                                char const *const value,
+                                size_t const value_len) {
+  if (!eb || !key || !value) {
+    return errg(err_invalid_arugment);
+  }
+  error err = reserve(eb, key_len + value_len + 3);
+  if (efailed(err)) {
+    return ethru(err);
+  }
+  put(eb, key, key_len);
+  PUT_LITERAL(eb, "=");
+  put(eb, value, value_len);
+  PUT_LITERAL(eb, "\r\n");
+  terminate(eb);
+  return eok();
+}
+
+NODISCARD error exobuilder_raw(struct exobuilder *const eb, char const *const text, size_t const text_len) {
+  if (!eb || !text) {
+    return errg(err_invalid_arugment);
+  }
+  error err = reserve(eb, text_len);
+  if (efailed(err)) {
+    return ethru(err);
+  }
+  put(eb, text, text_len);
+  terminate(eb);
+  return eok();
+}
+
+NODISCARD error exobuilder_append(struct exobuilder *const eb, struct exobuilder const *const src) {
+  if (!eb || !src || eb == src) {
+    return errg(err_invalid_arugment);
+  }
+  size_t const n = OV_ARRAY_LENGTH(src->sections);
+  if (!n) {
+    return eok();
+  }
+  error err = eok();
+  int const base = eb->stats.num_objects;
+  for (size_t i = 0; i < n; ++i) {
+    struct section const *const sec = &src->sections[i];
+    size_t const body = sec->offset + sec->header_len;
+    size_t const body_len = (i + 1 < n ? src->sections[i + 1].offset : src->len) - body;
+    err = reserve(eb, 32 + body_len);
+    if (efailed(err)) {
+      return ethru(err);
+    }
+    err = put_section(eb, base + sec->object, sec->filter);
+    if (efailed(err)) {
+      return ethru(err);
+    }
+    put(eb, src->buf + body, body_len);
+  }
+  terminate(eb);
+
+  struct exobuilder_stats const *const st = &src->stats;
+  eb->stats.num_objects += st->num_objects;
+  if (st->layer_min < eb->stats.layer_min) {
+    eb->stats.layer_min = st->layer_min;
+  }
+  if (st->layer_max > eb->stats.layer_max) {
+    eb->stats.layer_max = st->layer_max;
+  }
+  if (st->frames > eb->stats.frames) {
+    eb->stats.frames = st->frames;
+  }
+  if (src->current_object >= 0) {
+    eb->current_object = base + src->current_object;
+    eb->num_filters = src->num_filters;
+  }
+  return eok();
+}
+
+char const *exobuilder_get(struct exobuilder const *const eb, size_t *const len) {
+  if (!eb || !eb->len) {
+    if (len) {
+      *len = 0;
+    }
+    return NULL;
+  }
+  if (len) {
+    *len = eb->len;
+  }
+  return eb->buf;
+}
+
+void exobuilder_get_stats(struct exobuilder const *const eb, struct exobuilder_stats *const stats) {
+  if (!eb || !stats) {
+    return;
+  }
+  *stats = eb->stats;
+}
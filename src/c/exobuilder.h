@@ -0,0 +1,104 @@
+#pragma once
+
+#include <ovbase.h>
+
+struct exobuilder;
+
+/**
+ * @brief Statistics collected while building an *.exo.
+ */
+struct exobuilder_stats {
+  int num_objects; /**< Number of objects written. */
+  int layer_min;   /**< Minimum layer index, INT_MAX if no objects. */
+  int layer_max;   /**< Maximum layer index, INT_MIN if no objects. */
+  int frames;      /**< Maximum of the header length and every object end frame, INT_MIN if nothing is written. */
+};
+
+/**
+ * @brief Values written to the [exedit] section.
+ */
+struct exobuilder_header {
+  int width;
+  int height;
+  int rate;
+  int scale;
+  int length;
+  int audio_rate;
+  int audio_ch;
+};
+
+/**
+ * @brief Optional values written to an object section.
+ *
+ * Negative values are not written.
+ */
+struct exobuilder_object {
+  int start;
+  int end;
+  int layer;
+  int group;
+  int overlay;
+  int clipping;
+  int camera;
+  int chain;
+  int audio;
+};
+
+NODISCARD error exobuilder_create(struct exobuilder **const ebpp);
+void exobuilder_destroy(struct exobuilder **const ebpp);
+void exobuilder_reset(struct exobuilder *const eb);
+
+NODISCARD error exobuilder_header(struct exobuilder *const eb, struct exobuilder_header const *const header);
+
+/**
+ * @brief Starts a new object section.
+ *
+ * Writes "[N]" followed by the object values, where N is the number of objects written so far.
+ * @param eb The builder.
+ * @param obj Object values.
+ * @param index Receives the index of the new object. Can be NULL.
+ */
+NODISCARD error exobuilder_object(struct exobuilder *const eb,
+                                  struct exobuilder_object const *const obj,
+                                  int *const index);
+
+/**
+ * @brief Starts a new filter section in the current object.
+ *
+ * Writes "[N.M]" and "_name=name", where M is the number of filters written to the current object so far.
+ */
+NODISCARD error exobuilder_filter(struct exobuilder *const eb, char const *const name, size_t const name_len);
+
+/**
+ * @brief Writes "key=value" to the current section.
+ */
+NODISCARD error exobuilder_item(struct exobuilder *const eb,
+                                char const *const key,
+                                size_t const key_len,
+                                char const *const value,
+                                size_t const value_len);
+
+/**
+ * @brief Writes the given text as is.
+ *
+ * The text is not inspected, so it is not reflected in the statistics.
+ */
+NODISCARD error exobuilder_raw(struct exobuilder *const eb, char const *const text, size_t const text_len);
+
+/**
+ * @brief Appends the objects written to another builder.
+ *
+ * Objects are renumbered to follow the objects already written to eb.
+ * Anything written to src before its first object, such as the [exedit] section, is skipped.
+ * Text written by exobuilder_raw is copied as is, so it must not contain section headers.
+ */
+NODISCARD error exobuilder_append(struct exobuilder *const eb, struct exobuilder const *const src);
+
+/**
+ * @brief Returns the UTF-8 encoded *.exo written so far.
+ * @param eb The builder.
+ * @param len Receives the length of the returned string.
+ * @return The NUL terminated string, or NULL if nothing has been written.
+ */
+char const *exobuilder_get(struct exobuilder const *const eb, size_t *const len);
+void exobuilder_get_stats(struct exobuilder const *const eb, struct exobuilder_stats *const stats);
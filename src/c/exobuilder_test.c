@@ -0,0 +1,237 @@
+#include <ovtest.h>
+
+#include <limits.h>
+#include <string.h>
+
+#include "exobuilder.h"
+
+static void test_exobuilder_empty(void) {
+  struct exobuilder *eb = NULL;
+  if (!TEST_SUCCEEDED_F(exobuilder_create(&eb))) {
+    return;
+  }
+  size_t len = 1;
+  TEST_CHECK(exobuilder_get(eb, &len) == NULL);
+  TEST_CHECK(len == 0);
+  struct exobuilder_stats stats;
+  exobuilder_get_stats(eb, &stats);
+  TEST_CHECK(stats.num_objects == 0);
+  TEST_CHECK(stats.layer_min == INT_MAX);
+  TEST_CHECK(stats.layer_max == INT_MIN);
+  TEST_EISG_F(exobuilder_filter(eb, "x", 1), err_fail);
+  exobuilder_destroy(&eb);
+  TEST_CHECK(eb == NULL);
+}
+
+static void test_exobuilder_build(void) {
+  static char const golden[] = "[exedit]\r\n"
+                               "width=1920\r\n"
+                               "height=1080\r\n"
+                               "rate=30\r\n"
+                               "scale=1\r\n"
+                               "length=100\r\n"
+                               "audio_rate=48000\r\n"
+                               "audio_ch=2\r\n"
+                               "[0]\r\n"
+                               "start=1\r\n"
+                               "end=30\r\n"
+                               "layer=3\r\n"
+                               "group=1\r\n"
+                               "overlay=1\r\n"
+                               "camera=0\r\n"
+                               "[0.0]\r\n"
+                               "_name=a\r\n"
+                               "k=v\r\n"
+                               "text=xyz\r\n"
+                               "[0.1]\r\n"
+                               "_name=b\r\n"
+                               "[1]\r\n"
+                               "start=31\r\n"
+                               "end=250\r\n"
+                               "layer=-1\r\n"
+                               "[1.0]\r\n"
+                               "_name=c\r\n";
+  struct exobuilder *eb = NULL;
+  if (!TEST_SUCCEEDED_F(exobuilder_create(&eb))) {
+    return;
+  }
+  int idx = -1;
+  TEST_SUCCEEDED_F(exobuilder_header(eb,
+                                     &(struct exobuilder_header){
+                                         .width = 1920,
+                                         .height = 1080,
+                                         .rate = 30,
+                                         .scale = 1,
+                                         .length = 100,
+                                         .audio_rate = 48000,
+                                         .audio_ch = 2,
+                                     }));
+  TEST_SUCCEEDED_F(exobuilder_object(eb,
+                                     &(struct exobuilder_object){
+                                         .start = 1,
+                                         .end = 30,
+                                         .layer = 3,
+                                         .group = 1,
+                                         .overlay = 1,
+                                         .clipping = -1,
+                                         .camera = 0,
+                                         .chain = -1,
+                                         .audio = -1,
+                                     },
+                                     &idx));
+  TEST_CHECK(idx == 0);
+  TEST_SUCCEEDED_F(exobuilder_filter(eb, "a", 1));
+  TEST_SUCCEEDED_F(exobuilder_item(eb, "k", 1, "v", 1));
+  TEST_SUCCEEDED_F(exobuilder_raw(eb, "text=xyz\r\n", 10));
+  TEST_SUCCEEDED_F(exobuilder_filter(eb, "b", 1));
+  TEST_SUCCEEDED_F(exobuilder_object(eb,
+                                     &(struct exobuilder_object){
+                                         .start = 31,
+                                         .end = 250,
+                                         .layer = -1,
+                                         .group = -1,
+                                         .overlay = -1,
+                                         .clipping = -1,
+                                         .camera = -1,
+                                         .chain = -1,
+                                         .audio = -1,
+                                     },
+                                     &idx));
+  TEST_CHECK(idx == 1);
+  TEST_SUCCEEDED_F(exobuilder_filter(eb, "c", 1));
+
+  size_t len = 0;
+  char const *const exo = exobuilder_get(eb, &len);
+  TEST_CHECK(exo != NULL);
+  TEST_CHECK(len == sizeof(golden) - 1);
+  TEST_CHECK(exo && strcmp(exo, golden) == 0);
+  TEST_MSG("got: %s", exo);
+
+  struct exobuilder_stats stats;
+  exobuilder_get_stats(eb, &stats);
+  TEST_CHECK(stats.num_objects == 2);
+  TEST_CHECK(stats.layer_min == -1);
+  TEST_CHECK(stats.layer_max == 3);
+  TEST_CHECK(stats.frames == 250);
+
+  exobuilder_reset(eb);
+  TEST_CHECK(exobuilder_get(eb, &len) == NULL);
+  exobuilder_get_stats(eb, &stats);
+  TEST_CHECK(stats.num_objects == 0);
+  exobuilder_destroy(&eb);
+}
+
+static void test_exobuilder_grow(void) {
+  struct exobuilder *eb = NULL;
+  if (!TEST_SUCCEEDED_F(exobuilder_create(&eb))) {
+    return;
+  }
+  char value[1000];
+  memset(value, 'a', sizeof(value));
+  for (int i = 0; i < 1000; ++i) {
+    struct exobuilder_object const obj = {
+        .start = i * 10 + 1,
+        .end = i * 10 + 10,
+        .layer = i % 7 + 1,
+        .group = -1,
+        .overlay = -1,
+        .clipping = -1,
+        .camera = -1,
+        .chain = -1,
+        .audio = -1,
+    };
+    if (!TEST_SUCCEEDED_F(exobuilder_object(eb, &obj, NULL)) ||
+        !TEST_SUCCEEDED_F(exobuilder_filter(eb, "f", 1)) ||
+        !TEST_SUCCEEDED_F(exobuilder_item(eb, "v", 1, value, sizeof(value)))) {
+      goto cleanup;
+    }
+  }
+  size_t len = 0;
+  char const *const exo = exobuilder_get(eb, &len);
+  TEST_CHECK(exo != NULL);
+  TEST_CHECK(len > 1000 * sizeof(value));
+  TEST_CHECK(exo && strlen(exo) == len);
+  struct exobuilder_stats stats;
+  exobuilder_get_stats(eb, &stats);
+  TEST_CHECK(stats.num_objects == 1000);
+  TEST_CHECK(stats.layer_min == 1);
+  TEST_CHECK(stats.layer_max == 7);
+  TEST_CHECK(stats.frames == 9999 + 1);
+cleanup:
+  exobuilder_destroy(&eb);
+}
+
+static void test_exobuilder_append(void) {
+  static char const golden[] = "[exedit]\r\n"
+                               "width=1\r\n"
+                               "height=1\r\n"
+                               "rate=1\r\n"
+                               "scale=1\r\n"
+                               "length=1\r\n"
+                               "audio_rate=1\r\n"
+                               "audio_ch=1\r\n"
+                               "[0]\r\n"
+                               "start=1\r\n"
+                               "end=2\r\n"
+                               "layer=1\r\n"
+                               "[0.0]\r\n"
+                               "_name=a\r\n"
+                               "[1]\r\n"
+                               "start=3\r\n"
+                               "end=4\r\n"
+                               "layer=5\r\n"
+                               "[1.0]\r\n"
+                               "_name=b\r\n"
+                               "k=v\r\n"
+                               "[1.1]\r\n"
+                               "_name=c\r\n"
+                               "[2]\r\n"
+                               "start=5\r\n"
+                               "end=60\r\n"
+                               "layer=2\r\n";
+  struct exobuilder_header const header = {1, 1, 1, 1, 1, 1, 1};
+  struct exobuilder *dst = NULL;
+  struct exobuilder *src = NULL;
+  if (!TEST_SUCCEEDED_F(exobuilder_create(&dst)) || !TEST_SUCCEEDED_F(exobuilder_create(&src))) {
+    goto cleanup;
+  }
+  TEST_SUCCEEDED_F(exobuilder_header(dst, &header));
+  TEST_SUCCEEDED_F(exobuilder_object(dst, &(struct exobuilder_object){1, 2, 1, -1, -1, -1, -1, -1, -1}, NULL));
+  TEST_SUCCEEDED_F(exobuilder_filter(dst, "a", 1));
+
+  TEST_SUCCEEDED_F(exobuilder_header(src, &header));
+  TEST_SUCCEEDED_F(exobuilder_object(src, &(struct exobuilder_object){3, 4, 5, -1, -1, -1, -1, -1, -1}, NULL));
+  TEST_SUCCEEDED_F(exobuilder_filter(src, "b", 1));
+  TEST_SUCCEEDED_F(exobuilder_item(src, "k", 1, "v", 1));
+  TEST_SUCCEEDED_F(exobuilder_filter(src, "c", 1));
+  TEST_SUCCEEDED_F(exobuilder_object(src, &(struct exobuilder_object){5, 60, 2, -1, -1, -1, -1, -1, -1}, NULL));
+
+  TEST_SUCCEEDED_F(exobuilder_append(dst, src));
+  size_t len = 0;
+  char const *exo = exobuilder_get(dst, &len);
+  TEST_CHECK(exo && strcmp(exo, golden) == 0);
+  TEST_MSG("got: %s", exo);
+
+  struct exobuilder_stats stats;
+  exobuilder_get_stats(dst, &stats);
+  TEST_CHECK(stats.num_objects == 3);
+  TEST_CHECK(stats.layer_min == 1);
+  TEST_CHECK(stats.layer_max == 5);
+  TEST_CHECK(stats.frames == 60);
+
+  // Filters are added to the last appended object.
+  TEST_SUCCEEDED_F(exobuilder_filter(dst, "d", 1));
+  exo = exobuilder_get(dst, &len);
+  TEST_CHECK(exo && strcmp(exo + sizeof(golden) - 1, "[2.0]\r\n_name=d\r\n") == 0);
+cleanup:
+  exobuilder_destroy(&src);
+  exobuilder_destroy(&dst);
+}
+
+TEST_LIST = {
+    {"test_exobuilder_empty", test_exobuilder_empty},
+    {"test_exobuilder_build", test_exobuilder_build},
+    {"test_exobuilder_grow", test_exobuilder_grow},
+    {"test_exobuilder_append", test_exobuilder_append},
+    {NULL, NULL},
+};
@@ -0,0 +1,324 @@
+#include "exochunk.h"
+
+#include <ovarray.h>
+
+#include <stdlib.h>
+#include <string.h>
+
+enum section_type {
+  section_none,
+  section_other,
+  section_object,
+  section_filter,
+};
+
+struct object {
+  size_t begin; // offset of the "[N]" line
+  size_t end;   // offset of the line after the last line of the object
+  int start;
+  bool chain;
+};
+
+struct unit {
+  size_t first; // index of the first object, also used to keep the order of units with the same start
+  size_t count;
+  int start;
+};
+
+struct buffer {
+  char *ptr;
+  size_t len;
+  size_t cap;
+};
+
+static bool is_digit(char const c) { return c >= '0' && c <= '9'; }
+
+static size_t find_line_end(char const *const s, size_t const len, size_t pos) {
+  while (pos < len && s[pos] != '\n') {
+    ++pos;
+  }
+  return pos < len ? pos + 1 : pos;
+}
+
+/**
+ * Gets the type of the section header line and the position of "." in "[N.M]".
+ */
+static enum section_type
+get_section_type(char const *const line, size_t len, size_t *const dot, size_t *const close) {
+  while (len && (line[len - 1] == '\r' || line[len - 1] == '\n')) {
+    --len;
+  }
+  if (len < 3 || line[0] != '[' || line[len - 1] != ']') {
+    return section_none;
+  }
+  size_t pos = 1;
+  while (pos < len - 1 && is_digit(line[pos])) {
+    ++pos;
+  }
+  *close = len - 1;
+  if (pos == 1) {
+    return section_other;
+  }
+  if (pos == len - 1) {
+    return section_object;
+  }
+  if (line[pos] != '.') {
+    return section_other;
+  }
+  *dot = pos;
+  ++pos;
+  if (pos == len - 1) {
+    return section_other;
+  }
+  while (pos < len - 1 && is_digit(line[pos])) {
+    ++pos;
+  }
+  return pos == len - 1 ? section_filter : section_other;
+}
+
+static int parse_int(char const *s, size_t len) {
+  bool negative = false;
+  if (len && *s == '-') {
+    negative = true;
+    ++s;
+    --len;
+  }
+  int v = 0;
+  for (size_t i = 0; i < len && is_digit(s[i]) && v < INT_MAX / 10 - 1; ++i) {
+    v = v * 10 + (s[i] - '0');
+  }
+  return negative ? -v : v;
+}
+
+static bool has_key(char const *const line, size_t const len, char const *const key, size_t const key_len) {
+  return len > key_len && memcmp(line, key, key_len) == 0;
+}
+
+static NODISCARD error parse_objects(char const *const exo,
+                                     size_t const len,
+                                     size_t *const header_len,
+                                     struct object **const objects) {
+  size_t n = 0, cap = 0;
+  bool in_object = false;
+  *header_len = len;
+  for (size_t pos = 0; pos < len;) {
+    size_t const next = find_line_end(exo, len, pos);
+    char const *const line = exo + pos;
+    size_t const line_len = next - pos;
+    size_t dot = 0, close = 0;
+    enum section_type const type = get_section_type(line, line_len, &dot, &close);
+    if (type == section_object) {
+      if (n == cap) {
+        size_t const newcap = cap ? cap * 2 : 64;
+        error err = OV_ARRAY_GROW(objects, newcap);
+        if (efailed(err)) {
+          return ethru(err);
+        }
+        cap = newcap;
+      }
+      if (n) {
+        (*objects)[n - 1].end = pos;
+      } else {
+        *header_len = pos;
+      }
+      (*objects)[n++] = (struct object){.begin = pos, .end = len};
+      in_object = true;
+    } else if (type != section_none) {
+      in_object = false;
+    } else if (in_object) {
+      if (has_key(line, line_len, "start=", 6)) {
+        (*objects)[n - 1].start = parse_int(line + 6, line_len - 6);
+      } else if (has_key(line, line_len, "chain=", 6)) {
+        (*objects)[n - 1].chain = parse_int(line + 6, line_len - 6) != 0;
+      }
+    }
+    pos = next;
+  }
+  if (*objects) {
+    OV_ARRAY_SET_LENGTH(*objects, n);
+  }
+  return eok();
+}
+
+static int compare_unit(void const *const a, void const *const b) {
+  struct unit const *const ua = a;
+  struct unit const *const ub = b;
+  if (ua->start != ub->start) {
+    return ua->start < ub->start ? -1 : 1;
+  }
+  return ua->first < ub->first ? -1 : ua->first > ub->first ? 1 : 0;
+}
+
+static NODISCARD error append(struct buffer *const b, char const *const s, size_t const len) {
+  if (b->len + len + 1 > b->cap) {
+    size_t cap = b->cap ? b->cap : 4096;
+    while (cap < b->len + len + 1) {
+      cap *= 2;
+    }
+    error err = OV_ARRAY_GROW(&b->ptr, cap);
+    if (efailed(err)) {
+      return ethru(err);
+    }
+    b->cap = cap;
+  }
+  memcpy(b->ptr + b->len, s, len);
+  b->len += len;
+  b->ptr[b->len] = '\0';
+  return eok();
+}
+
+static NODISCARD error append_uint(struct buffer *const b, size_t v) {
+  char buf[32];
+  size_t pos = sizeof(buf);
+  do {
+    buf[--pos] = (char)('0' + v % 10);
+    v /= 10;
+  } while (v);
+  return append(b, buf + pos, sizeof(buf) - pos);
+}
+
+/**
+ * Appends the object with its sections renumbered to index.
+ */
+static NODISCARD error
+append_object(struct buffer *const b, char const *const exo, struct object const *const o, size_t const index) {
+  error err = eok();
+  for (size_t pos = o->begin; pos < o->end;) {
+    size_t const next = find_line_end(exo, o->end, pos);
+    size_t dot = 0, close = 0;
+    enum section_type const type = get_section_type(exo + pos, next - pos, &dot, &close);
+    if (type == section_object || type == section_filter) {
+      // "[N]" or "[N.M]" becomes "[index]" or "[index.M]", and the line ending is kept.
+      err = append(b, "[", 1);
+      if (esucceeded(err)) {
+        err = append_uint(b, index);
+      }
+      if (esucceeded(err)) {
+        size_t const rest = type == section_object ? close : dot;
+        err = append(b, exo + pos + rest, next - pos - rest);
+      }
+    } else {
+      err = append(b, exo + pos, next - pos);
+    }
+    if (efailed(err)) {
+      return ethru(err);
+    }
+    pos = next;
+  }
+  return eok();
+}
+
+NODISCARD error exochunk_split(char const *const exo,
+                               size_t const len,
+                               size_t const max_objects,
+                               NODISCARD error (*on_chunk)(void *const userdata, struct exochunk const *const chunk),
+                               void *const userdata) {
+  if (!exo || !on_chunk) {
+    return errg(err_invalid_arugment);
+  }
+  struct object *objects = NULL;
+  struct unit *units = NULL;
+  struct buffer b = {0};
+  size_t header_len = 0;
+  error err = parse_objects(exo, len, &header_len, &objects);
+  if (efailed(err)) {
+    err = ethru(err);
+    goto cleanup;
+  }
+  size_t const num_objects = OV_ARRAY_LENGTH(objects);
+  if (!num_objects) {
+    goto cleanup;
+  }
+  err = mem(&units, num_objects, sizeof(struct unit));
+  if (efailed(err)) {
+    err = ethru(err);
+    goto cleanup;
+  }
+  size_t num_units = 0;
+  for (size_t i = 0; i < num_objects; ++i) {
+    if (objects[i].chain && num_units) {
+      ++units[num_units - 1].count;
+      continue;
+    }
+    units[num_units++] = (struct unit){
+        .first = i,
+        .count = 1,
+        .start = objects[i].start,
+    };
+  }
+  qsort(units, num_units, sizeof(struct unit), compare_unit);
+
+  struct exochunk chunk = {0};
+  for (size_t u = 0; u < num_units;) {
+    b.len = 0;
+    err = append(&b, exo, header_len);
+    if (efailed(err)) {
+      err = ethru(err);
+      goto cleanup;
+    }
+    size_t n = 0;
+    do {
+      for (size_t i = 0; i < units[u].count; ++i) {
+        err = append_object(&b, exo, &objects[units[u].first + i], n++);
+        if (efailed(err)) {
+          err = ethru(err);
+          goto cleanup;
+        }
+      }
+      ++u;
+    } while (u < num_units && (!max_objects || n + units[u].count <= max_objects));
+    chunk.ptr = b.ptr;
+    chunk.len = b.len;
+    chunk.num_objects = n;
+    err = on_chunk(userdata, &chunk);
+    if (efailed(err)) {
+      err = ethru(err);
+      goto cleanup;
+    }
+    ++chunk.index;
+  }
+cleanup:
+  OV_ARRAY_DESTROY(&b.ptr);
+  if (units) {
+    ereport(mem_free(&units));
+  }
+  OV_ARRAY_DESTROY(&objects);
+  return err;
+}
+
+NODISCARD error exochunk_get_path(wchar_t const *const exo_path, size_t const index, wchar_t **const dest) {
+  if (!exo_path || !dest) {
+    return errg(err_invalid_arugment);
+  }
+  wchar_t num[32];
+  size_t num_pos = sizeof(num) / sizeof(num[0]);
+  size_t v = index + 1;
+  do {
+    num[--num_pos] = (wchar_t)(L'0' + v % 10);
+    v /= 10;
+  } while (v);
+  size_t const num_len = sizeof(num) / sizeof(num[0]) - num_pos;
+
+  wchar_t const *const sep = wcsrchr(exo_path, L'\\');
+  wchar_t const *const dot = wcsrchr(sep ? sep : exo_path, L'.');
+  size_t const base_len = dot ? (size_t)(dot - exo_path) : wcslen(exo_path);
+  static wchar_t const prefix[] = L".chunk";
+  static wchar_t const ext[] = L".exo";
+  size_t const prefix_len = sizeof(prefix) / sizeof(prefix[0]) - 1;
+  size_t const ext_len = sizeof(ext) / sizeof(ext[0]) - 1;
+  size_t const total = base_len + prefix_len + num_len + ext_len;
+  error err = OV_ARRAY_GROW(dest, total + 1);
+  if (efailed(err)) {
+    return ethru(err);
+  }
+  wchar_t *p = *dest;
+  memcpy(p, exo_path, base_len * sizeof(wchar_t));
+  p += base_len;
+  memcpy(p, prefix, prefix_len * sizeof(wchar_t));
+  p += prefix_len;
+  memcpy(p, num + num_pos, num_len * sizeof(wchar_t));
+  p += num_len;
+  memcpy(p, ext, (ext_len + 1) * sizeof(wchar_t));
+  OV_ARRAY_SET_LENGTH(*dest, total);
+  return eok();
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <ovbase.h>
+
+/**
+ * @brief A part of an *.exo that can be loaded by itself.
+ */
+struct exochunk {
+  char const *ptr;    /**< The header and the objects of the chunk, renumbered from 0. */
+  size_t len;         /**< Length of ptr in bytes. */
+  size_t index;       /**< Index of the chunk, 0-based. */
+  size_t num_objects; /**< Number of objects in the chunk. */
+};
+
+/**
+ * @brief Splits an *.exo into chunks of at most max_objects objects.
+ *
+ * The objects are ordered by their start frames, and the chunks are made from consecutive objects, so each chunk
+ * covers a later part of the timeline than the previous one. The header is copied to every chunk and the frames
+ * are kept as they are, so all chunks can be dropped at the same frame and layer.
+ * An object with "chain=1" stays in the same chunk as the previous object, so a chunk can have more objects than
+ * max_objects if the chain is longer than that.
+ *
+ * @param exo The *.exo, in any ASCII-compatible encoding.
+ * @param len Length of exo in bytes.
+ * @param max_objects Maximum number of objects in a chunk, 0 to put everything in one chunk.
+ * @param on_chunk Called for each chunk in order. The chunk is valid only during the call.
+ * @param userdata Passed to on_chunk.
+ * @return An error code indicating success or failure, or the error returned by on_chunk.
+ */
+NODISCARD error exochunk_split(char const *const exo,
+                               size_t const len,
+                               size_t const max_objects,
+                               NODISCARD error (*on_chunk)(void *const userdata, struct exochunk const *const chunk),
+                               void *const userdata);
+
+/**
+ * @brief Gets the path of a chunk file, "name.exo" becomes "name.chunkN.exo" where N is index + 1.
+ *
+ * @param exo_path Path of the whole *.exo.
+ * @param index Index of the chunk, 0-based.
+ * @param dest A pointer to an ovarray to receive the path.
+ * @return An error code indicating success or failure.
+ */
+NODISCARD error exochunk_get_path(wchar_t const *const exo_path, size_t const index, wchar_t **const dest);
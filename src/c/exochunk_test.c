@@ -0,0 +1,147 @@
+#include <ovtest.h>
+
+#include <ovarray.h>
+
+#include <string.h>
+
+#include "exochunk.h"
+
+static char const header[] = "[exedit]\r\nwidth=1920\r\nheight=1080\r\nlength=300\r\n";
+
+struct collected {
+  char chunks[8][1024];
+  size_t num_objects[8];
+  size_t n;
+};
+
+static NODISCARD error collect(void *const userdata, struct exochunk const *const chunk) {
+  struct collected *const c = userdata;
+  if (chunk->index != c->n || c->n >= 8 || chunk->len >= 1024) {
+    return errg(err_unexpected);
+  }
+  memcpy(c->chunks[c->n], chunk->ptr, chunk->len);
+  c->chunks[c->n][chunk->len] = '\0';
+  c->num_objects[c->n] = chunk->num_objects;
+  ++c->n;
+  return eok();
+}
+
+static NODISCARD error fail(void *const userdata, struct exochunk const *const chunk) {
+  (void)chunk;
+  ++*(size_t *)userdata;
+  return errg(err_abort);
+}
+
+static void test_exochunk_split(void) {
+  static char const exo[] = "[exedit]\r\nwidth=1920\r\nheight=1080\r\nlength=300\r\n"
+                            "[0]\r\nstart=200\r\nend=250\r\nlayer=1\r\n[0.0]\r\n_name=A\r\n"
+                            "[1]\r\nstart=1\r\nend=50\r\nlayer=1\r\n[1.0]\r\n_name=B\r\n"
+                            "[2]\r\nstart=1\r\nend=50\r\nlayer=2\r\nchain=1\r\n[2.0]\r\n_name=C\r\n"
+                            "[3]\r\nstart=100\r\nend=150\r\nlayer=1\r\n[3.0]\r\n_name=D\r\n";
+  struct collected c = {0};
+  if (!TEST_SUCCEEDED_F(exochunk_split(exo, strlen(exo), 2, collect, &c))) {
+    return;
+  }
+  if (!TEST_CHECK(c.n == 2)) {
+    TEST_MSG("got %zu chunks", c.n);
+    return;
+  }
+  TEST_CHECK(c.num_objects[0] == 2);
+  TEST_CHECK(c.num_objects[1] == 2);
+  for (size_t i = 0; i < c.n; ++i) {
+    TEST_CHECK(strncmp(c.chunks[i], header, strlen(header)) == 0);
+  }
+  char const *const chunk0 = c.chunks[0] + strlen(header);
+  TEST_CHECK(strcmp(chunk0,
+                    "[0]\r\nstart=1\r\nend=50\r\nlayer=1\r\n[0.0]\r\n_name=B\r\n"
+                    "[1]\r\nstart=1\r\nend=50\r\nlayer=2\r\nchain=1\r\n[1.0]\r\n_name=C\r\n") == 0);
+  TEST_MSG("got %s", chunk0);
+  char const *const chunk1 = c.chunks[1] + strlen(header);
+  TEST_CHECK(strcmp(chunk1,
+                    "[0]\r\nstart=100\r\nend=150\r\nlayer=1\r\n[0.0]\r\n_name=D\r\n"
+                    "[1]\r\nstart=200\r\nend=250\r\nlayer=1\r\n[1.0]\r\n_name=A\r\n") == 0);
+  TEST_MSG("got %s", chunk1);
+}
+
+static void test_exochunk_split_long_chain(void) {
+  static char const exo[] = "[exedit]\nlength=300\n"
+                            "[0]\nstart=1\nend=10\n"
+                            "[1]\nstart=1\nend=10\nchain=1\n"
+                            "[2]\nstart=1\nend=10\nchain=1\n"
+                            "[3]\nstart=20\nend=30\n";
+  struct collected c = {0};
+  if (!TEST_SUCCEEDED_F(exochunk_split(exo, strlen(exo), 2, collect, &c))) {
+    return;
+  }
+  TEST_CHECK(c.n == 2);
+  TEST_CHECK(c.num_objects[0] == 3);
+  TEST_CHECK(c.num_objects[1] == 1);
+  TEST_CHECK(strcmp(c.chunks[1], "[exedit]\nlength=300\n[0]\nstart=20\nend=30\n") == 0);
+  TEST_MSG("got %s", c.chunks[1]);
+}
+
+static void test_exochunk_split_no_limit(void) {
+  static char const exo[] = "[exedit]\nlength=300\n"
+                            "[0]\nstart=50\nend=60\n"
+                            "[1]\nstart=1\nend=10\n";
+  struct collected c = {0};
+  if (!TEST_SUCCEEDED_F(exochunk_split(exo, strlen(exo), 0, collect, &c))) {
+    return;
+  }
+  TEST_CHECK(c.n == 1);
+  TEST_CHECK(c.num_objects[0] == 2);
+  TEST_CHECK(strcmp(c.chunks[0], "[exedit]\nlength=300\n[0]\nstart=1\nend=10\n[1]\nstart=50\nend=60\n") == 0);
+  TEST_MSG("got %s", c.chunks[0]);
+}
+
+static void test_exochunk_split_empty(void) {
+  static char const exo[] = "[exedit]\nlength=300\n";
+  struct collected c = {0};
+  TEST_SUCCEEDED_F(exochunk_split(exo, strlen(exo), 10, collect, &c));
+  TEST_CHECK(c.n == 0);
+}
+
+static void test_exochunk_split_abort(void) {
+  static char const exo[] = "[exedit]\nlength=300\n"
+                            "[0]\nstart=1\nend=10\n"
+                            "[1]\nstart=20\nend=30\n";
+  size_t calls = 0;
+  error err = exochunk_split(exo, strlen(exo), 1, fail, &calls);
+  TEST_CHECK(eisg(err, err_abort));
+  efree(&err);
+  TEST_CHECK(calls == 1);
+  TEST_EISG_F(exochunk_split(NULL, 0, 1, fail, &calls), err_invalid_arugment);
+  TEST_EISG_F(exochunk_split(exo, strlen(exo), 1, NULL, NULL), err_invalid_arugment);
+}
+
+static void test_exochunk_get_path(void) {
+  static struct {
+    wchar_t const *input;
+    size_t index;
+    wchar_t const *expected;
+  } const tests[] = {
+      {L"C:\\tmp\\a.exo", 0, L"C:\\tmp\\a.chunk1.exo"},
+      {L"C:\\tmp\\a.exo", 11, L"C:\\tmp\\a.chunk12.exo"},
+      {L"C:\\tmp.d\\a", 0, L"C:\\tmp.d\\a.chunk1.exo"},
+  };
+  wchar_t *path = NULL;
+  for (size_t i = 0; i < sizeof(tests) / sizeof(tests[0]); ++i) {
+    if (!TEST_SUCCEEDED_F(exochunk_get_path(tests[i].input, tests[i].index, &path))) {
+      continue;
+    }
+    TEST_CHECK(wcscmp(path, tests[i].expected) == 0);
+    TEST_MSG("#%zu: got %ls", i, path);
+    TEST_CHECK(OV_ARRAY_LENGTH(path) == wcslen(tests[i].expected));
+  }
+  OV_ARRAY_DESTROY(&path);
+}
+
+TEST_LIST = {
+    {"test_exochunk_split", test_exochunk_split},
+    {"test_exochunk_split_long_chain", test_exochunk_split_long_chain},
+    {"test_exochunk_split_no_limit", test_exochunk_split_no_limit},
+    {"test_exochunk_split_empty", test_exochunk_split_empty},
+    {"test_exochunk_split_abort", test_exochunk_split_abort},
+    {"test_exochunk_get_path", test_exochunk_get_path},
+    {NULL, NULL},
+};
@@ -0,0 +1,55 @@
+#include "exotext.h"
+
+#include <emmintrin.h>
+
+#include "i18n.h"
+
+void exotext_encode_scalar(wchar_t const *const src, size_t const len, char *const dst) {
+  static char const hex[] = "0123456789abcdef";
+  for (size_t i = 0; i < len; ++i) {
+    int const c = src[i];
+    dst[i * 4 + 0] = hex[(c >> 4) & 0xf];
+    dst[i * 4 + 1] = hex[(c >> 0) & 0xf];
+    dst[i * 4 + 2] = hex[(c >> 12) & 0xf];
+    dst[i * 4 + 3] = hex[(c >> 8) & 0xf];
+  }
+}
+
+void exotext_encode(wchar_t const *const src, size_t const len, char *const dst) {
+  // Every code unit is stored as two bytes in little endian order and each byte is written as two hex digits,
+  // high nibble first. So the output is the hex dump of the source bytes.
+  __m128i const mask = _mm_set1_epi8(0x0f);
+  __m128i const nine = _mm_set1_epi8(9);
+  __m128i const zero = _mm_set1_epi8('0');
+  __m128i const alpha = _mm_set1_epi8('a' - '0' - 10);
+  size_t i = 0;
+  for (; i + 8 <= len; i += 8) {
+    __m128i const v = _mm_loadu_si128((__m128i const *)(void const *)(src + i));
+    __m128i const hi = _mm_and_si128(_mm_srli_epi16(v, 4), mask);
+    __m128i const lo = _mm_and_si128(v, mask);
+    __m128i a = _mm_unpacklo_epi8(hi, lo);
+    __m128i b = _mm_unpackhi_epi8(hi, lo);
+    a = _mm_add_epi8(_mm_add_epi8(a, zero), _mm_and_si128(_mm_cmpgt_epi8(a, nine), alpha));
+    b = _mm_add_epi8(_mm_add_epi8(b, zero), _mm_and_si128(_mm_cmpgt_epi8(b, nine), alpha));
+    _mm_storeu_si128((__m128i *)(void *)(dst + i * 4), a);
+    _mm_storeu_si128((__m128i *)(void *)(dst + i * 4 + 16), b);
+  }
+  exotext_encode_scalar(src + i, len - i, dst + i * 4);
+}
+
+NODISCARD error exotext_encode_field(wchar_t const *const src, size_t const len, char *const dst) {
+  if ((!src && len) || !dst) {
+    return errg(err_invalid_arugment);
+  }
+  if (len > exotext_max_length) {
+    return emsg_i18nf(err_type_generic,
+                      err_fail,
+                      L"%1$d%2$d",
+                      gettext("The text is too long (%1$d characters, the maximum is %2$d)."),
+                      (int)len,
+                      exotext_max_length);
+  }
+  exotext_encode(src, len, dst);
+  memset(dst + len * 4, '0', exotext_field_size - len * 4);
+  return eok();
+}
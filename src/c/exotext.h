@@ -0,0 +1,41 @@
+#pragma once
+
+#include <ovbase.h>
+
+enum {
+  /**
+   * @brief Maximum number of UTF-16 code units that can be stored in the text field of exedit.
+   *
+   * The field holds 1024 code units including the terminating NUL.
+   */
+  exotext_max_length = 1023,
+  /**
+   * @brief Size of the encoded text field in bytes.
+   */
+  exotext_field_size = (exotext_max_length + 1) * 4,
+};
+
+/**
+ * @brief Encodes UTF-16 code units into the hex representation used by the text field of *.exo.
+ *
+ * Each code unit is written as four characters, low byte first.
+ * @param src UTF-16 code units.
+ * @param len Number of code units.
+ * @param dst Destination buffer, must have room for len * 4 characters.
+ */
+void exotext_encode(wchar_t const *const src, size_t const len, char *const dst);
+
+/**
+ * @brief The reference implementation of exotext_encode.
+ */
+void exotext_encode_scalar(wchar_t const *const src, size_t const len, char *const dst);
+
+/**
+ * @brief Encodes the text and pads the rest of the field with '0'.
+ *
+ * @param src UTF-16 code units.
+ * @param len Number of code units.
+ * @param dst Destination buffer of exotext_field_size bytes.
+ * @return An error if len exceeds exotext_max_length.
+ */
+NODISCARD error exotext_encode_field(wchar_t const *const src, size_t const len, char *const dst);
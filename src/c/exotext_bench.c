@@ -0,0 +1,50 @@
+#include <ovbase.h>
+#include <ovutil/win32.h>
+
+#include <stdio.h>
+
+#include "exotext.h"
+
+enum {
+  iterations = 200000,
+};
+
+static double now(void) {
+  static LARGE_INTEGER freq;
+  if (!freq.QuadPart) {
+    QueryPerformanceFrequency(&freq);
+  }
+  LARGE_INTEGER c;
+  QueryPerformanceCounter(&c);
+  return (double)c.QuadPart / (double)freq.QuadPart;
+}
+
+static double run(void (*encode)(wchar_t const *const, size_t const, char *const),
+                  wchar_t const *const src,
+                  size_t const len,
+                  char *const dst) {
+  double const start = now();
+  for (int i = 0; i < iterations; ++i) {
+    encode(src, len, dst);
+  }
+  return now() - start;
+}
+
+int main(void) {
+  static wchar_t src[exotext_max_length];
+  static char dst[exotext_field_size];
+  for (size_t i = 0; i < exotext_max_length; ++i) {
+    src[i] = (wchar_t)(0x3042 + i % 80);
+  }
+  static size_t const lengths[] = {8, 32, 128, exotext_max_length};
+  for (size_t i = 0; i < sizeof(lengths) / sizeof(lengths[0]); ++i) {
+    double const scalar = run(exotext_encode_scalar, src, lengths[i], dst);
+    double const simd = run(exotext_encode, src, lengths[i], dst);
+    printf("len %4d: scalar %8.3fms, sse2 %8.3fms, x%.2f\n",
+           (int)lengths[i],
+           scalar * 1000.0,
+           simd * 1000.0,
+           simd > 0 ? scalar / simd : 0.0);
+  }
+  return 0;
+}
@@ -0,0 +1,75 @@
+#include <ovtest.h>
+
+#include "exotext.h"
+
+static uint32_t xorshift32(uint32_t *const state) {
+  uint32_t x = *state;
+  x ^= x << 13;
+  x ^= x >> 17;
+  x ^= x << 5;
+  return *state = x;
+}
+
+static void test_exotext_encode(void) {
+  wchar_t src[100];
+  char got[100 * 4 + 1];
+  char expected[100 * 4 + 1];
+  uint32_t state = 0x12345678;
+  for (size_t len = 0; len <= 100; ++len) {
+    for (size_t i = 0; i < len; ++i) {
+      src[i] = (wchar_t)(xorshift32(&state) & 0xffff);
+    }
+    memset(got, 'x', sizeof(got));
+    memset(expected, 'x', sizeof(expected));
+    exotext_encode(src, len, got);
+    exotext_encode_scalar(src, len, expected);
+    TEST_CHECK(memcmp(got, expected, sizeof(got)) == 0);
+    TEST_MSG("len: %zu", len);
+  }
+}
+
+static void test_exotext_encode_known(void) {
+  static wchar_t const src[] = L"A\x3042\xffff\x0010\x9abc\x00ef\x1234\x5678\x0a0d";
+  static char const golden[] = "4100"
+                               "4230"
+                               "ffff"
+                               "1000"
+                               "bc9a"
+                               "ef00"
+                               "3412"
+                               "7856"
+                               "0d0a";
+  char got[sizeof(golden)] = {0};
+  exotext_encode(src, sizeof(src) / sizeof(src[0]) - 1, got);
+  TEST_CHECK(strcmp(got, golden) == 0);
+  TEST_MSG("got: %s", got);
+}
+
+static void test_exotext_encode_field(void) {
+  static wchar_t src[exotext_max_length + 1];
+  static char dst[exotext_field_size];
+  for (size_t i = 0; i < sizeof(src) / sizeof(src[0]); ++i) {
+    src[i] = L'a';
+  }
+  if (TEST_SUCCEEDED_F(exotext_encode_field(src, 2, dst))) {
+    TEST_CHECK(memcmp(dst, "61006100", 8) == 0);
+    bool padded = true;
+    for (size_t i = 8; i < exotext_field_size; ++i) {
+      padded = padded && dst[i] == '0';
+    }
+    TEST_CHECK(padded);
+  }
+  if (TEST_SUCCEEDED_F(exotext_encode_field(src, exotext_max_length, dst))) {
+    TEST_CHECK(memcmp(dst + (exotext_max_length - 1) * 4, "61000000", 8) == 0);
+  }
+  TEST_EISG_F(exotext_encode_field(src, exotext_max_length + 1, dst), err_fail);
+  TEST_EISG_F(exotext_encode_field(NULL, 1, dst), err_invalid_arugment);
+  TEST_EISG_F(exotext_encode_field(src, 1, NULL), err_invalid_arugment);
+}
+
+TEST_LIST = {
+    {"test_exotext_encode", test_exotext_encode},
+    {"test_exotext_encode_known", test_exotext_encode_known},
+    {"test_exotext_encode_field", test_exotext_encode_field},
+    {NULL, NULL},
+};
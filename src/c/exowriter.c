@@ -0,0 +1,133 @@
+#include "exowriter.h"
+
+#include "i18n.h"
+
+enum {
+  // The contents of *.exo should be Shift_JIS.
+  // When loading in an environment with a different code page,
+  // it is expected to be translated by the GCMZDrops conversion function.
+  CP_SHIFT_JIS = 932,
+  default_chunk_size = 64 * 1024,
+  max_sequence_length = 4,
+};
+
+static size_t sequence_length(unsigned char const lead) {
+  if (lead >= 0xf0) {
+    return 4;
+  }
+  if (lead >= 0xe0) {
+    return 3;
+  }
+  if (lead >= 0xc0) {
+    return 2;
+  }
+  return 1;
+}
+
+/**
+ * Returns the number of bytes that can be converted without cutting a UTF-8 sequence in half.
+ * `n` must be less than `len` so that `s[n]` is readable.
+ */
+static size_t find_split_position(char const *const s, size_t const len, size_t const n) {
+  unsigned char const *const u = (unsigned char const *)s;
+  size_t pos = n;
+  while (pos > 0 && n - pos < max_sequence_length - 1 && (u[pos] & 0xc0) == 0x80) {
+    --pos;
+  }
+  if ((u[pos] & 0xc0) == 0x80) {
+    return n; // broken sequence, there is no better place to split
+  }
+  if (pos > 0) {
+    return pos;
+  }
+  // The first sequence does not fit in the chunk.
+  size_t const seqlen = sequence_length(u[0]);
+  return seqlen < len ? seqlen : len;
+}
+
+NODISCARD error exowriter_write(char const *const utf8,
+                                size_t const utf8_len,
+                                size_t const chunk_size,
+                                NODISCARD error (*write)(void *const userdata,
+                                                         char const *const sjis,
+                                                         size_t const sjis_len),
+                                void *const userdata) {
+  if (!utf8 || !write) {
+    return errg(err_invalid_arugment);
+  }
+  size_t const chunk = chunk_size ? chunk_size : default_chunk_size;
+  if (chunk > INT_MAX / 2) {
+    return errg(err_invalid_arugment);
+  }
+  size_t const wcap = chunk < max_sequence_length ? max_sequence_length : chunk;
+  error err = eok();
+  wchar_t *wbuf = NULL;
+  char *sjis = NULL;
+  err = mem(&wbuf, wcap, sizeof(wchar_t));
+  if (efailed(err)) {
+    err = ethru(err);
+    goto cleanup;
+  }
+  err = mem(&sjis, wcap * 2, sizeof(char));
+  if (efailed(err)) {
+    err = ethru(err);
+    goto cleanup;
+  }
+
+  size_t pos = 0;
+  while (pos < utf8_len) {
+    size_t const remain = utf8_len - pos;
+    size_t n = remain < chunk ? remain : chunk;
+    if (n < remain) {
+      n = find_split_position(utf8 + pos, remain, n);
+    }
+    int const wlen = MultiByteToWideChar(CP_UTF8, 0, utf8 + pos, (int)n, wbuf, (int)wcap);
+    if (wlen == 0) {
+      err = errhr(HRESULT_FROM_WIN32(GetLastError()));
+      goto cleanup;
+    }
+    int const sjislen = WideCharToMultiByte(CP_SHIFT_JIS, 0, wbuf, wlen, sjis, (int)(wcap * 2), NULL, NULL);
+    if (sjislen == 0) {
+      err = errhr(HRESULT_FROM_WIN32(GetLastError()));
+      goto cleanup;
+    }
+    err = write(userdata, sjis, (size_t)sjislen);
+    if (efailed(err)) {
+      err = ethru(err);
+      goto cleanup;
+    }
+    pos += n;
+  }
+
+cleanup:
+  if (sjis) {
+    ereport(mem_free(&sjis));
+  }
+  if (wbuf) {
+    ereport(mem_free(&wbuf));
+  }
+  return err;
+}
+
+static NODISCARD error write_file(void *const userdata, char const *const sjis, size_t const sjis_len) {
+  HANDLE const file = userdata;
+  DWORD written = 0;
+  if (!WriteFile(file, sjis, (DWORD)sjis_len, &written, NULL)) {
+    return errhr(HRESULT_FROM_WIN32(GetLastError()));
+  }
+  if (written != (DWORD)sjis_len) {
+    return emsg_i18n(err_type_generic, err_fail, gettext("Unable to write the entire file."));
+  }
+  return eok();
+}
+
+NODISCARD error exowriter_write_file(HANDLE const file, char const *const utf8, size_t const utf8_len) {
+  if (!file || file == INVALID_HANDLE_VALUE) {
+    return errg(err_invalid_arugment);
+  }
+  error err = exowriter_write(utf8, utf8_len, 0, write_file, file);
+  if (efailed(err)) {
+    return ethru(err);
+  }
+  return eok();
+}
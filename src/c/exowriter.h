@@ -0,0 +1,29 @@
+#pragma once
+
+#include <ovbase.h>
+#include <ovutil/win32.h>
+
+/**
+ * @brief Converts a UTF-8 encoded *.exo to Shift_JIS and writes it out chunk by chunk.
+ *
+ * The input is split only at UTF-8 sequence boundaries, so the output is identical to converting the whole text at
+ * once. Only one chunk of UTF-16 and Shift_JIS text is held in memory at a time.
+ * @param utf8 UTF-8 encoded text.
+ * @param utf8_len Length of utf8 in bytes.
+ * @param chunk_size Maximum number of UTF-8 bytes converted at once, 0 to use the default.
+ * @param write Callback function that receives the converted Shift_JIS text.
+ * @param userdata User-defined data passed to the callback.
+ * @return An error object indicating the success or failure of the conversion process.
+ */
+NODISCARD error exowriter_write(char const *const utf8,
+                                size_t const utf8_len,
+                                size_t const chunk_size,
+                                NODISCARD error (*write)(void *const userdata,
+                                                         char const *const sjis,
+                                                         size_t const sjis_len),
+                                void *const userdata);
+
+/**
+ * @brief Writes the converted *.exo to the given file handle.
+ */
+NODISCARD error exowriter_write_file(HANDLE const file, char const *const utf8, size_t const utf8_len);
@@ -0,0 +1,144 @@
+#include <ovtest.h>
+
+#include <ovarray.h>
+
+#include "exowriter.c"
+
+static struct corpus_entry {
+  char const *text;
+  bool round_trip; // false if the text contains characters that cannot be represented in Shift_JIS
+} const g_corpus[] = {
+    {"", true},
+    {"[exedit]\r\nwidth=1920\r\nheight=1080\r\n", true},
+    {"_name=テキスト\r\nサイズ=34\r\n表示速度=0.0\r\n文字毎に個別オブジェクト=0\r\n", true},
+    {"_name=標準描画\r\n拡大率=100.00\r\n透明度=0.0\r\n回転=0.00\r\n", true},
+    {"ｱｲｳｴｵ ﾊﾝｶｸｶﾀｶﾅ①②③ⅠⅡⅢ㈱", true},
+    {"全角ＡＢＣ　記号「」『』【】～－", true},
+    {"表能ソ十予ボ", true}, // second byte is 0x5c in Shift_JIS
+    {"emoji 😀 and 𠮷 are not in Shift_JIS", false},
+    {"中文 简体字 한국어", false},
+};
+
+struct sink {
+  char *buf;
+  size_t len;
+  size_t calls;
+};
+
+static NODISCARD error sink_write(void *const userdata, char const *const sjis, size_t const sjis_len) {
+  struct sink *const s = userdata;
+  error err = OV_ARRAY_GROW(&s->buf, s->len + sjis_len + 1);
+  if (efailed(err)) {
+    return ethru(err);
+  }
+  memcpy(s->buf + s->len, sjis, sjis_len);
+  s->len += sjis_len;
+  s->buf[s->len] = '\0';
+  ++s->calls;
+  return eok();
+}
+
+static bool convert_whole(char const *const utf8, struct sink *const s) {
+  int const utf8_len = (int)strlen(utf8);
+  if (!utf8_len) {
+    return true;
+  }
+  wchar_t wbuf[1024];
+  int const wlen = MultiByteToWideChar(CP_UTF8, 0, utf8, utf8_len, wbuf, 1024);
+  if (!wlen) {
+    return false;
+  }
+  char buf[2048];
+  int const len = WideCharToMultiByte(CP_SHIFT_JIS, 0, wbuf, wlen, buf, 2048, NULL, NULL);
+  if (!len) {
+    return false;
+  }
+  return esucceeded(sink_write(s, buf, (size_t)len));
+}
+
+static bool convert_back(char const *const sjis, size_t const sjis_len, char *const utf8, size_t const utf8_size) {
+  if (!sjis_len) {
+    utf8[0] = '\0';
+    return true;
+  }
+  wchar_t wbuf[1024];
+  int const wlen = MultiByteToWideChar(CP_SHIFT_JIS, 0, sjis, (int)sjis_len, wbuf, 1024);
+  if (!wlen) {
+    return false;
+  }
+  int const len = WideCharToMultiByte(CP_UTF8, 0, wbuf, wlen, utf8, (int)utf8_size - 1, NULL, NULL);
+  if (!len) {
+    return false;
+  }
+  utf8[len] = '\0';
+  return true;
+}
+
+static void test_find_split_position(void) {
+  // "aあ" = 61 e3 81 82
+  char const s[] = "a\xe3\x81\x82z";
+  TEST_CHECK(find_split_position(s, 5, 1) == 1);
+  TEST_CHECK(find_split_position(s, 5, 2) == 1);
+  TEST_CHECK(find_split_position(s, 5, 3) == 1);
+  TEST_CHECK(find_split_position(s, 5, 4) == 4);
+  // The first sequence is longer than the chunk.
+  TEST_CHECK(find_split_position(s + 1, 4, 1) == 3);
+  TEST_CHECK(find_split_position(s + 1, 4, 2) == 3);
+  // Broken sequence made of continuation bytes only.
+  char const broken[] = "\x81\x81\x81\x81\x81";
+  TEST_CHECK(find_split_position(broken, 5, 4) == 4);
+}
+
+static void test_exowriter_chunked(void) {
+  static size_t const chunk_sizes[] = {1, 2, 3, 4, 5, 7, 16, 0};
+  for (size_t i = 0; i < sizeof(g_corpus) / sizeof(g_corpus[0]); ++i) {
+    struct corpus_entry const *const e = &g_corpus[i];
+    struct sink golden = {0};
+    if (!TEST_CHECK(convert_whole(e->text, &golden))) {
+      TEST_MSG("corpus #%zu", i);
+      continue;
+    }
+    for (size_t j = 0; j < sizeof(chunk_sizes) / sizeof(chunk_sizes[0]); ++j) {
+      struct sink got = {0};
+      if (TEST_SUCCEEDED_F(exowriter_write(e->text, strlen(e->text), chunk_sizes[j], sink_write, &got))) {
+        TEST_CHECK(got.len == golden.len);
+        TEST_CHECK(got.len == 0 || memcmp(got.buf, golden.buf, got.len) == 0);
+        TEST_MSG("corpus #%zu, chunk size %zu", i, chunk_sizes[j]);
+      }
+      if (got.buf) {
+        OV_ARRAY_DESTROY(&got.buf);
+      }
+    }
+    if (e->round_trip) {
+      char utf8[2048];
+      TEST_CHECK(convert_back(golden.buf, golden.len, utf8, sizeof(utf8)));
+      TEST_CHECK(strcmp(utf8, e->text) == 0);
+      TEST_MSG("corpus #%zu", i);
+    }
+    if (golden.buf) {
+      OV_ARRAY_DESTROY(&golden.buf);
+    }
+  }
+}
+
+static void test_exowriter_chunk_count(void) {
+  char text[100];
+  memset(text, 'a', sizeof(text));
+  struct sink got = {0};
+  if (TEST_SUCCEEDED_F(exowriter_write(text, sizeof(text), 16, sink_write, &got))) {
+    TEST_CHECK(got.len == sizeof(text));
+    TEST_CHECK(got.calls == 7);
+  }
+  if (got.buf) {
+    OV_ARRAY_DESTROY(&got.buf);
+  }
+  TEST_EISG_F(exowriter_write(NULL, 0, 0, sink_write, &got), err_invalid_arugment);
+  TEST_EISG_F(exowriter_write(text, sizeof(text), 0, NULL, &got), err_invalid_arugment);
+}
+
+TEST_LIST = {
+    {"test_find_split_position", test_find_split_position},
+    {"test_exowriter_chunked", test_exowriter_chunked},
+    {"test_exowriter_chunk_count", test_exowriter_chunk_count},
+    {NULL, NULL},
+};
@@ -0,0 +1,160 @@
+#include "frametiming.h"
+
+#include <ovarray.h>
+
+#include <emmintrin.h>
+#include <math.h>
+#include <stddef.h>
+
+#include "transcript.h"
+
+// convert() loads the start and the end of a record at once.
+_Static_assert(offsetof(struct transcript_segment, end) == offsetof(struct transcript_segment, start) + sizeof(double),
+               "end must follow start");
+_Static_assert(offsetof(struct transcript_word, end) == offsetof(struct transcript_word, start) + sizeof(double),
+               "end must follow start");
+_Static_assert(sizeof(struct frametiming_range) == sizeof(int) * 2, "unexpected size of struct frametiming_range");
+
+enum {
+  // Leaves room to step over the neighbors without overflowing.
+  max_frame = INT_MAX / 2,
+};
+
+static int to_frame(double const v) {
+  if (!(v > (double)-max_frame)) {
+    return -max_frame;
+  }
+  if (!(v < (double)max_frame)) {
+    return max_frame;
+  }
+  return (int)v;
+}
+
+/**
+ * Converts the times in the same order of operations as "math.floor(t * rate / scale)" in Lua, so that the result
+ * does not change from what the modules used to compute.
+ * The start and the end of a record are converted together in the two lanes of a register.
+ */
+static void convert(struct frametiming_range *const r,
+                    double const *const times,
+                    size_t const stride,
+                    size_t const n,
+                    double const rate,
+                    double const scale) {
+  __m128d const vrate = _mm_set1_pd(rate);
+  __m128d const vscale = _mm_set1_pd(scale);
+  // The start is floor(v) + 1 and the end is floor(v).
+  __m128d const offset = _mm_set_pd(0.0, 1.0);
+  __m128d const lo = _mm_set1_pd((double)-max_frame);
+  __m128d const hi = _mm_set1_pd((double)max_frame);
+  __m128d const one = _mm_set1_pd(1.0);
+  char const *p = (char const *)times;
+  for (size_t i = 0; i < n; ++i, p += stride) {
+    __m128d v = _mm_loadu_pd((double const *)(void const *)p);
+    v = _mm_div_pd(_mm_mul_pd(v, vrate), vscale);
+    // Keeps the value in the range of int before the truncation, NaN goes to the lower bound like to_frame
+    // because maxpd returns the second operand for NaN.
+    v = _mm_min_pd(_mm_max_pd(v, _mm_sub_pd(lo, one)), hi);
+    // Truncation rounds negative values up, so they are moved down by one to get floor.
+    __m128d f = _mm_cvtepi32_pd(_mm_cvttpd_epi32(v));
+    f = _mm_sub_pd(f, _mm_and_pd(_mm_cmpgt_pd(f, v), one));
+    f = _mm_min_pd(_mm_max_pd(_mm_add_pd(f, offset), lo), hi);
+    _mm_storel_epi64((__m128i *)(void *)(r + i), _mm_cvttpd_epi32(f));
+  }
+}
+
+static int add_frames(int const v, int const n) { return v > max_frame - n ? max_frame : v + n; }
+
+static void resolve(struct frametiming_range *const r, size_t const n, int const min_frames) {
+  for (size_t i = 0; i < n; ++i) {
+    if (i > 0 && r[i].start <= r[i - 1].end) {
+      struct frametiming_range *const prev = &r[i - 1];
+      int const prev_min_end = add_frames(prev->start, min_frames - 1);
+      prev->end = r[i].start - 1 > prev_min_end ? r[i].start - 1 : prev_min_end;
+      if (r[i].start <= prev->end) {
+        r[i].start = add_frames(prev->end, 1);
+      }
+    }
+    int const min_end = add_frames(r[i].start, min_frames - 1);
+    if (r[i].end < min_end) {
+      r[i].end = min_end;
+    }
+  }
+}
+
+static void clamp(struct frametiming_range *const r, size_t const n, struct frametiming_range const *const bounds) {
+  for (size_t i = 0; i < n; ++i) {
+    if (r[i].start < bounds->start) {
+      r[i].start = bounds->start;
+    }
+    if (r[i].start > bounds->end) {
+      r[i].start = bounds->end;
+    }
+    if (r[i].end > bounds->end) {
+      r[i].end = bounds->end;
+    }
+    if (r[i].end < r[i].start) {
+      r[i].end = r[i].start;
+    }
+  }
+}
+
+NODISCARD error frametiming_compute(struct transcript *const t, struct frametiming_params const *const params) {
+  if (!t || !params || params->rate <= 0 || params->scale <= 0) {
+    return errg(err_invalid_arugment);
+  }
+  struct frametiming_range *segments = NULL;
+  struct frametiming_range *words = NULL;
+  error err = OV_ARRAY_GROW(&segments, t->num_segments + 1);
+  if (efailed(err)) {
+    err = ethru(err);
+    goto cleanup;
+  }
+  err = OV_ARRAY_GROW(&words, t->num_words + 1);
+  if (efailed(err)) {
+    err = ethru(err);
+    goto cleanup;
+  }
+  double const rate = (double)params->rate;
+  double const scale = (double)params->scale;
+  int const min_frames = params->min_frames > 1 ? params->min_frames : 1;
+  if (t->num_segments) {
+    convert(segments, &t->segments[0].start, sizeof(struct transcript_segment), t->num_segments, rate, scale);
+  }
+  if (t->num_words) {
+    convert(words, &t->words[0].start, sizeof(struct transcript_word), t->num_words, rate, scale);
+  }
+  if (params->fill_gaps) {
+    for (size_t i = 0; i < t->num_segments; ++i) {
+      struct transcript_segment const *const seg = &t->segments[i];
+      struct transcript_word const *const w = t->words + seg->first_word;
+      struct frametiming_range *const r = words + seg->first_word;
+      for (size_t j = 0; j < seg->num_words; ++j) {
+        double endsec = seg->end;
+        if (j + 1 < seg->num_words) {
+          endsec = w[j].end > w[j + 1].start ? w[j].end : w[j + 1].start;
+        }
+        r[j].end = to_frame(floor(endsec * rate / scale));
+      }
+    }
+  }
+  resolve(segments, t->num_segments, min_frames);
+  resolve(words, t->num_words, min_frames);
+  // Filling the gaps and resolving the segments can move a word outside of its segment.
+  for (size_t i = 0; i < t->num_segments; ++i) {
+    struct transcript_segment const *const seg = &t->segments[i];
+    clamp(words + seg->first_word, seg->num_words, &segments[i]);
+  }
+  OV_ARRAY_SET_LENGTH(segments, t->num_segments);
+  OV_ARRAY_SET_LENGTH(words, t->num_words);
+  OV_ARRAY_DESTROY(&t->segment_frames);
+  OV_ARRAY_DESTROY(&t->word_frames);
+  t->segment_frames = segments;
+  t->word_frames = words;
+  segments = NULL;
+  words = NULL;
+cleanup:
+  OV_ARRAY_DESTROY(&words);
+  OV_ARRAY_DESTROY(&segments);
+  return err;
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <ovbase.h>
+
+struct transcript;
+
+/**
+ * @brief A range of frames, both ends inclusive.
+ */
+struct frametiming_range {
+  int start; /**< First frame, 1-based. */
+  int end;   /**< Last frame. */
+};
+
+/**
+ * @brief Parameters for converting the times of the transcript to frames.
+ */
+struct frametiming_params {
+  int rate;       /**< Frame rate numerator of the video. */
+  int scale;      /**< Frame rate denominator of the video. */
+  int min_frames; /**< Minimum number of frames of each range, values less than 1 are treated as 1. */
+  bool fill_gaps; /**< Extends each word to the start of the next word, and the last word to the segment end. */
+};
+
+/**
+ * @brief Converts the times of all segments and words to frames.
+ *
+ * A time t becomes floor(t * rate / scale) + 1 for the start and floor(t * rate / scale) for the end, which is
+ * what the Lua modules used to compute by themselves.
+ * After that, ranges shorter than min_frames are extended, and overlapping ranges are resolved by moving the end
+ * of the earlier range back as far as min_frames allows, and then the start of the later range forward. Segments
+ * and words are resolved separately because they are usually placed on different layers. Finally, each word is
+ * clamped to the range of its segment.
+ *
+ * The results are stored in t->segment_frames and t->word_frames as ovarrays, and freed by transcript_destroy.
+ * @param t The transcript.
+ * @param params Parameters for the conversion.
+ * @return An error code indicating success or failure.
+ */
+NODISCARD error frametiming_compute(struct transcript *const t, struct frametiming_params const *const params);
@@ -0,0 +1,218 @@
+#include <ovtest.h>
+
+#include <ovarray.h>
+
+#include "frametiming.h"
+#include "transcript.h"
+
+#include <limits.h>
+#include <math.h>
+
+static int floor_frame(double const v) {
+  double const f = floor(v);
+  return (int)f;
+}
+
+static void destroy_frames(struct transcript *const t) {
+  OV_ARRAY_DESTROY(&t->segment_frames);
+  OV_ARRAY_DESTROY(&t->word_frames);
+}
+
+static void test_frametiming_same_as_lua(void) {
+  static struct transcript_segment const segments[] = {
+      {.start = 1.23, .end = 4.56, .first_word = 0, .num_words = 3},
+      {.start = 5.0, .end = 6.5, .first_word = 3, .num_words = 1},
+  };
+  static struct transcript_word const words[] = {
+      {.start = 1.23, .end = 2.0},
+      {.start = 2.34, .end = 3.0},
+      {.start = 3.5, .end = 4.0},
+      {.start = 5.0, .end = 6.0},
+  };
+  struct transcript t = {
+      .segments = segments,
+      .num_segments = sizeof(segments) / sizeof(segments[0]),
+      .words = words,
+      .num_words = sizeof(words) / sizeof(words[0]),
+  };
+  int const rate = 30000, scale = 1001;
+  if (!TEST_SUCCEEDED_F(frametiming_compute(&t,
+                                            &(struct frametiming_params){
+                                                .rate = rate,
+                                                .scale = scale,
+                                                .min_frames = 1,
+                                                .fill_gaps = true,
+                                            }))) {
+    return;
+  }
+  TEST_CHECK(OV_ARRAY_LENGTH(t.segment_frames) == 2);
+  TEST_CHECK(OV_ARRAY_LENGTH(t.word_frames) == 4);
+  for (size_t i = 0; i < t.num_segments; ++i) {
+    TEST_CHECK(t.segment_frames[i].start == floor_frame(segments[i].start * rate / scale) + 1);
+    TEST_CHECK(t.segment_frames[i].end == floor_frame(segments[i].end * rate / scale));
+  }
+  // The gaps are filled up to the next word, and the last word of each segment reaches the segment end.
+  double const ends[] = {2.34, 3.5, 4.56, 6.5};
+  for (size_t i = 0; i < t.num_words; ++i) {
+    TEST_CHECK(t.word_frames[i].start == floor_frame(words[i].start * rate / scale) + 1);
+    TEST_CHECK(t.word_frames[i].end == floor_frame(ends[i] * rate / scale));
+    TEST_MSG("word %zu: %d - %d", i, t.word_frames[i].start, t.word_frames[i].end);
+  }
+  destroy_frames(&t);
+}
+
+static void test_frametiming_resolve(void) {
+  static struct transcript_segment const segments[] = {
+      {.start = 0.0, .end = 2.0},
+      {.start = 1.0, .end = 3.0},  // overlaps the previous one
+      {.start = 3.0, .end = 3.0},  // zero length
+      {.start = 3.0, .end = 3.01}, // starts in the same frame as the previous one
+  };
+  struct transcript t = {
+      .segments = segments,
+      .num_segments = sizeof(segments) / sizeof(segments[0]),
+  };
+  if (!TEST_SUCCEEDED_F(frametiming_compute(&t,
+                                            &(struct frametiming_params){
+                                                .rate = 10,
+                                                .scale = 1,
+                                                .min_frames = 3,
+                                            }))) {
+    return;
+  }
+  struct frametiming_range const *const r = t.segment_frames;
+  TEST_CHECK(r[0].start == 1 && r[0].end == 10);
+  TEST_CHECK(r[1].start == 11 && r[1].end == 30);
+  TEST_CHECK(r[2].start == 31 && r[2].end == 33);
+  TEST_CHECK(r[3].start == 34 && r[3].end == 36);
+  for (size_t i = 0; i < t.num_segments; ++i) {
+    TEST_CHECK(r[i].start <= r[i].end);
+    TEST_CHECK(i == 0 || r[i - 1].end < r[i].start);
+    TEST_MSG("segment %zu: %d - %d", i, r[i].start, r[i].end);
+  }
+  destroy_frames(&t);
+}
+
+static void test_frametiming_without_fill_gaps(void) {
+  static struct transcript_segment const segments[] = {
+      {.start = 0.0, .end = 10.0, .first_word = 0, .num_words = 2},
+  };
+  static struct transcript_word const words[] = {
+      {.start = 0.0, .end = 1.0},
+      {.start = 5.0, .end = 6.0},
+  };
+  struct transcript t = {
+      .segments = segments,
+      .num_segments = 1,
+      .words = words,
+      .num_words = 2,
+  };
+  if (!TEST_SUCCEEDED_F(frametiming_compute(&t, &(struct frametiming_params){.rate = 10, .scale = 1}))) {
+    return;
+  }
+  TEST_CHECK(t.word_frames[0].start == 1 && t.word_frames[0].end == 10);
+  TEST_CHECK(t.word_frames[1].start == 51 && t.word_frames[1].end == 60);
+  destroy_frames(&t);
+}
+
+static bool convert_one(double const start, double const end, struct frametiming_range *const r) {
+  struct transcript_word const word = {.start = start, .end = end};
+  struct transcript t = {.words = &word, .num_words = 1};
+  if (!TEST_SUCCEEDED_F(frametiming_compute(&t, &(struct frametiming_params){.rate = 30000, .scale = 1001}))) {
+    return false;
+  }
+  *r = t.word_frames[0];
+  destroy_frames(&t);
+  return true;
+}
+
+static void test_frametiming_convert(void) {
+  int const rate = 30000, scale = 1001;
+  struct frametiming_range r;
+  for (int i = 0; i < 1000; ++i) {
+    double const start = (double)i * 0.0333667 - 1.0;
+    double const end = (double)i * 0.0417 + 0.001;
+    if (!convert_one(start, end, &r)) {
+      return;
+    }
+    int const want_start = floor_frame(start * rate / scale) + 1;
+    int const want_end = floor_frame(end * rate / scale);
+    TEST_CHECK(r.start == want_start);
+    TEST_CHECK(r.end == (want_end > want_start ? want_end : want_start));
+    TEST_MSG("%d: %d - %d", i, r.start, r.end);
+  }
+  if (convert_one(-1e300, 1e300, &r)) {
+    TEST_CHECK(r.start == -INT_MAX / 2 && r.end == INT_MAX / 2);
+  }
+  if (convert_one(1e300, -1e300, &r)) {
+    TEST_CHECK(r.start == INT_MAX / 2 && r.end == INT_MAX / 2);
+  }
+  if (convert_one(-0.0, 0.0, &r)) {
+    TEST_CHECK(r.start == 1 && r.end == 1);
+  }
+}
+
+static void test_frametiming_words_in_segment(void) {
+  static struct transcript_segment const segments[] = {
+      {.start = 0.0, .end = 5.0, .first_word = 0, .num_words = 3},
+      {.start = 4.0, .end = 8.0, .first_word = 3, .num_words = 1},
+  };
+  static struct transcript_word const words[] = {
+      {.start = 0.0, .end = 1.0},
+      {.start = 2.0, .end = 3.0},
+      {.start = 4.5, .end = 4.9}, // after the end of the resolved segment
+      {.start = 6.0, .end = 8.0},
+  };
+  struct transcript t = {
+      .segments = segments,
+      .num_segments = 2,
+      .words = words,
+      .num_words = 4,
+  };
+  if (!TEST_SUCCEEDED_F(frametiming_compute(&t,
+                                            &(struct frametiming_params){
+                                                .rate = 10,
+                                                .scale = 1,
+                                                .min_frames = 1,
+                                                .fill_gaps = true,
+                                            }))) {
+    return;
+  }
+  struct frametiming_range const *const s = t.segment_frames;
+  struct frametiming_range const *const w = t.word_frames;
+  TEST_CHECK(s[0].start == 1 && s[0].end == 40);
+  TEST_CHECK(s[1].start == 41 && s[1].end == 80);
+  TEST_CHECK(w[0].start == 1 && w[0].end == 20);
+  TEST_CHECK(w[1].start == 21 && w[1].end == 40);
+  TEST_CHECK(w[2].start == 40 && w[2].end == 40);
+  TEST_CHECK(w[3].start == 61 && w[3].end == 80);
+  for (size_t i = 0; i < t.num_segments; ++i) {
+    for (size_t j = 0; j < segments[i].num_words; ++j) {
+      struct frametiming_range const *const r = &w[segments[i].first_word + j];
+      TEST_CHECK(s[i].start <= r->start && r->start <= r->end && r->end <= s[i].end);
+      TEST_MSG("segment %zu word %zu: %d - %d", i, j, r->start, r->end);
+    }
+  }
+  destroy_frames(&t);
+}
+
+static void test_frametiming_invalid_argument(void) {
+  struct transcript t = {0};
+  TEST_EISG_F(frametiming_compute(NULL, &(struct frametiming_params){.rate = 30, .scale = 1}), err_invalid_arugment);
+  TEST_EISG_F(frametiming_compute(&t, NULL), err_invalid_arugment);
+  TEST_EISG_F(frametiming_compute(&t, &(struct frametiming_params){.rate = 30}), err_invalid_arugment);
+  if (TEST_SUCCEEDED_F(frametiming_compute(&t, &(struct frametiming_params){.rate = 30, .scale = 1}))) {
+    TEST_CHECK(OV_ARRAY_LENGTH(t.segment_frames) == 0 && OV_ARRAY_LENGTH(t.word_frames) == 0);
+  }
+  destroy_frames(&t);
+}
+
+TEST_LIST = {
+    {"test_frametiming_same_as_lua", test_frametiming_same_as_lua},
+    {"test_frametiming_resolve", test_frametiming_resolve},
+    {"test_frametiming_without_fill_gaps", test_frametiming_without_fill_gaps},
+    {"test_frametiming_convert", test_frametiming_convert},
+    {"test_frametiming_words_in_segment", test_frametiming_words_in_segment},
+    {"test_frametiming_invalid_argument", test_frametiming_invalid_argument},
+    {NULL, NULL},
+};
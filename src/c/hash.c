@@ -0,0 +1,11 @@
+#include "hash.h"
+
+uint64_t hash_fnv1a(void const *const data, size_t const len, uint64_t const seed) {
+  uint64_t h = seed ? seed : UINT64_C(14695981039346656037);
+  unsigned char const *p = data;
+  for (size_t i = 0; i < len; ++i) {
+    h ^= p[i];
+    h *= UINT64_C(1099511628211);
+  }
+  return h;
+}
@@ -0,0 +1,15 @@
+#pragma once
+
+#include <ovbase.h>
+
+/**
+ * @brief Calculates the 64-bit FNV-1a hash.
+ *
+ * To hash multiple buffers, pass the previous result as seed.
+ *
+ * @param data Data to hash.
+ * @param len Length of data.
+ * @param seed 0 to start a new hash, or the previous result to continue.
+ * @return The hash value.
+ */
+uint64_t hash_fnv1a(void const *const data, size_t const len, uint64_t const seed);
@@ -0,0 +1,15 @@
+#include <ovtest.h>
+
+#include "hash.h"
+
+static void test_hash_fnv1a(void) {
+  TEST_CHECK(hash_fnv1a("", 0, 0) == UINT64_C(0xcbf29ce484222325));
+  TEST_CHECK(hash_fnv1a("a", 1, 0) == UINT64_C(0xaf63dc4c8601ec8c));
+  TEST_CHECK(hash_fnv1a("foobar", 6, 0) == UINT64_C(0x85944171f73967e8));
+  TEST_CHECK(hash_fnv1a("bar", 3, hash_fnv1a("foo", 3, 0)) == hash_fnv1a("foobar", 6, 0));
+}
+
+TEST_LIST = {
+    {"test_hash_fnv1a", test_hash_fnv1a},
+    {NULL, NULL},
+};
@@ -5,243 +5,443 @@
 #include <ovarray.h>
 #include <ovnum.h>
 #include <ovprintf.h>
+#include <ovthreads.h>
 #include <ovutil/win32.h>
 
+#include "exobuilder.h"
+#include "exochunk.h"
+#include "exowriter.h"
+#include "frametiming.h"
 #include "i18n.h"
-#include "jsoncommon.h"
+#include "layeralloc.h"
+#include "luaalloc.h"
 #include "luactx.h"
+#include "luapool.h"
+#include "reflow.h"
+#include "subformat.h"
+#include "transcript.h"
 
-struct word {
-  double start;
-  double end;
-  char const *word;
-};
-
-struct segment {
-  double start;
-  double end;
-  char const *text;
-
-  struct word *words;
-  size_t num_words;
+struct json2exo_context {
+  void *userdata;
+  struct json2exo_params const *params;
+  struct luactx *luactx;
+  struct transcript const *transcript;
+  struct layeralloc *layeralloc;
+  int module_index;
 };
 
-#define VERIFY_AND_GET(out_var, obj, key, context, yytype, type)                                                       \
-  do {                                                                                                                 \
-    struct yyjson_val *val = yyjson_obj_get(obj, key);                                                                 \
-    if (!(val) || !(yyjson_is_##yytype(val))) {                                                                        \
-      return emsg_i18nf(err_type_generic,                                                                              \
-                        err_fail,                                                                                      \
-                        L"%1$hs%2$hs%3$hs",                                                                            \
-                        gettext("%1$hs must contain a \"%2$hs\" (type: %3$hs)."),                                      \
-                        context,                                                                                       \
-                        key,                                                                                           \
-                        type);                                                                                         \
-    }                                                                                                                  \
-    out_var = yyjson_get_##yytype(val);                                                                                \
-  } while (0)
-#define VERIFY_AND_GET_NUMBER(out_var, obj, key, context) VERIFY_AND_GET(out_var, obj, key, context, num, "number")
-#define VERIFY_AND_GET_STRING(out_var, obj, key, context) VERIFY_AND_GET(out_var, obj, key, context, str, "string")
-
-static NODISCARD error parse(HANDLE src,
-                             NODISCARD error (*on_segment)(void *const userdata, struct segment const *const),
-                             NODISCARD error (*on_progress)(void *const userdata, int const progress),
-                             void *const userdata) {
-  if (!src || src == INVALID_HANDLE_VALUE || !on_segment) {
-    return errg(err_invalid_arugment);
+static NODISCARD error report_progress(struct json2exo_params const *const params,
+                                       size_t const processed,
+                                       size_t const total) {
+  if (!params->on_progress) {
+    return eok();
+  }
+  if (!params->on_progress(params->userdata, total ? (int)(processed * 10000 / total) : 10000)) {
+    return errg(err_abort);
   }
+  return eok();
+}
 
+static NODISCARD error call_on_start(struct json2exo_context *const ctx, struct exobuilder_header const *const header) {
   error err = eok();
-  char *json = NULL;
-  struct segment segment = {0};
-  struct yyjson_doc *doc = NULL;
-
-  DWORD const size = GetFileSize(src, NULL);
-  if (size == INVALID_FILE_SIZE) {
-    err = errhr(HRESULT_FROM_WIN32(GetLastError()));
+  lua_State *L = luactx_get(ctx->luactx);
+  lua_getfield(L, ctx->module_index, "on_start");
+  if (!lua_isfunction(L, -1)) {
+    err = emsg_i18nf(err_type_generic, err_fail, L"%1$hs", gettext("\"%1$hs\" is not a function."), "on_start");
     goto cleanup;
   }
-
-  err = mem(&json, size + YYJSON_PADDING_SIZE, sizeof(char));
+  lua_newtable(L);
+  lua_pushinteger(L, header->width);
+  lua_setfield(L, -2, "width");
+  lua_pushinteger(L, header->height);
+  lua_setfield(L, -2, "height");
+  lua_pushinteger(L, header->rate);
+  lua_setfield(L, -2, "rate");
+  lua_pushinteger(L, header->scale);
+  lua_setfield(L, -2, "scale");
+  lua_pushinteger(L, header->length);
+  lua_setfield(L, -2, "length");
+  lua_pushinteger(L, header->audio_rate);
+  lua_setfield(L, -2, "audio_rate");
+  lua_pushinteger(L, header->audio_ch);
+  lua_setfield(L, -2, "audio_ch");
+  err = lua_safecall(L, 1, 1);
   if (efailed(err)) {
     err = ethru(err);
     goto cleanup;
   }
+  if (!lua_toboolean(L, -1)) {
+    err = emsg_i18nf(err_type_generic, err_abort, L"%1$hs", gettext("\"%1$hs\" function returned false."), "on_start");
+    goto cleanup;
+  }
+  lua_pop(L, 1);
+cleanup:
+  return err;
+}
 
-  DWORD read = 0;
-  if (!ReadFile(src, json, size, &read, NULL)) {
-    err = errhr(HRESULT_FROM_WIN32(GetLastError()));
+static NODISCARD error on_segment(struct json2exo_context *const ctx,
+                                  struct transcript_segment const *const segment) {
+  error err = eok();
+  lua_State *L = luactx_get(ctx->luactx);
+  lua_getfield(L, ctx->module_index, "on_segment");
+  if (!lua_isfunction(L, -1)) {
+    err = emsg_i18nf(err_type_generic, err_fail, L"%1$hs", gettext("\"%1$hs\" is not a function."), "on_segment");
     goto cleanup;
   }
-  if (read != size) {
-    err = emsg_i18n(err_type_generic, err_fail, gettext("Unable to read the entire file."));
+  lua_push_transcript_segment(L, ctx->transcript, (size_t)(segment - ctx->transcript->segments));
+  err = lua_safecall(L, 1, 1);
+  if (efailed(err)) {
+    err = ethru(err);
     goto cleanup;
   }
+  if (!lua_toboolean(L, -1)) {
+    err =
+        emsg_i18nf(err_type_generic, err_abort, L"%1$hs", gettext("\"%1$hs\" function returned false."), "on_segment");
+    goto cleanup;
+  }
+  lua_pop(L, 1);
+cleanup:
+  return err;
+}
 
-  struct yyjson_read_err read_err;
-  doc = yyjson_read_opts(json, read, YYJSON_READ_INSITU, jsoncommon_get_json_alc(), &read_err);
-  if (!doc) {
-    err = emsg_i18nf(err_type_generic,
-                     err_fail,
-                     L"%1$hs%2$d",
-                     gettext("Unable to parse JSON: %1$hs (line: %2$d)"),
-                     read_err.msg,
-                     read_err.pos);
+/**
+ * Calls on_finalize and leaves its two return values on the stack.
+ */
+static NODISCARD error call_on_finalize(struct json2exo_context *const ctx) {
+  error err = eok();
+  lua_State *L = luactx_get(ctx->luactx);
+  lua_getfield(L, ctx->module_index, "on_finalize");
+  if (!lua_isfunction(L, -1)) {
+    err = emsg_i18nf(err_type_generic, err_fail, L"%1$hs", gettext("\"%1$hs\" is not a function."), "on_finalize");
     goto cleanup;
   }
-  struct yyjson_val *root = yyjson_doc_get_root(doc);
-  if (!root || !yyjson_is_obj(root)) {
-    err = emsg_i18n(err_type_generic, err_fail, gettext("The root of the JSON must be an object."));
+  err = lua_safecall(L, 0, 2);
+  if (efailed(err)) {
+    err = ethru(err);
     goto cleanup;
   }
+cleanup:
+  return err;
+}
 
-  struct yyjson_val *segments = yyjson_obj_get(root, "segments");
-  if (!segments || !yyjson_is_arr(segments)) {
-    err = emsg_i18nf(err_type_generic,
-                     err_fail,
-                     L"%1$hs",
-                     gettext("The root of the JSON must contain a \"%1$hs\" array."),
-                     "segments");
-    goto cleanup;
+/**
+ * Returns true if get_info of the module returns a table with "parallel = true".
+ * Such modules declare that on_segment does not depend on the other segments.
+ */
+static bool is_parallel_module(lua_State *const L, int const module_index) {
+  bool parallel = false;
+  lua_getfield(L, module_index, "get_info");
+  if (!lua_isfunction(L, -1)) {
+    lua_pop(L, 1);
+    return false;
+  }
+  error err = lua_safecall(L, 0, 1);
+  if (efailed(err)) {
+    ereport(err);
+    lua_pop(L, 1);
+    return false;
   }
+  if (lua_istable(L, -1)) {
+    lua_getfield(L, -1, "parallel");
+    parallel = lua_toboolean(L, -1);
+    lua_pop(L, 1);
+  }
+  lua_pop(L, 1);
+  return parallel;
+}
 
-  size_t i, num_segments;
-  struct yyjson_val *elem;
-  yyjson_arr_foreach(segments, i, num_segments, elem) {
-    if (!yyjson_is_obj(elem)) {
-      err = emsg_i18nf(
-          err_type_generic, err_fail, L"%1$hs", gettext("\"%1$hs\" array must contain objects."), "segments");
-      goto cleanup;
-    }
+enum {
+  max_workers = 8,
+  min_segments_per_worker = 32,
+};
 
-    {
-      char const *const context = gettext("\"segment\" object");
-      VERIFY_AND_GET_NUMBER(segment.start, elem, "start", context);
-      VERIFY_AND_GET_NUMBER(segment.end, elem, "end", context);
-      VERIFY_AND_GET_STRING(segment.text, elem, "text", context);
-    }
+static size_t get_num_workers(size_t const num_segments) {
+  SYSTEM_INFO si;
+  GetSystemInfo(&si);
+  size_t n = si.dwNumberOfProcessors;
+  if (n > max_workers) {
+    n = max_workers;
+  }
+  size_t const limit = num_segments / min_segments_per_worker;
+  return n < limit ? n : limit;
+}
 
-    struct yyjson_val *words = yyjson_obj_get(elem, "words");
-    if (!words || !yyjson_is_arr(words)) {
-      err = emsg_i18nf(err_type_generic,
-                       err_fail,
-                       L"%1$hs%2$hs%3$hs",
-                       gettext("%1$hs must contain a \"%2$hs\" (type: %3$hs)."),
-                       gettext("\"segment\" object"),
-                       "words",
-                       "array");
-      goto cleanup;
-    }
+struct parallel_context {
+  struct json2exo_params const *params;
+  struct exobuilder_header const *header;
+  mtx_t mtx;
+  cnd_t cnd;
+  mtx_t log_mtx;
+  size_t processed;
+  size_t finished;
+  atomic_bool aborted;
+};
 
-    segment.num_words = yyjson_arr_size(words);
-    err = OV_ARRAY_GROW(&segment.words, segment.num_words);
-    if (efailed(err)) {
-      err = ethru(err);
+struct worker {
+  struct parallel_context *pc;
+  struct transcript_segment const *segments;
+  size_t num_segments;
+  struct json2exo_context ctx;
+  thrd_t thread;
+  error err;
+};
+
+static NODISCARD error acquire_luactx(struct json2exo_params const *const params,
+                                      void *const userdata,
+                                      void (*on_log_line)(void *const userdata, wchar_t const *const message),
+                                      struct luactx **const lcpp) {
+  if (params->luapool) {
+    return luapool_acquire(params->luapool, userdata, on_log_line, lcpp);
+  }
+  return luactx_create(lcpp,
+                       &(struct luactx_params){
+                           .lua_directory = params->lua_directory,
+                           .cache_directory = params->lua_cache_directory,
+                           .userdata = userdata,
+                           .on_log_line = on_log_line,
+                       });
+}
+
+static void worker_log_line(void *const userdata, wchar_t const *const message) {
+  struct parallel_context *const pc = userdata;
+  if (!pc->params->on_log_line) {
+    return;
+  }
+  mtx_lock(&pc->log_mtx);
+  pc->params->on_log_line(pc->params->userdata, message);
+  mtx_unlock(&pc->log_mtx);
+}
+
+static int worker_main(void *userdata) {
+  struct worker *const w = userdata;
+  struct parallel_context *const pc = w->pc;
+  error err = acquire_luactx(pc->params, pc, worker_log_line, &w->ctx.luactx);
+  if (efailed(err)) {
+    err = ethru(err);
+    goto cleanup;
+  }
+  luactx_set_transcript(w->ctx.luactx, w->ctx.transcript);
+  luactx_set_layeralloc(w->ctx.luactx, w->ctx.layeralloc);
+  luactx_set_parallel(w->ctx.luactx, true);
+  lua_State *L = luactx_get(w->ctx.luactx);
+  err = lua_require_reset(L, pc->params->module);
+  if (efailed(err)) {
+    err = ethru(err);
+    goto cleanup;
+  }
+  w->ctx.module_index = lua_gettop(L);
+  err = call_on_start(&w->ctx, pc->header);
+  if (efailed(err)) {
+    err = ethru(err);
+    goto cleanup;
+  }
+  for (size_t i = 0; i < w->num_segments; ++i) {
+    if (atomic_load(&pc->aborted)) {
+      err = errg(err_abort);
       goto cleanup;
     }
-    OV_ARRAY_SET_LENGTH(segment.words, segment.num_words);
-
-    size_t j, num_words;
-    struct yyjson_val *elem2;
-    yyjson_arr_foreach(words, j, num_words, elem2) {
-      if (!yyjson_is_obj(elem2)) {
-        err =
-            emsg_i18nf(err_type_generic, err_fail, L"%1$hs", gettext("\"%1$hs\" array must contain objects."), "words");
-        goto cleanup;
-      }
-      struct word *const word = &segment.words[j];
-      char const *const context = gettext("\"word\" object");
-      VERIFY_AND_GET_NUMBER(word->start, elem2, "start", context);
-      VERIFY_AND_GET_NUMBER(word->end, elem2, "end", context);
-      VERIFY_AND_GET_STRING(word->word, elem2, "word", context);
-    }
-
-    err = on_segment(userdata, &segment);
+    err = on_segment(&w->ctx, &w->segments[i]);
     if (efailed(err)) {
       err = ethru(err);
       goto cleanup;
     }
-    if (on_progress) {
-      err = on_progress(userdata, (int)((i + 1) * 10000 / num_segments));
-      if (efailed(err)) {
-        err = errg(err_abort);
-        goto cleanup;
-      }
-    }
+    mtx_lock(&pc->mtx);
+    ++pc->processed;
+    cnd_signal(&pc->cnd);
+    mtx_unlock(&pc->mtx);
   }
-cleanup:
-  if (segment.words) {
-    OV_ARRAY_DESTROY(&segment.words);
-  }
-  if (doc) {
-    yyjson_doc_free(doc);
-    doc = NULL;
+  err = call_on_finalize(&w->ctx);
+  if (efailed(err)) {
+    err = ethru(err);
+    goto cleanup;
   }
-  if (json) {
-    ereport(mem_free(&json));
+  if (!lua_isnil(L, -2)) {
+    err = emsg_i18n(err_type_generic,
+                    err_fail,
+                    gettext("Modules running in parallel must write the *.exo with the exo.* functions."));
+    goto cleanup;
   }
-  return err;
+cleanup:
+  if (efailed(err)) {
+    atomic_store(&pc->aborted, true);
+  }
+  w->err = err;
+  mtx_lock(&pc->mtx);
+  ++pc->finished;
+  cnd_signal(&pc->cnd);
+  mtx_unlock(&pc->mtx);
+  return 0;
 }
 
-struct json2exo_context {
-  void *userdata;
-  struct json2exo_params const *params;
-  struct luactx *luactx;
-  int module_index;
-};
+/**
+ * Adds the Lua memory usage of a worker to the total of the stage.
+ */
+static void add_alloc_stats(struct luaalloc_stats *const dest, struct luaalloc_stats const *const src) {
+  // Workers run concurrently, so the sum of their peaks is the worst case.
+  dest->bytes += src->bytes;
+  dest->peak_bytes += src->peak_bytes;
+  dest->arena_bytes += src->arena_bytes;
+  dest->allocations += src->allocations;
+}
 
-static NODISCARD error on_progress(void *const userdata, int const progress) {
-  struct json2exo_context *const ctx = userdata;
-  if (!ctx->params->on_progress) {
-    return eok();
-  }
-  if (!ctx->params->on_progress(ctx->userdata, progress)) {
-    return errg(err_abort);
-  }
-  return eok();
+static void report_alloc_stats(struct json2exo_params const *const params, struct luaalloc_stats const *const stats) {
+  if (!params->on_log_line) {
+    return;
+  }
+  wchar_t msg[1024];
+  mo_snprintf_wchar(msg,
+                    sizeof(msg) / sizeof(msg[0]),
+                    L"%1$d%2$d%3$d",
+                    "Lua memory: peak %1$d KiB, arena %2$d KiB, %3$d allocations",
+                    (int)((stats->peak_bytes + 1023) / 1024),
+                    (int)((stats->arena_bytes + 1023) / 1024),
+                    stats->allocations > INT_MAX ? INT_MAX : (int)stats->allocations);
+  params->on_log_line(params->userdata, msg);
 }
 
-static NODISCARD error on_segment(void *const userdata, struct segment const *const segment) {
-  struct json2exo_context *const ctx = userdata;
-  error err = eok();
-  lua_State *L = luactx_get(ctx->luactx);
-  lua_getfield(L, ctx->module_index, "on_segment");
-  if (!lua_isfunction(L, -1)) {
-    err = emsg_i18nf(err_type_generic, err_fail, L"%1$hs", gettext("\"%1$hs\" is not a function."), "on_segment");
+static void report_layer_stats(struct json2exo_params const *const params, struct layeralloc *const layeralloc) {
+  struct layeralloc_stats stats;
+  layeralloc_get_stats(layeralloc, &stats);
+  if (!params->on_log_line || !stats.allocations) {
+    return;
+  }
+  wchar_t msg[1024];
+  mo_snprintf_wchar(msg,
+                    sizeof(msg) / sizeof(msg[0]),
+                    L"%1$d%2$d%3$d",
+                    "Layer allocation: %1$d objects on layers %2$d to %3$d",
+                    stats.allocations,
+                    stats.layer_min,
+                    stats.layer_max);
+  params->on_log_line(params->userdata, msg);
+}
+
+/**
+ * Runs on_start, on_segment and on_finalize on separate Lua states, each handling a contiguous range of segments,
+ * then appends the objects they have written to dest in the order of the segments.
+ */
+static NODISCARD error run_parallel(struct json2exo_params const *const params,
+                                    struct exobuilder_header const *const header,
+                                    struct transcript const *const t,
+                                    struct layeralloc *const layeralloc,
+                                    size_t const num_workers,
+                                    struct exobuilder *const dest,
+                                    struct luaalloc_stats *const alloc_stats) {
+  struct worker *workers = NULL;
+  size_t started = 0;
+  bool aborted_by_user = false;
+  struct parallel_context pc = {
+      .params = params,
+      .header = header,
+  };
+  atomic_init(&pc.aborted, false);
+  mtx_init(&pc.mtx, mtx_plain);
+  mtx_init(&pc.log_mtx, mtx_plain);
+  cnd_init(&pc.cnd);
+
+  error err = mem(&workers, num_workers, sizeof(struct worker));
+  if (efailed(err)) {
+    err = ethru(err);
     goto cleanup;
   }
-  lua_newtable(L);
-  lua_pushnumber(L, segment->start);
-  lua_setfield(L, -2, "start");
-  lua_pushnumber(L, segment->end);
-  lua_setfield(L, -2, "end");
-  lua_pushstring(L, segment->text);
-  lua_setfield(L, -2, "text");
-  lua_newtable(L);
-  for (size_t i = 0; i < segment->num_words; ++i) {
-    struct word const *const word = &segment->words[i];
-    lua_newtable(L);
-    lua_pushnumber(L, word->start);
-    lua_setfield(L, -2, "start");
-    lua_pushnumber(L, word->end);
-    lua_setfield(L, -2, "end");
-    lua_pushstring(L, word->word);
-    lua_setfield(L, -2, "word");
-    lua_rawseti(L, -2, (int)i + 1);
-  }
-  lua_setfield(L, -2, "words");
-  err = lua_safecall(L, 1, 1);
+  size_t const per_worker = t->num_segments / num_workers;
+  size_t const remainder = t->num_segments % num_workers;
+  size_t pos = 0;
+  for (size_t i = 0; i < num_workers; ++i) {
+    size_t const n = per_worker + (i < remainder ? 1 : 0);
+    workers[i] = (struct worker){
+        .pc = &pc,
+        .segments = t->segments + pos,
+        .num_segments = n,
+        .ctx =
+            {
+                .userdata = params->userdata,
+                .params = params,
+                .transcript = t,
+                .layeralloc = layeralloc,
+            },
+    };
+    pos += n;
+  }
+  for (size_t i = 0; i < num_workers; ++i) {
+    if (thrd_create(&workers[i].thread, worker_main, &workers[i]) != thrd_success) {
+      err = errg(err_fail);
+      atomic_store(&pc.aborted, true);
+      break;
+    }
+    ++started;
+  }
+
+  mtx_lock(&pc.mtx);
+  while (pc.finished < started) {
+    size_t const processed = pc.processed;
+    mtx_unlock(&pc.mtx);
+    if (!atomic_load(&pc.aborted)) {
+      error e = report_progress(params, processed, t->num_segments);
+      if (efailed(e)) {
+        efree(&e);
+        aborted_by_user = true;
+        atomic_store(&pc.aborted, true);
+      }
+    }
+    mtx_lock(&pc.mtx);
+    if (pc.finished < started) {
+      cnd_wait(&pc.cnd, &pc.mtx);
+    }
+  }
+  mtx_unlock(&pc.mtx);
+  for (size_t i = 0; i < started; ++i) {
+    thrd_join(workers[i].thread, NULL);
+  }
+
+  // Prefer the error that caused the abort over the aborts it caused on the other workers.
+  for (size_t i = 0; i < started; ++i) {
+    if (esucceeded(workers[i].err)) {
+      continue;
+    }
+    if (esucceeded(err) || (eisg(err, err_abort) && !eisg(workers[i].err, err_abort))) {
+      efree(&err);
+      err = workers[i].err;
+      workers[i].err = NULL;
+    }
+  }
   if (efailed(err)) {
-    err = ethru(err);
     goto cleanup;
   }
-  if (!lua_toboolean(L, -1)) {
-    err =
-        emsg_i18nf(err_type_generic, err_abort, L"%1$hs", gettext("\"%1$hs\" function returned false."), "on_segment");
+  if (aborted_by_user) {
+    err = errg(err_abort);
+    goto cleanup;
+  }
+  for (size_t i = 0; i < num_workers; ++i) {
+    err = exobuilder_append(dest, luactx_get_exobuilder(workers[i].ctx.luactx));
+    if (efailed(err)) {
+      err = ethru(err);
+      goto cleanup;
+    }
+  }
+  err = report_progress(params, t->num_segments, t->num_segments);
+  if (efailed(err)) {
+    err = ethru(err);
     goto cleanup;
   }
-  lua_pop(L, 1);
 cleanup:
+  if (workers) {
+    for (size_t i = 0; i < num_workers; ++i) {
+      if (efailed(workers[i].err)) {
+        efree(&workers[i].err);
+      }
+      if (workers[i].ctx.luactx) {
+        struct luaalloc_stats stats;
+        luactx_get_alloc_stats(workers[i].ctx.luactx, &stats);
+        add_alloc_stats(alloc_stats, &stats);
+      }
+      luapool_release(params->luapool, &workers[i].ctx.luactx, esucceeded(err));
+    }
+    ereport(mem_free(&workers));
+  }
+  cnd_destroy(&pc.cnd);
+  mtx_destroy(&pc.log_mtx);
+  mtx_destroy(&pc.mtx);
   return err;
 }
 
@@ -353,14 +553,171 @@ static bool find_used_layer_range(
   return true;
 }
 
-static NODISCARD error find_max_time(void *const userdata, struct segment const *const seg) {
-  double *const max_time = userdata;
-  if (seg->end > *max_time) {
-    *max_time = seg->end;
+static NODISCARD error get_stats_from_table(lua_State *const L,
+                                            int const idx,
+                                            int *const num_objects,
+                                            int *const layer_min,
+                                            int *const layer_max,
+                                            int *const frames) {
+  static char const *const keys[] = {"num_objects", "layer_min", "layer_max", "frames"};
+  int *const values[] = {num_objects, layer_min, layer_max, frames};
+  for (size_t i = 0; i < sizeof(keys) / sizeof(keys[0]); ++i) {
+    lua_getfield(L, idx, keys[i]);
+    if (!lua_isnumber(L, -1)) {
+      lua_pop(L, 1);
+      return emsg_i18nf(err_type_generic,
+                        err_fail,
+                        L"%1$hs%2$hs%3$hs",
+                        gettext("%1$hs must contain a \"%2$hs\" (type: %3$hs)."),
+                        gettext("The statistics returned from \"on_finalize\""),
+                        keys[i],
+                        "number");
+    }
+    *values[i] = (int)lua_tointeger(L, -1);
+    lua_pop(L, 1);
   }
   return eok();
 }
 
+#ifndef NDEBUG
+static void verify_stats(struct json2exo_params const *const params,
+                         char const *const exo,
+                         int const num_objects,
+                         int const layer_min,
+                         int const layer_max,
+                         int const frames) {
+  int n = 0, lmin = INT_MAX, lmax = INT_MIN, fmax = INT_MIN;
+  if (!find_used_layer_range(exo, &n, &lmin, &lmax, &fmax)) {
+    return;
+  }
+  if (n == num_objects && lmin == layer_min && lmax == layer_max && fmax == frames) {
+    return;
+  }
+  if (params->on_log_line) {
+    wchar_t msg[1024];
+    mo_snprintf_wchar(msg,
+                      sizeof(msg) / sizeof(msg[0]),
+                      L"%1$d%2$d%3$d%4$d%5$d%6$d%7$d%8$d",
+                      "Statistics mismatch: objects %1$d/%2$d, layer min %3$d/%4$d, layer max %5$d/%6$d, "
+                      "frames %7$d/%8$d",
+                      num_objects,
+                      n,
+                      layer_min,
+                      lmin,
+                      layer_max,
+                      lmax,
+                      frames,
+                      fmax);
+    params->on_log_line(params->userdata, msg);
+  }
+}
+#endif
+
+static NODISCARD error write_sidecars(struct json2exo_params const *const params,
+                                      struct transcript const *const t,
+                                      int const width,
+                                      int const height) {
+  static enum subformat_type const types[] = {subformat_srt, subformat_vtt, subformat_ass};
+  wchar_t *path = NULL;
+  error err = subformat_write_files(t, params->sidecar_formats, width, height, params->sidecar_path);
+  if (efailed(err)) {
+    err = ethru(err);
+    goto cleanup;
+  }
+  if (params->on_log_line) {
+    for (size_t i = 0; i < sizeof(types) / sizeof(types[0]); ++i) {
+      if (!(params->sidecar_formats & (int)types[i])) {
+        continue;
+      }
+      err = subformat_get_path(params->sidecar_path, types[i], &path);
+      if (efailed(err)) {
+        err = ethru(err);
+        goto cleanup;
+      }
+      wchar_t msg[1024];
+      mo_snprintf_wchar(msg, sizeof(msg) / sizeof(msg[0]), L"%1$ls", "Subtitle: %1$ls", path);
+      params->on_log_line(params->userdata, msg);
+    }
+  }
+cleanup:
+  OV_ARRAY_DESTROY(&path);
+  return err;
+}
+
+struct chunk_writer {
+  wchar_t const *exo_path;
+  wchar_t *path;
+  int num_chunks;
+};
+
+static NODISCARD error write_chunk(void *const userdata, struct exochunk const *const chunk) {
+  struct chunk_writer *const cw = userdata;
+  HANDLE h = INVALID_HANDLE_VALUE;
+  error err = exochunk_get_path(cw->exo_path, chunk->index, &cw->path);
+  if (efailed(err)) {
+    err = ethru(err);
+    goto cleanup;
+  }
+  h = CreateFileW(cw->path, GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+  if (h == INVALID_HANDLE_VALUE) {
+    err = errhr(HRESULT_FROM_WIN32(GetLastError()));
+    goto cleanup;
+  }
+  // Count the file before writing so that it is deleted even if the write fails.
+  ++cw->num_chunks;
+  err = exowriter_write_file(h, chunk->ptr, chunk->len);
+  if (efailed(err)) {
+    err = ethru(err);
+    goto cleanup;
+  }
+cleanup:
+  if (h != INVALID_HANDLE_VALUE) {
+    CloseHandle(h);
+  }
+  return err;
+}
+
+static NODISCARD error write_chunks(struct json2exo_params const *const params,
+                                    char const *const exo_utf8,
+                                    size_t const exo_utf8_len,
+                                    int *const num_chunks) {
+  struct chunk_writer cw = {
+      .exo_path = params->exo_path,
+  };
+  error err = exochunk_split(exo_utf8, exo_utf8_len, (size_t)params->chunk_objects, write_chunk, &cw);
+  if (efailed(err)) {
+    err = ethru(err);
+    goto cleanup;
+  }
+  if (params->on_log_line) {
+    wchar_t msg[1024];
+    mo_snprintf_wchar(msg,
+                      sizeof(msg) / sizeof(msg[0]),
+                      L"%1$d%2$d",
+                      "Chunks: %1$d files of up to %2$d objects",
+                      cw.num_chunks,
+                      params->chunk_objects);
+    params->on_log_line(params->userdata, msg);
+  }
+cleanup:
+  OV_ARRAY_DESTROY(&cw.path);
+  *num_chunks = cw.num_chunks;
+  return err;
+}
+
+void json2exo_delete_chunks(wchar_t const *const exo_path, int const num_chunks) {
+  wchar_t *path = NULL;
+  for (int i = 0; i < num_chunks; ++i) {
+    error err = exochunk_get_path(exo_path, (size_t)i, &path);
+    if (efailed(err)) {
+      ereport(err);
+      break;
+    }
+    DeleteFileW(path);
+  }
+  OV_ARRAY_DESTROY(&path);
+}
+
 NODISCARD error json2exo(struct json2exo_params const *const params, struct json2exo_info *const info) {
   if (!params || !params->json_path || !params->lua_directory || !params->module || !params->fp || !params->editp ||
       !info) {
@@ -368,10 +725,11 @@ NODISCARD error json2exo(struct json2exo_params const *const params, struct json
   }
   error err = eok();
   FILE_INFO fi;
-  char *buf = NULL;
-  wchar_t *wbuf = NULL;
-  HANDLE json = INVALID_HANDLE_VALUE;
+  struct transcript t = {0};
   HANDLE exo = INVALID_HANDLE_VALUE;
+  struct luaalloc_stats alloc_stats = {0};
+  struct layeralloc *local_layeralloc = NULL;
+  int num_chunks = 0;
 
   if (params->on_log_line) {
     wchar_t msg[1024];
@@ -384,114 +742,165 @@ NODISCARD error json2exo(struct json2exo_params const *const params, struct json
   struct json2exo_context ctx = {
       .userdata = params->userdata,
       .params = params,
+      .transcript = &t,
   };
 
   if (!params->fp->exfunc->get_file_info(params->editp, &fi)) {
     err = emsg_i18n(err_type_generic, err_fail, gettext("Unable to retrieve file information."));
     goto cleanup;
   }
-  err = luactx_create(&ctx.luactx,
-                      &(struct luactx_params){
-                          .lua_directory = params->lua_directory,
-                          .userdata = params->userdata,
-                          .on_log_line = params->on_log_line,
-                      });
+  err = acquire_luactx(params, params->userdata, params->on_log_line, &ctx.luactx);
   if (efailed(err)) {
     err = ethru(err);
     goto cleanup;
   }
 
   lua_State *L = luactx_get(ctx.luactx);
-  err = lua_require(L, params->module);
+  err = lua_require_reset(L, params->module);
   if (efailed(err)) {
     err = ethru(err);
     goto cleanup;
   }
   ctx.module_index = lua_gettop(L);
 
-  json =
-      CreateFileW(params->json_path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
-  if (json == INVALID_HANDLE_VALUE) {
-    HRESULT hr = HRESULT_FROM_WIN32(GetLastError());
-    if (hr == HRESULT_FROM_WIN32(ERROR_FILE_NOT_FOUND)) {
-      err = emsg_i18nf(
-          err_type_generic, err_not_found, L"%1$ls", gettext("The file \"%1$ls\" is not found."), params->json_path);
-    } else {
-      err = errhr(hr);
-    }
-    goto cleanup;
-  }
-
-  double max_time = 0;
-  err = parse(json, find_max_time, NULL, &max_time);
+  err = transcript_load_file(params->json_path, &t);
   if (efailed(err)) {
     err = ethru(err);
     goto cleanup;
   }
-  if (SetFilePointer(json, 0, NULL, FILE_BEGIN) == INVALID_SET_FILE_POINTER) {
-    err = errhr(HRESULT_FROM_WIN32(GetLastError()));
-    goto cleanup;
-  }
-
-  lua_getfield(L, ctx.module_index, "on_start");
-  if (!lua_isfunction(L, -1)) {
-    err = emsg_i18nf(err_type_generic, err_fail, L"%1$hs", gettext("\"%1$hs\" is not a function."), "on_start");
-    goto cleanup;
+  if (params->reflow) {
+    size_t const num_segments = t.num_segments;
+    err = reflow_apply(&t, params->reflow);
+    if (efailed(err)) {
+      err = ethru(err);
+      goto cleanup;
+    }
+    if (params->on_log_line && t.num_segments != num_segments) {
+      wchar_t msg[1024];
+      mo_snprintf_wchar(msg,
+                        sizeof(msg) / sizeof(msg[0]),
+                        L"%1$d%2$d",
+                        "Reflow: %1$d segments to %2$d segments",
+                        (int)num_segments,
+                        (int)t.num_segments);
+      params->on_log_line(params->userdata, msg);
+    }
   }
-  lua_newtable(L);
-  lua_pushinteger(L, fi.w);
-  lua_setfield(L, -2, "width");
-  lua_pushinteger(L, fi.h);
-  lua_setfield(L, -2, "height");
-  lua_pushinteger(L, fi.video_rate);
-  lua_setfield(L, -2, "rate");
-  lua_pushinteger(L, fi.video_scale);
-  lua_setfield(L, -2, "scale");
-  lua_pushinteger(L, (int)(max_time * fi.video_rate / fi.video_scale));
-  lua_setfield(L, -2, "length");
-  lua_pushinteger(L, fi.audio_rate);
-  lua_setfield(L, -2, "audio_rate");
-  lua_pushinteger(L, fi.audio_ch);
-  lua_setfield(L, -2, "audio_ch");
-  err = lua_safecall(L, 1, 1);
+  err = transcript_build_index(&t);
   if (efailed(err)) {
     err = ethru(err);
     goto cleanup;
   }
-  if (!lua_toboolean(L, -1)) {
-    err = emsg_i18nf(err_type_generic, err_abort, L"%1$hs", gettext("\"%1$hs\" function returned false."), "on_start");
-    goto cleanup;
-  }
-  lua_pop(L, 1);
-
-  err = parse(json, on_segment, on_progress, &ctx);
+  err = frametiming_compute(&t,
+                             &(struct frametiming_params){
+                                 .rate = fi.video_rate,
+                                 .scale = fi.video_scale,
+                                 .min_frames = 1,
+                                 .fill_gaps = true,
+                             });
   if (efailed(err)) {
     err = ethru(err);
     goto cleanup;
   }
-
-  lua_getfield(L, ctx.module_index, "on_finalize");
-  if (!lua_isfunction(L, -1)) {
-    err = emsg_i18nf(err_type_generic, err_fail, L"%1$hs", gettext("\"%1$hs\" is not a function."), "on_finalize");
-    goto cleanup;
-  }
-  err = lua_safecall(L, 0, 1);
+  luactx_set_transcript(ctx.luactx, &t);
+  ctx.layeralloc = params->layeralloc;
+  if (!ctx.layeralloc) {
+    err = layeralloc_create(&local_layeralloc, &(struct layeralloc_params){0});
+    if (efailed(err)) {
+      err = ethru(err);
+      goto cleanup;
+    }
+    ctx.layeralloc = local_layeralloc;
+  }
+  luactx_set_layeralloc(ctx.luactx, ctx.layeralloc);
+
+  struct exobuilder_header const header = {
+      .width = fi.w,
+      .height = fi.h,
+      .rate = fi.video_rate,
+      .scale = fi.video_scale,
+      .length = (int)(t.max_time * fi.video_rate / fi.video_scale),
+      .audio_rate = fi.audio_rate,
+      .audio_ch = fi.audio_ch,
+  };
+  err = call_on_start(&ctx, &header);
   if (efailed(err)) {
     err = ethru(err);
     goto cleanup;
   }
-  size_t exo_utf8_len;
-  char const *exo_utf8 = lua_tolstring(L, -1, &exo_utf8_len);
-  if (!exo_utf8) {
-    err = emsg_i18nf(err_type_generic, err_fail, L"%1$hs", gettext("\"%1$hs\" must return a string."), "on_finalize");
-    goto cleanup;
-  }
 
+  size_t exo_utf8_len;
+  char const *exo_utf8;
   int num_objects = 0, lmin = INT_MAX, lmax = INT_MIN, fmax = INT_MIN;
-  if (!find_used_layer_range(exo_utf8, &num_objects, &lmin, &lmax, &fmax)) {
-    err = emsg_i18n(err_type_generic, err_fail, gettext("Unable to parse the *.exo."));
-    goto cleanup;
+  size_t const num_workers = is_parallel_module(L, ctx.module_index) ? get_num_workers(t.num_segments) : 1;
+  if (num_workers > 1) {
+    if (params->on_log_line) {
+      wchar_t msg[1024];
+      mo_snprintf_wchar(msg, sizeof(msg) / sizeof(msg[0]), L"%1$d", "Parallel mode: %1$d workers", (int)num_workers);
+      params->on_log_line(params->userdata, msg);
+    }
+    err = run_parallel(
+        params, &header, &t, ctx.layeralloc, num_workers, luactx_get_exobuilder(ctx.luactx), &alloc_stats);
+    if (efailed(err)) {
+      err = ethru(err);
+      goto cleanup;
+    }
+    lua_pushnil(L);
+    lua_pushnil(L);
+  } else {
+    for (size_t i = 0; i < t.num_segments; ++i) {
+      err = on_segment(&ctx, &t.segments[i]);
+      if (efailed(err)) {
+        err = ethru(err);
+        goto cleanup;
+      }
+      err = report_progress(params, i + 1, t.num_segments);
+      if (efailed(err)) {
+        err = ethru(err);
+        goto cleanup;
+      }
+    }
+    err = call_on_finalize(&ctx);
+    if (efailed(err)) {
+      err = ethru(err);
+      goto cleanup;
+    }
   }
+  if (lua_isnil(L, -2)) {
+    // The module has written the *.exo through the exo.* functions.
+    struct exobuilder_stats stats;
+    exobuilder_get_stats(luactx_get_exobuilder(ctx.luactx), &stats);
+    exo_utf8 = exobuilder_get(luactx_get_exobuilder(ctx.luactx), &exo_utf8_len);
+    if (!exo_utf8) {
+      err = emsg_i18n(err_type_generic, err_fail, gettext("No objects found in the *.exo."));
+      goto cleanup;
+    }
+    num_objects = stats.num_objects;
+    lmin = stats.layer_min;
+    lmax = stats.layer_max;
+    fmax = stats.frames;
+  } else {
+    exo_utf8 = lua_tolstring(L, -2, &exo_utf8_len);
+    if (!exo_utf8) {
+      err =
+          emsg_i18nf(err_type_generic, err_fail, L"%1$hs", gettext("\"%1$hs\" must return a string."), "on_finalize");
+      goto cleanup;
+    }
+    if (lua_istable(L, -1)) {
+      // The module has reported the statistics by itself.
+      err = get_stats_from_table(L, lua_gettop(L), &num_objects, &lmin, &lmax, &fmax);
+      if (efailed(err)) {
+        err = ethru(err);
+        goto cleanup;
+      }
+    } else if (!find_used_layer_range(exo_utf8, &num_objects, &lmin, &lmax, &fmax)) {
+      err = emsg_i18n(err_type_generic, err_fail, gettext("Unable to parse the *.exo."));
+      goto cleanup;
+    }
+  }
+#ifndef NDEBUG
+  verify_stats(params, exo_utf8, num_objects, lmin, lmax, fmax);
+#endif
   if (!num_objects) {
     err = emsg_i18n(err_type_generic, err_fail, gettext("No objects found in the *.exo."));
     goto cleanup;
@@ -502,56 +911,39 @@ NODISCARD error json2exo(struct json2exo_params const *const params, struct json
     err = errhr(HRESULT_FROM_WIN32(GetLastError()));
     goto cleanup;
   }
-  int wlen = MultiByteToWideChar(CP_UTF8, 0, exo_utf8, (int)exo_utf8_len, NULL, 0);
-  if (wlen == 0) {
-    err = errhr(HRESULT_FROM_WIN32(GetLastError()));
-    goto cleanup;
-  }
-  err = OV_ARRAY_GROW(&wbuf, wlen);
-  if (efailed(err)) {
-    err = ethru(err);
-    goto cleanup;
-  }
-  if (MultiByteToWideChar(CP_UTF8, 0, exo_utf8, (int)exo_utf8_len, wbuf, wlen) == 0) {
-    err = errhr(HRESULT_FROM_WIN32(GetLastError()));
-    goto cleanup;
-  }
-  // The contents of *.exo should be Shift_JIS.
-  // When loading in an environment with a different code page,
-  // it is expected to be translated by the GCMZDrops conversion function.
-  enum {
-    CP_SHIFT_JIS = 932,
-  };
-  int sjislen = WideCharToMultiByte(CP_SHIFT_JIS, 0, wbuf, wlen, NULL, 0, NULL, NULL);
-  if (sjislen == 0) {
-    err = errhr(HRESULT_FROM_WIN32(GetLastError()));
-    goto cleanup;
-  }
-  err = OV_ARRAY_GROW(&buf, sjislen);
+  err = exowriter_write_file(exo, exo_utf8, exo_utf8_len);
   if (efailed(err)) {
     err = ethru(err);
     goto cleanup;
   }
-  if (WideCharToMultiByte(CP_SHIFT_JIS, 0, wbuf, wlen, buf, sjislen, NULL, NULL) == 0) {
-    err = errhr(HRESULT_FROM_WIN32(GetLastError()));
-    goto cleanup;
-  }
-
-  DWORD written = 0;
-  if (!WriteFile(exo, buf, (DWORD)sjislen, &written, NULL)) {
-    err = errhr(HRESULT_FROM_WIN32(GetLastError()));
-    goto cleanup;
+  if (params->chunk_objects > 0 && num_objects > params->chunk_objects) {
+    err = write_chunks(params, exo_utf8, exo_utf8_len, &num_chunks);
+    if (efailed(err)) {
+      err = ethru(err);
+      goto cleanup;
+    }
   }
-  if (written != (DWORD)sjislen) {
-    err = emsg_i18n(err_type_generic, err_fail, gettext("Unable to write the entire file."));
-    goto cleanup;
+  if (params->sidecar_formats && params->sidecar_path) {
+    err = write_sidecars(params, &t, fi.w, fi.h);
+    if (efailed(err)) {
+      err = ethru(err);
+      goto cleanup;
+    }
   }
   *info = (struct json2exo_info){
       .frames = fmax,
       .layer_min = lmin,
       .layer_max = lmax,
       .num_objects = num_objects,
+      .num_chunks = num_chunks,
+      .num_segments = t.num_segments,
+      .num_words = t.num_words,
   };
+  struct luaalloc_stats main_alloc_stats;
+  luactx_get_alloc_stats(ctx.luactx, &main_alloc_stats);
+  add_alloc_stats(&alloc_stats, &main_alloc_stats);
+  report_alloc_stats(params, &alloc_stats);
+  report_layer_stats(params, ctx.layeralloc);
 
 cleanup:
   if (exo != INVALID_HANDLE_VALUE) {
@@ -561,18 +953,13 @@ cleanup:
       DeleteFileW(params->exo_path);
     }
   }
-  if (wbuf) {
-    OV_ARRAY_DESTROY(&wbuf);
-  }
-  if (buf) {
-    OV_ARRAY_DESTROY(&buf);
-  }
-  if (json != INVALID_HANDLE_VALUE) {
-    CloseHandle(json);
-    json = INVALID_HANDLE_VALUE;
+  if (efailed(err)) {
+    json2exo_delete_chunks(params->exo_path, num_chunks);
   }
+  transcript_destroy(&t);
   if (ctx.luactx) {
-    luactx_destroy(&ctx.luactx);
+    luapool_release(params->luapool, &ctx.luactx, esucceeded(err));
   }
+  layeralloc_destroy(&local_layeralloc);
   return err;
 }
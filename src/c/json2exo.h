@@ -4,14 +4,21 @@
 
 #include "aviutl.h"
 
+struct layeralloc;
+struct luapool;
+struct reflow_params;
+
 /**
  * @brief Information about the generated *.exo file.
  */
 struct json2exo_info {
-  int frames;      /**< Total frames of the *.exo file. */
-  int layer_min;   /**< Minimum layer index. */
-  int layer_max;   /**< Maximum layer index. */
-  int num_objects; /**< Number of objects in the *.exo file. */
+  int frames;          /**< Total frames of the *.exo file. */
+  int layer_min;       /**< Minimum layer index. */
+  int layer_max;       /**< Maximum layer index. */
+  int num_objects;     /**< Number of objects in the *.exo file. */
+  int num_chunks;      /**< Number of chunk files written next to the *.exo file, 0 if it was not split. */
+  size_t num_segments; /**< Number of segments after reflow. */
+  size_t num_words;    /**< Number of words in the transcript. */
 };
 
 /**
@@ -20,11 +27,18 @@ struct json2exo_info {
 struct json2exo_params {
   FILTER *fp;
   void *editp;
-  wchar_t const *json_path;     /**< Path to the input *.json file. */
-  wchar_t const *exo_path;      /**< Path to the output *.exo file. */
-  wchar_t const *lua_directory; /**< Directory containing Lua scripts. */
-  wchar_t const *module;        /**< Lua module name used for the conversion process. */
-  void *userdata;               /**< User-defined data passed to the callbacks. */
+  wchar_t const *json_path;           /**< Path to the input *.json file. */
+  wchar_t const *exo_path;            /**< Path to the output *.exo file. */
+  wchar_t const *lua_directory;       /**< Directory containing Lua scripts. */
+  wchar_t const *lua_cache_directory; /**< Directory to keep compiled Lua modules in, NULL to disable the cache. */
+  wchar_t const *module;              /**< Lua module name used for the conversion process. */
+  struct luapool *luapool;            /**< Pool to take Lua states from, NULL to create them for each call. */
+  int sidecar_formats;                /**< Subtitle files to write, see enum subformat_type. */
+  wchar_t const *sidecar_path;        /**< Path the subtitle files are named after by subformat_get_path. */
+  struct reflow_params const *reflow; /**< Limits to reflow the segments before on_segment, NULL to disable. */
+  struct layeralloc *layeralloc;      /**< Allocator for alloc_layer in Lua, NULL to use one without the timeline. */
+  int chunk_objects;                  /**< Maximum number of objects in a chunk file, 0 to write the *.exo only. */
+  void *userdata;                     /**< User-defined data passed to the callbacks. */
   /**
    * @brief Callback function to report progress.
    * @param userdata User-defined data passed to the callback.
@@ -44,6 +58,14 @@ struct json2exo_params {
  * @brief Converts a *.json file to an *.exo file.
  * This function blocks execution until the conversion is complete.
  * The on_progress and on_log_line callbacks are invoked from the same thread as the caller.
+ * If the module returns "parallel = true" from get_info, segments are processed by multiple Lua states on worker
+ * threads. In that case on_log_line may be called from the worker threads, but never concurrently.
+ * The subtitle files selected by sidecar_formats are written next to sidecar_path from the same transcript,
+ * after the *.exo has been written.
+ * Layers taken with alloc_layer in Lua are recorded to the layeralloc, which is shared by all the Lua states.
+ * alloc_layer is not available to parallel modules, so that the layers never depend on thread timing.
+ * If the *.exo has more objects than chunk_objects, it is also split into chunk files named by exochunk_get_path,
+ * which can be dropped one by one. The chunk files are removed if the conversion fails.
  * @note If the on_progress callback returns false, the conversion process is aborted, and the function returns
  * errg(err_abort).
  * @param params Pointer to the parameters required for the conversion.
@@ -51,3 +73,10 @@ struct json2exo_params {
  * @return An error object indicating the success or failure of the conversion process.
  */
 NODISCARD error json2exo(struct json2exo_params const *const params, struct json2exo_info *const info);
+
+/**
+ * @brief Deletes the chunk files written by json2exo.
+ * @param exo_path Path to the *.exo file.
+ * @param num_chunks Number of chunk files, json2exo_info.num_chunks.
+ */
+void json2exo_delete_chunks(wchar_t const *const exo_path, int const num_chunks);
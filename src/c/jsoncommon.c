@@ -1,6 +1,6 @@
 #include "jsoncommon.h"
 
-#include <ovbase.h>
+#include <string.h>
 
 static void *json_malloc(void *ctx, size_t size) {
   (void)ctx;
@@ -38,3 +38,129 @@ struct yyjson_alc const *jsoncommon_get_json_alc(void) {
   };
   return &alc;
 }
+
+struct jsoncommon_arena_chunk {
+  struct jsoncommon_arena_chunk *prev;
+  size_t size;
+  size_t used;
+};
+
+enum {
+  arena_align = 16,
+  arena_header_size = (sizeof(struct jsoncommon_arena_chunk) + arena_align - 1) & ~(size_t)(arena_align - 1),
+  arena_min_chunk_size = 64 * 1024,
+};
+
+static inline size_t arena_round(size_t const size) { return (size + arena_align - 1) & ~(size_t)(arena_align - 1); }
+
+static inline char *arena_data(struct jsoncommon_arena_chunk *const c) { return (char *)c + arena_header_size; }
+
+static bool arena_is_last(struct jsoncommon_arena const *const arena, void const *const ptr) {
+  return ptr && arena->chunk && ptr == arena->last;
+}
+
+static void *arena_malloc(void *ctx, size_t size) {
+  struct jsoncommon_arena *const arena = ctx;
+  size = arena_round(size ? size : 1);
+  struct jsoncommon_arena_chunk *c = arena->chunk;
+  if (!c || c->size - c->used < size) {
+    size_t const chunk_size = size > arena->next_size ? size : arena->next_size;
+    if (chunk_size > SIZE_MAX - arena_header_size) {
+      return NULL;
+    }
+    c = NULL;
+    error err = mem(&c, arena_header_size + chunk_size, sizeof(char));
+    if (efailed(err)) {
+      ereport(err);
+      return NULL;
+    }
+    *c = (struct jsoncommon_arena_chunk){
+        .prev = arena->chunk,
+        .size = chunk_size,
+    };
+    arena->chunk = c;
+    ++arena->num_chunks;
+    if (arena->next_size <= SIZE_MAX / 2) {
+      arena->next_size *= 2;
+    }
+  }
+  void *const ptr = arena_data(c) + c->used;
+  c->used += size;
+  arena->last = ptr;
+  return ptr;
+}
+
+static void *arena_realloc(void *ctx, void *ptr, size_t old_size, size_t size) {
+  struct jsoncommon_arena *const arena = ctx;
+  if (!ptr) {
+    return arena_malloc(ctx, size);
+  }
+  if (arena_is_last(arena, ptr)) {
+    // yyjson mostly grows the block it allocated last, which can be done in place while the chunk has room.
+    struct jsoncommon_arena_chunk *const c = arena->chunk;
+    size_t const offset = (size_t)((char *)ptr - arena_data(c));
+    size_t const rounded = arena_round(size ? size : 1);
+    if (rounded <= c->size - offset) {
+      c->used = offset + rounded;
+      return ptr;
+    }
+  } else if (size <= old_size) {
+    return ptr;
+  }
+  void *const p = arena_malloc(ctx, size);
+  if (!p) {
+    return NULL;
+  }
+  memcpy(p, ptr, old_size < size ? old_size : size);
+  return p;
+}
+
+static void arena_free(void *ctx, void *ptr) {
+  struct jsoncommon_arena *const arena = ctx;
+  if (arena_is_last(arena, ptr)) {
+    arena->chunk->used = (size_t)((char *)ptr - arena_data(arena->chunk));
+    arena->last = NULL;
+  }
+}
+
+NODISCARD error jsoncommon_arena_init(struct jsoncommon_arena *const arena,
+                                      size_t const json_len,
+                                      yyjson_read_flag const flags) {
+  if (!arena) {
+    return errg(err_invalid_arugment);
+  }
+  // yyjson_read_max_memory_usage is far beyond what real documents take, so it only caps the first chunk.
+  // The first chunk fits the input, or a copy of it when it is not parsed in place, and later ones double in size.
+  size_t const max_size = yyjson_read_max_memory_usage(json_len, flags);
+  size_t size = json_len > SIZE_MAX / 2 ? SIZE_MAX / 2 : json_len;
+  if (!(flags & YYJSON_READ_INSITU)) {
+    size *= 2;
+  }
+  if (max_size && size > max_size) {
+    size = max_size;
+  }
+  *arena = (struct jsoncommon_arena){
+      .alc =
+          {
+              .malloc = arena_malloc,
+              .realloc = arena_realloc,
+              .free = arena_free,
+              .ctx = arena,
+          },
+      .next_size = size < arena_min_chunk_size ? arena_min_chunk_size : arena_round(size),
+  };
+  return eok();
+}
+
+void jsoncommon_arena_destroy(struct jsoncommon_arena *const arena) {
+  if (!arena) {
+    return;
+  }
+  struct jsoncommon_arena_chunk *c = arena->chunk;
+  while (c) {
+    struct jsoncommon_arena_chunk *const prev = c->prev;
+    ereport(mem_free(&c));
+    c = prev;
+  }
+  *arena = (struct jsoncommon_arena){0};
+}
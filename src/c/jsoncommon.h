@@ -1,5 +1,7 @@
 #pragma once
 
+#include <ovbase.h>
+
 #ifdef __GNUC__
 #  ifndef __has_warning
 #    define __has_warning(x) 0
@@ -15,3 +17,35 @@
 #endif // __GNUC__
 
 struct yyjson_alc const *jsoncommon_get_json_alc(void);
+
+struct jsoncommon_arena_chunk;
+
+/**
+ * @brief A growable allocator for parsing a single JSON document.
+ *
+ * Memory is carved out of chunks that double in size, and nothing is returned to the heap until the arena is
+ * destroyed, which replaces the many small heap allocations made by yyjson with a few large ones.
+ * The arena must not be moved after jsoncommon_arena_init, and the document must be freed before the arena.
+ */
+struct jsoncommon_arena {
+  struct yyjson_alc alc;                /**< Allocator to pass to yyjson_read_opts. */
+  struct jsoncommon_arena_chunk *chunk; /**< The chunk being filled, linked to the previous ones. */
+  void *last;                           /**< The last block handed out, which can be resized in place. */
+  size_t next_size;                     /**< Size of the next chunk. */
+  size_t num_chunks;                    /**< Number of chunks taken from the heap. */
+};
+
+/**
+ * @brief Prepares an arena for yyjson_read_opts.
+ *
+ * No memory is allocated until yyjson asks for it. The first chunk is sized from the input length.
+ *
+ * @param arena The arena to initialize.
+ * @param json_len Length of the JSON to be parsed.
+ * @param flags The flags that will be passed to yyjson_read_opts.
+ * @return An error code indicating success or failure.
+ */
+NODISCARD error jsoncommon_arena_init(struct jsoncommon_arena *const arena,
+                                      size_t const json_len,
+                                      yyjson_read_flag const flags);
+void jsoncommon_arena_destroy(struct jsoncommon_arena *const arena);
@@ -0,0 +1,151 @@
+#include <ovarray.h>
+#include <ovbase.h>
+#include <ovutil/win32.h>
+
+#include <stdio.h>
+#include <string.h>
+
+#include "jsoncommon.h"
+
+enum {
+  iterations = 20,
+  num_segments = 20000,
+  words_per_segment = 12,
+};
+
+static double now(void) {
+  static LARGE_INTEGER freq;
+  if (!freq.QuadPart) {
+    QueryPerformanceFrequency(&freq);
+  }
+  LARGE_INTEGER c;
+  QueryPerformanceCounter(&c);
+  return (double)c.QuadPart / (double)freq.QuadPart;
+}
+
+struct counter {
+  struct yyjson_alc const *alc;
+  size_t calls;
+};
+
+static void *count_malloc(void *ctx, size_t size) {
+  struct counter *const c = ctx;
+  ++c->calls;
+  return c->alc->malloc(c->alc->ctx, size);
+}
+
+static void *count_realloc(void *ctx, void *ptr, size_t old_size, size_t size) {
+  struct counter *const c = ctx;
+  ++c->calls;
+  return c->alc->realloc(c->alc->ctx, ptr, old_size, size);
+}
+
+static void count_free(void *ctx, void *ptr) {
+  struct counter *const c = ctx;
+  ++c->calls;
+  c->alc->free(c->alc->ctx, ptr);
+}
+
+static struct yyjson_alc counting_alc(struct counter *const c) {
+  return (struct yyjson_alc){
+      .malloc = count_malloc,
+      .realloc = count_realloc,
+      .free = count_free,
+      .ctx = c,
+  };
+}
+
+static NODISCARD error build_transcript(char **const dest) {
+  static char const word[] = "{\"start\":12.34,\"end\":12.56,\"word\":\" word\",\"probability\":0.987}";
+  static char const head[] =
+      "{\"id\":0,\"start\":12.34,\"end\":15.67,\"text\":\" The quick brown fox jumps over the lazy dog.\",\"words\":[";
+  size_t const len = 32 + num_segments * (sizeof(head) + words_per_segment * sizeof(word) + 8);
+  error err = OV_ARRAY_GROW(dest, len);
+  if (efailed(err)) {
+    return ethru(err);
+  }
+  char *p = *dest;
+  p += sprintf(p, "{\"language\":\"en\",\"segments\":[");
+  for (size_t i = 0; i < num_segments; ++i) {
+    p += sprintf(p, "%s%s", i ? "," : "", head);
+    for (size_t j = 0; j < words_per_segment; ++j) {
+      p += sprintf(p, "%s%s", j ? "," : "", word);
+    }
+    p += sprintf(p, "]}");
+  }
+  p += sprintf(p, "]}");
+  OV_ARRAY_SET_LENGTH(*dest, (size_t)(p - *dest));
+  return eok();
+}
+
+int main(void) {
+  char *json = NULL;
+  char *work = NULL;
+  error err = build_transcript(&json);
+  if (efailed(err)) {
+    ereport(err);
+    goto cleanup;
+  }
+  size_t const len = OV_ARRAY_LENGTH(json);
+  err = OV_ARRAY_GROW(&work, len + YYJSON_PADDING_SIZE);
+  if (efailed(err)) {
+    ereport(err);
+    goto cleanup;
+  }
+  memset(work + len, 0, YYJSON_PADDING_SIZE);
+
+  struct counter heap = {.alc = jsoncommon_get_json_alc()};
+  struct yyjson_alc const heap_alc = counting_alc(&heap);
+  double elapsed_heap = 0;
+  for (int i = 0; i < iterations; ++i) {
+    memcpy(work, json, len);
+    double const start = now();
+    struct yyjson_doc *doc = yyjson_read_opts(work, len, YYJSON_READ_INSITU, &heap_alc, NULL);
+    yyjson_doc_free(doc);
+    elapsed_heap += now() - start;
+    if (!doc) {
+      printf("failed to parse\n");
+      goto cleanup;
+    }
+  }
+
+  // Only the chunks reach the heap, the rest is served from the arena.
+  struct counter pool = {0};
+  size_t chunks = 0;
+  double elapsed_arena = 0;
+  for (int i = 0; i < iterations; ++i) {
+    memcpy(work, json, len);
+    double const start = now();
+    struct jsoncommon_arena arena = {0};
+    err = jsoncommon_arena_init(&arena, len, YYJSON_READ_INSITU);
+    if (efailed(err)) {
+      ereport(err);
+      goto cleanup;
+    }
+    pool.alc = &arena.alc;
+    struct yyjson_alc const pool_alc = counting_alc(&pool);
+    struct yyjson_doc *doc = yyjson_read_opts(work, len, YYJSON_READ_INSITU, &pool_alc, NULL);
+    yyjson_doc_free(doc);
+    chunks += arena.num_chunks;
+    jsoncommon_arena_destroy(&arena);
+    elapsed_arena += now() - start;
+    if (!doc) {
+      printf("failed to parse\n");
+      goto cleanup;
+    }
+  }
+
+  printf("transcript: %d segments, %.2f MiB\n", num_segments, (double)len / (1024.0 * 1024.0));
+  printf("heap:  %8.3fms/parse, %6d heap calls/parse\n",
+         elapsed_heap * 1000.0 / iterations,
+         (int)(heap.calls / iterations));
+  printf("arena: %8.3fms/parse, %6d chunks/parse (%d calls served from the arena)\n",
+         elapsed_arena * 1000.0 / iterations,
+         (int)(chunks / iterations),
+         (int)(pool.calls / iterations));
+
+cleanup:
+  OV_ARRAY_DESTROY(&work);
+  OV_ARRAY_DESTROY(&json);
+  return 0;
+}
@@ -0,0 +1,94 @@
+#include <ovtest.h>
+
+#include <string.h>
+
+#include "jsoncommon.h"
+
+static void test_jsoncommon_arena_alloc(void) {
+  struct jsoncommon_arena arena = {0};
+  if (!TEST_SUCCEEDED_F(jsoncommon_arena_init(&arena, 16, YYJSON_READ_INSITU))) {
+    return;
+  }
+  struct yyjson_alc const *const alc = &arena.alc;
+  TEST_CHECK(arena.num_chunks == 0);
+
+  char *a = alc->malloc(alc->ctx, 10);
+  if (!TEST_CHECK(a != NULL)) {
+    goto cleanup;
+  }
+  memset(a, 'a', 10);
+  TEST_CHECK(((uintptr_t)a & 15) == 0);
+  TEST_CHECK(arena.num_chunks == 1);
+
+  // The last block grows in place.
+  char *b = alc->malloc(alc->ctx, 100);
+  if (!TEST_CHECK(b != NULL)) {
+    goto cleanup;
+  }
+  memset(b, 'b', 100);
+  TEST_CHECK(alc->realloc(alc->ctx, b, 100, 1000) == b);
+  TEST_CHECK(b[99] == 'b');
+
+  // Any other block is copied, and keeps its contents.
+  char *a2 = alc->realloc(alc->ctx, a, 10, 20);
+  if (!TEST_CHECK(a2 != NULL && a2 != a)) {
+    goto cleanup;
+  }
+  TEST_CHECK(memcmp(a2, "aaaaaaaaaa", 10) == 0);
+
+  // A block larger than the chunk gets a chunk of its own.
+  size_t const chunks = arena.num_chunks;
+  char *big = alc->malloc(alc->ctx, 1024 * 1024);
+  if (!TEST_CHECK(big != NULL)) {
+    goto cleanup;
+  }
+  memset(big, 'c', 1024 * 1024);
+  TEST_CHECK(arena.num_chunks == chunks + 1);
+  char *big2 = alc->realloc(alc->ctx, big, 1024 * 1024, 4 * 1024 * 1024);
+  if (!TEST_CHECK(big2 != NULL)) {
+    goto cleanup;
+  }
+  TEST_CHECK(big2[1024 * 1024 - 1] == 'c');
+
+  // Freeing the last block lets the next one reuse its space.
+  alc->free(alc->ctx, big2);
+  char *const c = alc->malloc(alc->ctx, 16);
+  TEST_CHECK(c == big2);
+  alc->free(alc->ctx, NULL);
+cleanup:
+  jsoncommon_arena_destroy(&arena);
+  TEST_CHECK(arena.chunk == NULL && arena.num_chunks == 0);
+}
+
+static void test_jsoncommon_arena_parse(void) {
+  static char const src[] = "{\"segments\":[{\"text\":\"a\",\"words\":[1,2,3]},{\"text\":\"b\",\"words\":[]}]}";
+  char json[sizeof(src) + YYJSON_PADDING_SIZE] = {0};
+  memcpy(json, src, sizeof(src));
+  size_t const len = sizeof(src) - 1;
+  struct jsoncommon_arena arena = {0};
+  struct yyjson_doc *doc = NULL;
+  if (!TEST_SUCCEEDED_F(jsoncommon_arena_init(&arena, len, YYJSON_READ_INSITU))) {
+    return;
+  }
+  doc = yyjson_read_opts(json, len, YYJSON_READ_INSITU, &arena.alc, NULL);
+  if (!TEST_CHECK(doc != NULL)) {
+    goto cleanup;
+  }
+  struct yyjson_val *const segments = yyjson_obj_get(yyjson_doc_get_root(doc), "segments");
+  TEST_CHECK(yyjson_arr_size(segments) == 2);
+  TEST_CHECK(strcmp(yyjson_get_str(yyjson_obj_get(yyjson_arr_get(segments, 1), "text")), "b") == 0);
+  TEST_CHECK(yyjson_arr_size(yyjson_obj_get(yyjson_arr_get(segments, 0), "words")) == 3);
+  // A small document fits in the first chunk.
+  TEST_CHECK(arena.num_chunks == 1);
+cleanup:
+  if (doc) {
+    yyjson_doc_free(doc);
+  }
+  jsoncommon_arena_destroy(&arena);
+}
+
+TEST_LIST = {
+    {"test_jsoncommon_arena_alloc", test_jsoncommon_arena_alloc},
+    {"test_jsoncommon_arena_parse", test_jsoncommon_arena_parse},
+    {NULL, NULL},
+};
@@ -0,0 +1,228 @@
+#include "layeralloc.h"
+
+#include <ovarray.h>
+#include <ovthreads.h>
+
+#include <string.h>
+
+#include "exedit.h"
+#include "layerindex.h"
+
+struct span {
+  int start;
+  int end;
+};
+
+struct layer {
+  struct span *spans; // sorted and merged, so both start and end are in ascending order
+  size_t len;
+  size_t cap;
+};
+
+struct layeralloc {
+  struct layeralloc_params params;
+  mtx_t mtx;
+  int num_layers;
+  struct layer layers[layer_length];
+  struct layeralloc_stats stats;
+};
+
+NODISCARD error layeralloc_create(struct layeralloc **const lapp, struct layeralloc_params const *const params) {
+  if (!lapp || *lapp || !params || params->layer_offset < 0 || params->layer_offset >= layer_length) {
+    return errg(err_invalid_arugment);
+  }
+  struct layeralloc *la = NULL;
+  error err = mem(&la, 1, sizeof(struct layeralloc));
+  if (efailed(err)) {
+    return ethru(err);
+  }
+  *la = (struct layeralloc){
+      .params = *params,
+      .num_layers = layer_length - params->layer_offset,
+      .stats =
+          {
+              .layer_min = INT_MAX,
+              .layer_max = INT_MIN,
+          },
+  };
+  mtx_init(&la->mtx, mtx_plain);
+  *lapp = la;
+  return eok();
+}
+
+void layeralloc_destroy(struct layeralloc **const lapp) {
+  if (!lapp || !*lapp) {
+    return;
+  }
+  struct layeralloc *const la = *lapp;
+  for (int i = 0; i < layer_length; ++i) {
+    OV_ARRAY_DESTROY(&la->layers[i].spans);
+  }
+  mtx_destroy(&la->mtx);
+  ereport(mem_free(lapp));
+}
+
+/**
+ * Returns the number of spans that start at or before frame.
+ */
+static size_t count_started(struct layer const *const l, int const frame) {
+  size_t lo = 0, hi = l->len;
+  while (lo < hi) {
+    size_t const mid = lo + (hi - lo) / 2;
+    if (l->spans[mid].start <= frame) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+  return lo;
+}
+
+static bool is_free(struct layeralloc const *const la, int const layer, int const start_frame, int const end_frame) {
+  struct layer const *const l = &la->layers[layer - 1];
+  size_t const n = count_started(l, end_frame);
+  if (n && l->spans[n - 1].end >= start_frame) {
+    return false;
+  }
+  if (!la->params.timeline) {
+    return true;
+  }
+  return layerindex_is_free(la->params.timeline,
+                            la->params.layer_offset + layer - 1,
+                            la->params.frame_offset + start_frame,
+                            la->params.frame_offset + end_frame);
+}
+
+static NODISCARD error take(struct layeralloc *const la, int const layer, int const start_frame, int const end_frame) {
+  struct layer *const l = &la->layers[layer - 1];
+  // Spans in [first, last) overlap the new one and are merged into it.
+  size_t first = 0, hi = l->len;
+  while (first < hi) {
+    size_t const mid = first + (hi - first) / 2;
+    if (l->spans[mid].end < start_frame) {
+      first = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+  size_t const last = count_started(l, end_frame);
+  struct span s = {
+      .start = start_frame,
+      .end = end_frame,
+  };
+  if (first < last) {
+    if (l->spans[first].start < s.start) {
+      s.start = l->spans[first].start;
+    }
+    if (l->spans[last - 1].end > s.end) {
+      s.end = l->spans[last - 1].end;
+    }
+    l->spans[first] = s;
+    memmove(l->spans + first + 1, l->spans + last, (l->len - last) * sizeof(struct span));
+    l->len -= last - first - 1;
+    return eok();
+  }
+  if (l->len == l->cap) {
+    size_t const cap = l->cap ? l->cap * 2 : 16;
+    error err = OV_ARRAY_GROW(&l->spans, cap);
+    if (efailed(err)) {
+      return ethru(err);
+    }
+    l->cap = cap;
+  }
+  memmove(l->spans + first + 1, l->spans + first, (l->len - first) * sizeof(struct span));
+  l->spans[first] = s;
+  ++l->len;
+  return eok();
+}
+
+NODISCARD error layeralloc_add(struct layeralloc *const la, int const layer, int const start_frame, int const end_frame) {
+  if (!la || start_frame > end_frame) {
+    return errg(err_invalid_arugment);
+  }
+  if (layer < 1 || layer > la->num_layers) {
+    // The object cannot be placed on the timeline anyway, so there is nothing to avoid.
+    return eok();
+  }
+  mtx_lock(&la->mtx);
+  error err = take(la, layer, start_frame, end_frame);
+  mtx_unlock(&la->mtx);
+  if (efailed(err)) {
+    return ethru(err);
+  }
+  return eok();
+}
+
+NODISCARD error layeralloc_alloc(
+    struct layeralloc *const la, int const start_frame, int const end_frame, int const count, int *const layer) {
+  if (!la || start_frame > end_frame || count < 1 || !layer) {
+    return errg(err_invalid_arugment);
+  }
+  error err = eok();
+  mtx_lock(&la->mtx);
+  int found = 0;
+  int run = 0;
+  for (int l = 1; l <= la->num_layers; ++l) {
+    if (!is_free(la, l, start_frame, end_frame)) {
+      run = 0;
+      continue;
+    }
+    if (++run == count) {
+      found = l - count + 1;
+      break;
+    }
+  }
+  if (!found) {
+    err = errg(err_not_found);
+    goto cleanup;
+  }
+  for (int l = found; l < found + count; ++l) {
+    err = take(la, l, start_frame, end_frame);
+    if (efailed(err)) {
+      err = ethru(err);
+      goto cleanup;
+    }
+  }
+  ++la->stats.allocations;
+  if (found < la->stats.layer_min) {
+    la->stats.layer_min = found;
+  }
+  if (found + count - 1 > la->stats.layer_max) {
+    la->stats.layer_max = found + count - 1;
+  }
+  *layer = found;
+cleanup:
+  mtx_unlock(&la->mtx);
+  return err;
+}
+
+bool layeralloc_fits(struct layeralloc *const la, struct layerindex const *const timeline) {
+  if (!la || !timeline) {
+    return false;
+  }
+  bool r = true;
+  mtx_lock(&la->mtx);
+  for (int l = 1; r && l <= la->num_layers; ++l) {
+    struct layer const *const layer = &la->layers[l - 1];
+    for (size_t i = 0; i < layer->len; ++i) {
+      if (!layerindex_is_free(timeline,
+                              la->params.layer_offset + l - 1,
+                              la->params.frame_offset + layer->spans[i].start,
+                              la->params.frame_offset + layer->spans[i].end)) {
+        r = false;
+        break;
+      }
+    }
+  }
+  mtx_unlock(&la->mtx);
+  return r;
+}
+
+void layeralloc_get_stats(struct layeralloc *const la, struct layeralloc_stats *const stats) {
+  if (!la || !stats) {
+    return;
+  }
+  mtx_lock(&la->mtx);
+  *stats = la->stats;
+  mtx_unlock(&la->mtx);
+}
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <ovbase.h>
+
+struct layeralloc;
+struct layerindex;
+
+/**
+ * @brief Where the *.exo is going to be dropped on the timeline.
+ */
+struct layeralloc_params {
+  struct layerindex const *timeline; /**< Occupancy of the timeline, NULL to consider the emitted objects only. */
+  int frame_offset;                  /**< Added to the frames of the *.exo to get the frames on the timeline. */
+  int layer_offset;                  /**< Layer on the timeline of the layer 1 of the *.exo, 0-based. */
+};
+
+/**
+ * @brief Statistics of the layers allocated with layeralloc_alloc.
+ */
+struct layeralloc_stats {
+  int allocations; /**< Number of successful layeralloc_alloc calls. */
+  int layer_min;   /**< Minimum allocated layer of the *.exo, INT_MAX if no allocations. */
+  int layer_max;   /**< Maximum allocated layer of the *.exo, INT_MIN if no allocations. */
+};
+
+/**
+ * @brief Creates a layer allocator that places objects of the *.exo into the gaps of the timeline.
+ *
+ * Each layer keeps the frame ranges taken by the emitted objects, merged and sorted, so both the timeline and the
+ * emitted objects can be checked with a binary search. The allocator is a first-fit greedy colouring of the
+ * interval graph, which uses as few layers as the maximum overlap when the ranges are allocated in order of the
+ * first frame and the timeline is empty.
+ * All functions can be called from multiple threads.
+ *
+ * @param lapp A pointer to receive the allocator.
+ * @param params Where the *.exo is going to be dropped. The timeline must outlive the allocator.
+ * @return An error code indicating success or failure.
+ */
+NODISCARD error layeralloc_create(struct layeralloc **const lapp, struct layeralloc_params const *const params);
+void layeralloc_destroy(struct layeralloc **const lapp);
+
+/**
+ * @brief Records an object placed on a fixed layer, so that later allocations avoid it.
+ *
+ * @param la The allocator.
+ * @param layer Layer of the *.exo, 1-based.
+ * @param start_frame First frame of the object in the *.exo, 1-based.
+ * @param end_frame Last frame of the object in the *.exo.
+ * @return An error code indicating success or failure.
+ */
+NODISCARD error layeralloc_add(struct layeralloc *const la, int const layer, int const start_frame, int const end_frame);
+
+/**
+ * @brief Finds the first consecutive layers that are free over the range and takes them.
+ *
+ * @param la The allocator.
+ * @param start_frame First frame of the object in the *.exo, 1-based.
+ * @param end_frame Last frame of the object in the *.exo.
+ * @param count Number of consecutive layers to take.
+ * @param layer A pointer to receive the first taken layer of the *.exo, 1-based.
+ * @return An error code indicating success or failure, err_not_found if there is no room left.
+ */
+NODISCARD error layeralloc_alloc(
+    struct layeralloc *const la, int const start_frame, int const end_frame, int const count, int *const layer);
+
+/**
+ * @brief Checks whether all recorded objects are still free to place on the timeline.
+ *
+ * The timeline may have been edited since the allocator was created, so this is checked again before dropping.
+ *
+ * @param la The allocator.
+ * @param timeline Current occupancy of the timeline.
+ * @return true if no recorded object overlaps an object on the timeline.
+ */
+bool layeralloc_fits(struct layeralloc *const la, struct layerindex const *const timeline);
+
+void layeralloc_get_stats(struct layeralloc *const la, struct layeralloc_stats *const stats);
@@ -0,0 +1,145 @@
+#include <ovtest.h>
+
+#include "exedit.h"
+#include "layeralloc.h"
+#include "layerindex.h"
+
+struct timeline {
+  struct exedit_object objects[16];
+  struct exedit_object const *sorted[16];
+  int32_t begin_index[layer_length];
+  int32_t end_index[layer_length];
+  size_t num_objects;
+};
+
+static void timeline_init(struct timeline *const tl) {
+  tl->num_objects = 0;
+  for (int i = 0; i < layer_length; ++i) {
+    tl->begin_index[i] = 0;
+    tl->end_index[i] = -1;
+  }
+}
+
+static void timeline_add(struct timeline *const tl, int const layer, int const frame_begin, int const frame_end) {
+  size_t const idx = tl->num_objects++;
+  tl->objects[idx] = (struct exedit_object){
+      .frame_begin = frame_begin,
+      .frame_end = frame_end,
+  };
+  tl->sorted[idx] = &tl->objects[idx];
+  if (tl->end_index[layer] < tl->begin_index[layer]) {
+    tl->begin_index[layer] = (int32_t)idx;
+  }
+  tl->end_index[layer] = (int32_t)idx;
+}
+
+static int alloc(struct layeralloc *const la, int const start_frame, int const end_frame, int const count) {
+  int layer = 0;
+  if (!TEST_SUCCEEDED_F(layeralloc_alloc(la, start_frame, end_frame, count, &layer))) {
+    return 0;
+  }
+  return layer;
+}
+
+static void test_layeralloc_without_timeline(void) {
+  struct layeralloc *la = NULL;
+  if (!TEST_SUCCEEDED_F(layeralloc_create(&la, &(struct layeralloc_params){0}))) {
+    return;
+  }
+  // Overlaps at most 2 at a time, so 2 layers are enough when allocated in order of the first frame.
+  TEST_CHECK(alloc(la, 1, 10, 1) == 1);
+  TEST_CHECK(alloc(la, 5, 15, 1) == 2);
+  TEST_CHECK(alloc(la, 11, 20, 1) == 1);
+  TEST_CHECK(alloc(la, 16, 30, 1) == 2);
+  TEST_CHECK(alloc(la, 21, 25, 1) == 1);
+  TEST_CHECK(alloc(la, 26, 40, 1) == 1);
+  // Merged spans still block the whole range.
+  TEST_CHECK(alloc(la, 1, 40, 1) == 3);
+  struct layeralloc_stats stats;
+  layeralloc_get_stats(la, &stats);
+  TEST_CHECK(stats.allocations == 7);
+  TEST_CHECK(stats.layer_min == 1);
+  TEST_CHECK(stats.layer_max == 3);
+  layeralloc_destroy(&la);
+}
+
+static void test_layeralloc_with_timeline(void) {
+  struct timeline tl;
+  timeline_init(&tl);
+  timeline_add(&tl, 2, 0, 99);
+  timeline_add(&tl, 3, 200, 299);
+  timeline_add(&tl, 4, 0, 49);
+  struct layerindex *li = NULL;
+  struct layeralloc *la = NULL;
+  if (!TEST_SUCCEEDED_F(layerindex_create(&li, tl.sorted, tl.begin_index, tl.end_index))) {
+    goto cleanup;
+  }
+  // The *.exo is dropped at frame 100 on the layer 3, so the frame 1 of the *.exo is the frame 100.
+  if (!TEST_SUCCEEDED_F(layeralloc_create(&la,
+                                          &(struct layeralloc_params){
+                                              .timeline = li,
+                                              .frame_offset = 99,
+                                              .layer_offset = 2,
+                                          }))) {
+    goto cleanup;
+  }
+  TEST_CHECK(alloc(la, 1, 100, 1) == 1);
+  TEST_CHECK(alloc(la, 101, 150, 1) == 1);
+  TEST_CHECK(alloc(la, 101, 150, 1) == 3);
+  TEST_CHECK(alloc(la, 151, 200, 2) == 3);
+  if (TEST_SUCCEEDED_F(layeralloc_add(la, 1, 151, 160))) {
+    TEST_CHECK(alloc(la, 155, 156, 1) == 5);
+  }
+  TEST_CHECK(layeralloc_fits(la, li));
+
+  // Someone has put an object at the allocated place meanwhile.
+  timeline_add(&tl, 5, 260, 260);
+  struct layerindex *li2 = NULL;
+  if (TEST_SUCCEEDED_F(layerindex_create(&li2, tl.sorted, tl.begin_index, tl.end_index))) {
+    TEST_CHECK(!layeralloc_fits(la, li2));
+    layerindex_destroy(&li2);
+  }
+cleanup:
+  layeralloc_destroy(&la);
+  layerindex_destroy(&li);
+}
+
+static void test_layeralloc_no_room(void) {
+  struct layeralloc *la = NULL;
+  if (!TEST_SUCCEEDED_F(layeralloc_create(&la, &(struct layeralloc_params){.layer_offset = layer_length - 2}))) {
+    return;
+  }
+  TEST_CHECK(alloc(la, 1, 10, 2) == 1);
+  int layer = 0;
+  TEST_EISG_F(layeralloc_alloc(la, 10, 20, 1, &layer), err_not_found);
+  TEST_CHECK(alloc(la, 11, 20, 1) == 1);
+  TEST_EISG_F(layeralloc_alloc(la, 1, 1, 3, &layer), err_not_found);
+  // Objects out of the timeline are ignored.
+  TEST_SUCCEEDED_F(layeralloc_add(la, 3, 1, 100));
+  layeralloc_destroy(&la);
+}
+
+static void test_layeralloc_invalid_argument(void) {
+  struct layeralloc *la = NULL;
+  int layer;
+  TEST_EISG_F(layeralloc_create(NULL, &(struct layeralloc_params){0}), err_invalid_arugment);
+  TEST_EISG_F(layeralloc_create(&la, NULL), err_invalid_arugment);
+  TEST_EISG_F(layeralloc_create(&la, &(struct layeralloc_params){.layer_offset = layer_length}), err_invalid_arugment);
+  if (!TEST_SUCCEEDED_F(layeralloc_create(&la, &(struct layeralloc_params){0}))) {
+    return;
+  }
+  TEST_EISG_F(layeralloc_alloc(la, 10, 9, 1, &layer), err_invalid_arugment);
+  TEST_EISG_F(layeralloc_alloc(la, 1, 9, 0, &layer), err_invalid_arugment);
+  TEST_EISG_F(layeralloc_alloc(la, 1, 9, 1, NULL), err_invalid_arugment);
+  TEST_EISG_F(layeralloc_add(la, 1, 10, 9), err_invalid_arugment);
+  TEST_CHECK(!layeralloc_fits(la, NULL));
+  layeralloc_destroy(&la);
+}
+
+TEST_LIST = {
+    {"test_layeralloc_without_timeline", test_layeralloc_without_timeline},
+    {"test_layeralloc_with_timeline", test_layeralloc_with_timeline},
+    {"test_layeralloc_no_room", test_layeralloc_no_room},
+    {"test_layeralloc_invalid_argument", test_layeralloc_invalid_argument},
+    {NULL, NULL},
+};
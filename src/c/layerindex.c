@@ -0,0 +1,145 @@
+#include "layerindex.h"
+
+#include <stdlib.h>
+
+#include "exedit.h"
+
+struct range {
+  int begin;
+  int max_end; // maximum end of this and all preceding ranges on the same layer
+};
+
+struct layerindex {
+  size_t offsets[layer_length + 1]; // ranges of the layer are in [offsets[layer], offsets[layer + 1])
+  struct range *ranges;
+};
+
+static int compare_range(void const *const a, void const *const b) {
+  struct range const *const ra = a;
+  struct range const *const rb = b;
+  return ra->begin < rb->begin ? -1 : ra->begin > rb->begin ? 1 : 0;
+}
+
+static void build_layer(struct range *const r, size_t const len, struct exedit_object const *const *const objects) {
+  bool sorted = true;
+  for (size_t i = 0; i < len; ++i) {
+    r[i] = (struct range){
+        .begin = objects[i]->frame_begin,
+        .max_end = objects[i]->frame_end,
+    };
+    if (i && r[i - 1].begin > r[i].begin) {
+      sorted = false;
+    }
+  }
+  if (!sorted) {
+    qsort(r, len, sizeof(struct range), compare_range);
+  }
+  for (size_t i = 1; i < len; ++i) {
+    if (r[i - 1].max_end > r[i].max_end) {
+      r[i].max_end = r[i - 1].max_end;
+    }
+  }
+}
+
+NODISCARD error layerindex_create(struct layerindex **const lipp,
+                                  struct exedit_object const *const *const sorted_objects,
+                                  int32_t const *const layer_begin_index,
+                                  int32_t const *const layer_end_index) {
+  if (!lipp || *lipp || !layer_begin_index || !layer_end_index) {
+    return errg(err_invalid_arugment);
+  }
+  struct layerindex *li = NULL;
+  error err = mem(&li, 1, sizeof(struct layerindex));
+  if (efailed(err)) {
+    err = ethru(err);
+    goto cleanup;
+  }
+  *li = (struct layerindex){0};
+  size_t n = 0;
+  for (int layer = 0; layer < layer_length; ++layer) {
+    li->offsets[layer] = n;
+    int32_t const sidx = layer_begin_index[layer];
+    int32_t const eidx = layer_end_index[layer];
+    if (sidx >= 0 && sidx <= eidx) {
+      n += (size_t)(eidx - sidx + 1);
+    }
+  }
+  li->offsets[layer_length] = n;
+  if (n) {
+    if (!sorted_objects) {
+      err = errg(err_invalid_arugment);
+      goto cleanup;
+    }
+    err = mem(&li->ranges, n, sizeof(struct range));
+    if (efailed(err)) {
+      err = ethru(err);
+      goto cleanup;
+    }
+    for (int layer = 0; layer < layer_length; ++layer) {
+      size_t const len = li->offsets[layer + 1] - li->offsets[layer];
+      if (len) {
+        build_layer(li->ranges + li->offsets[layer], len, sorted_objects + layer_begin_index[layer]);
+      }
+    }
+  }
+  *lipp = li;
+  li = NULL;
+cleanup:
+  if (li) {
+    layerindex_destroy(&li);
+  }
+  return err;
+}
+
+void layerindex_destroy(struct layerindex **const lipp) {
+  if (!lipp || !*lipp) {
+    return;
+  }
+  struct layerindex *const li = *lipp;
+  if (li->ranges) {
+    ereport(mem_free(&li->ranges));
+  }
+  ereport(mem_free(lipp));
+}
+
+bool layerindex_is_free(struct layerindex const *const li, int const layer, int const start_frame, int const end_frame) {
+  if (!li || layer < 0 || layer >= layer_length) {
+    return false;
+  }
+  struct range const *const r = li->ranges + li->offsets[layer];
+  size_t lo = 0, hi = li->offsets[layer + 1] - li->offsets[layer];
+  // Finds the number of ranges that begin at or before end_frame.
+  while (lo < hi) {
+    size_t const mid = lo + (hi - lo) / 2;
+    if (r[mid].begin <= end_frame) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+  // The ranges after them begin too late, and one of them overlaps if any of them ends at or after start_frame.
+  return lo == 0 || r[lo - 1].max_end < start_frame;
+}
+
+int layerindex_find_space(struct layerindex const *const li,
+                          int const start_frame,
+                          int const end_frame,
+                          int const required_spaces,
+                          int const search_offset,
+                          bool const last) {
+  int target_layer = -1;
+  int found_spaces = 0;
+  for (int layer = search_offset > 0 ? search_offset : 0; layer < layer_length; ++layer) {
+    if (!layerindex_is_free(li, layer, start_frame, end_frame)) {
+      found_spaces = 0;
+      continue;
+    }
+    if (++found_spaces == required_spaces) {
+      target_layer = layer - required_spaces;
+      if (!last) {
+        break;
+      }
+    }
+  }
+  return target_layer + 1;
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <ovbase.h>
+
+struct exedit_object;
+struct layerindex;
+
+/**
+ * @brief Builds an occupancy index of the timeline to find free layers.
+ *
+ * The frame ranges of the objects are stored per layer, sorted by the first frame and augmented with the maximum
+ * last frame so far, so whether a layer is free over a range can be answered with a binary search.
+ * Objects outside [begin_index, end_index] of each layer are ignored, and a layer whose end_index is less than
+ * begin_index is empty.
+ *
+ * @param lipp A pointer to receive the index.
+ * @param sorted_objects Objects of the scene sorted by layer, as active_scene_sorted_object of exedit.
+ * @param layer_begin_index Index of the first object of each layer in sorted_objects, layer_length entries.
+ * @param layer_end_index Index of the last object of each layer in sorted_objects, layer_length entries.
+ * @return An error code indicating success or failure.
+ */
+NODISCARD error layerindex_create(struct layerindex **const lipp,
+                                  struct exedit_object const *const *const sorted_objects,
+                                  int32_t const *const layer_begin_index,
+                                  int32_t const *const layer_end_index);
+void layerindex_destroy(struct layerindex **const lipp);
+
+/**
+ * @brief Checks whether no object on the layer overlaps [start_frame, end_frame].
+ *
+ * @param li The index.
+ * @param layer Layer number, 0-based. Layers out of range are never free.
+ * @param start_frame First frame of the range.
+ * @param end_frame Last frame of the range.
+ * @return true if the layer is free over the range.
+ */
+bool layerindex_is_free(struct layerindex const *const li, int const layer, int const start_frame, int const end_frame);
+
+/**
+ * @brief Finds consecutive free layers over [start_frame, end_frame].
+ *
+ * @param li The index.
+ * @param start_frame First frame of the range.
+ * @param end_frame Last frame of the range.
+ * @param required_spaces Number of consecutive free layers required.
+ * @param search_offset Layer to start the search from, 0-based.
+ * @param last If true, the last run of free layers is used instead of the first one.
+ * @return The first layer of the free layers, 0-based, or 0 if not found.
+ */
+int layerindex_find_space(struct layerindex const *const li,
+                          int const start_frame,
+                          int const end_frame,
+                          int const required_spaces,
+                          int const search_offset,
+                          bool const last);
@@ -0,0 +1,198 @@
+#include <ovtest.h>
+
+#include "exedit.h"
+#include "layerindex.h"
+
+struct timeline {
+  struct exedit_object objects[512];
+  struct exedit_object const *sorted[512];
+  int32_t begin_index[layer_length];
+  int32_t end_index[layer_length];
+  size_t num_objects;
+};
+
+static void timeline_init(struct timeline *const tl) {
+  tl->num_objects = 0;
+  for (int i = 0; i < layer_length; ++i) {
+    tl->begin_index[i] = 0;
+    tl->end_index[i] = -1;
+  }
+}
+
+/**
+ * Objects must be added in the order of layer and then frame_begin, as active_scene_sorted_object of exedit.
+ */
+static void timeline_add(struct timeline *const tl, int const layer, int const frame_begin, int const frame_end) {
+  size_t const idx = tl->num_objects++;
+  tl->objects[idx] = (struct exedit_object){
+      .layer_set = layer,
+      .frame_begin = frame_begin,
+      .frame_end = frame_end,
+  };
+  tl->sorted[idx] = &tl->objects[idx];
+  if (tl->end_index[layer] < tl->begin_index[layer]) {
+    tl->begin_index[layer] = (int32_t)idx;
+  }
+  tl->end_index[layer] = (int32_t)idx;
+}
+
+/**
+ * The linear scan that aviutl_find_space used to do.
+ */
+static int find_space_linear(struct timeline const *const tl,
+                             int const start_frame,
+                             int const end_frame,
+                             int const required_spaces,
+                             int const search_offset,
+                             bool const last) {
+  int target_layer = -1;
+  int found_spaces = 0;
+  for (int layer = search_offset; layer < layer_length; ++layer) {
+    bool blocked = false;
+    for (int32_t oidx = tl->begin_index[layer]; oidx <= tl->end_index[layer]; ++oidx) {
+      int const obegin = tl->sorted[oidx]->frame_begin;
+      int const oend = tl->sorted[oidx]->frame_end;
+      if ((start_frame <= obegin && obegin <= end_frame) || (start_frame <= oend && oend <= end_frame) ||
+          (obegin <= start_frame && end_frame <= oend)) {
+        blocked = true;
+        found_spaces = 0;
+        break;
+      }
+    }
+    if (!blocked) {
+      if (++found_spaces == required_spaces) {
+        target_layer = layer - required_spaces;
+        if (!last) {
+          break;
+        }
+      }
+    }
+  }
+  return target_layer + 1;
+}
+
+static void test_layerindex_is_free(void) {
+  struct timeline tl;
+  timeline_init(&tl);
+  timeline_add(&tl, 0, 0, 99);
+  timeline_add(&tl, 2, 10, 19);
+  timeline_add(&tl, 2, 30, 39);
+  struct layerindex *li = NULL;
+  if (!TEST_SUCCEEDED_F(layerindex_create(&li, tl.sorted, tl.begin_index, tl.end_index))) {
+    return;
+  }
+  TEST_CHECK(!layerindex_is_free(li, 0, 50, 60));
+  TEST_CHECK(layerindex_is_free(li, 0, 100, 200));
+  TEST_CHECK(layerindex_is_free(li, 1, 0, 1000));
+  TEST_CHECK(layerindex_is_free(li, 2, 0, 9));
+  TEST_CHECK(!layerindex_is_free(li, 2, 0, 10));
+  TEST_CHECK(!layerindex_is_free(li, 2, 19, 19));
+  TEST_CHECK(layerindex_is_free(li, 2, 20, 29));
+  TEST_CHECK(!layerindex_is_free(li, 2, 15, 35));
+  TEST_CHECK(!layerindex_is_free(li, 2, 0, 100));
+  TEST_CHECK(layerindex_is_free(li, 2, 40, 100));
+  TEST_CHECK(!layerindex_is_free(li, -1, 0, 0));
+  TEST_CHECK(!layerindex_is_free(li, layer_length, 0, 0));
+  layerindex_destroy(&li);
+}
+
+static void test_layerindex_find_space(void) {
+  struct timeline tl;
+  timeline_init(&tl);
+  timeline_add(&tl, 1, 0, 99);
+  timeline_add(&tl, 4, 50, 59);
+  timeline_add(&tl, 7, 0, 9);
+  struct layerindex *li = NULL;
+  if (!TEST_SUCCEEDED_F(layerindex_create(&li, tl.sorted, tl.begin_index, tl.end_index))) {
+    return;
+  }
+  TEST_CHECK(layerindex_find_space(li, 0, 9, 1, 0, false) == 0);
+  TEST_CHECK(layerindex_find_space(li, 0, 9, 2, 0, false) == 2);
+  TEST_CHECK(layerindex_find_space(li, 50, 59, 3, 0, false) == 5);
+  TEST_CHECK(layerindex_find_space(li, 50, 59, 3, 6, false) == 6);
+  TEST_CHECK(layerindex_find_space(li, 0, 9, 3, 0, true) == 8);
+  TEST_CHECK(layerindex_find_space(li, 0, 9, 100, 0, false) == 0);
+  layerindex_destroy(&li);
+}
+
+static void test_layerindex_same_as_linear(void) {
+  struct timeline tl;
+  timeline_init(&tl);
+  uint32_t seed = 12345;
+  for (int layer = 0; layer < layer_length && tl.num_objects < 500; ++layer) {
+    int frame = 0;
+    for (;;) {
+      seed = seed * 1103515245 + 12345;
+      frame += (int)((seed >> 16) % 200);
+      seed = seed * 1103515245 + 12345;
+      int const len = (int)((seed >> 16) % 100) + 1;
+      if (frame > 1000 || tl.num_objects >= 500) {
+        break;
+      }
+      timeline_add(&tl, layer, frame, frame + len - 1);
+      frame += len;
+    }
+  }
+  struct layerindex *li = NULL;
+  if (!TEST_SUCCEEDED_F(layerindex_create(&li, tl.sorted, tl.begin_index, tl.end_index))) {
+    return;
+  }
+  for (int i = 0; i < 2000; ++i) {
+    seed = seed * 1103515245 + 12345;
+    int const start = (int)((seed >> 16) % 1200);
+    seed = seed * 1103515245 + 12345;
+    int const end = start + (int)((seed >> 16) % 100);
+    seed = seed * 1103515245 + 12345;
+    int const required = (int)((seed >> 16) % 4) + 1;
+    seed = seed * 1103515245 + 12345;
+    int const offset = (int)((seed >> 16) % 50);
+    bool const last = i % 2 == 1;
+    int const expected = find_space_linear(&tl, start, end, required, offset, last);
+    int const got = layerindex_find_space(li, start, end, required, offset, last);
+    if (!TEST_CHECK(got == expected)) {
+      TEST_MSG("[%d, %d] x %d from %d: expected %d, got %d", start, end, required, offset, expected, got);
+      break;
+    }
+  }
+  layerindex_destroy(&li);
+}
+
+static void test_layerindex_unsorted(void) {
+  struct timeline tl;
+  timeline_init(&tl);
+  timeline_add(&tl, 0, 100, 109);
+  timeline_add(&tl, 0, 0, 199);
+  timeline_add(&tl, 0, 50, 59);
+  struct layerindex *li = NULL;
+  if (!TEST_SUCCEEDED_F(layerindex_create(&li, tl.sorted, tl.begin_index, tl.end_index))) {
+    return;
+  }
+  TEST_CHECK(!layerindex_is_free(li, 0, 150, 160));
+  TEST_CHECK(layerindex_is_free(li, 0, 200, 300));
+  layerindex_destroy(&li);
+}
+
+static void test_layerindex_invalid_argument(void) {
+  struct timeline tl;
+  timeline_init(&tl);
+  struct layerindex *li = NULL;
+  TEST_EISG_F(layerindex_create(NULL, tl.sorted, tl.begin_index, tl.end_index), err_invalid_arugment);
+  TEST_EISG_F(layerindex_create(&li, tl.sorted, NULL, tl.end_index), err_invalid_arugment);
+  TEST_EISG_F(layerindex_create(&li, tl.sorted, tl.begin_index, NULL), err_invalid_arugment);
+  timeline_add(&tl, 0, 0, 9);
+  TEST_EISG_F(layerindex_create(&li, NULL, tl.begin_index, tl.end_index), err_invalid_arugment);
+  if (TEST_SUCCEEDED_F(layerindex_create(&li, tl.sorted, tl.begin_index, tl.end_index))) {
+    TEST_EISG_F(layerindex_create(&li, tl.sorted, tl.begin_index, tl.end_index), err_invalid_arugment);
+    layerindex_destroy(&li);
+  }
+  TEST_CHECK(li == NULL);
+}
+
+TEST_LIST = {
+    {"test_layerindex_is_free", test_layerindex_is_free},
+    {"test_layerindex_find_space", test_layerindex_find_space},
+    {"test_layerindex_same_as_linear", test_layerindex_same_as_linear},
+    {"test_layerindex_unsorted", test_layerindex_unsorted},
+    {"test_layerindex_invalid_argument", test_layerindex_invalid_argument},
+    {NULL, NULL},
+};
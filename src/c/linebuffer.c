@@ -0,0 +1,167 @@
+#include "linebuffer.h"
+
+#include <emmintrin.h>
+
+#include <ovarray.h>
+
+#include <string.h>
+
+size_t linebuffer_find_eol_scalar(char const *const ptr, size_t const len) {
+  for (size_t i = 0; i < len; ++i) {
+    if (ptr[i] == '\r' || ptr[i] == '\n') {
+      return i;
+    }
+  }
+  return len;
+}
+
+size_t linebuffer_find_eol(char const *const ptr, size_t const len) {
+  __m128i const cr = _mm_set1_epi8('\r');
+  __m128i const lf = _mm_set1_epi8('\n');
+  size_t i = 0;
+  for (; i + 16 <= len; i += 16) {
+    __m128i const v = _mm_loadu_si128((__m128i const *)(void const *)(ptr + i));
+    __m128i const eol = _mm_or_si128(_mm_cmpeq_epi8(v, cr), _mm_cmpeq_epi8(v, lf));
+    unsigned int const mask = (unsigned int)_mm_movemask_epi8(eol);
+    if (mask) {
+      return i + (size_t)__builtin_ctz(mask);
+    }
+  }
+  return i + linebuffer_find_eol_scalar(ptr + i, len - i);
+}
+
+static NODISCARD error grow(struct linebuffer *const lb, size_t const len) {
+  if (len < lb->cap) {
+    return eok();
+  }
+  size_t cap = lb->cap ? lb->cap : 256;
+  while (cap <= len) {
+    cap *= 2;
+  }
+  error err = OV_ARRAY_GROW(&lb->buf, cap);
+  if (efailed(err)) {
+    return ethru(err);
+  }
+  lb->cap = cap;
+  return eok();
+}
+
+static NODISCARD error deliver(struct linebuffer *const lb) {
+  // The buffer may not be allocated yet if the line is empty.
+  error err = grow(lb, lb->len);
+  if (efailed(err)) {
+    return ethru(err);
+  }
+  lb->buf[lb->len] = '\0';
+  size_t const len = lb->len;
+  lb->len = 0;
+  if (lb->on_line) {
+    lb->on_line(lb->userdata, lb->buf, len);
+  }
+  return eok();
+}
+
+static NODISCARD error append(struct linebuffer *const lb, char const *ptr, size_t len) {
+  size_t const max_length = lb->max_length ? lb->max_length : linebuffer_default_max_length;
+  error err = eok();
+  while (lb->len + len > max_length) {
+    size_t const room = max_length - lb->len;
+    err = grow(lb, max_length);
+    if (efailed(err)) {
+      return ethru(err);
+    }
+    memcpy(lb->buf + lb->len, ptr, room);
+    lb->len = max_length;
+    err = deliver(lb);
+    if (efailed(err)) {
+      return ethru(err);
+    }
+    ptr += room;
+    len -= room;
+  }
+  if (!len) {
+    return eok();
+  }
+  err = grow(lb, lb->len + len);
+  if (efailed(err)) {
+    return ethru(err);
+  }
+  memcpy(lb->buf + lb->len, ptr, len);
+  lb->len += len;
+  return eok();
+}
+
+NODISCARD error linebuffer_write(struct linebuffer *const lb, void const *const ptr, size_t const len) {
+  if (!lb || (!ptr && len)) {
+    return errg(err_invalid_arugment);
+  }
+  char const *p = ptr;
+  size_t rest = len;
+  if (lb->skip_lf && rest) {
+    // The previous write has ended with '\r'.
+    if (*p == '\n') {
+      ++p;
+      --rest;
+    }
+    lb->skip_lf = false;
+  }
+  error err = eok();
+  while (rest) {
+    size_t const n = linebuffer_find_eol(p, rest);
+    err = append(lb, p, n);
+    if (efailed(err)) {
+      return ethru(err);
+    }
+    if (n == rest) {
+      break;
+    }
+    err = deliver(lb);
+    if (efailed(err)) {
+      return ethru(err);
+    }
+    char const c = p[n];
+    p += n + 1;
+    rest -= n + 1;
+    if (c == '\r') {
+      if (!rest) {
+        lb->skip_lf = true;
+      } else if (*p == '\n') {
+        ++p;
+        --rest;
+      }
+    }
+  }
+  return eok();
+}
+
+NODISCARD error linebuffer_flush(struct linebuffer *const lb) {
+  if (!lb) {
+    return errg(err_invalid_arugment);
+  }
+  if (!lb->len) {
+    return eok();
+  }
+  error err = deliver(lb);
+  if (efailed(err)) {
+    return ethru(err);
+  }
+  return eok();
+}
+
+void linebuffer_reset(struct linebuffer *const lb) {
+  if (!lb) {
+    return;
+  }
+  lb->len = 0;
+  lb->skip_lf = false;
+}
+
+void linebuffer_destroy(struct linebuffer *const lb) {
+  if (!lb) {
+    return;
+  }
+  OV_ARRAY_DESTROY(&lb->buf);
+  lb->len = 0;
+  lb->cap = 0;
+  lb->skip_lf = false;
+}
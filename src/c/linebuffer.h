@@ -0,0 +1,72 @@
+#pragma once
+
+#include <ovbase.h>
+
+enum {
+  /**
+   * @brief Maximum length of a line when linebuffer.max_length is 0.
+   */
+  linebuffer_default_max_length = 1024 * 1024,
+};
+
+/**
+ * @brief Splits a byte stream into lines.
+ *
+ * "\r\n", "\r" and "\n" are all line breaks, and "\r\n" split across two writes is still one line break.
+ * The buffer grows as needed, and a line longer than max_length is delivered in pieces of max_length bytes.
+ * Set userdata, on_line and max_length, and zero the rest before the first write.
+ */
+struct linebuffer {
+  void *userdata;    /**< Passed to on_line. */
+  size_t max_length; /**< Maximum length of a line in bytes, 0 to use linebuffer_default_max_length. */
+  /**
+   * @brief Called for each line without the line break.
+   * @param userdata User-defined data.
+   * @param line The line, NUL-terminated. It is valid only during the call.
+   * @param len Length of the line in bytes.
+   */
+  void (*on_line)(void *const userdata, char const *const line, size_t const len);
+
+  char *buf;
+  size_t len;
+  size_t cap;
+  bool skip_lf;
+};
+
+/**
+ * @brief Appends bytes and calls on_line for every completed line.
+ *
+ * @param lb The line buffer.
+ * @param ptr Bytes to append.
+ * @param len Number of bytes.
+ * @return An error code indicating success or failure.
+ */
+NODISCARD error linebuffer_write(struct linebuffer *const lb, void const *const ptr, size_t const len);
+
+/**
+ * @brief Calls on_line for the incomplete line at the end, if any.
+ *
+ * @param lb The line buffer.
+ * @return An error code indicating success or failure.
+ */
+NODISCARD error linebuffer_flush(struct linebuffer *const lb);
+
+/**
+ * @brief Discards the incomplete line and keeps the allocated buffer.
+ */
+void linebuffer_reset(struct linebuffer *const lb);
+
+/**
+ * @brief Frees the buffer.
+ */
+void linebuffer_destroy(struct linebuffer *const lb);
+
+/**
+ * @brief Returns the position of the first '\r' or '\n', or len if there is none.
+ */
+size_t linebuffer_find_eol(char const *const ptr, size_t const len);
+
+/**
+ * @brief The reference implementation of linebuffer_find_eol.
+ */
+size_t linebuffer_find_eol_scalar(char const *const ptr, size_t const len);
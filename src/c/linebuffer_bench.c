@@ -0,0 +1,145 @@
+#include <ovbase.h>
+#include <ovutil/win32.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "linebuffer.h"
+
+enum {
+  iterations = 20,
+  synthetic_lines = 100000,
+};
+
+static double now(void) {
+  static LARGE_INTEGER freq;
+  if (!freq.QuadPart) {
+    QueryPerformanceFrequency(&freq);
+  }
+  LARGE_INTEGER c;
+  QueryPerformanceCounter(&c);
+  return (double)c.QuadPart / (double)freq.QuadPart;
+}
+
+/**
+ * Makes a log that looks like the output of faster-whisper: timestamped segments and progress lines.
+ */
+static char *make_synthetic_log(size_t *const len) {
+  size_t const cap = (size_t)synthetic_lines * 128;
+  char *const buf = malloc(cap);
+  if (!buf) {
+    return NULL;
+  }
+  size_t pos = 0;
+  for (int i = 0; i < synthetic_lines; ++i) {
+    int const s = i * 2;
+    int const n =
+        i % 8 == 7
+            ? snprintf(buf + pos,
+                       cap - pos,
+                       "%3d%% | %d/%d | 00:%02d<00:%02d |  3.11 audio seconds/s\r",
+                       i * 100 / synthetic_lines,
+                       i,
+                       synthetic_lines,
+                       s % 60,
+                       (s + 2) % 60)
+            : snprintf(buf + pos,
+                       cap - pos,
+                       "[%02d:%02d.000 --> %02d:%02d.000]  This is a segment line of the transcript.\r\n",
+                       s / 60 % 60,
+                       s % 60,
+                       (s + 2) / 60 % 60,
+                       (s + 2) % 60);
+    if (n < 0 || (size_t)n >= cap - pos) {
+      break;
+    }
+    pos += (size_t)n;
+  }
+  *len = pos;
+  return buf;
+}
+
+static char *load_file(char const *const path, size_t *const len) {
+  FILE *const f = fopen(path, "rb");
+  if (!f) {
+    return NULL;
+  }
+  char *buf = NULL;
+  if (fseek(f, 0, SEEK_END) == 0) {
+    long const size = ftell(f);
+    if (size > 0 && fseek(f, 0, SEEK_SET) == 0) {
+      buf = malloc((size_t)size);
+      if (buf && fread(buf, 1, (size_t)size, f) != (size_t)size) {
+        free(buf);
+        buf = NULL;
+      }
+      *len = (size_t)size;
+    }
+  }
+  fclose(f);
+  return buf;
+}
+
+static void count_line(void *const userdata, char const *const line, size_t const len) {
+  (void)line;
+  *(size_t *)userdata += len + 1;
+}
+
+static double run_scan(size_t (*find_eol)(char const *const, size_t const), char const *const src, size_t const len) {
+  size_t lines = 0;
+  double const start = now();
+  for (int i = 0; i < iterations; ++i) {
+    for (size_t pos = 0; pos < len;) {
+      pos += find_eol(src + pos, len - pos) + 1;
+      ++lines;
+    }
+  }
+  double const elapsed = now() - start;
+  return lines ? elapsed : 0;
+}
+
+static double run_write(char const *const src, size_t const len, size_t const read_size) {
+  size_t total = 0;
+  struct linebuffer lb = {
+      .userdata = &total,
+      .on_line = count_line,
+  };
+  double const start = now();
+  for (int i = 0; i < iterations; ++i) {
+    for (size_t pos = 0; pos < len; pos += read_size) {
+      size_t const n = len - pos < read_size ? len - pos : read_size;
+      error err = linebuffer_write(&lb, src + pos, n);
+      if (efailed(err)) {
+        ereport(err);
+        break;
+      }
+    }
+  }
+  double const elapsed = now() - start;
+  linebuffer_destroy(&lb);
+  return total ? elapsed : 0;
+}
+
+static double mbps(size_t const len, double const elapsed) {
+  return elapsed > 0 ? (double)len * iterations / elapsed / (1024.0 * 1024.0) : 0.0;
+}
+
+int main(int argc, char **argv) {
+  size_t len = 0;
+  char *const src = argc > 1 ? load_file(argv[1], &len) : make_synthetic_log(&len);
+  if (!src) {
+    fprintf(stderr, "failed to prepare the log\n");
+    return 1;
+  }
+  printf("%s: %d bytes\n", argc > 1 ? argv[1] : "synthetic log", (int)len);
+  double const scalar = run_scan(linebuffer_find_eol_scalar, src, len);
+  double const simd = run_scan(linebuffer_find_eol, src, len);
+  printf("scan: scalar %8.1fMB/s, sse2 %8.1fMB/s\n", mbps(len, scalar), mbps(len, simd));
+  static size_t const read_sizes[] = {1024, 4096, 65536};
+  for (size_t i = 0; i < sizeof(read_sizes) / sizeof(read_sizes[0]); ++i) {
+    printf("write %5d bytes/read: %8.1fMB/s\n", (int)read_sizes[i], mbps(len, run_write(src, len, read_sizes[i])));
+  }
+  free(src);
+  return 0;
+}
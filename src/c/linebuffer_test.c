@@ -0,0 +1,153 @@
+#include <ovtest.h>
+
+#include <string.h>
+
+#include "linebuffer.h"
+
+struct lines {
+  char text[1024];
+  size_t pos;
+  size_t count;
+  bool length_mismatch;
+};
+
+static void on_line(void *const userdata, char const *const line, size_t const len) {
+  struct lines *const l = userdata;
+  if (strlen(line) != len) {
+    l->length_mismatch = true;
+  }
+  if (l->pos + len + 2 < sizeof(l->text)) {
+    memcpy(l->text + l->pos, line, len);
+    l->pos += len;
+    l->text[l->pos++] = '|';
+    l->text[l->pos] = '\0';
+  }
+  ++l->count;
+}
+
+static void write_all(struct linebuffer *const lb, char const *const s) {
+  TEST_SUCCEEDED_F(linebuffer_write(lb, s, strlen(s)));
+}
+
+static void test_linebuffer_line_breaks(void) {
+  struct lines l = {0};
+  struct linebuffer lb = {.userdata = &l, .on_line = on_line};
+  write_all(&lb, "a\nb\r\nc\rd\n\ne");
+  TEST_CHECK(strcmp(l.text, "a|b|c|d||") == 0);
+  TEST_MSG("got %s", l.text);
+  TEST_SUCCEEDED_F(linebuffer_flush(&lb));
+  TEST_CHECK(strcmp(l.text, "a|b|c|d||e|") == 0);
+  TEST_MSG("got %s", l.text);
+  TEST_CHECK(!l.length_mismatch);
+  linebuffer_destroy(&lb);
+}
+
+static void test_linebuffer_crlf_split(void) {
+  struct lines l = {0};
+  struct linebuffer lb = {.userdata = &l, .on_line = on_line};
+  write_all(&lb, "first\r");
+  write_all(&lb, "\nsecond\r");
+  write_all(&lb, "\r");
+  write_all(&lb, "\n");
+  write_all(&lb, "third\r");
+  write_all(&lb, "");
+  write_all(&lb, "\n");
+  TEST_CHECK(strcmp(l.text, "first|second||third|") == 0);
+  TEST_MSG("got %s", l.text);
+  TEST_CHECK(l.count == 4);
+  linebuffer_destroy(&lb);
+}
+
+static void test_linebuffer_split_anywhere(void) {
+  // The result must not depend on how the stream is split into writes.
+  static char const src[] = "[00:00.000 --> 00:02.000] Hello, this is a long enough line to cross the vector width.\r\n"
+                            " 50% | 1/2 | 00:01<00:01 |  3.11 audio seconds/s\r"
+                            "[00:02.000 --> 00:04.000] World\n\n"
+                            "\r\n";
+  struct lines expected = {0};
+  struct linebuffer lb = {.userdata = &expected, .on_line = on_line};
+  write_all(&lb, src);
+  linebuffer_destroy(&lb);
+  for (size_t split = 1; split < sizeof(src) - 1; ++split) {
+    struct lines l = {0};
+    lb = (struct linebuffer){.userdata = &l, .on_line = on_line};
+    TEST_SUCCEEDED_F(linebuffer_write(&lb, src, split));
+    TEST_SUCCEEDED_F(linebuffer_write(&lb, src + split, sizeof(src) - 1 - split));
+    linebuffer_destroy(&lb);
+    if (!TEST_CHECK(strcmp(l.text, expected.text) == 0)) {
+      TEST_MSG("split at %zu: got %s", split, l.text);
+      break;
+    }
+  }
+  TEST_CHECK(expected.count == 5);
+}
+
+static void test_linebuffer_long_line(void) {
+  char src[3000];
+  for (size_t i = 0; i < sizeof(src); ++i) {
+    src[i] = (char)('a' + i % 26);
+  }
+  struct lines l = {0};
+  struct linebuffer lb = {.userdata = &l, .on_line = on_line};
+  // Longer than the old fixed buffer of 1024 bytes, but delivered as one line.
+  TEST_SUCCEEDED_F(linebuffer_write(&lb, src, 500));
+  TEST_SUCCEEDED_F(linebuffer_write(&lb, src + 500, 500));
+  TEST_SUCCEEDED_F(linebuffer_write(&lb, src + 1000, 500));
+  TEST_SUCCEEDED_F(linebuffer_write(&lb, "\n", 1));
+  TEST_CHECK(l.count == 1);
+  TEST_CHECK(!l.length_mismatch);
+  linebuffer_destroy(&lb);
+
+  l = (struct lines){0};
+  lb = (struct linebuffer){.userdata = &l, .on_line = on_line, .max_length = 100};
+  TEST_SUCCEEDED_F(linebuffer_write(&lb, src, 250));
+  TEST_CHECK(l.count == 2);
+  TEST_SUCCEEDED_F(linebuffer_write(&lb, "\n", 1));
+  TEST_CHECK(l.count == 3);
+  TEST_CHECK(l.pos == 250 + 3);
+  TEST_CHECK(!l.length_mismatch);
+  linebuffer_destroy(&lb);
+}
+
+static void test_linebuffer_find_eol(void) {
+  char src[80];
+  for (size_t i = 0; i < sizeof(src); ++i) {
+    src[i] = 'x';
+  }
+  TEST_CHECK(linebuffer_find_eol(src, sizeof(src)) == sizeof(src));
+  for (size_t pos = 0; pos < sizeof(src); ++pos) {
+    for (size_t len = 0; len <= sizeof(src); len += 7) {
+      src[pos] = pos % 2 ? '\r' : '\n';
+      size_t const expected = linebuffer_find_eol_scalar(src, len);
+      size_t const got = linebuffer_find_eol(src, len);
+      src[pos] = 'x';
+      if (!TEST_CHECK(got == expected)) {
+        TEST_MSG("pos %zu len %zu: expected %zu, got %zu", pos, len, expected, got);
+        return;
+      }
+    }
+  }
+}
+
+static void test_linebuffer_reset(void) {
+  struct lines l = {0};
+  struct linebuffer lb = {.userdata = &l, .on_line = on_line};
+  write_all(&lb, "partial\r");
+  linebuffer_reset(&lb);
+  write_all(&lb, "\nnext\n");
+  TEST_CHECK(strcmp(l.text, "partial||next|") == 0);
+  TEST_MSG("got %s", l.text);
+  TEST_EISG_F(linebuffer_write(NULL, "a", 1), err_invalid_arugment);
+  TEST_EISG_F(linebuffer_write(&lb, NULL, 1), err_invalid_arugment);
+  linebuffer_destroy(&lb);
+}
+
+TEST_LIST = {
+    {"test_linebuffer_line_breaks", test_linebuffer_line_breaks},
+    {"test_linebuffer_crlf_split", test_linebuffer_crlf_split},
+    {"test_linebuffer_split_anywhere", test_linebuffer_split_anywhere},
+    {"test_linebuffer_long_line", test_linebuffer_long_line},
+    {"test_linebuffer_find_eol", test_linebuffer_find_eol},
+    {"test_linebuffer_reset", test_linebuffer_reset},
+    {NULL, NULL},
+};
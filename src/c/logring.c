@@ -0,0 +1,158 @@
+#include "logring.h"
+
+#include <stdatomic.h>
+#include <string.h>
+
+/**
+ * A slot is owned by a producer when seq equals the position being written,
+ * and by the consumer when seq equals the position plus one.
+ */
+struct slot {
+  atomic_size_t seq;
+  SYSTEMTIME time;
+  wchar_t *message;
+  size_t cap;
+  bool valid;
+};
+
+struct logring {
+  struct slot *slots;
+  size_t mask;
+  atomic_size_t tail;
+  size_t head;
+  atomic_size_t dropped;
+};
+
+NODISCARD error logring_create(struct logring **const lrp, size_t const capacity) {
+  if (!lrp || *lrp || !capacity || capacity > SIZE_MAX / 2) {
+    return errg(err_invalid_arugment);
+  }
+  size_t n = 2;
+  while (n < capacity) {
+    n *= 2;
+  }
+  struct logring *lr = NULL;
+  error err = mem(&lr, 1, sizeof(struct logring));
+  if (efailed(err)) {
+    err = ethru(err);
+    goto cleanup;
+  }
+  *lr = (struct logring){
+      .mask = n - 1,
+  };
+  err = mem(&lr->slots, n, sizeof(struct slot));
+  if (efailed(err)) {
+    err = ethru(err);
+    goto cleanup;
+  }
+  for (size_t i = 0; i < n; ++i) {
+    lr->slots[i] = (struct slot){0};
+    atomic_init(&lr->slots[i].seq, i);
+  }
+  atomic_init(&lr->tail, 0);
+  atomic_init(&lr->dropped, 0);
+  *lrp = lr;
+  lr = NULL;
+cleanup:
+  if (lr) {
+    logring_destroy(&lr);
+  }
+  return err;
+}
+
+void logring_destroy(struct logring **const lrp) {
+  if (!lrp || !*lrp) {
+    return;
+  }
+  struct logring *const lr = *lrp;
+  if (lr->slots) {
+    for (size_t i = 0; i <= lr->mask; ++i) {
+      if (lr->slots[i].message) {
+        ereport(mem_free(&lr->slots[i].message));
+      }
+    }
+    ereport(mem_free(&lr->slots));
+  }
+  ereport(mem_free(lrp));
+}
+
+bool logring_push(struct logring *const lr, SYSTEMTIME const *const time, wchar_t const *const message) {
+  if (!lr || !time || !message) {
+    return false;
+  }
+  struct slot *s = NULL;
+  size_t pos = atomic_load_explicit(&lr->tail, memory_order_relaxed);
+  for (;;) {
+    s = lr->slots + (pos & lr->mask);
+    size_t const seq = atomic_load_explicit(&s->seq, memory_order_acquire);
+    ptrdiff_t const diff = (ptrdiff_t)(seq - pos);
+    if (diff == 0) {
+      if (atomic_compare_exchange_weak_explicit(
+              &lr->tail, &pos, pos + 1, memory_order_relaxed, memory_order_relaxed)) {
+        break;
+      }
+    } else if (diff < 0) {
+      // The consumer has not taken the line written one lap ago yet.
+      atomic_fetch_add_explicit(&lr->dropped, 1, memory_order_relaxed);
+      return false;
+    } else {
+      pos = atomic_load_explicit(&lr->tail, memory_order_relaxed);
+    }
+  }
+  size_t const len = wcslen(message);
+  s->valid = false;
+  if (len + 1 > s->cap) {
+    size_t cap = s->cap ? s->cap : 64;
+    while (cap < len + 1) {
+      cap *= 2;
+    }
+    error err = mem(&s->message, cap, sizeof(wchar_t));
+    if (efailed(err)) {
+      efree(&err);
+    } else {
+      s->cap = cap;
+    }
+  }
+  if (len + 1 <= s->cap) {
+    memcpy(s->message, message, (len + 1) * sizeof(wchar_t));
+    s->time = *time;
+    s->valid = true;
+  }
+  // The slot has been claimed, so it is published even on failure to keep the order of the following lines.
+  atomic_store_explicit(&s->seq, pos + 1, memory_order_release);
+  if (!s->valid) {
+    atomic_fetch_add_explicit(&lr->dropped, 1, memory_order_relaxed);
+    return false;
+  }
+  return true;
+}
+
+size_t logring_drain(struct logring *const lr,
+                     void (*on_line)(void *const userdata, SYSTEMTIME const *const time, wchar_t const *const message),
+                     void *const userdata) {
+  if (!lr || !on_line) {
+    return 0;
+  }
+  size_t n = 0;
+  for (size_t i = 0; i <= lr->mask; ++i) {
+    size_t const pos = lr->head;
+    struct slot *const s = lr->slots + (pos & lr->mask);
+    if (atomic_load_explicit(&s->seq, memory_order_acquire) != pos + 1) {
+      break;
+    }
+    if (s->valid) {
+      on_line(userdata, &s->time, s->message);
+      ++n;
+    }
+    atomic_store_explicit(&s->seq, pos + lr->mask + 1, memory_order_release);
+    lr->head = pos + 1;
+  }
+  return n;
+}
+
+size_t logring_take_dropped(struct logring *const lr) {
+  if (!lr) {
+    return 0;
+  }
+  return atomic_exchange_explicit(&lr->dropped, 0, memory_order_relaxed);
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <ovbase.h>
+
+#include <ovutil/win32.h>
+
+struct logring;
+
+/**
+ * @brief Creates a bounded queue of log lines that any number of threads can append to without blocking.
+ *
+ * Only one thread may drain the queue. Lines that do not fit are counted as dropped instead of waiting for room.
+ *
+ * @param lrp A pointer to receive the queue.
+ * @param capacity Maximum number of queued lines, rounded up to a power of two.
+ * @return An error code indicating success or failure.
+ */
+NODISCARD error logring_create(struct logring **const lrp, size_t const capacity);
+void logring_destroy(struct logring **const lrp);
+
+/**
+ * @brief Appends a line.
+ *
+ * The line is copied into a buffer owned by the slot, so the allocation is reused once the slot has grown enough.
+ *
+ * @param lr The queue.
+ * @param time Time of the line.
+ * @param message The line, NUL-terminated.
+ * @return true if the line was queued, false if it was dropped because the queue was full or out of memory.
+ */
+bool logring_push(struct logring *const lr, SYSTEMTIME const *const time, wchar_t const *const message);
+
+/**
+ * @brief Takes the queued lines in order.
+ *
+ * At most the capacity of the queue is taken per call, so lines appended while draining do not keep the caller busy.
+ *
+ * @param lr The queue.
+ * @param on_line Called for each line. message is NUL-terminated and valid only during the call.
+ * @param userdata Passed to on_line.
+ * @return Number of lines taken.
+ */
+size_t logring_drain(struct logring *const lr,
+                     void (*on_line)(void *const userdata, SYSTEMTIME const *const time, wchar_t const *const message),
+                     void *const userdata);
+
+/**
+ * @brief Returns the number of dropped lines since the last call and resets it.
+ */
+size_t logring_take_dropped(struct logring *const lr);
@@ -0,0 +1,142 @@
+#include <ovtest.h>
+
+#include <ovthreads.h>
+
+#include <string.h>
+
+#include "logring.h"
+
+struct received {
+  wchar_t lines[64][32];
+  size_t n;
+};
+
+static void on_line(void *const userdata, SYSTEMTIME const *const time, wchar_t const *const message) {
+  (void)time;
+  struct received *const r = userdata;
+  if (r->n < sizeof(r->lines) / sizeof(r->lines[0])) {
+    wcsncpy(r->lines[r->n], message, 31);
+    r->lines[r->n][31] = L'\0';
+  }
+  ++r->n;
+}
+
+static void test_logring_order(void) {
+  struct logring *lr = NULL;
+  if (!TEST_SUCCEEDED_F(logring_create(&lr, 4))) {
+    return;
+  }
+  SYSTEMTIME const st = {.wYear = 2024};
+  struct received r = {0};
+  TEST_CHECK(logring_drain(lr, on_line, &r) == 0);
+  // Go around the ring a few times to reuse the slots.
+  for (int round = 0; round < 3; ++round) {
+    r.n = 0;
+    TEST_CHECK(logring_push(lr, &st, L"first"));
+    TEST_CHECK(logring_push(lr, &st, L"a longer line than the first one to grow the buffer of the slot"));
+    TEST_CHECK(logring_push(lr, &st, L""));
+    TEST_CHECK(logring_drain(lr, on_line, &r) == 3);
+    TEST_CHECK(r.n == 3);
+    TEST_CHECK(wcscmp(r.lines[0], L"first") == 0);
+    TEST_CHECK(wcsncmp(r.lines[1], L"a longer line", 13) == 0);
+    TEST_CHECK(wcscmp(r.lines[2], L"") == 0);
+  }
+  TEST_CHECK(logring_take_dropped(lr) == 0);
+  logring_destroy(&lr);
+  TEST_CHECK(lr == NULL);
+}
+
+static void test_logring_overflow(void) {
+  struct logring *lr = NULL;
+  if (!TEST_SUCCEEDED_F(logring_create(&lr, 3))) {
+    return;
+  }
+  SYSTEMTIME const st = {0};
+  wchar_t buf[16];
+  // The capacity is rounded up to 4.
+  for (int i = 0; i < 6; ++i) {
+    swprintf(buf, sizeof(buf) / sizeof(buf[0]), L"%d", i);
+    TEST_CHECK(logring_push(lr, &st, buf) == (i < 4));
+  }
+  TEST_CHECK(logring_take_dropped(lr) == 2);
+  TEST_CHECK(logring_take_dropped(lr) == 0);
+  struct received r = {0};
+  TEST_CHECK(logring_drain(lr, on_line, &r) == 4);
+  TEST_CHECK(wcscmp(r.lines[0], L"0") == 0);
+  TEST_CHECK(wcscmp(r.lines[3], L"3") == 0);
+  TEST_CHECK(logring_push(lr, &st, L"4"));
+  logring_destroy(&lr);
+}
+
+enum {
+  producers = 4,
+  lines_per_producer = 20000,
+};
+
+struct producer {
+  struct logring *lr;
+  int id;
+};
+
+static int produce(void *const userdata) {
+  struct producer const *const p = userdata;
+  SYSTEMTIME const st = {0};
+  wchar_t buf[32];
+  for (int i = 0; i < lines_per_producer; ++i) {
+    swprintf(buf, sizeof(buf) / sizeof(buf[0]), L"%d %d", p->id, i);
+    while (!logring_push(p->lr, &st, buf)) {
+      thrd_yield();
+    }
+  }
+  return 0;
+}
+
+struct counter {
+  int next[producers];
+  bool ordered;
+  size_t n;
+};
+
+static void count_line(void *const userdata, SYSTEMTIME const *const time, wchar_t const *const message) {
+  (void)time;
+  struct counter *const c = userdata;
+  int id = -1, i = -1;
+  if (swscanf(message, L"%d %d", &id, &i) != 2 || id < 0 || id >= producers || c->next[id] != i) {
+    c->ordered = false;
+  } else {
+    ++c->next[id];
+  }
+  ++c->n;
+}
+
+static void test_logring_threads(void) {
+  struct logring *lr = NULL;
+  if (!TEST_SUCCEEDED_F(logring_create(&lr, 256))) {
+    return;
+  }
+  struct producer p[producers];
+  thrd_t th[producers];
+  for (int i = 0; i < producers; ++i) {
+    p[i] = (struct producer){.lr = lr, .id = i};
+    TEST_CHECK(thrd_create(th + i, produce, p + i) == thrd_success);
+  }
+  struct counter c = {.ordered = true};
+  while (c.n < (size_t)(producers * lines_per_producer)) {
+    if (!logring_drain(lr, count_line, &c)) {
+      thrd_yield();
+    }
+  }
+  for (int i = 0; i < producers; ++i) {
+    thrd_join(th[i], NULL);
+  }
+  TEST_CHECK(c.ordered);
+  TEST_CHECK(c.n == (size_t)(producers * lines_per_producer));
+  logring_destroy(&lr);
+}
+
+TEST_LIST = {
+    {"test_logring_order", test_logring_order},
+    {"test_logring_overflow", test_logring_overflow},
+    {"test_logring_threads", test_logring_threads},
+    {NULL, NULL},
+};
@@ -0,0 +1,320 @@
+#include "logstore.h"
+
+#include <ovarray.h>
+
+#include <string.h>
+
+#include "i18n.h"
+
+enum {
+  initial_chars = 64 * 1024,
+  save_flush_size = 64 * 1024,
+};
+
+struct record {
+  uint64_t time;
+  uint32_t offset;
+  uint32_t len;
+};
+
+struct logstore {
+  struct record *records;
+  size_t max_lines;
+  size_t first;
+  size_t count;
+  uint64_t evicted;
+
+  wchar_t *text;
+  size_t cap;
+  size_t max_chars;
+  size_t tail;
+};
+
+static uint64_t pack_time(SYSTEMTIME const *const st) {
+  return ((uint64_t)st->wYear << 36) | ((uint64_t)(st->wMonth & 0xf) << 32) | ((uint64_t)(st->wDay & 0x1f) << 27) |
+         ((uint64_t)(st->wHour & 0x1f) << 22) | ((uint64_t)(st->wMinute & 0x3f) << 16) |
+         ((uint64_t)(st->wSecond & 0x3f) << 10) | (uint64_t)(st->wMilliseconds & 0x3ff);
+}
+
+static void unpack_time(uint64_t const t, SYSTEMTIME *const st) {
+  *st = (SYSTEMTIME){
+      .wYear = (WORD)(t >> 36),
+      .wMonth = (WORD)((t >> 32) & 0xf),
+      .wDay = (WORD)((t >> 27) & 0x1f),
+      .wHour = (WORD)((t >> 22) & 0x1f),
+      .wMinute = (WORD)((t >> 16) & 0x3f),
+      .wSecond = (WORD)((t >> 10) & 0x3f),
+      .wMilliseconds = (WORD)(t & 0x3ff),
+  };
+}
+
+NODISCARD error logstore_create(struct logstore **const lsp, size_t const max_lines, size_t const max_chars) {
+  if (!lsp || *lsp || !max_lines || max_chars < 2 || max_chars > UINT32_MAX) {
+    return errg(err_invalid_arugment);
+  }
+  struct logstore *ls = NULL;
+  error err = mem(&ls, 1, sizeof(struct logstore));
+  if (efailed(err)) {
+    err = ethru(err);
+    goto cleanup;
+  }
+  *ls = (struct logstore){
+      .max_lines = max_lines,
+      .max_chars = max_chars,
+  };
+  err = mem(&ls->records, max_lines, sizeof(struct record));
+  if (efailed(err)) {
+    err = ethru(err);
+    goto cleanup;
+  }
+  *lsp = ls;
+  ls = NULL;
+cleanup:
+  if (ls) {
+    logstore_destroy(&ls);
+  }
+  return err;
+}
+
+void logstore_destroy(struct logstore **const lsp) {
+  if (!lsp || !*lsp) {
+    return;
+  }
+  struct logstore *const ls = *lsp;
+  if (ls->records) {
+    ereport(mem_free(&ls->records));
+  }
+  if (ls->text) {
+    ereport(mem_free(&ls->text));
+  }
+  ereport(mem_free(lsp));
+}
+
+static struct record *get_record(struct logstore const *const ls, size_t const index) {
+  size_t i = ls->first + index;
+  if (i >= ls->max_lines) {
+    i -= ls->max_lines;
+  }
+  return ls->records + i;
+}
+
+static void evict(struct logstore *const ls) {
+  if (++ls->first == ls->max_lines) {
+    ls->first = 0;
+  }
+  --ls->count;
+  ++ls->evicted;
+}
+
+/**
+ * Finds where a line of need characters can be written, evicting the oldest lines or growing the text buffer.
+ */
+NODISCARD static error reserve(struct logstore *const ls, size_t const need, size_t *const pos) {
+  for (;;) {
+    if (ls->count == 0) {
+      ls->tail = 0;
+    }
+    if (ls->count < ls->max_lines) {
+      size_t const head = ls->count ? get_record(ls, 0)->offset : 0;
+      if (ls->count == 0 || head < ls->tail) {
+        // The text is [head, tail), so there is room after tail and before head.
+        if (ls->tail + need > ls->cap && ls->cap < ls->max_chars) {
+          size_t cap = ls->cap ? ls->cap : initial_chars;
+          while (cap < ls->tail + need) {
+            cap *= 2;
+          }
+          if (cap > ls->max_chars) {
+            cap = ls->max_chars;
+          }
+          error err = mem(&ls->text, cap, sizeof(wchar_t));
+          if (efailed(err)) {
+            return ethru(err);
+          }
+          ls->cap = cap;
+        }
+        if (ls->tail + need <= ls->cap) {
+          *pos = ls->tail;
+          return eok();
+        }
+        if (need <= head) {
+          *pos = 0;
+          return eok();
+        }
+      } else if (ls->tail + need <= head) {
+        // The text has wrapped around, so the only room is between tail and head.
+        *pos = ls->tail;
+        return eok();
+      }
+    }
+    if (!ls->count) {
+      return errg(err_unexpected);
+    }
+    evict(ls);
+  }
+}
+
+NODISCARD error logstore_add(struct logstore *const ls, SYSTEMTIME const *const time, wchar_t const *const message) {
+  if (!ls || !time || !message) {
+    return errg(err_invalid_arugment);
+  }
+  size_t len = wcslen(message);
+  if (len + 1 > ls->max_chars) {
+    len = ls->max_chars - 1;
+  }
+  size_t pos = 0;
+  error err = reserve(ls, len + 1, &pos);
+  if (efailed(err)) {
+    return ethru(err);
+  }
+  memcpy(ls->text + pos, message, len * sizeof(wchar_t));
+  ls->text[pos + len] = L'\0';
+  ls->tail = pos + len + 1;
+  *get_record(ls, ls->count) = (struct record){
+      .time = pack_time(time),
+      .offset = (uint32_t)pos,
+      .len = (uint32_t)len,
+  };
+  ++ls->count;
+  return eok();
+}
+
+size_t logstore_count(struct logstore const *const ls) { return ls ? ls->count : 0; }
+
+uint64_t logstore_evicted(struct logstore const *const ls) { return ls ? ls->evicted : 0; }
+
+wchar_t const *logstore_get(struct logstore const *const ls, size_t const index, SYSTEMTIME *const time) {
+  if (!ls || index >= ls->count) {
+    return NULL;
+  }
+  struct record const *const r = get_record(ls, index);
+  if (time) {
+    unpack_time(r->time, time);
+  }
+  return ls->text + r->offset;
+}
+
+static wchar_t *put_number(wchar_t *p, unsigned int v, int digits) {
+  for (int i = digits - 1; i >= 0; --i) {
+    p[i] = (wchar_t)(L'0' + v % 10);
+    v /= 10;
+  }
+  return p + digits;
+}
+
+size_t logstore_format(struct logstore const *const ls, size_t const index, wchar_t *const buf, size_t const buflen) {
+  if (!buf || !buflen) {
+    return 0;
+  }
+  buf[0] = L'\0';
+  if (!ls || index >= ls->count) {
+    return 0;
+  }
+  struct record const *const r = get_record(ls, index);
+  SYSTEMTIME st;
+  unpack_time(r->time, &st);
+  wchar_t ts[32];
+  wchar_t *p = ts;
+  p = put_number(p, st.wYear, 4);
+  *p++ = L'-';
+  p = put_number(p, st.wMonth, 2);
+  *p++ = L'-';
+  p = put_number(p, st.wDay, 2);
+  *p++ = L' ';
+  p = put_number(p, st.wHour, 2);
+  *p++ = L':';
+  p = put_number(p, st.wMinute, 2);
+  *p++ = L':';
+  p = put_number(p, st.wSecond, 2);
+  *p++ = L'.';
+  p = put_number(p, st.wMilliseconds, 3);
+  *p++ = L' ';
+  *p++ = L' ';
+  size_t const tslen = (size_t)(p - ts);
+  size_t n = tslen < buflen - 1 ? tslen : buflen - 1;
+  memcpy(buf, ts, n * sizeof(wchar_t));
+  size_t const mlen = r->len < buflen - 1 - n ? r->len : buflen - 1 - n;
+  memcpy(buf + n, ls->text + r->offset, mlen * sizeof(wchar_t));
+  n += mlen;
+  buf[n] = L'\0';
+  return n;
+}
+
+NODISCARD static error write_all(HANDLE const h, char const *const data, size_t const len) {
+  DWORD written;
+  if (!WriteFile(h, data, (DWORD)len, &written, NULL)) {
+    return errhr(HRESULT_FROM_WIN32(GetLastError()));
+  }
+  if (written != len) {
+    return emsg_i18n(err_type_generic, err_fail, gettext("Unable to write the entire file."));
+  }
+  return eok();
+}
+
+NODISCARD error logstore_save_file(struct logstore const *const ls, wchar_t const *const path) {
+  if (!ls || !path) {
+    return errg(err_invalid_arugment);
+  }
+  wchar_t *line = NULL;
+  char *out = NULL;
+  size_t used = 0;
+  HANDLE h = INVALID_HANDLE_VALUE;
+  error err = eok();
+  h = CreateFileW(path, GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+  if (h == INVALID_HANDLE_VALUE) {
+    err = errhr(HRESULT_FROM_WIN32(GetLastError()));
+    goto cleanup;
+  }
+  for (size_t i = 0; i < ls->count; ++i) {
+    size_t const cap = get_record(ls, i)->len + 32;
+    err = OV_ARRAY_GROW(&line, cap);
+    if (efailed(err)) {
+      err = ethru(err);
+      goto cleanup;
+    }
+    size_t n = logstore_format(ls, i, line, cap - 2);
+    line[n++] = L'\r';
+    line[n++] = L'\n';
+    // A UTF-16 code unit never takes more than 3 bytes in UTF-8.
+    err = OV_ARRAY_GROW(&out, used + n * 3);
+    if (efailed(err)) {
+      err = ethru(err);
+      goto cleanup;
+    }
+    int const r = WideCharToMultiByte(CP_UTF8, 0, line, (int)n, out + used, (int)(n * 3), NULL, NULL);
+    if (r == 0) {
+      err = errhr(HRESULT_FROM_WIN32(GetLastError()));
+      goto cleanup;
+    }
+    used += (size_t)r;
+    if (used >= save_flush_size) {
+      err = write_all(h, out, used);
+      if (efailed(err)) {
+        err = ethru(err);
+        goto cleanup;
+      }
+      used = 0;
+    }
+  }
+  if (used) {
+    err = write_all(h, out, used);
+    if (efailed(err)) {
+      err = ethru(err);
+      goto cleanup;
+    }
+  }
+cleanup:
+  if (h != INVALID_HANDLE_VALUE) {
+    CloseHandle(h);
+    h = INVALID_HANDLE_VALUE;
+    if (efailed(err)) {
+      DeleteFileW(path);
+    }
+  }
+  if (out) {
+    OV_ARRAY_DESTROY(&out);
+  }
+  if (line) {
+    OV_ARRAY_DESTROY(&line);
+  }
+  return err;
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <ovbase.h>
+
+#include <ovutil/win32.h>
+
+struct logstore;
+
+/**
+ * @brief Creates an in-memory history of log lines for a virtual list view.
+ *
+ * Lines are kept as compact records that point into one circular UTF-16 text buffer, so appending is O(1) and
+ * the oldest lines are evicted once either limit is reached. The text buffer grows on demand up to max_chars.
+ *
+ * @param lsp A pointer to receive the store.
+ * @param max_lines Maximum number of lines.
+ * @param max_chars Maximum number of characters of all lines, including one terminator per line.
+ * @return An error code indicating success or failure.
+ */
+NODISCARD error logstore_create(struct logstore **const lsp, size_t const max_lines, size_t const max_chars);
+void logstore_destroy(struct logstore **const lsp);
+
+/**
+ * @brief Appends a line, evicting the oldest lines if needed.
+ *
+ * A line longer than max_chars is truncated.
+ *
+ * @param ls The store.
+ * @param time Time of the line.
+ * @param message The line, NUL-terminated.
+ * @return An error code indicating success or failure.
+ */
+NODISCARD error logstore_add(struct logstore *const ls, SYSTEMTIME const *const time, wchar_t const *const message);
+
+/**
+ * @brief Returns the number of stored lines.
+ */
+size_t logstore_count(struct logstore const *const ls);
+
+/**
+ * @brief Returns the number of lines evicted since the store was created.
+ *
+ * The index of a line decreases by one for each eviction, so the view can tell whether it has to redraw everything.
+ */
+uint64_t logstore_evicted(struct logstore const *const ls);
+
+/**
+ * @brief Gets a line.
+ *
+ * @param ls The store.
+ * @param index Index of the line, 0 is the oldest.
+ * @param time A pointer to receive the time of the line, can be NULL.
+ * @return The line, NUL-terminated, valid until the next logstore_add, or NULL if index is out of range.
+ */
+wchar_t const *logstore_get(struct logstore const *const ls, size_t const index, SYSTEMTIME *const time);
+
+/**
+ * @brief Formats a line as "YYYY-MM-DD hh:mm:ss.mmm  message".
+ *
+ * @param ls The store.
+ * @param index Index of the line, 0 is the oldest.
+ * @param buf Destination buffer, the result is truncated and always NUL-terminated.
+ * @param buflen Size of buf in characters.
+ * @return Number of characters written without the terminator.
+ */
+size_t logstore_format(struct logstore const *const ls, size_t const index, wchar_t *const buf, size_t const buflen);
+
+/**
+ * @brief Writes all lines to a UTF-8 text file with CRLF line breaks.
+ *
+ * @param ls The store.
+ * @param path Path of the file to create.
+ * @return An error code indicating success or failure.
+ */
+NODISCARD error logstore_save_file(struct logstore const *const ls, wchar_t const *const path);
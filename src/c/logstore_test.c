@@ -0,0 +1,170 @@
+#include <ovtest.h>
+
+#include <ovarray.h>
+
+#include <string.h>
+
+#include "logstore.h"
+#include "path.h"
+
+static SYSTEMTIME const test_time = {
+    .wYear = 2024,
+    .wMonth = 12,
+    .wDay = 31,
+    .wHour = 23,
+    .wMinute = 59,
+    .wSecond = 58,
+    .wMilliseconds = 987,
+};
+
+static void test_logstore_add_get(void) {
+  struct logstore *ls = NULL;
+  if (!TEST_SUCCEEDED_F(logstore_create(&ls, 8, 1024))) {
+    return;
+  }
+  TEST_CHECK(logstore_count(ls) == 0);
+  TEST_CHECK(logstore_get(ls, 0, NULL) == NULL);
+  TEST_SUCCEEDED_F(logstore_add(ls, &test_time, L"hello"));
+  TEST_SUCCEEDED_F(logstore_add(ls, &test_time, L""));
+  TEST_CHECK(logstore_count(ls) == 2);
+  SYSTEMTIME st = {0};
+  TEST_CHECK(wcscmp(logstore_get(ls, 0, &st), L"hello") == 0);
+  TEST_CHECK(st.wYear == 2024 && st.wMonth == 12 && st.wDay == 31);
+  TEST_CHECK(st.wHour == 23 && st.wMinute == 59 && st.wSecond == 58 && st.wMilliseconds == 987);
+  TEST_CHECK(wcscmp(logstore_get(ls, 1, NULL), L"") == 0);
+  TEST_CHECK(logstore_get(ls, 2, NULL) == NULL);
+
+  wchar_t buf[64];
+  TEST_CHECK(logstore_format(ls, 0, buf, 64) == 30);
+  TEST_CHECK(wcscmp(buf, L"2024-12-31 23:59:58.987  hello") == 0);
+  TEST_CHECK(logstore_format(ls, 0, buf, 8) == 7);
+  TEST_CHECK(wcscmp(buf, L"2024-12") == 0);
+  TEST_CHECK(logstore_format(ls, 0, buf, 28) == 27);
+  TEST_CHECK(wcscmp(buf, L"2024-12-31 23:59:58.987  he") == 0);
+  TEST_CHECK(logstore_format(ls, 5, buf, 64) == 0);
+  TEST_CHECK(buf[0] == L'\0');
+  logstore_destroy(&ls);
+  TEST_CHECK(ls == NULL);
+}
+
+static void test_logstore_evict_lines(void) {
+  struct logstore *ls = NULL;
+  if (!TEST_SUCCEEDED_F(logstore_create(&ls, 3, 1024))) {
+    return;
+  }
+  wchar_t buf[16];
+  for (int i = 0; i < 10; ++i) {
+    swprintf(buf, sizeof(buf) / sizeof(buf[0]), L"line %d", i);
+    TEST_SUCCEEDED_F(logstore_add(ls, &test_time, buf));
+  }
+  TEST_CHECK(logstore_count(ls) == 3);
+  TEST_CHECK(logstore_evicted(ls) == 7);
+  TEST_CHECK(wcscmp(logstore_get(ls, 0, NULL), L"line 7") == 0);
+  TEST_CHECK(wcscmp(logstore_get(ls, 2, NULL), L"line 9") == 0);
+  logstore_destroy(&ls);
+}
+
+static void test_logstore_evict_chars(void) {
+  enum {
+    max_lines = 64,
+    max_chars = 200,
+    total = 2000,
+  };
+  struct logstore *ls = NULL;
+  if (!TEST_SUCCEEDED_F(logstore_create(&ls, max_lines, max_chars))) {
+    return;
+  }
+  // Lines of varying length make the text buffer wrap around at different positions.
+  static wchar_t lines[total][48];
+  unsigned int seed = 1;
+  for (int i = 0; i < total; ++i) {
+    seed = seed * 1103515245 + 12345;
+    int const len = (int)((seed >> 16) % 40);
+    int n = swprintf(lines[i], 48, L"%d:", i);
+    while (n < len) {
+      lines[i][n++] = L'x';
+    }
+    lines[i][n] = L'\0';
+    if (!TEST_SUCCEEDED_F(logstore_add(ls, &test_time, lines[i]))) {
+      break;
+    }
+    size_t const count = logstore_count(ls);
+    if (!TEST_CHECK(count > 0 && count <= max_lines)) {
+      break;
+    }
+    // The stored lines must be the latest ones in order, and fit in max_chars.
+    size_t chars = 0;
+    bool ok = true;
+    for (size_t j = 0; j < count; ++j) {
+      wchar_t const *const s = logstore_get(ls, j, NULL);
+      ok = ok && wcscmp(s, lines[(size_t)i - count + 1 + j]) == 0;
+      chars += wcslen(s) + 1;
+    }
+    if (!TEST_CHECK(ok && chars <= max_chars)) {
+      TEST_MSG("#%d: count %zu, chars %zu", i, count, chars);
+      break;
+    }
+    TEST_CHECK(logstore_evicted(ls) + count == (size_t)i + 1);
+  }
+  logstore_destroy(&ls);
+}
+
+static void test_logstore_truncate(void) {
+  struct logstore *ls = NULL;
+  if (!TEST_SUCCEEDED_F(logstore_create(&ls, 4, 8))) {
+    return;
+  }
+  TEST_SUCCEEDED_F(logstore_add(ls, &test_time, L"0123456789"));
+  TEST_CHECK(logstore_count(ls) == 1);
+  TEST_CHECK(wcscmp(logstore_get(ls, 0, NULL), L"0123456") == 0);
+  TEST_SUCCEEDED_F(logstore_add(ls, &test_time, L"ab"));
+  TEST_CHECK(logstore_count(ls) == 1);
+  TEST_CHECK(wcscmp(logstore_get(ls, 0, NULL), L"ab") == 0);
+  logstore_destroy(&ls);
+}
+
+static void test_logstore_save_file(void) {
+  struct logstore *ls = NULL;
+  wchar_t *path = NULL;
+  char buf[256];
+  HANDLE h = INVALID_HANDLE_VALUE;
+  if (!TEST_SUCCEEDED_F(logstore_create(&ls, 4, 1024))) {
+    goto cleanup;
+  }
+  if (!TEST_SUCCEEDED_F(path_get_temp_file(&path, L"logstore_test.txt"))) {
+    goto cleanup;
+  }
+  TEST_SUCCEEDED_F(logstore_add(ls, &test_time, L"a"));
+  TEST_SUCCEEDED_F(logstore_add(ls, &test_time, L"\u3042"));
+  if (!TEST_SUCCEEDED_F(logstore_save_file(ls, path))) {
+    goto cleanup;
+  }
+  h = CreateFileW(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+  if (!TEST_CHECK(h != INVALID_HANDLE_VALUE)) {
+    goto cleanup;
+  }
+  DWORD read = 0;
+  TEST_CHECK(ReadFile(h, buf, sizeof(buf), &read, NULL));
+  static char const expected[] = "2024-12-31 23:59:58.987  a\r\n"
+                                 "2024-12-31 23:59:58.987  \xe3\x81\x82\r\n";
+  TEST_CHECK(read == sizeof(expected) - 1);
+  TEST_CHECK(memcmp(buf, expected, sizeof(expected) - 1) == 0);
+cleanup:
+  if (h != INVALID_HANDLE_VALUE) {
+    CloseHandle(h);
+  }
+  if (path) {
+    DeleteFileW(path);
+    OV_ARRAY_DESTROY(&path);
+  }
+  logstore_destroy(&ls);
+}
+
+TEST_LIST = {
+    {"test_logstore_add_get", test_logstore_add_get},
+    {"test_logstore_evict_lines", test_logstore_evict_lines},
+    {"test_logstore_evict_chars", test_logstore_evict_chars},
+    {"test_logstore_truncate", test_logstore_truncate},
+    {"test_logstore_save_file", test_logstore_save_file},
+    {NULL, NULL},
+};
@@ -0,0 +1,210 @@
+#include "luaalloc.h"
+
+#include <ovarray.h>
+
+#include <string.h>
+
+enum {
+  granularity = 16,
+  max_small_size = 512,
+  num_classes = max_small_size / granularity,
+  arena_size = 64 * 1024,
+};
+
+struct free_block {
+  struct free_block *next;
+};
+
+struct luaalloc {
+  struct free_block *freelists[num_classes];
+  char **arenas;
+  size_t arenas_cap;
+  char *arena_pos;
+  size_t arena_remain;
+  size_t arena_limit; // Maximum of arena_bytes, 0 means no limit. Tests set this to simulate running out of memory.
+  struct luaalloc_stats stats;
+};
+
+static inline size_t get_class(size_t const size) { return (size - 1) / granularity; }
+
+NODISCARD error luaalloc_create(struct luaalloc **const lapp) {
+  if (!lapp || *lapp) {
+    return errg(err_invalid_arugment);
+  }
+  struct luaalloc *la = NULL;
+  error err = mem(&la, 1, sizeof(struct luaalloc));
+  if (efailed(err)) {
+    return ethru(err);
+  }
+  *la = (struct luaalloc){0};
+  *lapp = la;
+  return eok();
+}
+
+void luaalloc_destroy(struct luaalloc **const lapp) {
+  if (!lapp || !*lapp) {
+    return;
+  }
+  struct luaalloc *la = *lapp;
+  for (size_t i = 0, n = OV_ARRAY_LENGTH(la->arenas); i < n; ++i) {
+    ereport(mem_free(&la->arenas[i]));
+  }
+  OV_ARRAY_DESTROY(&la->arenas);
+  ereport(mem_free(lapp));
+}
+
+static NODISCARD error reserve_arena_slot(struct luaalloc *const la) {
+  if (OV_ARRAY_LENGTH(la->arenas) < la->arenas_cap) {
+    return eok();
+  }
+  size_t const cap = la->arenas_cap ? la->arenas_cap * 2 : 16;
+  error err = OV_ARRAY_GROW(&la->arenas, cap);
+  if (efailed(err)) {
+    return ethru(err);
+  }
+  la->arenas_cap = cap;
+  return eok();
+}
+
+static NODISCARD error add_arena(struct luaalloc *const la) {
+  if (la->arena_limit && la->stats.arena_bytes + arena_size > la->arena_limit) {
+    return errg(err_out_of_memory);
+  }
+  error err = reserve_arena_slot(la);
+  if (efailed(err)) {
+    return ethru(err);
+  }
+  size_t const n = OV_ARRAY_LENGTH(la->arenas);
+  char *arena = NULL;
+  err = mem(&arena, arena_size, 1);
+  if (efailed(err)) {
+    return ethru(err);
+  }
+  la->arenas[n] = arena;
+  OV_ARRAY_SET_LENGTH(la->arenas, n + 1);
+  // The tail of the previous arena is too small to use, and is left as is.
+  la->arena_pos = arena;
+  la->arena_remain = arena_size;
+  la->stats.arena_bytes += arena_size;
+  return eok();
+}
+
+static void *alloc_small(struct luaalloc *const la, size_t const size) {
+  size_t const cls = get_class(size);
+  struct free_block *const b = la->freelists[cls];
+  if (b) {
+    la->freelists[cls] = b->next;
+    return b;
+  }
+  size_t const block_size = (cls + 1) * granularity;
+  if (la->arena_remain < block_size) {
+    if (!ereport(add_arena(la))) {
+      return NULL;
+    }
+  }
+  void *const p = la->arena_pos;
+  la->arena_pos += block_size;
+  la->arena_remain -= block_size;
+  return p;
+}
+
+static void free_small(struct luaalloc *const la, void *const ptr, size_t const size) {
+  size_t const cls = get_class(size);
+  struct free_block *const b = ptr;
+  b->next = la->freelists[cls];
+  la->freelists[cls] = b;
+}
+
+static void *alloc_block(struct luaalloc *const la, size_t const size) {
+  if (size <= max_small_size) {
+    return alloc_small(la, size);
+  }
+  void *p = NULL;
+  if (!ereport(mem(&p, size, 1))) {
+    return NULL;
+  }
+  return p;
+}
+
+static void free_block(struct luaalloc *const la, void *ptr, size_t const size) {
+  if (size <= max_small_size) {
+    free_small(la, ptr, size);
+    return;
+  }
+  ereport(mem_free(&ptr));
+}
+
+/**
+ * Keeps a large block whose size is now reported as small.
+ * It is recycled as a small block from then on, and is freed with the arenas.
+ */
+static void adopt_block(struct luaalloc *const la, void *const ptr, size_t const size) {
+  if (!ereport(reserve_arena_slot(la))) {
+    // Without a slot the block is still usable, but it is not freed when the allocator is destroyed.
+    return;
+  }
+  size_t const n = OV_ARRAY_LENGTH(la->arenas);
+  la->arenas[n] = ptr;
+  OV_ARRAY_SET_LENGTH(la->arenas, n + 1);
+  la->stats.arena_bytes += size;
+}
+
+void *luaalloc_alloc(void *const ud, void *const ptr, size_t const old_size, size_t const new_size) {
+  struct luaalloc *const la = ud;
+  // Lua 5.1 passes 0 as old_size when ptr is NULL.
+  size_t const osize = ptr ? old_size : 0;
+  if (!new_size) {
+    if (ptr) {
+      free_block(la, ptr, osize);
+      la->stats.bytes -= osize;
+    }
+    return NULL;
+  }
+  void *p;
+  if (ptr && osize > max_small_size && new_size > max_small_size) {
+    p = ptr;
+    if (!ereport(mem(&p, new_size, 1))) {
+      p = NULL;
+    }
+  } else if (ptr && osize <= max_small_size && new_size <= max_small_size && get_class(osize) == get_class(new_size)) {
+    p = ptr;
+  } else {
+    p = alloc_block(la, new_size);
+    if (p && ptr) {
+      memcpy(p, ptr, osize < new_size ? osize : new_size);
+      free_block(la, ptr, osize);
+    }
+  }
+  if (!p) {
+    if (new_size > osize) {
+      return NULL;
+    }
+    // Lua assumes that shrinking a block never fails, so the block is kept as is.
+    // A small block in a larger size class is only wasteful, but a large block has to be adopted.
+    if (osize > max_small_size && new_size <= max_small_size) {
+      adopt_block(la, ptr, osize);
+    }
+    p = ptr;
+  }
+  la->stats.bytes = la->stats.bytes - osize + new_size;
+  if (la->stats.bytes > la->stats.peak_bytes) {
+    la->stats.peak_bytes = la->stats.bytes;
+  }
+  ++la->stats.allocations;
+  return p;
+}
+
+void luaalloc_get_stats(struct luaalloc const *const la, struct luaalloc_stats *const stats) {
+  if (!la || !stats) {
+    return;
+  }
+  *stats = la->stats;
+}
+
+void luaalloc_reset_stats(struct luaalloc *const la) {
+  if (!la) {
+    return;
+  }
+  la->stats.peak_bytes = la->stats.bytes;
+  la->stats.allocations = 0;
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <ovbase.h>
+
+struct luaalloc;
+
+/**
+ * @brief Allocation statistics of a Lua state.
+ */
+struct luaalloc_stats {
+  size_t bytes;         /**< Bytes currently allocated by Lua. */
+  size_t peak_bytes;    /**< Maximum of bytes since the statistics were reset. */
+  size_t arena_bytes;   /**< Bytes reserved for the arenas. */
+  uint64_t allocations; /**< Number of allocations since the statistics were reset. */
+};
+
+/**
+ * @brief Creates an allocator for a Lua state.
+ *
+ * Small blocks are carved from arenas and recycled through per size class freelists,
+ * larger blocks are passed to mem().
+ * The arenas are released at once when the allocator is destroyed, so it must outlive the Lua state.
+ * The allocator is not thread-safe, like the Lua state itself.
+ */
+NODISCARD error luaalloc_create(struct luaalloc **const lapp);
+void luaalloc_destroy(struct luaalloc **const lapp);
+
+/**
+ * @brief The lua_Alloc function, pass the allocator as ud of lua_newstate.
+ */
+void *luaalloc_alloc(void *const ud, void *const ptr, size_t const old_size, size_t const new_size);
+
+void luaalloc_get_stats(struct luaalloc const *const la, struct luaalloc_stats *const stats);
+
+/**
+ * @brief Resets peak_bytes to the current bytes and allocations to zero.
+ */
+void luaalloc_reset_stats(struct luaalloc *const la);
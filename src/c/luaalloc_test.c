@@ -0,0 +1,186 @@
+#include <ovtest.h>
+
+#include "luaalloc.c"
+
+static void test_luaalloc_alloc(void) {
+  struct luaalloc *la = NULL;
+  if (!TEST_SUCCEEDED_F(luaalloc_create(&la))) {
+    return;
+  }
+  struct luaalloc_stats stats;
+
+  char *a = luaalloc_alloc(la, NULL, 0, 10);
+  char *b = luaalloc_alloc(la, NULL, 0, 100);
+  char *c = luaalloc_alloc(la, NULL, 0, 4096);
+  if (!TEST_CHECK(a && b && c)) {
+    goto cleanup;
+  }
+  memset(a, 'a', 10);
+  memset(b, 'b', 100);
+  memset(c, 'c', 4096);
+  luaalloc_get_stats(la, &stats);
+  TEST_CHECK(stats.bytes == 10 + 100 + 4096);
+  TEST_CHECK(stats.peak_bytes == stats.bytes);
+  TEST_CHECK(stats.allocations == 3);
+  TEST_CHECK(stats.arena_bytes > 0);
+
+  // Growing within the same size class keeps the block.
+  char *a2 = luaalloc_alloc(la, a, 10, 16);
+  TEST_CHECK(a2 == a);
+  a = a2;
+
+  // Moving between a small block and a large block keeps the contents.
+  char *b2 = luaalloc_alloc(la, b, 100, 1000);
+  if (!TEST_CHECK(b2 != NULL)) {
+    goto cleanup;
+  }
+  b = b2;
+  for (size_t i = 0; i < 100; ++i) {
+    TEST_CHECK(b[i] == 'b');
+  }
+  luaalloc_get_stats(la, &stats);
+  TEST_CHECK(stats.peak_bytes == 16 + 1000 + 4096);
+  memset(b, 'B', 1000);
+  b2 = luaalloc_alloc(la, b, 1000, 50);
+  if (!TEST_CHECK(b2 != NULL)) {
+    goto cleanup;
+  }
+  b = b2;
+  for (size_t i = 0; i < 50; ++i) {
+    TEST_CHECK(b[i] == 'B');
+  }
+
+  char *c2 = luaalloc_alloc(la, c, 4096, 8192);
+  if (!TEST_CHECK(c2 != NULL)) {
+    goto cleanup;
+  }
+  c = c2;
+  TEST_CHECK(c[4095] == 'c');
+  luaalloc_get_stats(la, &stats);
+  TEST_CHECK(stats.bytes == 16 + 50 + 8192);
+  TEST_CHECK(stats.peak_bytes == stats.bytes);
+
+  // Freed small blocks are reused.
+  TEST_CHECK(luaalloc_alloc(la, b, 50, 0) == NULL);
+  char *d = luaalloc_alloc(la, NULL, 0, 60);
+  TEST_CHECK(d == b);
+  b = d;
+
+  luaalloc_reset_stats(la);
+  luaalloc_get_stats(la, &stats);
+  TEST_CHECK(stats.bytes == 16 + 60 + 8192);
+  TEST_CHECK(stats.peak_bytes == stats.bytes);
+  TEST_CHECK(stats.allocations == 0);
+
+  TEST_CHECK(luaalloc_alloc(la, a, 16, 0) == NULL);
+  TEST_CHECK(luaalloc_alloc(la, b, 60, 0) == NULL);
+  TEST_CHECK(luaalloc_alloc(la, c, 8192, 0) == NULL);
+  a = b = c = NULL;
+  luaalloc_get_stats(la, &stats);
+  TEST_CHECK(stats.bytes == 0);
+
+cleanup:
+  if (c) {
+    luaalloc_alloc(la, c, 8192, 0);
+  }
+  luaalloc_destroy(&la);
+}
+
+static void test_luaalloc_many(void) {
+  enum { n = 20000 };
+  struct luaalloc *la = NULL;
+  if (!TEST_SUCCEEDED_F(luaalloc_create(&la))) {
+    return;
+  }
+  static void *ptrs[n];
+  for (size_t i = 0; i < n; ++i) {
+    size_t const size = 1 + (i * 37) % 600;
+    ptrs[i] = luaalloc_alloc(la, NULL, 0, size);
+    if (!TEST_CHECK(ptrs[i] != NULL)) {
+      goto cleanup;
+    }
+    memset(ptrs[i], (int)(i & 0xff), size);
+  }
+  for (size_t i = 0; i < n; ++i) {
+    size_t const size = 1 + (i * 37) % 600;
+    unsigned char const *const p = ptrs[i];
+    TEST_CHECK(p[0] == (i & 0xff) && p[size - 1] == (i & 0xff));
+    TEST_MSG("block %zu is overwritten", i);
+    // Large blocks are not owned by the arenas, so they have to be freed.
+    if (size > 512) {
+      luaalloc_alloc(la, ptrs[i], size, 0);
+    }
+  }
+  struct luaalloc_stats stats;
+  luaalloc_get_stats(la, &stats);
+  TEST_CHECK(stats.allocations == n);
+cleanup:
+  // Small blocks are released with the arenas.
+  luaalloc_destroy(&la);
+}
+
+static void test_luaalloc_shrink_out_of_memory(void) {
+  struct luaalloc *la = NULL;
+  if (!TEST_SUCCEEDED_F(luaalloc_create(&la))) {
+    return;
+  }
+  struct luaalloc_stats stats;
+  char *a = luaalloc_alloc(la, NULL, 0, 500);
+  char *b = luaalloc_alloc(la, NULL, 0, 4096);
+  if (!TEST_CHECK(a && b)) {
+    goto cleanup;
+  }
+  memset(a, 'a', 500);
+  memset(b, 'b', 4096);
+  // No more arenas can be added and the current one is used up, so every new small block fails.
+  la->arena_limit = la->stats.arena_bytes;
+  la->arena_remain = 0;
+  TEST_CHECK(luaalloc_alloc(la, NULL, 0, 10) == NULL);
+
+  // Shrinking into another size class keeps the block.
+  TEST_CHECK(luaalloc_alloc(la, a, 500, 20) == a);
+  TEST_CHECK(a[0] == 'a' && a[19] == 'a');
+
+  // Shrinking a large block into a small one keeps the block too.
+  size_t const arena_bytes = la->stats.arena_bytes;
+  TEST_CHECK(luaalloc_alloc(la, b, 4096, 100) == b);
+  TEST_CHECK(b[0] == 'b' && b[99] == 'b');
+  luaalloc_get_stats(la, &stats);
+  TEST_CHECK(stats.bytes == 20 + 100);
+  TEST_CHECK(stats.arena_bytes == arena_bytes + 4096);
+
+  // Growing still fails.
+  TEST_CHECK(luaalloc_alloc(la, a, 20, 100) == NULL);
+
+  // The kept blocks are recycled in their new size classes.
+  TEST_CHECK(luaalloc_alloc(la, a, 20, 0) == NULL);
+  TEST_CHECK(luaalloc_alloc(la, b, 100, 0) == NULL);
+  TEST_CHECK(luaalloc_alloc(la, NULL, 0, 20) == a);
+  TEST_CHECK(luaalloc_alloc(la, NULL, 0, 100) == b);
+  a = b = NULL;
+cleanup:
+  if (b) {
+    luaalloc_alloc(la, b, 4096, 0);
+  }
+  // The adopted block is released with the arenas.
+  luaalloc_destroy(&la);
+}
+
+static void test_luaalloc_invalid_argument(void) {
+  struct luaalloc *la = NULL;
+  TEST_EISG_F(luaalloc_create(NULL), err_invalid_arugment);
+  if (!TEST_SUCCEEDED_F(luaalloc_create(&la))) {
+    return;
+  }
+  TEST_EISG_F(luaalloc_create(&la), err_invalid_arugment);
+  luaalloc_destroy(&la);
+  TEST_CHECK(la == NULL);
+}
+
+TEST_LIST = {
+    {"test_luaalloc_alloc", test_luaalloc_alloc},
+    {"test_luaalloc_many", test_luaalloc_many},
+    {"test_luaalloc_shrink_out_of_memory", test_luaalloc_shrink_out_of_memory},
+    {"test_luaalloc_invalid_argument", test_luaalloc_invalid_argument},
+    {NULL, NULL},
+};
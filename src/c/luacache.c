@@ -0,0 +1,202 @@
+#include "luacache.h"
+
+#include <ovarray.h>
+
+#include <lua.h>
+
+#include <string.h>
+
+#include "hash.h"
+#include "i18n.h"
+
+// Cache entry layout, all values are stored in the native byte order:
+//   uint32_t magic
+//   uint32_t format version
+//   uint32_t LUA_VERSION_NUM
+//   uint32_t sizeof(void *)
+//   uint64_t source mtime
+//   uint64_t source size
+//   uint64_t source hash
+//   uint64_t bytecode size
+//   uint64_t bytecode hash
+//   bytecode
+static uint32_t const magic = 0x434c4253; // "SBLC"
+static uint32_t const format_version = 1;
+
+static char *put_u32(char *const dest, uint32_t const v) {
+  memcpy(dest, &v, sizeof(v));
+  return dest + sizeof(v);
+}
+
+static char *put_u64(char *const dest, uint64_t const v) {
+  memcpy(dest, &v, sizeof(v));
+  return dest + sizeof(v);
+}
+
+static char const *get_u32(char const *const src, uint32_t *const v) {
+  memcpy(v, src, sizeof(*v));
+  return src + sizeof(*v);
+}
+
+static char const *get_u64(char const *const src, uint64_t *const v) {
+  memcpy(v, src, sizeof(*v));
+  return src + sizeof(*v);
+}
+
+NODISCARD error luacache_encode(struct luacache_source const *const src,
+                                char const *const bytecode,
+                                size_t const bytecode_len,
+                                char **const dest) {
+  if (!src || !bytecode || !dest) {
+    return errg(err_invalid_arugment);
+  }
+  error err = OV_ARRAY_GROW(dest, luacache_header_size + bytecode_len);
+  if (efailed(err)) {
+    return ethru(err);
+  }
+  char *p = *dest;
+  p = put_u32(p, magic);
+  p = put_u32(p, format_version);
+  p = put_u32(p, LUA_VERSION_NUM);
+  p = put_u32(p, sizeof(void *));
+  p = put_u64(p, src->mtime);
+  p = put_u64(p, src->size);
+  p = put_u64(p, src->hash);
+  p = put_u64(p, bytecode_len);
+  p = put_u64(p, hash_fnv1a(bytecode, bytecode_len, 0));
+  memcpy(p, bytecode, bytecode_len);
+  OV_ARRAY_SET_LENGTH(*dest, luacache_header_size + bytecode_len);
+  return eok();
+}
+
+bool luacache_decode(char const *const data,
+                     size_t const len,
+                     struct luacache_source const *const src,
+                     char const **const bytecode,
+                     size_t *const bytecode_len) {
+  if (!data || !src || !bytecode || !bytecode_len || len < luacache_header_size) {
+    return false;
+  }
+  uint32_t m, fv, lv, ps;
+  uint64_t mtime, size, hash, bc_len, bc_hash;
+  char const *p = data;
+  p = get_u32(p, &m);
+  p = get_u32(p, &fv);
+  p = get_u32(p, &lv);
+  p = get_u32(p, &ps);
+  p = get_u64(p, &mtime);
+  p = get_u64(p, &size);
+  p = get_u64(p, &hash);
+  p = get_u64(p, &bc_len);
+  p = get_u64(p, &bc_hash);
+  if (m != magic || fv != format_version || lv != LUA_VERSION_NUM || ps != sizeof(void *)) {
+    return false;
+  }
+  if (mtime != src->mtime || size != src->size || hash != src->hash) {
+    return false;
+  }
+  // The Lua 5.1 loader does not verify the chunk, so a damaged chunk must never reach it.
+  if (bc_len != len - luacache_header_size || hash_fnv1a(p, (size_t)bc_len, 0) != bc_hash) {
+    return false;
+  }
+  *bytecode = p;
+  *bytecode_len = (size_t)bc_len;
+  return true;
+}
+
+NODISCARD error luacache_read_file(wchar_t const *const path, char **const dest, uint64_t *const mtime) {
+  if (!path || !dest) {
+    return errg(err_invalid_arugment);
+  }
+  error err = eok();
+  HANDLE h = CreateFileW(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+  if (h == INVALID_HANDLE_VALUE) {
+    err = errhr(HRESULT_FROM_WIN32(GetLastError()));
+    goto cleanup;
+  }
+  LARGE_INTEGER size;
+  if (!GetFileSizeEx(h, &size)) {
+    err = errhr(HRESULT_FROM_WIN32(GetLastError()));
+    goto cleanup;
+  }
+  if (size.QuadPart > INT_MAX) {
+    err = emsg_i18n(err_type_generic, err_fail, gettext("The file is too large."));
+    goto cleanup;
+  }
+  if (mtime) {
+    FILETIME ft;
+    if (!GetFileTime(h, NULL, NULL, &ft)) {
+      err = errhr(HRESULT_FROM_WIN32(GetLastError()));
+      goto cleanup;
+    }
+    *mtime = ((uint64_t)ft.dwHighDateTime << 32) | (uint64_t)ft.dwLowDateTime;
+  }
+  err = OV_ARRAY_GROW(dest, (size_t)size.QuadPart + 1);
+  if (efailed(err)) {
+    err = ethru(err);
+    goto cleanup;
+  }
+  DWORD read;
+  if (!ReadFile(h, *dest, (DWORD)size.QuadPart, &read, NULL)) {
+    err = errhr(HRESULT_FROM_WIN32(GetLastError()));
+    goto cleanup;
+  }
+  if (read != (DWORD)size.QuadPart) {
+    err = emsg_i18n(err_type_generic, err_fail, gettext("Unable to read the entire file."));
+    goto cleanup;
+  }
+  (*dest)[read] = '\0';
+  OV_ARRAY_SET_LENGTH(*dest, (size_t)read);
+cleanup:
+  if (h != INVALID_HANDLE_VALUE) {
+    CloseHandle(h);
+    h = INVALID_HANDLE_VALUE;
+  }
+  return err;
+}
+
+NODISCARD error luacache_write_file(wchar_t const *const path, char const *const data, size_t const len) {
+  if (!path || !data) {
+    return errg(err_invalid_arugment);
+  }
+  wchar_t *tmp = NULL;
+  HANDLE h = INVALID_HANDLE_VALUE;
+  size_t const pathlen = wcslen(path);
+  error err = OV_ARRAY_GROW(&tmp, pathlen + 32);
+  if (efailed(err)) {
+    err = ethru(err);
+    goto cleanup;
+  }
+  // Multiple Lua states may write the same entry at the same time, so the temporary file is per thread.
+  wsprintfW(tmp, L"%s.%lu.tmp", path, GetCurrentThreadId());
+  h = CreateFileW(tmp, GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+  if (h == INVALID_HANDLE_VALUE) {
+    err = errhr(HRESULT_FROM_WIN32(GetLastError()));
+    goto cleanup;
+  }
+  DWORD written;
+  if (!WriteFile(h, data, (DWORD)len, &written, NULL)) {
+    err = errhr(HRESULT_FROM_WIN32(GetLastError()));
+    goto cleanup;
+  }
+  if (written != len) {
+    err = emsg_i18n(err_type_generic, err_fail, gettext("Unable to write the entire file."));
+    goto cleanup;
+  }
+  CloseHandle(h);
+  h = INVALID_HANDLE_VALUE;
+  if (!MoveFileExW(tmp, path, MOVEFILE_REPLACE_EXISTING)) {
+    err = errhr(HRESULT_FROM_WIN32(GetLastError()));
+    goto cleanup;
+  }
+cleanup:
+  if (h != INVALID_HANDLE_VALUE) {
+    CloseHandle(h);
+    h = INVALID_HANDLE_VALUE;
+  }
+  if (efailed(err) && tmp) {
+    DeleteFileW(tmp);
+  }
+  OV_ARRAY_DESTROY(&tmp);
+  return err;
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <ovbase.h>
+
+/**
+ * @brief Identifies the source a cached chunk was compiled from.
+ */
+struct luacache_source {
+  uint64_t mtime; /**< Last write time of the source file. */
+  uint64_t size;  /**< Size of the source file. */
+  uint64_t hash;  /**< Hash of the chunk name and the source, see hash_fnv1a. */
+};
+
+enum {
+  luacache_header_size = 56,
+};
+
+/**
+ * @brief Builds a cache entry from the compiled chunk.
+ *
+ * @param src The source the chunk was compiled from.
+ * @param bytecode The chunk written by lua_dump.
+ * @param bytecode_len Length of bytecode.
+ * @param dest Receives the cache entry. It must be released with OV_ARRAY_DESTROY.
+ * @return An error code indicating success or failure.
+ */
+NODISCARD error luacache_encode(struct luacache_source const *const src,
+                                char const *const bytecode,
+                                size_t const bytecode_len,
+                                char **const dest);
+
+/**
+ * @brief Extracts the compiled chunk from the cache entry.
+ *
+ * The entry is rejected if it was written by another version of the cache format or Lua,
+ * if it was compiled from another source, or if the chunk is damaged.
+ *
+ * @param data The cache entry.
+ * @param len Length of data.
+ * @param src The current source.
+ * @param bytecode Receives the pointer to the chunk in data.
+ * @param bytecode_len Receives the length of the chunk.
+ * @return true if the chunk can be used.
+ */
+bool luacache_decode(char const *const data,
+                     size_t const len,
+                     struct luacache_source const *const src,
+                     char const **const bytecode,
+                     size_t *const bytecode_len);
+
+/**
+ * @brief Reads the entire file.
+ *
+ * @param path Path to the file.
+ * @param dest Receives the content. It must be released with OV_ARRAY_DESTROY.
+ * @param mtime Receives the last write time of the file. Can be NULL.
+ * @return An error code indicating success or failure.
+ */
+NODISCARD error luacache_read_file(wchar_t const *const path, char **const dest, uint64_t *const mtime);
+
+/**
+ * @brief Writes the file so that other readers never see a partially written file.
+ *
+ * The data is written to a temporary file in the same directory and then moved to path.
+ */
+NODISCARD error luacache_write_file(wchar_t const *const path, char const *const data, size_t const len);
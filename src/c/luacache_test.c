@@ -0,0 +1,70 @@
+#include <ovtest.h>
+
+#include <ovarray.h>
+
+#include "luacache.h"
+
+#include <string.h>
+
+static void test_luacache_round_trip(void) {
+  static char const bytecode[] = "\x1bLua\x51\x00 dummy chunk";
+  struct luacache_source const src = {
+      .mtime = UINT64_C(0x01d9f00000000000),
+      .size = 1234,
+      .hash = UINT64_C(0x123456789abcdef0),
+  };
+  char *entry = NULL;
+  if (!TEST_SUCCEEDED_F(luacache_encode(&src, bytecode, sizeof(bytecode), &entry))) {
+    return;
+  }
+  size_t const len = OV_ARRAY_LENGTH(entry);
+  TEST_CHECK(len == luacache_header_size + sizeof(bytecode));
+
+  char const *bc = NULL;
+  size_t bc_len = 0;
+  TEST_CHECK(luacache_decode(entry, len, &src, &bc, &bc_len));
+  TEST_CHECK(bc_len == sizeof(bytecode));
+  TEST_CHECK(bc && memcmp(bc, bytecode, sizeof(bytecode)) == 0);
+
+  // The source has been changed.
+  struct luacache_source changed = src;
+  changed.mtime++;
+  TEST_CHECK(!luacache_decode(entry, len, &changed, &bc, &bc_len));
+  changed = src;
+  changed.size++;
+  TEST_CHECK(!luacache_decode(entry, len, &changed, &bc, &bc_len));
+  changed = src;
+  changed.hash++;
+  TEST_CHECK(!luacache_decode(entry, len, &changed, &bc, &bc_len));
+
+  // The entry is damaged.
+  for (size_t i = 0; i < len; ++i) {
+    entry[i] ^= 0x20;
+    TEST_CHECK(!luacache_decode(entry, len, &src, &bc, &bc_len));
+    TEST_MSG("flipped byte at %zu", i);
+    entry[i] ^= 0x20;
+  }
+  for (size_t i = 0; i < len; ++i) {
+    TEST_CHECK(!luacache_decode(entry, i, &src, &bc, &bc_len));
+    TEST_MSG("truncated to %zu", i);
+  }
+  TEST_CHECK(luacache_decode(entry, len, &src, &bc, &bc_len));
+  OV_ARRAY_DESTROY(&entry);
+}
+
+static void test_luacache_invalid_argument(void) {
+  struct luacache_source const src = {0};
+  char *entry = NULL;
+  TEST_EISG_F(luacache_encode(NULL, "", 0, &entry), err_invalid_arugment);
+  TEST_EISG_F(luacache_encode(&src, NULL, 0, &entry), err_invalid_arugment);
+  TEST_EISG_F(luacache_encode(&src, "", 0, NULL), err_invalid_arugment);
+  char const *bc = NULL;
+  size_t bc_len = 0;
+  TEST_CHECK(!luacache_decode(NULL, 0, &src, &bc, &bc_len));
+}
+
+TEST_LIST = {
+    {"test_luacache_round_trip", test_luacache_round_trip},
+    {"test_luacache_invalid_argument", test_luacache_invalid_argument},
+    {NULL, NULL},
+};
@@ -7,32 +7,47 @@
 #include <lualib.h>
 
 #include "aviutl.h"
+#include "exobuilder.h"
+#include "exotext.h"
+#include "frametiming.h"
+#include "hash.h"
 #include "i18n.h"
-#include "process.h"
+#include "layeralloc.h"
+#include "linebuffer.h"
+#include "luaalloc.h"
+#include "luacache.h"
+#include "transcript.h"
+#include "utf8conv.h"
 
 static int g_key = 0;
+static int g_exotext_cache_key = 0;
+
+enum {
+  exotext_cache_max_entries = 256,
+};
+
+struct loaded_file {
+  wchar_t *path;
+  uint64_t mtime;
+  uint64_t size;
+};
 
 struct luactx {
   lua_State *L;
-  struct process_line_buffer_context line_buffer;
+  struct luaalloc *alloc;
+  struct linebuffer line_buffer;
   struct luactx_params params;
   char *preferred_languages;
   wchar_t *buffer;
+  wchar_t *cache_directory;
+  struct loaded_file *loaded_files;
+  struct exobuilder *exobuilder;
+  struct transcript const *transcript;
+  struct layeralloc *layeralloc;
+  int exotext_cache_entries;
+  bool parallel;
 };
 
-static void *lua_alloc(void *const userdata, void *ptr, size_t const old_size, size_t const new_size) {
-  (void)userdata;
-  (void)old_size;
-  if (new_size) {
-    if (!ereport(mem(&ptr, new_size, 1))) {
-      return NULL;
-    }
-    return ptr;
-  }
-  ereport(mem_free(&ptr));
-  return NULL;
-}
-
 static int lua_throw_error(lua_State *const L, error e, char const *const funcname) {
   struct wstr msg = {0};
   struct wstr errmsg = {0};
@@ -134,23 +149,69 @@ cleanup:
   return err;
 }
 
-static void process_line(void *const userdata, char const *const message) {
+NODISCARD error lua_require_reset(lua_State *const L, wchar_t const *const module_name) {
+  error err = eok();
+  char *buf = NULL;
+  int const top = lua_gettop(L);
+  int len = WideCharToMultiByte(CP_ACP, 0, module_name, -1, NULL, 0, NULL, NULL);
+  if (len == 0) {
+    err = errhr(HRESULT_FROM_WIN32(GetLastError()));
+    goto cleanup;
+  }
+  err = OV_ARRAY_GROW(&buf, len);
+  if (efailed(err)) {
+    err = ethru(err);
+    goto cleanup;
+  }
+  OV_ARRAY_SET_LENGTH(buf, (size_t)len);
+  if (WideCharToMultiByte(CP_ACP, 0, module_name, -1, buf, len, NULL, NULL) == 0) {
+    err = errhr(HRESULT_FROM_WIN32(GetLastError()));
+    goto cleanup;
+  }
+
+  lua_getglobal(L, "package");
+  lua_getfield(L, -1, "loaded");
+  lua_getfield(L, -1, buf);
+  if (lua_istable(L, -1)) {
+    lua_getfield(L, -1, "on_reset");
+    if (lua_isfunction(L, -1)) {
+      err = lua_safecall(L, 0, 0);
+      if (efailed(err)) {
+        err = ethru(err);
+        goto cleanup;
+      }
+    } else {
+      // The module cannot clear its state by itself, so run the chunk again to get a fresh one.
+      lua_pushnil(L);
+      lua_setfield(L, -4, buf);
+      lua_pop(L, 1);
+    }
+  }
+  lua_settop(L, top);
+
+  lua_getglobal(L, "require");
+  lua_pushstring(L, buf);
+  err = lua_safecall(L, 1, 1);
+  if (efailed(err)) {
+    err = ethru(err);
+    goto cleanup;
+  }
+cleanup:
+  if (efailed(err)) {
+    lua_settop(L, top);
+  }
+  OV_ARRAY_DESTROY(&buf);
+  return err;
+}
+
+static void process_line(void *const userdata, char const *const message, size_t const msglen) {
   struct luactx *const ctx = userdata;
   if (ctx->params.on_log_line) {
-    int len = MultiByteToWideChar(CP_UTF8, 0, message, -1, NULL, 0);
-    if (len == 0) {
-      ereport(errhr(HRESULT_FROM_WIN32(GetLastError())));
-      return;
-    }
-    error err = OV_ARRAY_GROW(&ctx->buffer, len);
+    error err = utf8conv_to_wchar(message, msglen, &ctx->buffer, NULL);
     if (efailed(err)) {
       ereport(err);
       return;
     }
-    if (MultiByteToWideChar(CP_UTF8, 0, message, -1, ctx->buffer, len) == 0) {
-      ereport(errhr(HRESULT_FROM_WIN32(GetLastError())));
-      return;
-    }
     ctx->params.on_log_line(ctx->params.userdata, ctx->buffer);
   }
 }
@@ -171,44 +232,360 @@ static int lua_debug_print(lua_State *L) {
   lua_pushlightuserdata(L, (void *)&g_key);
   lua_gettable(L, LUA_REGISTRYINDEX);
   struct luactx *ctx = lua_touserdata(L, -1);
-  process_line_buffer(&ctx->line_buffer, s, len);
-  if (s[len - 1] != '\n') {
-    process_line_buffer(&ctx->line_buffer, "\n", 1);
+  err = linebuffer_write(&ctx->line_buffer, s, len);
+  if (efailed(err)) {
+    err = ethru(err);
+    goto cleanup;
+  }
+  if (!len || s[len - 1] != '\n') {
+    err = linebuffer_write(&ctx->line_buffer, "\n", 1);
+    if (efailed(err)) {
+      err = ethru(err);
+      goto cleanup;
+    }
   }
 cleanup:
   return efailed(err) ? lua_throw(L, err) : 0;
 }
 
+static struct luactx *get_context(lua_State *const L) {
+  lua_pushlightuserdata(L, (void *)&g_key);
+  lua_gettable(L, LUA_REGISTRYINDEX);
+  struct luactx *ctx = lua_touserdata(L, -1);
+  lua_pop(L, 1);
+  return ctx;
+}
+
 static int luafn_exotext(lua_State *const L) {
   struct wstr tmp = {0};
   error err = eok();
   int const nargs = lua_gettop(L);
-  if (nargs != 1) {
+  if (nargs != 1 || !lua_isstring(L, 1)) {
     err = errg(err_invalid_arugment);
     goto cleanup;
   }
+
+  // Modules tend to encode the same templates over and over, so the recent results are cached.
+  lua_pushlightuserdata(L, (void *)&g_exotext_cache_key);
+  lua_rawget(L, LUA_REGISTRYINDEX);
+  lua_pushvalue(L, 1);
+  lua_rawget(L, -2);
+  if (lua_isstring(L, -1)) {
+    goto cleanup;
+  }
+  lua_pop(L, 1);
+
   err = from_utf8(&str_unmanaged_const(lua_tostring(L, 1)), &tmp);
   if (efailed(err)) {
     err = ethru(err);
     goto cleanup;
   }
-  char buf[4096];
-  static char const hex[] = "0123456789abcdef";
-  size_t len = tmp.len;
-  for (size_t i = 0; i < len; ++i) {
-    int const c = tmp.ptr[i];
-    buf[i * 4 + 0] = hex[(c >> 4) & 0xf];
-    buf[i * 4 + 1] = hex[(c >> 0) & 0xf];
-    buf[i * 4 + 2] = hex[(c >> 12) & 0xf];
-    buf[i * 4 + 3] = hex[(c >> 8) & 0xf];
+  char buf[exotext_field_size];
+  err = exotext_encode_field(tmp.ptr, tmp.len, buf);
+  if (efailed(err)) {
+    err = ethru(err);
+    goto cleanup;
+  }
+  lua_pushlstring(L, buf, exotext_field_size);
+
+  struct luactx *ctx = get_context(L);
+  if (ctx) {
+    if (++ctx->exotext_cache_entries > exotext_cache_max_entries) {
+      lua_newtable(L);
+      lua_pushlightuserdata(L, (void *)&g_exotext_cache_key);
+      lua_pushvalue(L, -2);
+      lua_rawset(L, LUA_REGISTRYINDEX);
+      lua_replace(L, -3);
+      ctx->exotext_cache_entries = 1;
+    }
+    lua_pushvalue(L, 1);
+    lua_pushvalue(L, -2);
+    lua_rawset(L, -4);
   }
-  memset(buf + len * 4, '0', 4096 - len * 4);
-  lua_pushlstring(L, buf, 4096);
 cleanup:
   ereport(sfree(&tmp));
   return efailed(err) ? lua_throw(L, err) : 1;
 }
 
+static int get_int_field(lua_State *const L, int const idx, char const *const key, int const default_value) {
+  lua_getfield(L, idx, key);
+  int const v = lua_isnumber(L, -1) ? (int)lua_tointeger(L, -1) : default_value;
+  lua_pop(L, 1);
+  return v;
+}
+
+static int luafn_exo_header(lua_State *const L) {
+  error err = eok();
+  if (lua_gettop(L) != 1 || !lua_istable(L, 1)) {
+    err = errg(err_invalid_arugment);
+    goto cleanup;
+  }
+  struct luactx *ctx = get_context(L);
+  if (!ctx) {
+    err = errg(err_invalid_arugment);
+    goto cleanup;
+  }
+  err = exobuilder_header(ctx->exobuilder,
+                          &(struct exobuilder_header){
+                              .width = get_int_field(L, 1, "width", 0),
+                              .height = get_int_field(L, 1, "height", 0),
+                              .rate = get_int_field(L, 1, "rate", 0),
+                              .scale = get_int_field(L, 1, "scale", 0),
+                              .length = get_int_field(L, 1, "length", 0),
+                              .audio_rate = get_int_field(L, 1, "audio_rate", 0),
+                              .audio_ch = get_int_field(L, 1, "audio_ch", 0),
+                          });
+  if (efailed(err)) {
+    err = ethru(err);
+    goto cleanup;
+  }
+cleanup:
+  return efailed(err) ? lua_throw(L, err) : 0;
+}
+
+static int luafn_exo_object(lua_State *const L) {
+  error err = eok();
+  int index = 0;
+  if (lua_gettop(L) != 1 || !lua_istable(L, 1)) {
+    err = errg(err_invalid_arugment);
+    goto cleanup;
+  }
+  struct luactx *ctx = get_context(L);
+  if (!ctx) {
+    err = errg(err_invalid_arugment);
+    goto cleanup;
+  }
+  struct exobuilder_object const o = {
+      .start = get_int_field(L, 1, "start", 1),
+      .end = get_int_field(L, 1, "end", 1),
+      .layer = get_int_field(L, 1, "layer", 1),
+      .group = get_int_field(L, 1, "group", -1),
+      .overlay = get_int_field(L, 1, "overlay", -1),
+      .clipping = get_int_field(L, 1, "clipping", -1),
+      .camera = get_int_field(L, 1, "camera", -1),
+      .chain = get_int_field(L, 1, "chain", -1),
+      .audio = get_int_field(L, 1, "audio", -1),
+  };
+  err = exobuilder_object(ctx->exobuilder, &o, &index);
+  if (efailed(err)) {
+    err = ethru(err);
+    goto cleanup;
+  }
+  if (ctx->layeralloc && o.start <= o.end) {
+    err = layeralloc_add(ctx->layeralloc, o.layer, o.start, o.end);
+    if (efailed(err)) {
+      err = ethru(err);
+      goto cleanup;
+    }
+  }
+  lua_pushinteger(L, index);
+cleanup:
+  return efailed(err) ? lua_throw(L, err) : 1;
+}
+
+static int luafn_exo_filter(lua_State *const L) {
+  error err = eok();
+  int const nargs = lua_gettop(L);
+  if (nargs < 1 || nargs > 2 || !lua_isstring(L, 1) || (nargs == 2 && !lua_istable(L, 2))) {
+    err = errg(err_invalid_arugment);
+    goto cleanup;
+  }
+  struct luactx *ctx = get_context(L);
+  if (!ctx) {
+    err = errg(err_invalid_arugment);
+    goto cleanup;
+  }
+  size_t name_len;
+  char const *const name = lua_tolstring(L, 1, &name_len);
+  err = exobuilder_filter(ctx->exobuilder, name, name_len);
+  if (efailed(err)) {
+    err = ethru(err);
+    goto cleanup;
+  }
+  if (nargs == 1) {
+    goto cleanup;
+  }
+  // Items are given as an array of {key, value} pairs to preserve their order.
+  size_t const n = lua_objlen(L, 2);
+  for (size_t i = 0; i < n; ++i) {
+    lua_rawgeti(L, 2, (int)i + 1);
+    if (!lua_istable(L, -1)) {
+      err = errg(err_invalid_arugment);
+      goto cleanup;
+    }
+    lua_rawgeti(L, -1, 1);
+    lua_rawgeti(L, -2, 2);
+    size_t key_len, value_len;
+    char const *const key = lua_tolstring(L, -2, &key_len);
+    char const *const value = lua_tolstring(L, -1, &value_len);
+    if (!key || !value) {
+      err = errg(err_invalid_arugment);
+      goto cleanup;
+    }
+    err = exobuilder_item(ctx->exobuilder, key, key_len, value, value_len);
+    if (efailed(err)) {
+      err = ethru(err);
+      goto cleanup;
+    }
+    lua_pop(L, 3);
+  }
+cleanup:
+  return efailed(err) ? lua_throw(L, err) : 0;
+}
+
+static int luafn_exo_text(lua_State *const L) {
+  error err = eok();
+  if (lua_gettop(L) != 1 || !lua_isstring(L, 1)) {
+    err = errg(err_invalid_arugment);
+    goto cleanup;
+  }
+  struct luactx *ctx = get_context(L);
+  if (!ctx) {
+    err = errg(err_invalid_arugment);
+    goto cleanup;
+  }
+  size_t len;
+  char const *const s = lua_tolstring(L, 1, &len);
+  err = exobuilder_raw(ctx->exobuilder, s, len);
+  if (efailed(err)) {
+    err = ethru(err);
+    goto cleanup;
+  }
+cleanup:
+  return efailed(err) ? lua_throw(L, err) : 0;
+}
+
+static int luafn_alloc_layer(lua_State *const L) {
+  error err = eok();
+  int const nargs = lua_gettop(L);
+  if (nargs < 2 || nargs > 3 || !lua_isnumber(L, 1) || !lua_isnumber(L, 2) || (nargs == 3 && !lua_isnumber(L, 3))) {
+    err = errg(err_invalid_arugment);
+    goto cleanup;
+  }
+  struct luactx *ctx = get_context(L);
+  if (!ctx || !ctx->layeralloc) {
+    err = errg(err_invalid_arugment);
+    goto cleanup;
+  }
+  if (ctx->parallel) {
+    // Which worker reaches the allocator first depends on timing, so the layers would differ from run to run.
+    err = emsg_i18n(err_type_generic, err_fail, gettext("alloc_layer cannot be used by modules that run in parallel."));
+    goto cleanup;
+  }
+  int layer = 0;
+  err = layeralloc_alloc(ctx->layeralloc,
+                         (int)lua_tointeger(L, 1),
+                         (int)lua_tointeger(L, 2),
+                         nargs == 3 ? (int)lua_tointeger(L, 3) : 1,
+                         &layer);
+  if (efailed(err)) {
+    if (eisg(err, err_not_found)) {
+      efree(&err);
+      err = emsg_i18n(err_type_generic, err_not_found, gettext("No free layer is available."));
+    }
+    err = ethru(err);
+    goto cleanup;
+  }
+  lua_pushinteger(L, layer);
+cleanup:
+  return efailed(err) ? lua_throw(L, err) : 1;
+}
+
+static void push_frames(lua_State *const L, struct frametiming_range const *const frames, size_t const index) {
+  if (!frames) {
+    return;
+  }
+  lua_pushinteger(L, frames[index].start);
+  lua_setfield(L, -2, "start_frame");
+  lua_pushinteger(L, frames[index].end);
+  lua_setfield(L, -2, "end_frame");
+}
+
+void lua_push_transcript_segment(lua_State *const L, struct transcript const *const t, size_t const index) {
+  struct transcript_segment const *const segment = &t->segments[index];
+  lua_newtable(L);
+  lua_pushinteger(L, (lua_Integer)index + 1);
+  lua_setfield(L, -2, "index");
+  lua_pushnumber(L, segment->start);
+  lua_setfield(L, -2, "start");
+  lua_pushnumber(L, segment->end);
+  lua_setfield(L, -2, "end");
+  lua_pushlstring(L, t->strings + segment->text, segment->text_len);
+  lua_setfield(L, -2, "text");
+  push_frames(L, t->segment_frames, index);
+  lua_createtable(L, (int)segment->num_words, 0);
+  struct transcript_word const *const words = t->words + segment->first_word;
+  for (size_t i = 0; i < segment->num_words; ++i) {
+    struct transcript_word const *const word = &words[i];
+    lua_newtable(L);
+    lua_pushnumber(L, word->start);
+    lua_setfield(L, -2, "start");
+    lua_pushnumber(L, word->end);
+    lua_setfield(L, -2, "end");
+    lua_pushlstring(L, t->strings + word->word, word->word_len);
+    lua_setfield(L, -2, "word");
+    push_frames(L, t->word_frames, segment->first_word + i);
+    lua_rawseti(L, -2, (int)i + 1);
+  }
+  lua_setfield(L, -2, "words");
+}
+
+static void push_transcript_word(lua_State *const L, struct transcript const *const t, size_t const index) {
+  struct transcript_word const *const word = &t->words[index];
+  lua_newtable(L);
+  lua_pushinteger(L, (lua_Integer)index + 1);
+  lua_setfield(L, -2, "index");
+  lua_pushnumber(L, word->start);
+  lua_setfield(L, -2, "start");
+  lua_pushnumber(L, word->end);
+  lua_setfield(L, -2, "end");
+  lua_pushlstring(L, t->strings + word->word, word->word_len);
+  lua_setfield(L, -2, "word");
+  push_frames(L, t->word_frames, index);
+}
+
+static int query_transcript(lua_State *const L, bool const words) {
+  error err = eok();
+  size_t *indices = NULL;
+  if (lua_gettop(L) != 2 || !lua_isnumber(L, 1) || !lua_isnumber(L, 2)) {
+    err = errg(err_invalid_arugment);
+    goto cleanup;
+  }
+  struct luactx *ctx = get_context(L);
+  if (!ctx || !ctx->transcript) {
+    err = errg(err_invalid_arugment);
+    goto cleanup;
+  }
+  double const t0 = lua_tonumber(L, 1);
+  double const t1 = lua_tonumber(L, 2);
+  if (words) {
+    err = transcript_query_words(ctx->transcript, t0, t1, &indices);
+  } else {
+    err = transcript_query_segments(ctx->transcript, t0, t1, &indices);
+  }
+  if (efailed(err)) {
+    err = ethru(err);
+    goto cleanup;
+  }
+  size_t const n = OV_ARRAY_LENGTH(indices);
+  lua_createtable(L, (int)n, 0);
+  for (size_t i = 0; i < n; ++i) {
+    if (words) {
+      push_transcript_word(L, ctx->transcript, indices[i]);
+    } else {
+      lua_push_transcript_segment(L, ctx->transcript, indices[i]);
+    }
+    lua_rawseti(L, -2, (int)i + 1);
+  }
+cleanup:
+  OV_ARRAY_DESTROY(&indices);
+  return efailed(err) ? lua_throw(L, err) : 1;
+}
+
+static int luafn_transcript_query(lua_State *const L) { return query_transcript(L, false); }
+
+static int luafn_transcript_query_words(lua_State *const L) { return query_transcript(L, true); }
+
 static NODISCARD error get_preferred_languages_in_utf8(char **langs) {
   error err = eok();
   struct wstr tmp = {0};
@@ -288,6 +665,264 @@ cleanup:
   return efailed(err) ? lua_throw(L, err) : 1;
 }
 
+static NODISCARD error acp_to_wide(char const *const src, wchar_t **const dest) {
+  int const len = MultiByteToWideChar(CP_ACP, 0, src, -1, NULL, 0);
+  if (len == 0) {
+    return errhr(HRESULT_FROM_WIN32(GetLastError()));
+  }
+  error err = OV_ARRAY_GROW(dest, (size_t)len);
+  if (efailed(err)) {
+    return ethru(err);
+  }
+  if (MultiByteToWideChar(CP_ACP, 0, src, -1, *dest, len) == 0) {
+    return errhr(HRESULT_FROM_WIN32(GetLastError()));
+  }
+  OV_ARRAY_SET_LENGTH(*dest, (size_t)(len - 1));
+  return eok();
+}
+
+/**
+ * Searches package.path for the module in the same way as the standard Lua loader.
+ * If found, pushes the file name and returns true.
+ */
+static bool find_module_file(lua_State *const L, char const *const name, wchar_t **const path) {
+  lua_getglobal(L, "package");
+  lua_getfield(L, -1, "path");
+  char const *p = lua_tostring(L, -1);
+  if (!p) {
+    lua_pop(L, 2);
+    return false;
+  }
+  char const *const n = luaL_gsub(L, name, ".", LUA_DIRSEP);
+  for (;;) {
+    while (*p == *LUA_PATHSEP) {
+      ++p;
+    }
+    if (*p == '\0') {
+      break;
+    }
+    char const *e = strchr(p, *LUA_PATHSEP);
+    if (!e) {
+      e = p + strlen(p);
+    }
+    lua_pushlstring(L, p, (size_t)(e - p));
+    char const *const filename = luaL_gsub(L, lua_tostring(L, -1), LUA_PATH_MARK, n);
+    lua_remove(L, -2);
+    p = e;
+    error err = acp_to_wide(filename, path);
+    if (efailed(err)) {
+      efree(&err);
+      lua_pop(L, 1);
+      continue;
+    }
+    DWORD const attr = GetFileAttributesW(*path);
+    if (attr == INVALID_FILE_ATTRIBUTES || (attr & FILE_ATTRIBUTE_DIRECTORY)) {
+      lua_pop(L, 1);
+      continue;
+    }
+    // package, package.path, n, filename -> filename
+    lua_replace(L, -4);
+    lua_pop(L, 2);
+    return true;
+  }
+  lua_pop(L, 3);
+  return false;
+}
+
+static NODISCARD error get_cache_path(struct luactx const *const ctx, char const *const name, wchar_t **const path) {
+  wchar_t *wname = NULL;
+  error err = acp_to_wide(name, &wname);
+  if (efailed(err)) {
+    err = ethru(err);
+    goto cleanup;
+  }
+  for (wchar_t *c = wname; *c; ++c) {
+    if (wcschr(L"\\/:*?\"<>|", *c)) {
+      *c = L'_';
+    }
+  }
+  size_t const dirlen = wcslen(ctx->cache_directory);
+  size_t const namelen = wcslen(wname);
+  err = OV_ARRAY_GROW(path, dirlen + 1 + namelen + 6);
+  if (efailed(err)) {
+    err = ethru(err);
+    goto cleanup;
+  }
+  wcscpy(*path, ctx->cache_directory);
+  wcscpy(*path + dirlen, L"\\");
+  wcscpy(*path + dirlen + 1, wname);
+  wcscpy(*path + dirlen + 1 + namelen, L".luac");
+cleanup:
+  OV_ARRAY_DESTROY(&wname);
+  return err;
+}
+
+static NODISCARD error
+add_loaded_file(struct luactx *const ctx, wchar_t const *const path, uint64_t const mtime, uint64_t const size) {
+  struct loaded_file f = {
+      .mtime = mtime,
+      .size = size,
+  };
+  size_t const len = wcslen(path);
+  error err = OV_ARRAY_GROW(&f.path, len + 1);
+  if (efailed(err)) {
+    err = ethru(err);
+    goto cleanup;
+  }
+  wcscpy(f.path, path);
+  size_t const n = OV_ARRAY_LENGTH(ctx->loaded_files);
+  err = OV_ARRAY_GROW(&ctx->loaded_files, n + 1);
+  if (efailed(err)) {
+    err = ethru(err);
+    goto cleanup;
+  }
+  ctx->loaded_files[n] = f;
+  OV_ARRAY_SET_LENGTH(ctx->loaded_files, n + 1);
+  f.path = NULL;
+cleanup:
+  OV_ARRAY_DESTROY(&f.path);
+  return err;
+}
+
+struct dump_buffer {
+  char *ptr;
+  size_t len;
+  size_t cap;
+};
+
+static int dump_writer(lua_State *const L, void const *const p, size_t const sz, void *const ud) {
+  (void)L;
+  struct dump_buffer *const b = ud;
+  if (b->len + sz > b->cap) {
+    size_t cap = b->cap ? b->cap : 4096;
+    while (cap < b->len + sz) {
+      cap *= 2;
+    }
+    error err = OV_ARRAY_GROW(&b->ptr, cap);
+    if (efailed(err)) {
+      efree(&err);
+      return 1;
+    }
+    b->cap = cap;
+  }
+  memcpy(b->ptr + b->len, p, sz);
+  b->len += sz;
+  return 0;
+}
+
+/**
+ * A package loader that records the files it has loaded, so that luactx_is_stale can find changes.
+ * It also keeps the compiled chunk of Lua modules in the cache directory if available.
+ * It is placed before the standard Lua loader, and behaves the same except that
+ * the chunk is loaded from the cache if the source file has not been changed.
+ */
+static int luafn_cached_loader(lua_State *const L) {
+  struct luactx *const ctx = get_context(L);
+  char const *const name = luaL_checkstring(L, 1);
+  wchar_t *path = NULL;
+  wchar_t *cache_path = NULL;
+  char *source = NULL;
+  char *cache = NULL;
+  char *entry = NULL;
+  struct dump_buffer dump = {0};
+  char const *filename = NULL;
+  bool found = false;
+  bool compile_failed = false;
+  error err = eok();
+
+  if (!find_module_file(L, name, &path)) {
+    goto cleanup;
+  }
+  found = true;
+  filename = lua_tostring(L, -1);
+  lua_pushfstring(L, "@%s", filename);
+  char const *const chunkname = lua_tostring(L, -1);
+  uint64_t mtime = 0;
+  err = luacache_read_file(path, &source, &mtime);
+  if (efailed(err)) {
+    err = ethru(err);
+    goto cleanup;
+  }
+  size_t const source_len = OV_ARRAY_LENGTH(source);
+  err = add_loaded_file(ctx, path, mtime, source_len);
+  if (efailed(err)) {
+    err = ethru(err);
+    goto cleanup;
+  }
+  if (!ctx->cache_directory) {
+    if (luaL_loadbuffer(L, source, source_len, chunkname) != 0) {
+      compile_failed = true;
+    }
+    goto cleanup;
+  }
+  // The chunk name is embedded in the compiled chunk, so it is part of the key too.
+  struct luacache_source const src = {
+      .mtime = mtime,
+      .size = source_len,
+      .hash = hash_fnv1a(source, source_len, hash_fnv1a(chunkname, strlen(chunkname), 0)),
+  };
+  err = get_cache_path(ctx, name, &cache_path);
+  if (efailed(err)) {
+    err = ethru(err);
+    goto cleanup;
+  }
+  error cache_err = luacache_read_file(cache_path, &cache, NULL);
+  if (efailed(cache_err)) {
+    efree(&cache_err);
+  } else {
+    char const *bytecode = NULL;
+    size_t bytecode_len = 0;
+    if (luacache_decode(cache, OV_ARRAY_LENGTH(cache), &src, &bytecode, &bytecode_len)) {
+      if (luaL_loadbuffer(L, bytecode, bytecode_len, chunkname) == 0) {
+        goto cleanup;
+      }
+      lua_pop(L, 1);
+    }
+  }
+  if (luaL_loadbuffer(L, source, source_len, chunkname) != 0) {
+    compile_failed = true;
+    goto cleanup;
+  }
+  if (lua_dump(L, dump_writer, &dump) == 0 && dump.len) {
+    cache_err = luacache_encode(&src, dump.ptr, dump.len, &entry);
+    if (esucceeded(cache_err)) {
+      cache_err = luacache_write_file(cache_path, entry, OV_ARRAY_LENGTH(entry));
+    }
+    // The cache is only for speed, so the module can still be used if it cannot be written.
+    if (efailed(cache_err)) {
+      efree(&cache_err);
+    }
+  }
+cleanup:
+  OV_ARRAY_DESTROY(&path);
+  OV_ARRAY_DESTROY(&cache_path);
+  OV_ARRAY_DESTROY(&source);
+  OV_ARRAY_DESTROY(&cache);
+  OV_ARRAY_DESTROY(&entry);
+  OV_ARRAY_DESTROY(&dump.ptr);
+  if (efailed(err)) {
+    return lua_throw(L, err);
+  }
+  if (compile_failed) {
+    return luaL_error(
+        L, "error loading module " LUA_QS " from file " LUA_QS ":\n\t%s", name, filename, lua_tostring(L, -1));
+  }
+  return found ? 1 : 0;
+}
+
+static void install_cached_loader(lua_State *const L) {
+  lua_getglobal(L, "package");
+  lua_getfield(L, -1, "loaders");
+  // Insert after package.preload and before the standard Lua loader.
+  for (int i = (int)lua_objlen(L, -1); i >= 2; --i) {
+    lua_rawgeti(L, -1, i);
+    lua_rawseti(L, -2, i + 1);
+  }
+  lua_pushcfunction(L, luafn_cached_loader);
+  lua_rawseti(L, -2, 2);
+  lua_pop(L, 2);
+}
+
 NODISCARD error luactx_create(struct luactx **const lcpp, struct luactx_params const *const params) {
   if (!lcpp || *lcpp) {
     return errg(err_invalid_arugment);
@@ -306,7 +941,19 @@ NODISCARD error luactx_create(struct luactx **const lcpp, struct luactx_params c
   lc->line_buffer.userdata = lc;
   lc->line_buffer.on_line = process_line;
 
-  lc->L = lua_newstate(lua_alloc, NULL);
+  err = exobuilder_create(&lc->exobuilder);
+  if (efailed(err)) {
+    err = ethru(err);
+    goto cleanup;
+  }
+
+  err = luaalloc_create(&lc->alloc);
+  if (efailed(err)) {
+    err = ethru(err);
+    goto cleanup;
+  }
+
+  lc->L = lua_newstate(luaalloc_alloc, lc->alloc);
   if (!lc->L) {
     err = errg(err_out_of_memory);
     goto cleanup;
@@ -315,6 +962,9 @@ NODISCARD error luactx_create(struct luactx **const lcpp, struct luactx_params c
   lua_pushlightuserdata(lc->L, (void *)&g_key);
   lua_pushlightuserdata(lc->L, lc);
   lua_settable(lc->L, LUA_REGISTRYINDEX);
+  lua_pushlightuserdata(lc->L, (void *)&g_exotext_cache_key);
+  lua_newtable(lc->L);
+  lua_settable(lc->L, LUA_REGISTRYINDEX);
 
   luaL_openlibs(lc->L);
   lua_pushcfunction(lc->L, lua_debug_print);
@@ -323,6 +973,28 @@ NODISCARD error luactx_create(struct luactx **const lcpp, struct luactx_params c
   lua_setglobal(lc->L, "exotext");
   lua_pushcfunction(lc->L, luafn_i18n);
   lua_setglobal(lc->L, "i18n");
+  lua_pushcfunction(lc->L, luafn_alloc_layer);
+  lua_setglobal(lc->L, "alloc_layer");
+
+  static luaL_Reg const exo_funcs[] = {
+      {"header", luafn_exo_header},
+      {"object", luafn_exo_object},
+      {"filter", luafn_exo_filter},
+      {"text", luafn_exo_text},
+      {NULL, NULL},
+  };
+  lua_newtable(lc->L);
+  luaL_register(lc->L, NULL, exo_funcs);
+  lua_setglobal(lc->L, "exo");
+
+  static luaL_Reg const transcript_funcs[] = {
+      {"query", luafn_transcript_query},
+      {"query_words", luafn_transcript_query_words},
+      {NULL, NULL},
+  };
+  lua_newtable(lc->L);
+  luaL_register(lc->L, NULL, transcript_funcs);
+  lua_setglobal(lc->L, "transcript");
 
   int len = WideCharToMultiByte(CP_ACP, 0, params->lua_directory, -1, NULL, 0, NULL, NULL);
   if (len == 0) {
@@ -346,6 +1018,19 @@ NODISCARD error luactx_create(struct luactx **const lcpp, struct luactx_params c
   lua_setfield(lc->L, -2, "cpath");
   lua_pop(lc->L, 1);
 
+  if (params->cache_directory) {
+    if (CreateDirectoryW(params->cache_directory, NULL) || GetLastError() == ERROR_ALREADY_EXISTS) {
+      size_t const cache_directory_len = wcslen(params->cache_directory);
+      err = OV_ARRAY_GROW(&lc->cache_directory, cache_directory_len + 1);
+      if (efailed(err)) {
+        err = ethru(err);
+        goto cleanup;
+      }
+      wcscpy(lc->cache_directory, params->cache_directory);
+    }
+  }
+  install_cached_loader(lc->L);
+
   *lcpp = lc;
 cleanup:
   if (efailed(err)) {
@@ -363,9 +1048,68 @@ void luactx_destroy(struct luactx **const lcpp) {
   if (lc->L) {
     lua_close(lc->L);
   }
+  luaalloc_destroy(&lc->alloc);
+  linebuffer_destroy(&lc->line_buffer);
   OV_ARRAY_DESTROY(&lc->buffer);
+  OV_ARRAY_DESTROY(&lc->cache_directory);
+  for (size_t i = 0, n = OV_ARRAY_LENGTH(lc->loaded_files); i < n; ++i) {
+    OV_ARRAY_DESTROY(&lc->loaded_files[i].path);
+  }
+  OV_ARRAY_DESTROY(&lc->loaded_files);
   OV_ARRAY_DESTROY(&lc->preferred_languages);
+  exobuilder_destroy(&lc->exobuilder);
   ereport(mem_free(lcpp));
 }
 
 lua_State *luactx_get(struct luactx *const lc) { return lc->L; }
+
+struct exobuilder *luactx_get_exobuilder(struct luactx *const lc) { return lc->exobuilder; }
+
+void luactx_set_transcript(struct luactx *const lc, struct transcript const *const t) { lc->transcript = t; }
+
+void luactx_set_layeralloc(struct luactx *const lc, struct layeralloc *const la) { lc->layeralloc = la; }
+
+void luactx_set_parallel(struct luactx *const lc, bool const parallel) { lc->parallel = parallel; }
+
+void luactx_reset(struct luactx *const lc,
+                  void *const userdata,
+                  void (*on_log_line)(void *const userdata, wchar_t const *const message)) {
+  if (!lc) {
+    return;
+  }
+  lc->params.userdata = userdata;
+  lc->params.on_log_line = on_log_line;
+  lc->transcript = NULL;
+  lc->layeralloc = NULL;
+  lc->parallel = false;
+  linebuffer_reset(&lc->line_buffer);
+  lua_settop(lc->L, 0);
+  exobuilder_reset(lc->exobuilder);
+  luaalloc_reset_stats(lc->alloc);
+}
+
+void luactx_get_alloc_stats(struct luactx const *const lc, struct luaalloc_stats *const stats) {
+  if (!lc) {
+    return;
+  }
+  luaalloc_get_stats(lc->alloc, stats);
+}
+
+bool luactx_is_stale(struct luactx const *const lc) {
+  if (!lc) {
+    return true;
+  }
+  for (size_t i = 0, n = OV_ARRAY_LENGTH(lc->loaded_files); i < n; ++i) {
+    struct loaded_file const *const f = &lc->loaded_files[i];
+    WIN32_FILE_ATTRIBUTE_DATA fad;
+    if (!GetFileAttributesExW(f->path, GetFileExInfoStandard, &fad)) {
+      return true;
+    }
+    uint64_t const mtime = ((uint64_t)fad.ftLastWriteTime.dwHighDateTime << 32) | fad.ftLastWriteTime.dwLowDateTime;
+    uint64_t const size = ((uint64_t)fad.nFileSizeHigh << 32) | fad.nFileSizeLow;
+    if (mtime != f->mtime || size != f->size) {
+      return true;
+    }
+  }
+  return false;
+}
@@ -9,9 +9,14 @@ enum {
 };
 
 struct luactx;
+struct exobuilder;
+struct layeralloc;
+struct luaalloc_stats;
+struct transcript;
 
 struct luactx_params {
   wchar_t const *lua_directory;
+  wchar_t const *cache_directory; /**< Directory to keep compiled modules in, NULL to disable the cache. */
   void *userdata;
   void (*on_log_line)(void *const userdata, wchar_t const *const message);
 };
@@ -19,7 +24,70 @@ struct luactx_params {
 NODISCARD error luactx_create(struct luactx **const lcpp, struct luactx_params const *const params);
 void luactx_destroy(struct luactx **const lcpp);
 lua_State *luactx_get(struct luactx *const lc);
+
+/**
+ * @brief Prepares the state for another run.
+ *
+ * Replaces the log callback, clears the stack, the exobuilder, the transcript and the layer allocator, and resets
+ * the allocation statistics.
+ * Loaded modules and global variables are kept.
+ */
+void luactx_reset(struct luactx *const lc,
+                  void *const userdata,
+                  void (*on_log_line)(void *const userdata, wchar_t const *const message));
+
+/**
+ * @brief Returns true if any Lua file loaded by require has been changed or removed since it was loaded.
+ */
+bool luactx_is_stale(struct luactx const *const lc);
+
+/**
+ * @brief Gets the memory usage of the Lua state since it was created or reset.
+ */
+void luactx_get_alloc_stats(struct luactx const *const lc, struct luaalloc_stats *const stats);
+struct exobuilder *luactx_get_exobuilder(struct luactx *const lc);
+
+/**
+ * @brief Makes the transcript available to transcript.query and transcript.query_words in Lua.
+ *
+ * The transcript must have its index built and must outlive the use of the state.
+ */
+void luactx_set_transcript(struct luactx *const lc, struct transcript const *const t);
+
+/**
+ * @brief Makes the layer allocator available to alloc_layer in Lua.
+ *
+ * Objects written with exo.object are also recorded to the allocator.
+ * The allocator must outlive the use of the state.
+ */
+void luactx_set_layeralloc(struct luactx *const lc, struct layeralloc *const la);
+
+/**
+ * @brief Marks the state as one of several processing segments concurrently.
+ *
+ * alloc_layer in Lua raises an error in such a state, because the layers it returns would depend on the order in
+ * which the workers happen to reach the allocator.
+ */
+void luactx_set_parallel(struct luactx *const lc, bool const parallel);
+
+/**
+ * @brief Pushes a table with index, start, end, text and words of the segment, as passed to on_segment.
+ *
+ * If the frames have been computed by frametiming_compute, the segment and its words also have start_frame and
+ * end_frame.
+ */
+void lua_push_transcript_segment(lua_State *const L, struct transcript const *const t, size_t const index);
 NODISCARD error lua_pcall_(lua_State *const L, int const nargs, int const nresults ERR_FILEPOS_PARAMS);
 #define lua_safecall(L, nargs, nresults) (lua_pcall_((L), (nargs), (nresults)ERR_FILEPOS_VALUES))
 
 NODISCARD error lua_require(lua_State *const L, wchar_t const *const module_name);
+
+/**
+ * @brief Requires the module so that it starts from a clean state.
+ *
+ * If the module has already been loaded in this state, its on_reset function is called.
+ * If the module has no on_reset, the module is loaded again instead.
+ * Modules required by the module are not reset.
+ * The module is pushed onto the stack on success.
+ */
+NODISCARD error lua_require_reset(lua_State *const L, wchar_t const *const module_name);
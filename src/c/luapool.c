@@ -0,0 +1,137 @@
+#include "luapool.h"
+
+#include <ovarray.h>
+#include <ovthreads.h>
+
+#include "luactx.h"
+#include "strutil.h"
+
+enum {
+  luapool_max_idle = 16,
+};
+
+struct luapool {
+  mtx_t mtx;
+  wchar_t *lua_directory;
+  wchar_t *cache_directory;
+  struct luactx **idle;
+};
+
+NODISCARD error luapool_create(struct luapool **const pp,
+                               wchar_t const *const lua_directory,
+                               wchar_t const *const cache_directory) {
+  if (!pp || *pp || !lua_directory) {
+    return errg(err_invalid_arugment);
+  }
+  struct luapool *pool = NULL;
+  error err = mem(&pool, 1, sizeof(struct luapool));
+  if (efailed(err)) {
+    err = ethru(err);
+    goto cleanup;
+  }
+  *pool = (struct luapool){0};
+  mtx_init(&pool->mtx, mtx_plain);
+  err = strutil_copy(&pool->lua_directory, lua_directory);
+  if (efailed(err)) {
+    err = ethru(err);
+    goto cleanup;
+  }
+  if (cache_directory) {
+    err = strutil_copy(&pool->cache_directory, cache_directory);
+    if (efailed(err)) {
+      err = ethru(err);
+      goto cleanup;
+    }
+  }
+  err = OV_ARRAY_GROW(&pool->idle, luapool_max_idle);
+  if (efailed(err)) {
+    err = ethru(err);
+    goto cleanup;
+  }
+  *pp = pool;
+  pool = NULL;
+cleanup:
+  if (pool) {
+    luapool_destroy(&pool);
+  }
+  return err;
+}
+
+void luapool_destroy(struct luapool **const pp) {
+  if (!pp || !*pp) {
+    return;
+  }
+  struct luapool *pool = *pp;
+  for (size_t i = 0, n = OV_ARRAY_LENGTH(pool->idle); i < n; ++i) {
+    luactx_destroy(&pool->idle[i]);
+  }
+  OV_ARRAY_DESTROY(&pool->idle);
+  OV_ARRAY_DESTROY(&pool->cache_directory);
+  OV_ARRAY_DESTROY(&pool->lua_directory);
+  mtx_destroy(&pool->mtx);
+  ereport(mem_free(pp));
+}
+
+static struct luactx *pop_idle(struct luapool *const pool) {
+  struct luactx *lc = NULL;
+  mtx_lock(&pool->mtx);
+  size_t const n = OV_ARRAY_LENGTH(pool->idle);
+  if (n) {
+    lc = pool->idle[n - 1];
+    OV_ARRAY_SET_LENGTH(pool->idle, n - 1);
+  }
+  mtx_unlock(&pool->mtx);
+  return lc;
+}
+
+NODISCARD error luapool_acquire(struct luapool *const pool,
+                                void *const userdata,
+                                void (*on_log_line)(void *const userdata, wchar_t const *const message),
+                                struct luactx **const lcpp) {
+  if (!pool || !lcpp || *lcpp) {
+    return errg(err_invalid_arugment);
+  }
+  struct luactx *lc;
+  while ((lc = pop_idle(pool)) != NULL) {
+    if (!luactx_is_stale(lc)) {
+      luactx_reset(lc, userdata, on_log_line);
+      *lcpp = lc;
+      return eok();
+    }
+    luactx_destroy(&lc);
+  }
+  error err = luactx_create(lcpp,
+                            &(struct luactx_params){
+                                .lua_directory = pool->lua_directory,
+                                .cache_directory = pool->cache_directory,
+                                .userdata = userdata,
+                                .on_log_line = on_log_line,
+                            });
+  if (efailed(err)) {
+    return ethru(err);
+  }
+  return eok();
+}
+
+void luapool_release(struct luapool *const pool, struct luactx **const lcpp, bool const reusable) {
+  if (!lcpp || !*lcpp) {
+    return;
+  }
+  if (!pool || !reusable) {
+    luactx_destroy(lcpp);
+    return;
+  }
+  // Do not keep the callbacks of the finished run.
+  luactx_reset(*lcpp, NULL, NULL);
+  mtx_lock(&pool->mtx);
+  size_t const n = OV_ARRAY_LENGTH(pool->idle);
+  if (n < luapool_max_idle) {
+    pool->idle[n] = *lcpp;
+    OV_ARRAY_SET_LENGTH(pool->idle, n + 1);
+    *lcpp = NULL;
+  }
+  mtx_unlock(&pool->mtx);
+  if (*lcpp) {
+    luactx_destroy(lcpp);
+  }
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <ovbase.h>
+
+struct luactx;
+struct luapool;
+
+/**
+ * @brief Creates a pool of Lua states.
+ *
+ * Creating a Lua state and loading a module takes time, so the states used by a run are kept
+ * and handed to the next run. A state is discarded instead of being reused when any of the
+ * Lua files it has loaded has been changed, so edited modules are picked up on the next run.
+ *
+ * @param pp A pointer to receive the pool.
+ * @param lua_directory Directory containing Lua scripts.
+ * @param cache_directory Directory to keep compiled modules in, NULL to disable the cache.
+ * @return An error code indicating success or failure.
+ */
+NODISCARD error luapool_create(struct luapool **const pp,
+                               wchar_t const *const lua_directory,
+                               wchar_t const *const cache_directory);
+void luapool_destroy(struct luapool **const pp);
+
+/**
+ * @brief Takes a Lua state from the pool, or creates a new one if there is none.
+ *
+ * The returned state has an empty stack and an empty exobuilder.
+ * Modules loaded by a previous run are still loaded, see lua_require_reset.
+ * This function is thread-safe.
+ */
+NODISCARD error luapool_acquire(struct luapool *const pool,
+                                void *const userdata,
+                                void (*on_log_line)(void *const userdata, wchar_t const *const message),
+                                struct luactx **const lcpp);
+
+/**
+ * @brief Returns the Lua state to the pool.
+ *
+ * @param pool The pool. If NULL, the state is destroyed.
+ * @param lcpp A pointer to the state. It is set to NULL.
+ * @param reusable false if the state may be broken, such as after an error, to destroy it.
+ */
+void luapool_release(struct luapool *const pool, struct luactx **const lcpp, bool const reusable);
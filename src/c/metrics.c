@@ -0,0 +1,155 @@
+#include "metrics.h"
+
+#include <ovprintf.h>
+#include <ovutil/win32.h>
+
+#include <psapi.h>
+
+#include "i18n.h"
+#include "jsoncommon.h"
+
+static uint64_t get_cpu_time(void) {
+  FILETIME creation, exit, kernel, user;
+  if (!GetProcessTimes(GetCurrentProcess(), &creation, &exit, &kernel, &user)) {
+    return 0;
+  }
+  return (((uint64_t)kernel.dwHighDateTime << 32) | kernel.dwLowDateTime) +
+         (((uint64_t)user.dwHighDateTime << 32) | user.dwLowDateTime);
+}
+
+void metrics_clock_start(struct metrics_clock *const c) {
+  LARGE_INTEGER counter;
+  QueryPerformanceCounter(&counter);
+  *c = (struct metrics_clock){
+      .counter = counter.QuadPart,
+      .cpu = get_cpu_time(),
+  };
+}
+
+void metrics_clock_stop(struct metrics_clock const *const c, struct metrics *const m) {
+  LARGE_INTEGER counter, freq;
+  QueryPerformanceCounter(&counter);
+  QueryPerformanceFrequency(&freq);
+  m->wall_time = (double)(counter.QuadPart - c->counter) / (double)freq.QuadPart;
+  m->cpu_time = (double)(get_cpu_time() - c->cpu) / 10000000.0;
+  PROCESS_MEMORY_COUNTERS pmc = {.cb = sizeof(pmc)};
+  m->process_peak_memory = GetProcessMemoryInfo(GetCurrentProcess(), &pmc, sizeof(pmc)) ? pmc.PeakWorkingSetSize : 0;
+  m->realtime_factor = m->audio_duration > 0 ? m->wall_time / m->audio_duration : 0;
+}
+
+uint64_t metrics_get_file_size(wchar_t const *const path) {
+  WIN32_FILE_ATTRIBUTE_DATA fad;
+  if (!path || !GetFileAttributesExW(path, GetFileExInfoStandard, &fad)) {
+    return 0;
+  }
+  return ((uint64_t)fad.nFileSizeHigh << 32) | fad.nFileSizeLow;
+}
+
+NODISCARD error metrics_to_json(struct metrics const *const m, char **const json, size_t *const json_len) {
+  if (!m || !m->stage || !json || *json || !json_len) {
+    return errg(err_invalid_arugment);
+  }
+  error err = eok();
+  struct yyjson_mut_doc *doc = yyjson_mut_doc_new(jsoncommon_get_json_alc());
+  if (!doc) {
+    err = errg(err_out_of_memory);
+    goto cleanup;
+  }
+  struct yyjson_mut_val *const root = yyjson_mut_obj(doc);
+  if (!root) {
+    err = errg(err_out_of_memory);
+    goto cleanup;
+  }
+  yyjson_mut_doc_set_root(doc, root);
+
+  char started[32] = {0};
+  SYSTEMTIME st;
+  ULARGE_INTEGER const ft = {.QuadPart = m->run_started};
+  if (FileTimeToSystemTime(&(FILETIME){.dwLowDateTime = ft.LowPart, .dwHighDateTime = ft.HighPart}, &st)) {
+    ov_snprintf(started,
+                sizeof(started),
+                NULL,
+                "%04d-%02d-%02dT%02d:%02d:%02d.%03dZ",
+                st.wYear,
+                st.wMonth,
+                st.wDay,
+                st.wHour,
+                st.wMinute,
+                st.wSecond,
+                st.wMilliseconds);
+  }
+  yyjson_mut_obj_add_strcpy(doc, root, "run", started);
+  yyjson_mut_obj_add_strcpy(doc, root, "stage", m->stage);
+  yyjson_mut_obj_add_bool(doc, root, "success", m->success);
+  yyjson_mut_obj_add_real(doc, root, "wall_time", m->wall_time);
+  yyjson_mut_obj_add_real(doc, root, "cpu_time", m->cpu_time);
+  yyjson_mut_obj_add_real(doc, root, "child_cpu_time", m->child_cpu_time);
+  yyjson_mut_obj_add_uint(doc, root, "child_peak_memory", m->child_peak_memory);
+  yyjson_mut_obj_add_uint(doc, root, "bytes_in", m->bytes_in);
+  yyjson_mut_obj_add_uint(doc, root, "bytes_out", m->bytes_out);
+  yyjson_mut_obj_add_uint(doc, root, "samples", m->samples);
+  yyjson_mut_obj_add_int(doc, root, "sample_rate", m->sample_rate);
+  yyjson_mut_obj_add_real(doc, root, "audio_duration", m->audio_duration);
+  yyjson_mut_obj_add_uint(doc, root, "segments", m->segments);
+  yyjson_mut_obj_add_uint(doc, root, "words", m->words);
+  yyjson_mut_obj_add_int(doc, root, "exo_objects", m->exo_objects);
+  yyjson_mut_obj_add_uint(doc, root, "process_peak_memory", m->process_peak_memory);
+  yyjson_mut_obj_add_real(doc, root, "realtime_factor", m->realtime_factor);
+
+  struct yyjson_write_err jsonerr;
+  *json = yyjson_mut_write_opts(doc, 0, jsoncommon_get_json_alc(), json_len, &jsonerr);
+  if (!*json) {
+    err = emsg_i18nf(err_type_generic, err_fail, L"%1$hs", gettext("Unable to write JSON: %1$hs"), jsonerr.msg);
+    goto cleanup;
+  }
+cleanup:
+  if (doc) {
+    yyjson_mut_doc_free(doc);
+    doc = NULL;
+  }
+  return err;
+}
+
+NODISCARD error metrics_append_file(struct metrics const *const m, wchar_t const *const path) {
+  if (!m || !path) {
+    return errg(err_invalid_arugment);
+  }
+  char *json = NULL;
+  size_t json_len = 0;
+  HANDLE h = INVALID_HANDLE_VALUE;
+  error err = metrics_to_json(m, &json, &json_len);
+  if (efailed(err)) {
+    err = ethru(err);
+    goto cleanup;
+  }
+  err = mem(&json, json_len + 1, sizeof(char));
+  if (efailed(err)) {
+    err = ethru(err);
+    goto cleanup;
+  }
+  json[json_len++] = '\n';
+  // FILE_APPEND_DATA makes every write go to the end of the file, so a line is never interleaved with others.
+  h = CreateFileW(path, FILE_APPEND_DATA, FILE_SHARE_READ, NULL, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+  if (h == INVALID_HANDLE_VALUE) {
+    err = errhr(HRESULT_FROM_WIN32(GetLastError()));
+    goto cleanup;
+  }
+  DWORD written;
+  if (!WriteFile(h, json, (DWORD)json_len, &written, NULL)) {
+    err = errhr(HRESULT_FROM_WIN32(GetLastError()));
+    goto cleanup;
+  }
+  if (written != json_len) {
+    err = emsg_i18n(err_type_generic, err_fail, gettext("Unable to write the entire file."));
+    goto cleanup;
+  }
+cleanup:
+  if (h != INVALID_HANDLE_VALUE) {
+    CloseHandle(h);
+    h = INVALID_HANDLE_VALUE;
+  }
+  if (json) {
+    ereport(mem_free(&json));
+  }
+  return err;
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <ovbase.h>
+
+/**
+ * @brief Measurements of one stage of a run. Counters that do not apply to the stage are 0.
+ */
+struct metrics {
+  char const *stage;            /**< "raw2opus", "opus2json" or "json2exo". */
+  bool success;                 /**< false if the stage failed or was aborted. */
+  uint64_t run_started;         /**< Start of the run as FILETIME in UTC, shared by the stages of the same run. */
+  double wall_time;             /**< Elapsed time in seconds. */
+  double cpu_time;              /**< User and kernel time this process spent in the stage in seconds. */
+  double child_cpu_time;        /**< User and kernel time of the child process of the stage, Whisper for opus2json. */
+  uint64_t child_peak_memory;   /**< Peak working set of the child process of the stage in bytes. */
+  uint64_t bytes_in;            /**< Size of the input, the raw PCM for raw2opus. */
+  uint64_t bytes_out;           /**< Size of the output file. */
+  uint64_t samples;             /**< Audio samples per channel. */
+  int sample_rate;              /**< Sample rate of the audio. */
+  double audio_duration;        /**< Length of the audio in seconds. */
+  size_t segments;              /**< Segments of the transcript, after reflow for json2exo. */
+  size_t words;                 /**< Words of the transcript. */
+  int exo_objects;              /**< Objects written to the *.exo. */
+  uint64_t process_peak_memory; /**< Peak working set of this process since it started, not only in the stage. */
+  double realtime_factor;       /**< wall_time divided by audio_duration, lower is faster, 0 without the duration. */
+};
+
+/**
+ * @brief A starting point for measuring the wall and CPU time of a stage.
+ */
+struct metrics_clock {
+  int64_t counter;
+  uint64_t cpu;
+};
+
+/**
+ * @brief Records the current wall and CPU time.
+ */
+void metrics_clock_start(struct metrics_clock *const c);
+
+/**
+ * @brief Fills wall_time, cpu_time, process_peak_memory and realtime_factor since metrics_clock_start.
+ *
+ * audio_duration must be set before this call to compute realtime_factor.
+ * Windows keeps only the lifetime peak of the working set, so the peak of this process cannot be measured per stage.
+ */
+void metrics_clock_stop(struct metrics_clock const *const c, struct metrics *const m);
+
+/**
+ * @brief Returns the size of the file, or 0 if it does not exist.
+ */
+uint64_t metrics_get_file_size(wchar_t const *const path);
+
+/**
+ * @brief Serializes the metrics to a single-line JSON object without a line break.
+ *
+ * @param m The metrics.
+ * @param json A pointer to receive the JSON, free it with mem_free.
+ * @param json_len A pointer to receive the length of the JSON.
+ * @return An error code indicating success or failure.
+ */
+NODISCARD error metrics_to_json(struct metrics const *const m, char **const json, size_t *const json_len);
+
+/**
+ * @brief Appends the metrics to the file as one line of JSON Lines, creating the file if needed.
+ */
+NODISCARD error metrics_append_file(struct metrics const *const m, wchar_t const *const path);
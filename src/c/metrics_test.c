@@ -0,0 +1,133 @@
+#include <ovtest.h>
+
+#include <ovarray.h>
+
+#include <math.h>
+#include <string.h>
+
+#include "jsoncommon.h"
+#include "metrics.h"
+#include "path.h"
+
+static struct metrics const test_metrics = {
+    .stage = "opus2json",
+    .success = true,
+    .run_started = 116444736000000000ULL + 1234 * 10000, // 1970-01-01T00:00:01.234Z
+    .wall_time = 12.5,
+    .cpu_time = 0.25,
+    .child_cpu_time = 30.5,
+    .child_peak_memory = 2048ULL * 1024 * 1024,
+    .bytes_in = 1000,
+    .bytes_out = 5000000000ULL,
+    .samples = 480000,
+    .sample_rate = 48000,
+    .audio_duration = 10,
+    .segments = 3,
+    .words = 42,
+    .process_peak_memory = 64 * 1024 * 1024,
+    .realtime_factor = 1.25,
+};
+
+static void test_metrics_to_json(void) {
+  char *json = NULL;
+  size_t json_len = 0;
+  struct yyjson_doc *doc = NULL;
+  if (!TEST_SUCCEEDED_F(metrics_to_json(&test_metrics, &json, &json_len))) {
+    goto cleanup;
+  }
+  TEST_CHECK(strlen(json) == json_len);
+  TEST_CHECK(strchr(json, '\n') == NULL);
+  doc = yyjson_read(json, json_len, 0);
+  if (!TEST_CHECK(doc != NULL)) {
+    goto cleanup;
+  }
+  struct yyjson_val *const root = yyjson_doc_get_root(doc);
+  TEST_CHECK(strcmp(yyjson_get_str(yyjson_obj_get(root, "run")), "1970-01-01T00:00:01.234Z") == 0);
+  TEST_CHECK(strcmp(yyjson_get_str(yyjson_obj_get(root, "stage")), "opus2json") == 0);
+  TEST_CHECK(yyjson_get_bool(yyjson_obj_get(root, "success")));
+  TEST_CHECK(fabs(yyjson_get_real(yyjson_obj_get(root, "wall_time")) - 12.5) < 1e-9);
+  TEST_CHECK(fabs(yyjson_get_real(yyjson_obj_get(root, "cpu_time")) - 0.25) < 1e-9);
+  TEST_CHECK(fabs(yyjson_get_real(yyjson_obj_get(root, "child_cpu_time")) - 30.5) < 1e-9);
+  TEST_CHECK(yyjson_get_uint(yyjson_obj_get(root, "child_peak_memory")) == 2048ULL * 1024 * 1024);
+  TEST_CHECK(yyjson_get_uint(yyjson_obj_get(root, "bytes_in")) == 1000);
+  TEST_CHECK(yyjson_get_uint(yyjson_obj_get(root, "bytes_out")) == 5000000000ULL);
+  TEST_CHECK(yyjson_get_uint(yyjson_obj_get(root, "samples")) == 480000);
+  TEST_CHECK(yyjson_get_int(yyjson_obj_get(root, "sample_rate")) == 48000);
+  TEST_CHECK(yyjson_get_uint(yyjson_obj_get(root, "segments")) == 3);
+  TEST_CHECK(yyjson_get_uint(yyjson_obj_get(root, "words")) == 42);
+  TEST_CHECK(yyjson_get_int(yyjson_obj_get(root, "exo_objects")) == 0);
+  TEST_CHECK(yyjson_get_uint(yyjson_obj_get(root, "process_peak_memory")) == 64 * 1024 * 1024);
+  TEST_CHECK(fabs(yyjson_get_real(yyjson_obj_get(root, "realtime_factor")) - 1.25) < 1e-9);
+
+  TEST_EISG_F(metrics_to_json(&(struct metrics){0}, &(char *){NULL}, &json_len), err_invalid_arugment);
+cleanup:
+  if (doc) {
+    yyjson_doc_free(doc);
+  }
+  if (json) {
+    TEST_SUCCEEDED_F(mem_free(&json));
+  }
+}
+
+static void test_metrics_clock(void) {
+  struct metrics m = {.audio_duration = 2};
+  struct metrics_clock c;
+  metrics_clock_start(&c);
+  volatile unsigned int x = 0;
+  for (unsigned int i = 0; i < 1000000; ++i) {
+    x += i;
+  }
+  metrics_clock_stop(&c, &m);
+  TEST_CHECK(m.wall_time >= 0);
+  TEST_CHECK(m.cpu_time >= 0);
+  TEST_CHECK(m.process_peak_memory > 0);
+  TEST_CHECK(fabs(m.realtime_factor - m.wall_time / 2) < 1e-9);
+
+  m = (struct metrics){0};
+  metrics_clock_start(&c);
+  metrics_clock_stop(&c, &m);
+  TEST_CHECK(m.realtime_factor < 1e-9);
+}
+
+static void test_metrics_append_file(void) {
+  wchar_t *path = NULL;
+  char buf[2048];
+  HANDLE h = INVALID_HANDLE_VALUE;
+  if (!TEST_SUCCEEDED_F(path_get_temp_file(&path, L"metrics_test.jsonl"))) {
+    goto cleanup;
+  }
+  DeleteFileW(path);
+  TEST_CHECK(metrics_get_file_size(path) == 0);
+  TEST_SUCCEEDED_F(metrics_append_file(&test_metrics, path));
+  uint64_t const size = metrics_get_file_size(path);
+  TEST_CHECK(size > 0);
+  TEST_SUCCEEDED_F(metrics_append_file(&test_metrics, path));
+  TEST_CHECK(metrics_get_file_size(path) == size * 2);
+  h = CreateFileW(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+  if (!TEST_CHECK(h != INVALID_HANDLE_VALUE)) {
+    goto cleanup;
+  }
+  DWORD read = 0;
+  TEST_CHECK(ReadFile(h, buf, sizeof(buf), &read, NULL));
+  if (!TEST_CHECK(read == size * 2)) {
+    goto cleanup;
+  }
+  // Each line is one complete record.
+  TEST_CHECK(buf[size - 1] == '\n' && buf[read - 1] == '\n');
+  TEST_CHECK(memcmp(buf, buf + size, (size_t)size) == 0);
+cleanup:
+  if (h != INVALID_HANDLE_VALUE) {
+    CloseHandle(h);
+  }
+  if (path) {
+    DeleteFileW(path);
+    OV_ARRAY_DESTROY(&path);
+  }
+}
+
+TEST_LIST = {
+    {"test_metrics_to_json", test_metrics_to_json},
+    {"test_metrics_clock", test_metrics_clock},
+    {"test_metrics_append_file", test_metrics_append_file},
+    {NULL, NULL},
+};
@@ -0,0 +1,408 @@
+#include "modindex.h"
+
+#include <ovarray.h>
+
+#include "i18n.h"
+#include "jsoncommon.h"
+#include "strutil.h"
+
+enum {
+  modindex_version = 1,
+};
+
+struct entry {
+  wchar_t *module;
+  wchar_t *name;
+  wchar_t *description;
+  uint64_t mtime;
+  uint64_t size;
+};
+
+struct modindex {
+  wchar_t *language;
+  struct entry *entries;
+};
+
+static void entry_destroy(struct entry *const e) {
+  OV_ARRAY_DESTROY(&e->module);
+  OV_ARRAY_DESTROY(&e->name);
+  OV_ARRAY_DESTROY(&e->description);
+}
+
+static void clear(struct modindex *const mi) {
+  for (size_t i = 0, n = OV_ARRAY_LENGTH(mi->entries); i < n; ++i) {
+    entry_destroy(&mi->entries[i]);
+  }
+  if (mi->entries) {
+    OV_ARRAY_SET_LENGTH(mi->entries, 0);
+  }
+}
+
+static struct entry *find(struct modindex const *const mi, wchar_t const *const module) {
+  for (size_t i = 0, n = OV_ARRAY_LENGTH(mi->entries); i < n; ++i) {
+    if (wcscmp(mi->entries[i].module, module) == 0) {
+      return &mi->entries[i];
+    }
+  }
+  return NULL;
+}
+
+NODISCARD error modindex_create(struct modindex **const mipp, wchar_t const *const language) {
+  if (!mipp || *mipp || !language) {
+    return errg(err_invalid_arugment);
+  }
+  struct modindex *mi = NULL;
+  error err = mem(&mi, 1, sizeof(struct modindex));
+  if (efailed(err)) {
+    err = ethru(err);
+    goto cleanup;
+  }
+  *mi = (struct modindex){0};
+  err = strutil_copy(&mi->language, language);
+  if (efailed(err)) {
+    err = ethru(err);
+    goto cleanup;
+  }
+  *mipp = mi;
+  mi = NULL;
+cleanup:
+  if (mi) {
+    modindex_destroy(&mi);
+  }
+  return err;
+}
+
+void modindex_destroy(struct modindex **const mipp) {
+  if (!mipp || !*mipp) {
+    return;
+  }
+  struct modindex *mi = *mipp;
+  clear(mi);
+  OV_ARRAY_DESTROY(&mi->entries);
+  OV_ARRAY_DESTROY(&mi->language);
+  ereport(mem_free(mipp));
+}
+
+bool modindex_find(struct modindex const *const mi,
+                   wchar_t const *const module,
+                   uint64_t const mtime,
+                   uint64_t const size,
+                   wchar_t const **const name,
+                   wchar_t const **const description) {
+  if (!mi || !module) {
+    return false;
+  }
+  struct entry const *const e = find(mi, module);
+  if (!e || e->mtime != mtime || e->size != size) {
+    return false;
+  }
+  if (name) {
+    *name = e->name;
+  }
+  if (description) {
+    *description = e->description;
+  }
+  return true;
+}
+
+NODISCARD error modindex_add(struct modindex *const mi,
+                             wchar_t const *const module,
+                             uint64_t const mtime,
+                             uint64_t const size,
+                             wchar_t const *const name,
+                             wchar_t const *const description) {
+  if (!mi || !module || !name || !description) {
+    return errg(err_invalid_arugment);
+  }
+  struct entry e = {
+      .mtime = mtime,
+      .size = size,
+  };
+  error err = strutil_copy(&e.module, module);
+  if (efailed(err)) {
+    err = ethru(err);
+    goto cleanup;
+  }
+  err = strutil_copy(&e.name, name);
+  if (efailed(err)) {
+    err = ethru(err);
+    goto cleanup;
+  }
+  err = strutil_copy(&e.description, description);
+  if (efailed(err)) {
+    err = ethru(err);
+    goto cleanup;
+  }
+  struct entry *const found = find(mi, module);
+  if (found) {
+    entry_destroy(found);
+    *found = e;
+    e = (struct entry){0};
+    goto cleanup;
+  }
+  size_t const n = OV_ARRAY_LENGTH(mi->entries);
+  err = OV_ARRAY_GROW(&mi->entries, n + 1);
+  if (efailed(err)) {
+    err = ethru(err);
+    goto cleanup;
+  }
+  mi->entries[n] = e;
+  OV_ARRAY_SET_LENGTH(mi->entries, n + 1);
+  e = (struct entry){0};
+cleanup:
+  entry_destroy(&e);
+  return err;
+}
+
+NODISCARD error modindex_load(struct modindex *const mi, char const *const json, size_t const json_len) {
+  if (!mi || !json) {
+    return errg(err_invalid_arugment);
+  }
+  error err = eok();
+  wchar_t *lang = NULL;
+  wchar_t *module = NULL;
+  wchar_t *name = NULL;
+  wchar_t *description = NULL;
+  struct yyjson_doc *doc = NULL;
+
+  clear(mi);
+  struct yyjson_read_err read_err;
+  doc = yyjson_read_opts(ov_deconster_(json), json_len, 0, jsoncommon_get_json_alc(), &read_err);
+  if (!doc) {
+    err = emsg_i18nf(err_type_generic,
+                     err_fail,
+                     L"%1$hs%2$d",
+                     gettext("Unable to parse JSON: %1$hs (line: %2$d)"),
+                     read_err.msg,
+                     read_err.pos);
+    goto cleanup;
+  }
+  struct yyjson_val *const root = yyjson_doc_get_root(doc);
+  if (!root || !yyjson_is_obj(root)) {
+    err = emsg_i18n(err_type_generic, err_fail, gettext("The root of the JSON must be an object."));
+    goto cleanup;
+  }
+  struct yyjson_val *const version = yyjson_obj_get(root, "version");
+  if (!version || !yyjson_is_int(version) || yyjson_get_int(version) != modindex_version) {
+    goto cleanup;
+  }
+  struct yyjson_val *const language = yyjson_obj_get(root, "language");
+  if (!language || !yyjson_is_str(language)) {
+    goto cleanup;
+  }
+  err = strutil_utf8_to_wide(yyjson_get_str(language), &lang);
+  if (efailed(err)) {
+    err = ethru(err);
+    goto cleanup;
+  }
+  if (wcscmp(lang, mi->language) != 0) {
+    goto cleanup;
+  }
+  struct yyjson_val *const modules = yyjson_obj_get(root, "modules");
+  if (!modules || !yyjson_is_arr(modules)) {
+    goto cleanup;
+  }
+  size_t idx, max;
+  struct yyjson_val *v;
+  yyjson_arr_foreach(modules, idx, max, v) {
+    struct yyjson_val *const m = yyjson_obj_get(v, "module");
+    struct yyjson_val *const mt = yyjson_obj_get(v, "mtime");
+    struct yyjson_val *const sz = yyjson_obj_get(v, "size");
+    struct yyjson_val *const n = yyjson_obj_get(v, "name");
+    struct yyjson_val *const d = yyjson_obj_get(v, "description");
+    if (!yyjson_is_str(m) || !yyjson_is_uint(mt) || !yyjson_is_uint(sz) || !yyjson_is_str(n) || !yyjson_is_str(d)) {
+      continue;
+    }
+    err = strutil_utf8_to_wide(yyjson_get_str(m), &module);
+    if (efailed(err)) {
+      err = ethru(err);
+      goto cleanup;
+    }
+    err = strutil_utf8_to_wide(yyjson_get_str(n), &name);
+    if (efailed(err)) {
+      err = ethru(err);
+      goto cleanup;
+    }
+    err = strutil_utf8_to_wide(yyjson_get_str(d), &description);
+    if (efailed(err)) {
+      err = ethru(err);
+      goto cleanup;
+    }
+    err = modindex_add(mi, module, yyjson_get_uint(mt), yyjson_get_uint(sz), name, description);
+    if (efailed(err)) {
+      err = ethru(err);
+      goto cleanup;
+    }
+  }
+cleanup:
+  OV_ARRAY_DESTROY(&lang);
+  OV_ARRAY_DESTROY(&module);
+  OV_ARRAY_DESTROY(&name);
+  OV_ARRAY_DESTROY(&description);
+  if (doc) {
+    yyjson_doc_free(doc);
+    doc = NULL;
+  }
+  if (efailed(err)) {
+    clear(mi);
+  }
+  return err;
+}
+
+NODISCARD error modindex_load_file(struct modindex *const mi, wchar_t const *const path) {
+  if (!mi || !path) {
+    return errg(err_invalid_arugment);
+  }
+  error err = eok();
+  HANDLE h = INVALID_HANDLE_VALUE;
+  char *json = NULL;
+  h = CreateFileW(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+  if (h == INVALID_HANDLE_VALUE) {
+    err = errhr(HRESULT_FROM_WIN32(GetLastError()));
+    goto cleanup;
+  }
+  LARGE_INTEGER size;
+  if (!GetFileSizeEx(h, &size)) {
+    err = errhr(HRESULT_FROM_WIN32(GetLastError()));
+    goto cleanup;
+  }
+  if (size.QuadPart > INT_MAX) {
+    err = emsg_i18n(err_type_generic, err_fail, gettext("The file is too large."));
+    goto cleanup;
+  }
+  DWORD read;
+  err = mem(&json, (size_t)size.QuadPart + 1, sizeof(char));
+  if (efailed(err)) {
+    err = ethru(err);
+    goto cleanup;
+  }
+  if (!ReadFile(h, json, (DWORD)size.QuadPart, &read, NULL)) {
+    err = errhr(HRESULT_FROM_WIN32(GetLastError()));
+    goto cleanup;
+  }
+  if (read != (DWORD)size.QuadPart) {
+    err = emsg_i18n(err_type_generic, err_fail, gettext("Unable to read the entire file."));
+    goto cleanup;
+  }
+  json[read] = '\0';
+  err = modindex_load(mi, json, (size_t)read);
+  if (efailed(err)) {
+    err = ethru(err);
+    goto cleanup;
+  }
+cleanup:
+  if (h != INVALID_HANDLE_VALUE) {
+    CloseHandle(h);
+    h = INVALID_HANDLE_VALUE;
+  }
+  if (json) {
+    ereport(mem_free(&json));
+  }
+  return err;
+}
+
+NODISCARD error modindex_save(struct modindex const *const mi, char **const json, size_t *const json_len) {
+  if (!mi || !json || *json) {
+    return errg(err_invalid_arugment);
+  }
+  error err = eok();
+  char *s = NULL;
+  struct yyjson_mut_doc *doc = NULL;
+  doc = yyjson_mut_doc_new(jsoncommon_get_json_alc());
+  if (!doc) {
+    err = errg(err_out_of_memory);
+    goto cleanup;
+  }
+  struct yyjson_mut_val *const root = yyjson_mut_obj(doc);
+  struct yyjson_mut_val *const modules = yyjson_mut_arr(doc);
+  if (!root || !modules) {
+    err = errg(err_out_of_memory);
+    goto cleanup;
+  }
+  yyjson_mut_doc_set_root(doc, root);
+  yyjson_mut_obj_add_int(doc, root, "version", modindex_version);
+  err = strutil_wide_to_utf8(mi->language, &s);
+  if (efailed(err)) {
+    err = ethru(err);
+    goto cleanup;
+  }
+  yyjson_mut_obj_add_strcpy(doc, root, "language", s);
+  yyjson_mut_obj_add_val(doc, root, "modules", modules);
+
+#define ADD_STRING_PROPERTY(NAME)                                                                                      \
+  err = strutil_wide_to_utf8(e->NAME, &s);                                                                             \
+  if (efailed(err)) {                                                                                                  \
+    err = ethru(err);                                                                                                  \
+    goto cleanup;                                                                                                      \
+  }                                                                                                                    \
+  yyjson_mut_obj_add_strcpy(doc, v, #NAME, s);
+  for (size_t i = 0, n = OV_ARRAY_LENGTH(mi->entries); i < n; ++i) {
+    struct entry const *const e = &mi->entries[i];
+    struct yyjson_mut_val *const v = yyjson_mut_arr_add_obj(doc, modules);
+    if (!v) {
+      err = errg(err_out_of_memory);
+      goto cleanup;
+    }
+    ADD_STRING_PROPERTY(module)
+    yyjson_mut_obj_add_uint(doc, v, "mtime", e->mtime);
+    yyjson_mut_obj_add_uint(doc, v, "size", e->size);
+    ADD_STRING_PROPERTY(name)
+    ADD_STRING_PROPERTY(description)
+  }
+#undef ADD_STRING_PROPERTY
+
+  struct yyjson_write_err jsonerr;
+  *json = yyjson_mut_write_opts(doc, 0, jsoncommon_get_json_alc(), json_len, &jsonerr);
+  if (!*json) {
+    err = emsg_i18nf(err_type_generic, err_fail, L"%1$hs", gettext("Unable to write JSON: %1$hs"), jsonerr.msg);
+    goto cleanup;
+  }
+cleanup:
+  OV_ARRAY_DESTROY(&s);
+  if (doc) {
+    yyjson_mut_doc_free(doc);
+    doc = NULL;
+  }
+  return err;
+}
+
+NODISCARD error modindex_save_file(struct modindex const *const mi, wchar_t const *const path) {
+  if (!mi || !path) {
+    return errg(err_invalid_arugment);
+  }
+  size_t jsonlen = 0;
+  char *json = NULL;
+  HANDLE h = INVALID_HANDLE_VALUE;
+
+  error err = modindex_save(mi, &json, &jsonlen);
+  if (efailed(err)) {
+    err = ethru(err);
+    goto cleanup;
+  }
+  h = CreateFileW(path, GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+  if (h == INVALID_HANDLE_VALUE) {
+    err = errhr(HRESULT_FROM_WIN32(GetLastError()));
+    goto cleanup;
+  }
+  DWORD written;
+  if (!WriteFile(h, json, (DWORD)jsonlen, &written, NULL)) {
+    err = errhr(HRESULT_FROM_WIN32(GetLastError()));
+    goto cleanup;
+  }
+  if (written != jsonlen) {
+    err = emsg_i18n(err_type_generic, err_fail, gettext("Unable to write the entire file."));
+    goto cleanup;
+  }
+cleanup:
+  if (h != INVALID_HANDLE_VALUE) {
+    CloseHandle(h);
+    h = INVALID_HANDLE_VALUE;
+    if (efailed(err)) {
+      DeleteFileW(path);
+    }
+  }
+  if (json) {
+    ereport(mem_free(&json));
+  }
+  return err;
+}
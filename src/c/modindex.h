@@ -0,0 +1,59 @@
+#pragma once
+
+#include <ovbase.h>
+
+struct modindex;
+
+/**
+ * @brief Creates an empty module index.
+ *
+ * The module index remembers the name and description of Lua modules so that
+ * they do not have to be loaded again unless the module file is changed.
+ * Since the name and description are localized, the index is tied to the UI language.
+ *
+ * @param mipp A pointer to receive the index.
+ * @param language The UI language the entries are written in.
+ * @return An error code indicating success or failure.
+ */
+NODISCARD error modindex_create(struct modindex **const mipp, wchar_t const *const language);
+void modindex_destroy(struct modindex **const mipp);
+
+/**
+ * @brief Loads the entries from JSON.
+ *
+ * If the index was written for another UI language, no entries are loaded.
+ */
+NODISCARD error modindex_load(struct modindex *const mi, char const *const json, size_t const json_len);
+NODISCARD error modindex_load_file(struct modindex *const mi, wchar_t const *const path);
+NODISCARD error modindex_save(struct modindex const *const mi, char **const json, size_t *const json_len);
+NODISCARD error modindex_save_file(struct modindex const *const mi, wchar_t const *const path);
+
+/**
+ * @brief Finds the entry for the module.
+ *
+ * @param mi The index.
+ * @param module The name used to require the module in Lua.
+ * @param mtime The last write time of the module file.
+ * @param size The size of the module file.
+ * @param name Receives the name of the module. Valid until the index is modified.
+ * @param description Receives the description of the module. Valid until the index is modified.
+ * @return true if the entry is found and the module file has not been changed.
+ */
+bool modindex_find(struct modindex const *const mi,
+                   wchar_t const *const module,
+                   uint64_t const mtime,
+                   uint64_t const size,
+                   wchar_t const **const name,
+                   wchar_t const **const description);
+
+/**
+ * @brief Adds the entry for the module.
+ *
+ * The existing entry for the same module is replaced.
+ */
+NODISCARD error modindex_add(struct modindex *const mi,
+                             wchar_t const *const module,
+                             uint64_t const mtime,
+                             uint64_t const size,
+                             wchar_t const *const name,
+                             wchar_t const *const description);
@@ -0,0 +1,90 @@
+#include <ovtest.h>
+
+#include "modindex.h"
+
+static void test_modindex_find(void) {
+  struct modindex *mi = NULL;
+  if (!TEST_SUCCEEDED_F(modindex_create(&mi, L"ja_JP;en_US"))) {
+    return;
+  }
+  TEST_CHECK(!modindex_find(mi, L"text", 1, 2, NULL, NULL));
+  TEST_SUCCEEDED_F(modindex_add(mi, L"text", 1, 2, L"Text", L"Description"));
+  wchar_t const *name = NULL;
+  wchar_t const *description = NULL;
+  TEST_CHECK(modindex_find(mi, L"text", 1, 2, &name, &description));
+  TEST_CHECK(name && wcscmp(name, L"Text") == 0);
+  TEST_CHECK(description && wcscmp(description, L"Description") == 0);
+  TEST_CHECK(!modindex_find(mi, L"text", 3, 2, NULL, NULL));
+  TEST_CHECK(!modindex_find(mi, L"text", 1, 3, NULL, NULL));
+  TEST_CHECK(!modindex_find(mi, L"text_highlight", 1, 2, NULL, NULL));
+
+  TEST_SUCCEEDED_F(modindex_add(mi, L"text", 3, 4, L"Text2", L"Description2"));
+  TEST_CHECK(!modindex_find(mi, L"text", 1, 2, NULL, NULL));
+  TEST_CHECK(modindex_find(mi, L"text", 3, 4, &name, &description));
+  TEST_CHECK(name && wcscmp(name, L"Text2") == 0);
+  TEST_CHECK(description && wcscmp(description, L"Description2") == 0);
+
+  TEST_EISG_F(modindex_add(mi, NULL, 0, 0, L"", L""), err_invalid_arugment);
+  modindex_destroy(&mi);
+  TEST_CHECK(mi == NULL);
+}
+
+static void test_modindex_save_load(void) {
+  struct modindex *mi = NULL;
+  struct modindex *mi2 = NULL;
+  struct modindex *mi3 = NULL;
+  char *json = NULL;
+  size_t json_len = 0;
+  if (!TEST_SUCCEEDED_F(modindex_create(&mi, L"ja_JP;en_US"))) {
+    goto cleanup;
+  }
+  if (!TEST_SUCCEEDED_F(modindex_add(mi, L"text", 0x123456789abcdefULL, 42, L"テキスト", L"説明 \"quoted\""))) {
+    goto cleanup;
+  }
+  if (!TEST_SUCCEEDED_F(modindex_add(mi, L"psdtoolkit", 1, 0, L"PSDToolKit", L""))) {
+    goto cleanup;
+  }
+  if (!TEST_SUCCEEDED_F(modindex_save(mi, &json, &json_len))) {
+    goto cleanup;
+  }
+
+  if (!TEST_SUCCEEDED_F(modindex_create(&mi2, L"ja_JP;en_US"))) {
+    goto cleanup;
+  }
+  if (TEST_SUCCEEDED_F(modindex_load(mi2, json, json_len))) {
+    wchar_t const *name = NULL;
+    wchar_t const *description = NULL;
+    TEST_CHECK(modindex_find(mi2, L"text", 0x123456789abcdefULL, 42, &name, &description));
+    TEST_CHECK(name && wcscmp(name, L"テキスト") == 0);
+    TEST_CHECK(description && wcscmp(description, L"説明 \"quoted\"") == 0);
+    TEST_CHECK(modindex_find(mi2, L"psdtoolkit", 1, 0, &name, &description));
+    TEST_CHECK(name && wcscmp(name, L"PSDToolKit") == 0);
+    TEST_CHECK(description && wcscmp(description, L"") == 0);
+  }
+
+  // Entries written for another UI language must not be used.
+  if (!TEST_SUCCEEDED_F(modindex_create(&mi3, L"en_US"))) {
+    goto cleanup;
+  }
+  if (TEST_SUCCEEDED_F(modindex_load(mi3, json, json_len))) {
+    TEST_CHECK(!modindex_find(mi3, L"text", 0x123456789abcdefULL, 42, NULL, NULL));
+  }
+
+  static char const broken[] = "{\"version\":1,";
+  TEST_EISG_F(modindex_load(mi2, broken, sizeof(broken) - 1), err_fail);
+  TEST_CHECK(!modindex_find(mi2, L"psdtoolkit", 1, 0, NULL, NULL));
+
+cleanup:
+  if (json) {
+    ereport(mem_free(&json));
+  }
+  modindex_destroy(&mi3);
+  modindex_destroy(&mi2);
+  modindex_destroy(&mi);
+}
+
+TEST_LIST = {
+    {"test_modindex_find", test_modindex_find},
+    {"test_modindex_save_load", test_modindex_save_load},
+    {NULL, NULL},
+};
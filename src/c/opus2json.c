@@ -4,7 +4,6 @@
 #include <ovnum.h>
 #include <ovprintf.h>
 #include <ovthreads.h>
-#include <ovutf.h>
 #include <ovutil/win32.h>
 
 #ifdef __GNUC__
@@ -22,8 +21,10 @@
 #endif // __GNUC__
 
 #include "i18n.h"
+#include "linebuffer.h"
 #include "path.h"
 #include "process.h"
+#include "utf8conv.h"
 
 enum send_state {
   send_state_ready,
@@ -38,8 +39,8 @@ enum processed_state {
 };
 
 struct opus2json_context {
-  struct process_line_buffer_context out_buffer;
-  struct process_line_buffer_context err_buffer;
+  struct linebuffer out_buffer;
+  struct linebuffer err_buffer;
   struct opus2json_params params;
   mtx_t mtx;
   mtx_t mtx2;
@@ -272,7 +273,7 @@ static void lock_log(char const *const msg, int const line, char const *const fu
     } while (0)
 #endif
 
-static void process_line(void *const userdata, char const *const message) {
+static void process_line(void *const userdata, char const *const message, size_t const msglen) {
   struct opus2json_context *const ctx = userdata;
   if (ctx->params.on_progress) {
     char const *arrow = strstr(message, " --> ");
@@ -322,22 +323,12 @@ static void process_line(void *const userdata, char const *const message) {
   }
 
   if (ctx->params.on_log_line) {
-    size_t const msglen = strlen(message);
-    UINT const cp = msglen && ov_utf8_to_wchar_len(message, msglen) == 0 ? CP_ACP : CP_UTF8;
-    int len = MultiByteToWideChar(cp, 0, message, -1, NULL, 0);
-    if (len == 0) {
-      ereport(errhr(HRESULT_FROM_WIN32(GetLastError())));
-      return;
-    }
-    error err = OV_ARRAY_GROW(&ctx->buffer, len);
+    // Whisper writes UTF-8 in most cases, but the messages from Python itself may be in the ANSI code page.
+    error err = utf8conv_to_wchar(message, msglen, &ctx->buffer, NULL);
     if (efailed(err)) {
       ereport(err);
       return;
     }
-    if (MultiByteToWideChar(cp, 0, message, -1, ctx->buffer, len) == 0) {
-      ereport(errhr(HRESULT_FROM_WIN32(GetLastError())));
-      return;
-    }
     mtx_lock(&ctx->mtx3);
     mtx_lock(&ctx->mtx);
     ctx->send_state = send_state_on_log_line;
@@ -355,12 +346,12 @@ static void process_line(void *const userdata, char const *const message) {
 
 static void process_on_receive_stdout(void *userdata, void const *const ptr, size_t const len) {
   struct opus2json_context *const ctx = userdata;
-  process_line_buffer(&ctx->out_buffer, ptr, len);
+  ereport(linebuffer_write(&ctx->out_buffer, ptr, len));
 }
 
 static void process_on_receive_stderr(void *userdata, void const *const ptr, size_t const len) {
   struct opus2json_context *const ctx = userdata;
-  process_line_buffer(&ctx->err_buffer, ptr, len);
+  ereport(linebuffer_write(&ctx->err_buffer, ptr, len));
 }
 
 static void process_on_close(void *userdata, error err) {
@@ -449,6 +440,10 @@ NODISCARD error opus2json(struct opus2json_params const *const params) {
     params->on_log_line(params->userdata, buf);
   }
 
+  ctx.out_buffer.userdata = &ctx;
+  ctx.out_buffer.on_line = process_line;
+  ctx.err_buffer.userdata = &ctx;
+  ctx.err_buffer.on_line = process_line;
   err = process_create(&pr,
                        &(struct process_options){
                            .cmdline = buf,
@@ -463,10 +458,6 @@ NODISCARD error opus2json(struct opus2json_params const *const params) {
     goto cleanup;
   }
 
-  ctx.out_buffer.userdata = &ctx;
-  ctx.out_buffer.on_line = process_line;
-  ctx.err_buffer.userdata = &ctx;
-  ctx.err_buffer.on_line = process_line;
   ctx.samples = samples;
   ctx.sample_rate = 48000;
   ctx.channels = channels;
@@ -530,6 +521,19 @@ cleanup:
     err = emsg_i18nf(err_type_generic, err_not_found, L"%1$ls", gettext("The file \"%1$ls\" is not found."), json_path);
   }
   if (pr) {
+    if (params->usage) {
+      double kernel = 0, user = 0;
+      error e = process_get_times(pr, &kernel, &user);
+      if (efailed(e)) {
+        efree(&e);
+      } else {
+        params->usage->cpu_time = kernel + user;
+      }
+      e = process_get_memory(pr, &params->usage->peak_memory);
+      if (efailed(e)) {
+        efree(&e);
+      }
+    }
     process_destroy(&pr);
   }
   if (temp_path) {
@@ -544,6 +548,8 @@ cleanup:
   if (ctx.buffer) {
     OV_ARRAY_DESTROY(&ctx.buffer);
   }
+  linebuffer_destroy(&ctx.err_buffer);
+  linebuffer_destroy(&ctx.out_buffer);
   cnd_destroy(&ctx.cnd2);
   cnd_destroy(&ctx.cnd);
   mtx_destroy(&ctx.mtx3);
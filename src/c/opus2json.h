@@ -2,6 +2,14 @@
 
 #include <ovbase.h>
 
+/**
+ * @brief Resources used by Whisper, which are not counted in the measurements of this process.
+ */
+struct opus2json_usage {
+  double cpu_time;      /**< User and kernel time of Whisper in seconds. */
+  uint64_t peak_memory; /**< Peak working set of Whisper in bytes. */
+};
+
 /**
  * @brief Parameters for the opus2json conversion function.
  */
@@ -9,6 +17,7 @@ struct opus2json_params {
   wchar_t const *opus_path;       /**< Path to the input *.opus file. */
   wchar_t const *whisper_path;    /**< Path to the Whisper model file. */
   wchar_t const *additional_args; /**< Additional arguments for the conversion process. */
+  struct opus2json_usage *usage;  /**< Receives the resources used by Whisper, can be NULL. */
   void *userdata;                 /**< User-defined data passed to the callbacks. */
   /**
    * @brief Callback function to report progress.
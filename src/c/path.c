@@ -102,17 +102,19 @@ wchar_t const *path_extract_file_name_const(wchar_t const *const path) {
   return path_extract_file_name_mut(ov_deconster_(path));
 }
 
-NODISCARD error path_select_file(HWND const window,
-                                 wchar_t const *const title,
-                                 wchar_t const *const filter,
-                                 GUID const *const client_id,
-                                 wchar_t **const path) {
+static NODISCARD error select_file(CLSID const *const clsid,
+                                   HWND const window,
+                                   wchar_t const *const title,
+                                   wchar_t const *const filter,
+                                   wchar_t const *const default_ext,
+                                   GUID const *const client_id,
+                                   wchar_t **const path) {
   error err = eok();
   IFileDialog *pfd = NULL;
   COMDLG_FILTERSPEC *fs = NULL;
   IShellItem *psiResult = NULL;
   PWSTR pszPath = NULL;
-  HRESULT hr = CoCreateInstance(&CLSID_FileOpenDialog, NULL, CLSCTX_INPROC_SERVER, &IID_IFileDialog, (void **)&pfd);
+  HRESULT hr = CoCreateInstance(clsid, NULL, CLSCTX_INPROC_SERVER, &IID_IFileDialog, (void **)&pfd);
   if (FAILED(hr)) {
     err = errhr(hr);
     goto cleanup;
@@ -146,6 +148,13 @@ NODISCARD error path_select_file(HWND const window,
     err = errhr(hr);
     goto cleanup;
   }
+  if (default_ext) {
+    hr = pfd->lpVtbl->SetDefaultExtension(pfd, default_ext);
+    if (FAILED(hr)) {
+      err = errhr(hr);
+      goto cleanup;
+    }
+  }
   hr = pfd->lpVtbl->SetClientGuid(pfd, client_id);
   if (FAILED(hr)) {
     err = errhr(hr);
@@ -191,6 +200,23 @@ cleanup:
   return err;
 }
 
+NODISCARD error path_select_file(HWND const window,
+                                 wchar_t const *const title,
+                                 wchar_t const *const filter,
+                                 GUID const *const client_id,
+                                 wchar_t **const path) {
+  return select_file(&CLSID_FileOpenDialog, window, title, filter, NULL, client_id, path);
+}
+
+NODISCARD error path_select_save_file(HWND const window,
+                                      wchar_t const *const title,
+                                      wchar_t const *const filter,
+                                      wchar_t const *const default_ext,
+                                      GUID const *const client_id,
+                                      wchar_t **const path) {
+  return select_file(&CLSID_FileSaveDialog, window, title, filter, default_ext, client_id, path);
+}
+
 NODISCARD error path_select_folder(HWND const window,
                                    wchar_t const *const title,
                                    GUID const *const client_id,
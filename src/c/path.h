@@ -16,6 +16,12 @@ NODISCARD error path_select_file(HWND const window,
                                  wchar_t const *const filter,
                                  GUID const *const client_id,
                                  wchar_t **const path);
+NODISCARD error path_select_save_file(HWND const window,
+                                      wchar_t const *const title,
+                                      wchar_t const *const filter,
+                                      wchar_t const *const default_ext,
+                                      GUID const *const client_id,
+                                      wchar_t **const path);
 NODISCARD error path_select_folder(HWND const window,
                                    wchar_t const *const title,
                                    GUID const *const client_id,
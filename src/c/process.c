@@ -1,19 +1,42 @@
 #include "process.h"
 
+#include <stdatomic.h>
+
 #include <ovarray.h>
 #include <ovprintf.h>
 #include <ovthreads.h>
 
+#include <psapi.h>
+
 #include "i18n.h"
 
+enum {
+  default_buffer_size = 65536,
+  // How long to wait for more output after the process has exited before giving up the pipes.
+  // The write ends can be kept open by the processes that the child has started.
+  exit_grace_ms = 1000,
+};
+
+struct reader {
+  HANDLE *h;
+  OVERLAPPED ol;
+  uint8_t *buf;
+  bool active;
+  void (*receive)(void *userdata, void const *const ptr, size_t const len);
+  void (*close)(void *userdata, error err);
+};
+
 struct process {
   HANDLE process;
   HANDLE in_w;
   HANDLE out_r;
   HANDLE err_r;
 
-  thrd_t thread_stdout;
-  thrd_t thread_stderr;
+  thrd_t thread;
+  bool thread_started;
+  size_t buffer_size;
+  uint8_t *buffer;
+  struct reader readers[2];
 
   void *userdata;
   void (*on_receive_stdout)(void *userdata, void const *const ptr, size_t const len);
@@ -127,37 +150,45 @@ cleanup:
   return err;
 }
 
-static void read_worker(HANDLE h,
-                        void (*receive)(void *userdata, void const *const ptr, size_t const len),
-                        void (*close)(void *userdata, error err),
-                        void *userdata) {
-  enum {
-    buffer_size = 1024,
-  };
-  uint8_t buf[buffer_size];
-  DWORD len;
-  error err = eok();
-  while (1) {
-    if (!ReadFile(h, buf, buffer_size, &len, NULL)) {
-      HRESULT hr = HRESULT_FROM_WIN32(GetLastError());
-      if (hr == HRESULT_FROM_WIN32(ERROR_BROKEN_PIPE)) {
-        break;
-      }
-      err = errhr(hr);
-      goto cleanup;
-    }
-    if (len > 0) {
-      receive(userdata, buf, (size_t)len);
-    }
-  }
-cleanup:
-  if (close) {
-    close(userdata, err);
+static void reader_finish(struct process *const pr, struct reader *const r, error err) {
+  r->active = false;
+  if (r->close) {
+    r->close(pr->userdata, err);
   } else {
     ereport(err);
   }
 }
 
+/**
+ * Issues the next read. The event of the reader is signaled when it completes, even if ReadFile completed it
+ * synchronously, so the result is always taken by reader_complete.
+ */
+static void reader_start(struct process *const pr, struct reader *const r) {
+  if (ReadFile(*r->h, r->buf, (DWORD)pr->buffer_size, NULL, &r->ol)) {
+    return;
+  }
+  DWORD const code = GetLastError();
+  if (code == ERROR_IO_PENDING) {
+    return;
+  }
+  reader_finish(pr, r, code == ERROR_BROKEN_PIPE ? eok() : errhr(HRESULT_FROM_WIN32(code)));
+}
+
+static void reader_complete(struct process *const pr, struct reader *const r) {
+  DWORD len = 0;
+  if (!GetOverlappedResult(*r->h, &r->ol, &len, FALSE)) {
+    DWORD const code = GetLastError();
+    // ERROR_OPERATION_ABORTED means that the read was cancelled after the process has exited.
+    bool const closed = code == ERROR_BROKEN_PIPE || code == ERROR_OPERATION_ABORTED;
+    reader_finish(pr, r, closed ? eok() : errhr(HRESULT_FROM_WIN32(code)));
+    return;
+  }
+  if (len > 0) {
+    r->receive(pr->userdata, r->buf, (size_t)len);
+  }
+  reader_start(pr, r);
+}
+
 #if 0
 static void log_thread_id(wchar_t const *const msg) {
   wchar_t buf[128];
@@ -168,18 +199,111 @@ static void log_thread_id(wchar_t const *const msg) {
 #  define log_thread_id(msg) ((void)0)
 #endif
 
-static int read_stdout_worker(void *userdata) {
+/**
+ * Reads stdout and stderr with overlapped I/O and watches the process handle, all on one thread.
+ */
+static int read_worker(void *userdata) {
   struct process *const pr = userdata;
-  log_thread_id(L"read_stdout_worker");
-  read_worker(pr->out_r, pr->on_receive_stdout, pr->on_close_stdout, pr->userdata);
+  size_t const num_readers = sizeof(pr->readers) / sizeof(pr->readers[0]);
+  // The handle is set before this thread starts and is closed only after it is joined.
+  HANDLE const process = pr->process;
+  log_thread_id(L"read_worker");
+  for (size_t i = 0; i < num_readers; ++i) {
+    if (pr->readers[i].active) {
+      reader_start(pr, &pr->readers[i]);
+    }
+  }
+  bool exited = false;
+  for (;;) {
+    HANDLE handles[sizeof(pr->readers) / sizeof(pr->readers[0]) + 1];
+    DWORD n = 0;
+    for (size_t i = 0; i < num_readers; ++i) {
+      if (pr->readers[i].active) {
+        handles[n++] = pr->readers[i].ol.hEvent;
+      }
+    }
+    if (!n) {
+      break;
+    }
+    DWORD const num_events = n;
+    if (!exited) {
+      handles[n++] = process;
+    }
+    DWORD const r = WaitForMultipleObjects(n, handles, FALSE, exited ? exit_grace_ms : INFINITE);
+    if (r == WAIT_FAILED) {
+      HRESULT const hr = HRESULT_FROM_WIN32(GetLastError());
+      for (size_t i = 0; i < num_readers; ++i) {
+        struct reader *const rd = &pr->readers[i];
+        if (rd->active) {
+          DWORD len;
+          CancelIo(*rd->h);
+          GetOverlappedResult(*rd->h, &rd->ol, &len, TRUE);
+          reader_finish(pr, rd, errhr(hr));
+        }
+      }
+      break;
+    }
+    if (r == WAIT_TIMEOUT) {
+      // The pending reads complete with ERROR_OPERATION_ABORTED and close the readers.
+      for (size_t i = 0; i < num_readers; ++i) {
+        if (pr->readers[i].active) {
+          CancelIo(*pr->readers[i].h);
+        }
+      }
+      continue;
+    }
+    if (r == WAIT_OBJECT_0 + num_events) {
+      exited = true;
+      continue;
+    }
+    // Serve every ready stream so that a busy stream does not starve the other one.
+    for (size_t i = 0; i < num_readers; ++i) {
+      struct reader *const rd = &pr->readers[i];
+      if (rd->active && WaitForSingleObject(rd->ol.hEvent, 0) == WAIT_OBJECT_0) {
+        reader_complete(pr, rd);
+      }
+    }
+  }
   return 0;
 }
 
-static int read_stderr_worker(void *userdata) {
-  struct process *const pr = userdata;
-  log_thread_id(L"read_stderr_worker");
-  read_worker(pr->err_r, pr->on_receive_stderr, pr->on_close_stderr, pr->userdata);
-  return 0;
+/**
+ * Creates a pipe whose read end supports overlapped I/O, which anonymous pipes do not.
+ * Only the write end is inheritable.
+ */
+static NODISCARD error create_pipe(HANDLE *const r, HANDLE *const w, DWORD const buffer_size) {
+  static atomic_uint counter;
+  DWORD const pid = GetCurrentProcessId();
+  unsigned int const id = atomic_fetch_add(&counter, 1);
+  wchar_t name[64];
+  ov_snprintf_wchar(
+      name, sizeof(name) / sizeof(name[0]), NULL, L"\\\\.\\pipe\\aviutl_subtitler.%u.%u", (unsigned int)pid, id);
+  HANDLE const hr = CreateNamedPipeW(name,
+                                     PIPE_ACCESS_INBOUND | FILE_FLAG_OVERLAPPED | FILE_FLAG_FIRST_PIPE_INSTANCE,
+                                     PIPE_TYPE_BYTE | PIPE_READMODE_BYTE | PIPE_WAIT | PIPE_REJECT_REMOTE_CLIENTS,
+                                     1,
+                                     buffer_size,
+                                     buffer_size,
+                                     0,
+                                     NULL);
+  if (hr == INVALID_HANDLE_VALUE) {
+    return errhr(HRESULT_FROM_WIN32(GetLastError()));
+  }
+  HANDLE const hw = CreateFileW(name,
+                                GENERIC_WRITE,
+                                0,
+                                &(SECURITY_ATTRIBUTES){sizeof(SECURITY_ATTRIBUTES), 0, TRUE},
+                                OPEN_EXISTING,
+                                FILE_ATTRIBUTE_NORMAL,
+                                NULL);
+  if (hw == INVALID_HANDLE_VALUE) {
+    error err = errhr(HRESULT_FROM_WIN32(GetLastError()));
+    CloseHandle(hr);
+    return err;
+  }
+  *r = hr;
+  *w = hw;
+  return eok();
 }
 
 NODISCARD error process_write(struct process *const pr, void const *const buf, size_t const len) {
@@ -214,29 +338,34 @@ NODISCARD error process_create(struct process **prp, struct process_options cons
 
   HANDLE out_r = INVALID_HANDLE_VALUE;
   HANDLE out_w = INVALID_HANDLE_VALUE;
-  HANDLE out_r_tmp = INVALID_HANDLE_VALUE;
 
   HANDLE err_r = INVALID_HANDLE_VALUE;
   HANDLE err_w = INVALID_HANDLE_VALUE;
-  HANDLE err_r_tmp = INVALID_HANDLE_VALUE;
 
   wchar_t *env = NULL;
   wchar_t *cmdline = NULL;
   wchar_t *dir = NULL;
 
+  size_t const buffer_size = options->buffer_size ? options->buffer_size : default_buffer_size;
   PROCESS_INFORMATION pi = {INVALID_HANDLE_VALUE, INVALID_HANDLE_VALUE, 0, 0};
   SECURITY_ATTRIBUTES sa = {sizeof(SECURITY_ATTRIBUTES), 0, TRUE};
 
+  if (buffer_size > MAXDWORD) {
+    err = errg(err_invalid_arugment);
+    goto cleanup;
+  }
   if (!CreatePipe(&in_r, &in_w_tmp, &sa, 0)) {
     err = errhr(HRESULT_FROM_WIN32(GetLastError()));
     goto cleanup;
   }
-  if (!CreatePipe(&out_r_tmp, &out_w, &sa, 0)) {
-    err = errhr(HRESULT_FROM_WIN32(GetLastError()));
+  err = create_pipe(&out_r, &out_w, (DWORD)buffer_size);
+  if (efailed(err)) {
+    err = ethru(err);
     goto cleanup;
   }
-  if (!CreatePipe(&err_r_tmp, &err_w, &sa, 0)) {
-    err = errhr(HRESULT_FROM_WIN32(GetLastError()));
+  err = create_pipe(&err_r, &err_w, (DWORD)buffer_size);
+  if (efailed(err)) {
+    err = ethru(err);
     goto cleanup;
   }
 
@@ -245,21 +374,9 @@ NODISCARD error process_create(struct process **prp, struct process_options cons
     err = errhr(HRESULT_FROM_WIN32(GetLastError()));
     goto cleanup;
   }
-  if (!DuplicateHandle(curproc, out_r_tmp, curproc, &out_r, 0, FALSE, DUPLICATE_SAME_ACCESS)) {
-    err = errhr(HRESULT_FROM_WIN32(GetLastError()));
-    goto cleanup;
-  }
-  if (!DuplicateHandle(curproc, err_r_tmp, curproc, &err_r, 0, FALSE, DUPLICATE_SAME_ACCESS)) {
-    err = errhr(HRESULT_FROM_WIN32(GetLastError()));
-    goto cleanup;
-  }
 
   CloseHandle(in_w_tmp);
   in_w_tmp = INVALID_HANDLE_VALUE;
-  CloseHandle(out_r_tmp);
-  out_r_tmp = INVALID_HANDLE_VALUE;
-  CloseHandle(err_r_tmp);
-  err_r_tmp = INVALID_HANDLE_VALUE;
 
   err = build_environment_strings(&env, options->envvar_name, options->envvar_value);
   if (efailed(err)) {
@@ -326,24 +443,47 @@ NODISCARD error process_create(struct process **prp, struct process_options cons
   out_r = INVALID_HANDLE_VALUE;
   err_r = INVALID_HANDLE_VALUE;
 
-  if (pr->on_receive_stdout) {
-    if (thrd_create(&pr->thread_stdout, read_stdout_worker, pr) != thrd_success) {
-      pr->on_receive_stdout = NULL;
-      err = emsg_i18n(err_type_generic, err_fail, gettext("Unable to create thread."));
-      goto cleanup;
-    }
-  } else {
+  pr->readers[0] = (struct reader){
+      .h = &pr->out_r,
+      .receive = pr->on_receive_stdout,
+      .close = pr->on_close_stdout,
+  };
+  pr->readers[1] = (struct reader){
+      .h = &pr->err_r,
+      .receive = pr->on_receive_stderr,
+      .close = pr->on_close_stderr,
+  };
+  if (!pr->on_receive_stdout) {
     process_close_stdout(pr);
   }
-
-  if (pr->on_receive_stderr) {
-    if (thrd_create(&pr->thread_stderr, read_stderr_worker, pr) != thrd_success) {
-      pr->on_receive_stderr = NULL;
+  if (!pr->on_receive_stderr) {
+    process_close_stderr(pr);
+  }
+  if (pr->on_receive_stdout || pr->on_receive_stderr) {
+    err = mem(&pr->buffer, buffer_size * 2, 1);
+    if (efailed(err)) {
+      err = ethru(err);
+      goto cleanup;
+    }
+    pr->buffer_size = buffer_size;
+    for (size_t i = 0; i < sizeof(pr->readers) / sizeof(pr->readers[0]); ++i) {
+      struct reader *const r = &pr->readers[i];
+      if (!r->receive) {
+        continue;
+      }
+      r->ol.hEvent = CreateEventW(NULL, TRUE, FALSE, NULL);
+      if (!r->ol.hEvent) {
+        err = errhr(HRESULT_FROM_WIN32(GetLastError()));
+        goto cleanup;
+      }
+      r->buf = pr->buffer + buffer_size * i;
+      r->active = true;
+    }
+    if (thrd_create(&pr->thread, read_worker, pr) != thrd_success) {
       err = emsg_i18n(err_type_generic, err_fail, gettext("Unable to create thread."));
       goto cleanup;
     }
-  } else {
-    process_close_stderr(pr);
+    pr->thread_started = true;
   }
 
   *prp = pr;
@@ -379,10 +519,6 @@ cleanup:
     CloseHandle(err_w);
     err_w = INVALID_HANDLE_VALUE;
   }
-  if (err_r_tmp != INVALID_HANDLE_VALUE) {
-    CloseHandle(err_r_tmp);
-    err_r_tmp = INVALID_HANDLE_VALUE;
-  }
   if (out_r != INVALID_HANDLE_VALUE) {
     CloseHandle(out_r);
     out_r = INVALID_HANDLE_VALUE;
@@ -391,10 +527,6 @@ cleanup:
     CloseHandle(out_w);
     out_w = INVALID_HANDLE_VALUE;
   }
-  if (out_r_tmp != INVALID_HANDLE_VALUE) {
-    CloseHandle(out_r_tmp);
-    out_r_tmp = INVALID_HANDLE_VALUE;
-  }
   if (in_r != INVALID_HANDLE_VALUE) {
     CloseHandle(in_r);
     in_r = INVALID_HANDLE_VALUE;
@@ -416,20 +548,26 @@ void process_destroy(struct process **const prp) {
   }
   struct process *const pr = *prp;
   process_close_stdin(pr);
+  if (pr->process != INVALID_HANDLE_VALUE && process_isrunning(pr)) {
+    WaitForSingleObject(pr->process, INFINITE);
+  }
+  // The reader thread waits on the process handle, so it must finish before the handle is closed.
+  if (pr->thread_started) {
+    thrd_join(pr->thread, NULL);
+    pr->thread_started = false;
+  }
   if (pr->process != INVALID_HANDLE_VALUE) {
-    if (process_isrunning(pr)) {
-      WaitForSingleObject(pr->process, INFINITE);
-    }
     CloseHandle(pr->process);
     pr->process = INVALID_HANDLE_VALUE;
   }
-  if (pr->on_receive_stdout) {
-    thrd_join(pr->thread_stdout, NULL);
-    pr->on_receive_stdout = NULL;
+  for (size_t i = 0; i < sizeof(pr->readers) / sizeof(pr->readers[0]); ++i) {
+    if (pr->readers[i].ol.hEvent) {
+      CloseHandle(pr->readers[i].ol.hEvent);
+      pr->readers[i].ol.hEvent = NULL;
+    }
   }
-  if (pr->on_receive_stderr) {
-    thrd_join(pr->thread_stderr, NULL);
-    pr->on_receive_stderr = NULL;
+  if (pr->buffer) {
+    ereport(mem_free(&pr->buffer));
   }
   process_close_stdout(pr);
   process_close_stderr(pr);
@@ -546,31 +684,27 @@ cleanup:
 
 bool process_isrunning(struct process const *const pr) { return WaitForSingleObject(pr->process, 0) == WAIT_TIMEOUT; }
 
-static inline void flush_line_buffer(struct process_line_buffer_context *ctx) {
-  ctx->buf[ctx->written] = '\0';
-  ctx->on_line(ctx->userdata, ctx->buf);
-  ctx->written = 0;
+NODISCARD error process_get_times(struct process const *const pr, double *const kernel_time, double *const user_time) {
+  if (!pr || pr->process == INVALID_HANDLE_VALUE || !kernel_time || !user_time) {
+    return errg(err_invalid_arugment);
+  }
+  FILETIME creation, exit, kernel, user;
+  if (!GetProcessTimes(pr->process, &creation, &exit, &kernel, &user)) {
+    return errhr(HRESULT_FROM_WIN32(GetLastError()));
+  }
+  *kernel_time = (double)(((uint64_t)kernel.dwHighDateTime << 32) | kernel.dwLowDateTime) / 10000000.0;
+  *user_time = (double)(((uint64_t)user.dwHighDateTime << 32) | user.dwLowDateTime) / 10000000.0;
+  return eok();
 }
 
-void process_line_buffer(struct process_line_buffer_context *ctx, void const *const ptr, size_t const len) {
-  char const *const p = ptr;
-  for (size_t i = 0; i < len; ++i) {
-    switch (p[i]) {
-    case '\r':
-      if (i + 1 < len && p[i + 1] == '\n') {
-        ++i;
-      }
-      flush_line_buffer(ctx);
-      break;
-    case '\n':
-      flush_line_buffer(ctx);
-      break;
-    default:
-      if (ctx->written == sizeof(ctx->buf) - 1) {
-        flush_line_buffer(ctx);
-      }
-      ctx->buf[ctx->written++] = p[i];
-      break;
-    }
+NODISCARD error process_get_memory(struct process const *const pr, uint64_t *const peak_working_set) {
+  if (!pr || pr->process == INVALID_HANDLE_VALUE || !peak_working_set) {
+    return errg(err_invalid_arugment);
+  }
+  PROCESS_MEMORY_COUNTERS pmc = {.cb = sizeof(pmc)};
+  if (!GetProcessMemoryInfo(pr->process, &pmc, sizeof(pmc))) {
+    return errhr(HRESULT_FROM_WIN32(GetLastError()));
   }
+  *peak_working_set = pmc.PeakWorkingSetSize;
+  return eok();
 }
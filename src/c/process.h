@@ -9,6 +9,7 @@ struct process_options {
   wchar_t const *cmdline;
   wchar_t const *envvar_name;
   wchar_t const *envvar_value;
+  size_t buffer_size; /**< Read buffer size for each of stdout and stderr, 0 to use the default of 64 KiB. */
   void *userdata;
   void (*on_receive_stdout)(void *userdata, void const *const ptr, size_t const len);
   void (*on_receive_stderr)(void *userdata, void const *const ptr, size_t const len);
@@ -16,6 +17,16 @@ struct process_options {
   void (*on_close_stderr)(void *userdata, error err);
 };
 
+/**
+ * @brief Starts a child process.
+ *
+ * stdout and stderr are read with overlapped I/O on one thread per process, which also watches the process handle.
+ * The receive and close callbacks are called from that thread, so they are never called concurrently.
+ *
+ * @param prp A pointer to receive the process.
+ * @param options Options of the process.
+ * @return An error code indicating success or failure.
+ */
 NODISCARD error process_create(struct process **prp, struct process_options const *const options);
 void process_destroy(struct process **const prp);
 void process_close_stdin(struct process *const pr);
@@ -23,14 +34,26 @@ void process_close_stdout(struct process *const pr);
 void process_close_stderr(struct process *const pr);
 NODISCARD error process_write(struct process *const pr, void const *const buf, size_t const len);
 bool process_isrunning(struct process const *const pr);
-void process_abort(struct process *const pr);
-NODISCARD error process_send_ctrl_break(struct process *const pr);
 
-struct process_line_buffer_context {
-  char buf[1024];
-  size_t written;
-  void *userdata;
-  void (*on_line)(void *const userdata, char const *const message);
-};
+/**
+ * @brief Gets the CPU time the process has used so far, or in total once it has exited.
+ *
+ * It can be called after the process has exited, until process_destroy.
+ * @param pr The process.
+ * @param kernel_time A pointer to receive the kernel time in seconds.
+ * @param user_time A pointer to receive the user time in seconds.
+ * @return An error code indicating success or failure.
+ */
+NODISCARD error process_get_times(struct process const *const pr, double *const kernel_time, double *const user_time);
 
-void process_line_buffer(struct process_line_buffer_context *ctx, void const *const ptr, size_t const len);
+/**
+ * @brief Gets the peak working set of the process.
+ *
+ * It can be called after the process has exited, until process_destroy.
+ * @param pr The process.
+ * @param peak_working_set A pointer to receive the peak working set in bytes.
+ * @return An error code indicating success or failure.
+ */
+NODISCARD error process_get_memory(struct process const *const pr, uint64_t *const peak_working_set);
+void process_abort(struct process *const pr);
+NODISCARD error process_send_ctrl_break(struct process *const pr);
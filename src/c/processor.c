@@ -3,39 +3,90 @@
 #include <ovarray.h>
 #include <ovthreads.h>
 
+#include "artifact.h"
 #include "config.h"
+#include "exochunk.h"
+#include "hash.h"
 #include "i18n.h"
 #include "json2exo.h"
+#include "layeralloc.h"
+#include "layerindex.h"
 #include "luactx.h"
+#include "luapool.h"
+#include "metrics.h"
+#include "modindex.h"
 #include "opus2json.h"
 #include "path.h"
 #include "raw2opus.h"
+#include "reflow.h"
+#include "strutil.h"
+#include "subformat.h"
+#include "transcript.h"
 
 struct processor {
   struct config *config;
+  struct luapool *luapool;
   struct processor_params params;
   thrd_t thread;
+  thrd_t modules_thread;
+  bool modules_thread_started;
   enum processor_type type;
   int progress;
   bool aborted;
+  uint64_t run_started;  // FILETIME of the start of the run, shared by the metrics of its stages.
+  double audio_duration; // Length of the audio in seconds, 0 until a stage has found it.
+  uint64_t audio_key;    // Hash of the audio read by raw2opus in this run, 0 if it has not been read.
 };
 
-static NODISCARD error get_json_path(wchar_t **const json_path, HINSTANCE const hinst) {
-  error err = path_get_module_name(json_path, hinst);
+enum {
+  // Number of objects in a chunk of the *.exo when exo_chunk_objects is not set.
+  default_exo_chunk_objects = 500,
+  // Size budget of the artifact directory in MiB when artifact_max_size is not set.
+  default_artifact_max_size = 1024,
+  // Longest gap in milliseconds that short segments are merged across when reflow_max_merge_gap is not set.
+  default_reflow_max_merge_gap = 1000,
+};
+
+// Files the stages write, removed after a run and kept as artifacts in solo mode.
+static wchar_t const *const work_file_exts[] = {
+    L".opus",
+    L".json",
+    L".transcript",
+    L".exo",
+};
+
+static NODISCARD error get_side_file_path(wchar_t **const path, HINSTANCE const hinst, wchar_t const *const ext) {
+  error err = path_get_module_name(path, hinst);
   if (efailed(err)) {
     err = ethru(err);
     goto cleanup;
   }
-  err = OV_ARRAY_GROW(json_path, wcslen(*json_path) + 6);
-  wchar_t *ext = wcsrchr(*json_path, L'.');
-  if (!ext) {
-    ext = *json_path + wcslen(*json_path);
+  err = OV_ARRAY_GROW(path, wcslen(*path) + wcslen(ext) + 1);
+  if (efailed(err)) {
+    err = ethru(err);
+    goto cleanup;
+  }
+  wchar_t *e = wcsrchr(*path, L'.');
+  if (!e) {
+    e = *path + wcslen(*path);
   }
-  wcscpy(ext, L".json");
+  wcscpy(e, ext);
 cleanup:
   return err;
 }
 
+static NODISCARD error get_json_path(wchar_t **const json_path, HINSTANCE const hinst) {
+  return get_side_file_path(json_path, hinst, L".json");
+}
+
+static NODISCARD error get_module_index_path(wchar_t **const index_path, HINSTANCE const hinst) {
+  return get_side_file_path(index_path, hinst, L".modules.json");
+}
+
+static NODISCARD error get_metrics_path(wchar_t **const metrics_path, HINSTANCE const hinst) {
+  return get_side_file_path(metrics_path, hinst, L".metrics.jsonl");
+}
+
 static NODISCARD error get_lua_directory(wchar_t **const lua_path, HINSTANCE const hinst) {
   static wchar_t const directory[] = L"Subtitler";
   error err = path_get_module_name(lua_path, hinst);
@@ -58,59 +109,241 @@ cleanup:
   return err;
 }
 
-static NODISCARD error get_target_file_path(wchar_t **const path,
-                                            HINSTANCE const hinst,
-                                            bool const solo,
-                                            wchar_t const *const ext) {
+static NODISCARD error get_temp_directory(wchar_t **const path, HINSTANCE const hinst, wchar_t const *const suffix) {
   wchar_t *module_name = NULL;
   error err = path_get_module_name(&module_name, hinst);
   if (efailed(err)) {
     err = ethru(err);
     goto cleanup;
   }
-  err = OV_ARRAY_GROW(&module_name, OV_ARRAY_LENGTH(module_name) + 64);
+  err = OV_ARRAY_GROW(&module_name, OV_ARRAY_LENGTH(module_name) + wcslen(suffix) + 1);
+  if (efailed(err)) {
+    err = ethru(err);
+    goto cleanup;
+  }
+  wchar_t *const name = path_extract_file_name(module_name);
+  wchar_t *const ext = wcsrchr(name, L'.');
+  wcscpy(ext ? ext : name + wcslen(name), suffix);
+  err = path_get_temp_file(path, name);
+  if (efailed(err)) {
+    err = ethru(err);
+    goto cleanup;
+  }
+cleanup:
+  OV_ARRAY_DESTROY(&module_name);
+  return err;
+}
+
+static NODISCARD error get_lua_cache_directory(wchar_t **const path, HINSTANCE const hinst) {
+  return get_temp_directory(path, hinst, L"_luacache");
+}
+
+static NODISCARD error get_artifact_directory(wchar_t **const path, struct processor const *const p) {
+  wchar_t const *const dir = config_get_artifact_dir(p->config);
+  if (!dir || !*dir) {
+    return get_temp_directory(path, p->params.hinst, L"_artifacts");
+  }
+  error err = strutil_copy(path, dir);
+  if (efailed(err)) {
+    return ethru(err);
+  }
+  return eok();
+}
+
+/**
+ * Gets the prefix of the files the stages pass to each other, which is the name of the module file without the
+ * extension.
+ */
+static NODISCARD error get_work_file_prefix(wchar_t **const prefix, HINSTANCE const hinst) {
+  wchar_t *module_name = NULL;
+  error err = path_get_module_name(&module_name, hinst);
   if (efailed(err)) {
     err = ethru(err);
     goto cleanup;
   }
-  wchar_t *delim = wcsrchr(module_name, L'\\');
-  wchar_t *e = wcsrchr(module_name, L'.');
-  if (!delim || !e) {
+  wchar_t *const name = path_extract_file_name(module_name);
+  wchar_t *const e = wcsrchr(name, L'.');
+  if (name == module_name || !e) {
     err = emsg_i18n(err_type_generic, err_fail, gettext("Unexpected path for the module file."));
     goto cleanup;
   }
   *e = L'\0';
-  wchar_t *real_module_name = delim + 1;
+  err = strutil_copy(prefix, name);
+  if (efailed(err)) {
+    err = ethru(err);
+    goto cleanup;
+  }
+cleanup:
+  OV_ARRAY_DESTROY(&module_name);
+  return err;
+}
+
+/**
+ * Opens the artifact directory with the configured budget, or leaves a NULL if it is disabled.
+ */
+static NODISCARD error open_artifact(struct processor const *const p, struct artifact **const a) {
+  wchar_t *dir = NULL;
+  wchar_t *prefix = NULL;
+  error err = eok();
+  // 0 uses the default, and a negative value disables the artifact directory.
+  int max_size = config_get_artifact_max_size(p->config);
+  if (!max_size) {
+    max_size = default_artifact_max_size;
+  } else if (max_size < 0) {
+    goto cleanup;
+  }
+  err = get_artifact_directory(&dir, p);
+  if (efailed(err)) {
+    err = ethru(err);
+    goto cleanup;
+  }
+  err = get_work_file_prefix(&prefix, p->params.hinst);
+  if (efailed(err)) {
+    err = ethru(err);
+    goto cleanup;
+  }
+  err = artifact_create(a, dir, (uint64_t)max_size * 1024 * 1024, prefix);
+  if (efailed(err)) {
+    err = ethru(err);
+    goto cleanup;
+  }
+cleanup:
+  OV_ARRAY_DESTROY(&prefix);
+  OV_ARRAY_DESTROY(&dir);
+  return err;
+}
+
+/**
+ * Gets the path of a file the stages pass to each other, which is written in the artifact directory.
+ * The files of a run are named after the process so that runs in multiple processes do not collide,
+ * and the files of solo mode have fixed names so that the stages can be run one by one.
+ */
+static NODISCARD error get_target_file_path(wchar_t **const path,
+                                            struct processor const *const p,
+                                            bool const solo,
+                                            wchar_t const *const ext) {
+  wchar_t *name = NULL;
+  error err = get_work_file_prefix(&name, p->params.hinst);
+  if (efailed(err)) {
+    err = ethru(err);
+    goto cleanup;
+  }
+  size_t const prefix_len = OV_ARRAY_LENGTH(name);
+  err = OV_ARRAY_GROW(&name, prefix_len + wcslen(ext) + 16);
+  if (efailed(err)) {
+    err = ethru(err);
+    goto cleanup;
+  }
   if (solo) {
-    wcscpy(e, ext);
+    wcscpy(name + prefix_len, ext);
   } else {
-    wsprintfW(e, L"_%d%s", GetCurrentProcessId(), ext);
+    wsprintfW(name + prefix_len, L"_%d%s", GetCurrentProcessId(), ext);
   }
-  err = path_get_temp_file(path, real_module_name);
+  err = get_artifact_directory(path, p);
   if (efailed(err)) {
     err = ethru(err);
     goto cleanup;
   }
+  if (!CreateDirectoryW(*path, NULL) && GetLastError() != ERROR_ALREADY_EXISTS) {
+    err = errhr(HRESULT_FROM_WIN32(GetLastError()));
+    goto cleanup;
+  }
+  size_t len = OV_ARRAY_LENGTH(*path);
+  err = OV_ARRAY_GROW(path, len + wcslen(name) + 2);
+  if (efailed(err)) {
+    err = ethru(err);
+    goto cleanup;
+  }
+  if (len && (*path)[len - 1] != L'\\' && (*path)[len - 1] != L'/') {
+    (*path)[len++] = L'\\';
+  }
+  wcscpy(*path + len, name);
+  OV_ARRAY_SET_LENGTH(*path, len + wcslen(name));
 cleanup:
-  OV_ARRAY_DESTROY(&module_name);
+  OV_ARRAY_DESTROY(&name);
   return err;
 }
 
-static NODISCARD error remove_temporary_files(HINSTANCE const hinst) {
+/**
+ * Gets the path the subtitle files are named after, which is the project file, or the edited file if the project
+ * has not been saved yet. The subtitle files are the output of the run, so they are not written with the work files.
+ */
+static NODISCARD error get_sidecar_path(wchar_t **const path, struct processor const *const p) {
+  SYS_INFO si;
+  if (!p->params.fp->exfunc->get_sys_info(p->params.editp, &si)) {
+    return emsg_i18nf(err_type_generic,
+                      err_fail,
+                      L"%1$hs",
+                      gettext("Unable to get system information from %1$hs."),
+                      gettext("AviUtl"));
+  }
+  char const *const name = si.project_name && si.project_name[0] ? si.project_name
+                           : si.edit_name && si.edit_name[0]     ? si.edit_name
+                                                                 : NULL;
+  if (!name) {
+    return emsg_i18n(err_type_generic, err_fail, gettext("Save the project to write the subtitle files."));
+  }
+  int const len = MultiByteToWideChar(CP_ACP, 0, name, -1, NULL, 0);
+  if (!len) {
+    return errhr(HRESULT_FROM_WIN32(GetLastError()));
+  }
+  error err = OV_ARRAY_GROW(path, (size_t)len);
+  if (efailed(err)) {
+    return ethru(err);
+  }
+  if (!MultiByteToWideChar(CP_ACP, 0, name, -1, *path, len)) {
+    return errhr(HRESULT_FROM_WIN32(GetLastError()));
+  }
+  OV_ARRAY_SET_LENGTH(*path, (size_t)(len - 1));
+  return eok();
+}
+
+static NODISCARD error remove_temporary_files(struct processor const *const p) {
   wchar_t *path = NULL;
-  error err = get_target_file_path(&path, hinst, false, L".opus");
+  error err = eok();
+  for (size_t i = 0; i < sizeof(work_file_exts) / sizeof(work_file_exts[0]); ++i) {
+    err = get_target_file_path(&path, p, false, work_file_exts[i]);
+    if (efailed(err)) {
+      err = ethru(err);
+      goto cleanup;
+    }
+    DeleteFileW(path);
+  }
+cleanup:
+  OV_ARRAY_DESTROY(&path);
+  return err;
+}
+
+/**
+ * Registers the files of solo mode in the artifact directory, so that they are evicted like the other artifacts
+ * instead of being left behind.
+ */
+static NODISCARD error touch_solo_files(struct processor const *const p) {
+  struct artifact *a = NULL;
+  wchar_t *path = NULL;
+  error err = open_artifact(p, &a);
   if (efailed(err)) {
     err = ethru(err);
     goto cleanup;
   }
-  DeleteFileW(path);
-  wchar_t *ext = wcsrchr(path, L'.');
-  wcscpy(ext, L".json");
-  DeleteFileW(path);
-  wcscpy(ext, L".exo");
-  DeleteFileW(path);
+  if (!a) {
+    goto cleanup;
+  }
+  for (size_t i = 0; i < sizeof(work_file_exts) / sizeof(work_file_exts[0]); ++i) {
+    err = get_target_file_path(&path, p, true, work_file_exts[i]);
+    if (efailed(err)) {
+      err = ethru(err);
+      goto cleanup;
+    }
+    err = artifact_touch(a, path_extract_file_name(path));
+    if (efailed(err)) {
+      err = ethru(err);
+      goto cleanup;
+    }
+  }
 cleanup:
   OV_ARRAY_DESTROY(&path);
+  artifact_destroy(&a);
   return err;
 }
 
@@ -164,6 +397,10 @@ void processor_destroy(struct processor **const pp) {
     return;
   }
   struct processor *p = *pp;
+  if (p->modules_thread_started) {
+    thrd_join(p->modules_thread, NULL);
+    p->modules_thread_started = false;
+  }
   wchar_t *json_path = NULL;
   error err = get_json_path(&json_path, p->params.hinst);
   if (efailed(err)) {
@@ -176,6 +413,9 @@ void processor_destroy(struct processor **const pp) {
     goto cleanup;
   }
 cleanup:
+  if (p->luapool) {
+    luapool_destroy(&p->luapool);
+  }
   if (p->config) {
     config_destroy(&p->config);
   }
@@ -212,8 +452,95 @@ static void on_log_line(void *const userdata, wchar_t const *const message) {
   p->params.on_log_line(p->params.userdata, p->type, message);
 }
 
+static void start_run(struct processor *const p) {
+  FILETIME ft;
+  GetSystemTimeAsFileTime(&ft);
+  p->run_started = ((uint64_t)ft.dwHighDateTime << 32) | (uint64_t)ft.dwLowDateTime;
+  p->audio_duration = 0;
+  p->audio_key = 0;
+}
+
+/**
+ * Finishes the measurements of the stage, then writes them to the log, the *.metrics.jsonl file and on_metrics.
+ * Failing to write the file is not an error of the stage.
+ */
+static void report_metrics(struct processor *const p,
+                           struct metrics_clock const *const clock,
+                           struct metrics *const m) {
+  wchar_t *path = NULL;
+  if (m->audio_duration <= 0) {
+    m->audio_duration = p->audio_duration;
+  }
+  metrics_clock_stop(clock, m);
+  if (p->params.on_log_line) {
+    wchar_t msg[1024];
+    int const wall = (int)(m->wall_time * 1000.0);
+    int const cpu = (int)(m->cpu_time * 1000.0);
+    int const peak = (int)(m->process_peak_memory / (1024 * 1024));
+    if (m->audio_duration > 0) {
+      int const rtf = (int)(m->realtime_factor * 1000.0);
+      mo_snprintf_wchar(msg,
+                        sizeof(msg) / sizeof(msg[0]),
+                        L"%1$hs%2$d%3$03d%4$d%5$03d%6$d%7$d%8$03d",
+                        "Metrics: %1$hs took %2$d.%3$03ds, CPU %4$d.%5$03ds, peak memory %6$dMiB, "
+                        "realtime factor %7$d.%8$03d",
+                        m->stage,
+                        wall / 1000,
+                        wall % 1000,
+                        cpu / 1000,
+                        cpu % 1000,
+                        peak,
+                        rtf / 1000,
+                        rtf % 1000);
+    } else {
+      mo_snprintf_wchar(msg,
+                        sizeof(msg) / sizeof(msg[0]),
+                        L"%1$hs%2$d%3$03d%4$d%5$03d%6$d",
+                        "Metrics: %1$hs took %2$d.%3$03ds, CPU %4$d.%5$03ds, peak memory %6$dMiB",
+                        m->stage,
+                        wall / 1000,
+                        wall % 1000,
+                        cpu / 1000,
+                        cpu % 1000,
+                        peak);
+    }
+    on_log_line(p, msg);
+    if (m->child_cpu_time > 0 || m->child_peak_memory > 0) {
+      int const child_cpu = (int)(m->child_cpu_time * 1000.0);
+      mo_snprintf_wchar(msg,
+                        sizeof(msg) / sizeof(msg[0]),
+                        L"%1$hs%2$d%3$03d%4$d",
+                        "Metrics: %1$hs child process CPU %2$d.%3$03ds, peak memory %4$dMiB",
+                        m->stage,
+                        child_cpu / 1000,
+                        child_cpu % 1000,
+                        (int)(m->child_peak_memory / (1024 * 1024)));
+      on_log_line(p, msg);
+    }
+  }
+  error err = get_metrics_path(&path, p->params.hinst);
+  if (efailed(err)) {
+    err = ethru(err);
+    goto cleanup;
+  }
+  err = metrics_append_file(m, path);
+  if (efailed(err)) {
+    err = ethru(err);
+    goto cleanup;
+  }
+cleanup:
+  ereport(err);
+  OV_ARRAY_DESTROY(&path);
+  if (p->params.on_metrics) {
+    p->params.on_metrics(p->params.userdata, m);
+  }
+}
+
 static bool run_raw2opus(struct processor *const p, bool const solo) {
   wchar_t *opus_path = NULL;
+  struct metrics m = {.stage = "raw2opus"};
+  struct metrics_clock clock;
+  bool measuring = false;
   error err = eok();
   if (!p) {
     err = errg(err_invalid_arugment);
@@ -224,7 +551,7 @@ static bool run_raw2opus(struct processor *const p, bool const solo) {
     err = ethru(err);
     goto cleanup;
   }
-  err = get_target_file_path(&opus_path, p->params.hinst, solo, L".opus");
+  err = get_target_file_path(&opus_path, p, solo, L".opus");
   if (efailed(err)) {
     err = ethru(err);
     goto cleanup;
@@ -234,6 +561,9 @@ static bool run_raw2opus(struct processor *const p, bool const solo) {
   if (p->params.on_start) {
     p->params.on_start(p->params.userdata, p->type);
   }
+  m.run_started = p->run_started;
+  metrics_clock_start(&clock);
+  measuring = true;
   struct raw2opus_info info;
   err = raw2opus(
       &(struct raw2opus_params){
@@ -245,7 +575,25 @@ static bool run_raw2opus(struct processor *const p, bool const solo) {
           .on_log_line = on_log_line,
       },
       &info);
+  if (efailed(err)) {
+    err = ethru(err);
+    goto cleanup;
+  }
+  // The audio is read from AviUtl as 16-bit PCM.
+  m.bytes_in = (uint64_t)info.samples * (uint64_t)info.channels * sizeof(int16_t);
+  m.bytes_out = metrics_get_file_size(opus_path);
+  m.samples = info.samples;
+  m.sample_rate = info.sample_rate;
+  if (info.sample_rate > 0) {
+    p->audio_duration = (double)info.samples / (double)info.sample_rate;
+  }
+  p->audio_key = hash_fnv1a(&info.sample_rate, sizeof(info.sample_rate), info.hash);
+  p->audio_key = hash_fnv1a(&info.channels, sizeof(info.channels), p->audio_key);
 cleanup:
+  if (measuring) {
+    m.success = esucceeded(err) && !p->aborted;
+    report_metrics(p, &clock, &m);
+  }
   OV_ARRAY_DESTROY(&opus_path);
   bool const r = esucceeded(err);
   if (p->params.on_finish) {
@@ -308,11 +656,71 @@ cleanup:
   return err;
 }
 
+/**
+ * Looks for the *.json transcribed from the same audio with the same Whisper and arguments in the artifact
+ * directory, and copies it to json_path if found.
+ * The audio is identified by audio_key if raw2opus has read it in this run, or by the *.opus otherwise,
+ * because the *.opus is not byte-identical between encodes of the same audio.
+ * name receives the content-addressed name of the *.json, to put it into the directory after transcribing.
+ */
+static NODISCARD error find_transcript_artifact(struct artifact *const a,
+                                                uint64_t const audio_key,
+                                                wchar_t const *const opus_path,
+                                                wchar_t const *const whisper_path,
+                                                wchar_t const *const args,
+                                                wchar_t const *const json_path,
+                                                wchar_t *const name,
+                                                bool *const found) {
+  wchar_t *path = NULL;
+  uint64_t key = audio_key;
+  error err = eok();
+  if (!key) {
+    err = artifact_hash_file(opus_path, 0, &key);
+    if (efailed(err)) {
+      err = ethru(err);
+      goto cleanup;
+    }
+  }
+  key = hash_fnv1a(whisper_path, (wcslen(whisper_path) + 1) * sizeof(wchar_t), key);
+  if (args) {
+    key = hash_fnv1a(args, wcslen(args) * sizeof(wchar_t), key);
+  }
+  artifact_make_name(key, L".json", name);
+  err = artifact_find(a, name, found);
+  if (efailed(err)) {
+    err = ethru(err);
+    goto cleanup;
+  }
+  if (!*found) {
+    goto cleanup;
+  }
+  err = artifact_get_path(a, name, &path);
+  if (efailed(err)) {
+    err = ethru(err);
+    goto cleanup;
+  }
+  if (!CopyFileW(path, json_path, FALSE)) {
+    *found = false;
+    err = errhr(HRESULT_FROM_WIN32(GetLastError()));
+    goto cleanup;
+  }
+cleanup:
+  OV_ARRAY_DESTROY(&path);
+  return err;
+}
+
 static bool run_opus2json(struct processor *const p, bool const solo) {
   wchar_t const *const whisper_path = config_get_whisper_path(p->config);
   wchar_t *opus_path = NULL;
+  wchar_t *json_path = NULL;
   wchar_t *args = NULL;
   wchar_t *buf = NULL;
+  struct artifact *artifact = NULL;
+  wchar_t artifact_name[artifact_key_chars + 8] = {0};
+  bool reused = false;
+  struct metrics m = {.stage = "opus2json"};
+  struct metrics_clock clock;
+  bool measuring = false;
   error err = eok();
   if (!p) {
     err = errg(err_invalid_arugment);
@@ -323,7 +731,7 @@ static bool run_opus2json(struct processor *const p, bool const solo) {
     err = ethru(err);
     goto cleanup;
   }
-  err = get_target_file_path(&opus_path, p->params.hinst, solo, L".opus");
+  err = get_target_file_path(&opus_path, p, solo, L".opus");
   if (efailed(err)) {
     err = ethru(err);
     goto cleanup;
@@ -351,16 +759,74 @@ static bool run_opus2json(struct processor *const p, bool const solo) {
   if (p->params.on_start) {
     p->params.on_start(p->params.userdata, p->type);
   }
+  m.run_started = p->run_started;
+  metrics_clock_start(&clock);
+  measuring = true;
 
-  err = opus2json(&(struct opus2json_params){
-      .opus_path = opus_path,
-      .whisper_path = whisper_path,
-      .additional_args = args,
-      .userdata = p,
-      .on_progress = on_progress,
-      .on_log_line = on_log_line,
-  });
+  err = get_target_file_path(&json_path, p, solo, L".json");
+  if (efailed(err)) {
+    err = ethru(err);
+    goto cleanup;
+  }
+  // The artifact directory only saves time, so Whisper is run as usual if it does not work.
+  ereport(open_artifact(p, &artifact));
+  if (artifact) {
+    ereport(find_transcript_artifact(
+        artifact, p->audio_key, opus_path, whisper_path, args, json_path, artifact_name, &reused));
+  }
+  if (reused) {
+    if (p->params.on_log_line) {
+      wchar_t msg[1024];
+      mo_snprintf_wchar(msg,
+                        sizeof(msg) / sizeof(msg[0]),
+                        L"%1$ls",
+                        "Reusing the transcript %1$ls from the artifact directory",
+                        artifact_name);
+      on_log_line(p, msg);
+    }
+  } else {
+    struct opus2json_usage usage = {0};
+    err = opus2json(&(struct opus2json_params){
+        .opus_path = opus_path,
+        .whisper_path = whisper_path,
+        .additional_args = args,
+        .usage = &usage,
+        .userdata = p,
+        .on_progress = on_progress,
+        .on_log_line = on_log_line,
+    });
+    m.child_cpu_time = usage.cpu_time;
+    m.child_peak_memory = usage.peak_memory;
+    if (efailed(err)) {
+      err = ethru(err);
+      goto cleanup;
+    }
+    if (artifact && artifact_name[0]) {
+      ereport(artifact_put_file(artifact, artifact_name, json_path));
+    }
+  }
+  // Convert the transcript once here so that json2exo can map it without parsing the JSON.
+  // json2exo converts the JSON by itself if this fails, so it is not an error, and the counts are left at zero.
+  struct transcript_summary summary = {0};
+  error e = transcript_build_file(json_path, &summary);
+  if (efailed(e)) {
+    ereport(e);
+  } else {
+    m.segments = summary.num_segments;
+    m.words = summary.num_words;
+    if (p->audio_duration <= 0) {
+      p->audio_duration = summary.max_time;
+    }
+  }
+  m.bytes_in = metrics_get_file_size(opus_path);
+  m.bytes_out = metrics_get_file_size(json_path);
 cleanup:
+  if (measuring) {
+    m.success = esucceeded(err) && !p->aborted;
+    report_metrics(p, &clock, &m);
+  }
+  artifact_destroy(&artifact);
+  OV_ARRAY_DESTROY(&json_path);
   OV_ARRAY_DESTROY(&buf);
   OV_ARRAY_DESTROY(&args);
   OV_ARRAY_DESTROY(&opus_path);
@@ -373,21 +839,97 @@ cleanup:
   return r;
 }
 
+/**
+ * Drops the *.exo, or its chunks one by one so that the progress is shown and the drop can be aborted between them.
+ * Each chunk is loaded by a single call, so an abort never leaves a part of a chunk on the timeline.
+ */
+static NODISCARD error drop_exo(struct processor *const p,
+                                wchar_t const *const exo_path,
+                                struct json2exo_info const *const info,
+                                struct processor_placement const *const placement,
+                                struct layeralloc *const layeralloc) {
+  if (!p->params.on_create_exo) {
+    return eok();
+  }
+  error err = eok();
+  wchar_t *chunk_path = NULL;
+  struct processor_drop drop = {0};
+  struct processor_exo_info ei = {
+      .exo_path = exo_path,
+      .length = info->frames,
+      .layer_min = info->layer_min,
+      .layer_max = info->layer_max,
+      .num_chunks = info->num_chunks,
+      .drop = &drop,
+      .placement = placement,
+      .layeralloc = layeralloc,
+  };
+  if (!info->num_chunks) {
+    if (!p->params.on_create_exo(p->params.userdata, &ei)) {
+      err = errg(err_abort);
+      goto cleanup;
+    }
+    if (drop.failed) {
+      err = emsg_i18n(err_type_generic, err_fail, gettext("Unable to drop the *.exo."));
+    }
+    goto cleanup;
+  }
+  if (p->params.on_log_line) {
+    wchar_t msg[1024];
+    mo_snprintf_wchar(
+        msg, sizeof(msg) / sizeof(msg[0]), L"%1$d", "Dropping the *.exo in %1$d chunks", info->num_chunks);
+    on_log_line(p, msg);
+  }
+  p->progress = 0;
+  for (int i = 0; i < info->num_chunks; ++i) {
+    err = exochunk_get_path(exo_path, (size_t)i, &chunk_path);
+    if (efailed(err)) {
+      err = ethru(err);
+      goto cleanup;
+    }
+    ei.exo_path = chunk_path;
+    ei.chunk = i;
+    if (!p->params.on_create_exo(p->params.userdata, &ei)) {
+      err = errg(err_abort);
+      goto cleanup;
+    }
+    if (drop.failed) {
+      err = emsg_i18n(err_type_generic, err_fail, gettext("Unable to drop the *.exo."));
+      goto cleanup;
+    }
+    if (!on_progress(p, (i + 1) * 10000 / info->num_chunks) && i + 1 < info->num_chunks) {
+      err = errg(err_abort);
+      goto cleanup;
+    }
+  }
+cleanup:
+  OV_ARRAY_DESTROY(&chunk_path);
+  return err;
+}
+
 static bool run_json2exo(struct processor *const p, bool const solo) {
   wchar_t *json_path = NULL;
   wchar_t *exo_path = NULL;
   wchar_t *lua_directory = NULL;
+  wchar_t *lua_cache_directory = NULL;
+  wchar_t *sidecar_path = NULL;
+  struct processor_placement placement = {0};
+  struct layeralloc *layeralloc = NULL;
+  int num_chunks = 0;
+  struct metrics m = {.stage = "json2exo"};
+  struct metrics_clock clock;
+  bool measuring = false;
   error err = eok();
   if (!p) {
     err = errg(err_invalid_arugment);
     goto cleanup;
   }
-  err = get_target_file_path(&json_path, p->params.hinst, solo, L".json");
+  err = get_target_file_path(&json_path, p, solo, L".json");
   if (efailed(err)) {
     err = ethru(err);
     goto cleanup;
   }
-  err = get_target_file_path(&exo_path, p->params.hinst, solo, L".exo");
+  err = get_target_file_path(&exo_path, p, solo, L".exo");
   if (efailed(err)) {
     err = ethru(err);
     goto cleanup;
@@ -397,18 +939,79 @@ static bool run_json2exo(struct processor *const p, bool const solo) {
     err = ethru(err);
     goto cleanup;
   }
+  err = get_lua_cache_directory(&lua_cache_directory, p->params.hinst);
+  if (efailed(err)) {
+    err = ethru(err);
+    goto cleanup;
+  }
   wchar_t const *const module = config_get_module(p->config);
   if (!module || !*module) {
     err = emsg_i18n(err_type_generic, err_fail, gettext("The module is not set."));
     goto cleanup;
   }
+  if (!p->luapool) {
+    err = luapool_create(&p->luapool, lua_directory, lua_cache_directory);
+    if (efailed(err)) {
+      err = ethru(err);
+      goto cleanup;
+    }
+  }
 
   p->type = processor_type_json2exo;
   p->progress = 0;
   if (p->params.on_start) {
     p->params.on_start(p->params.userdata, p->type);
   }
+  m.run_started = p->run_started;
+  metrics_clock_start(&clock);
+  measuring = true;
+
+  if (p->params.on_get_placement && !p->params.on_get_placement(p->params.userdata, &placement)) {
+    err = errg(err_abort);
+    goto cleanup;
+  }
+  if (placement.timeline) {
+    err = layeralloc_create(&layeralloc,
+                            &(struct layeralloc_params){
+                                .timeline = placement.timeline,
+                                .frame_offset = placement.frame - 1,
+                                .layer_offset = placement.layer,
+                            });
+    if (efailed(err)) {
+      err = ethru(err);
+      goto cleanup;
+    }
+  }
 
+  int const sidecar_formats = config_get_sidecar_formats(p->config) & subformat_all;
+  if (sidecar_formats) {
+    err = get_sidecar_path(&sidecar_path, p);
+    if (efailed(err)) {
+      err = ethru(err);
+      goto cleanup;
+    }
+  }
+  // 0 uses the default, and a negative value allows merging across any gap.
+  int max_merge_gap = config_get_reflow_max_merge_gap(p->config);
+  if (!max_merge_gap) {
+    max_merge_gap = default_reflow_max_merge_gap;
+  } else if (max_merge_gap < 0) {
+    max_merge_gap = 0;
+  }
+  struct reflow_params const reflow = {
+      .max_width = config_get_reflow_max_width(p->config),
+      .max_duration = config_get_reflow_max_duration(p->config) / 1000.0,
+      .min_duration = config_get_reflow_min_duration(p->config) / 1000.0,
+      .min_gap = config_get_reflow_min_gap(p->config) / 1000.0,
+      .max_merge_gap = max_merge_gap / 1000.0,
+  };
+  // 0 uses the default, and a negative value disables splitting.
+  int chunk_objects = config_get_exo_chunk_objects(p->config);
+  if (!chunk_objects) {
+    chunk_objects = default_exo_chunk_objects;
+  } else if (chunk_objects < 0) {
+    chunk_objects = 0;
+  }
   struct json2exo_info info;
   err = json2exo(
       &(struct json2exo_params){
@@ -417,22 +1020,46 @@ static bool run_json2exo(struct processor *const p, bool const solo) {
           .json_path = json_path,
           .exo_path = exo_path,
           .lua_directory = lua_directory,
+          .lua_cache_directory = lua_cache_directory,
           .module = module,
+          .luapool = p->luapool,
+          .sidecar_formats = sidecar_formats,
+          .sidecar_path = sidecar_path,
+          .reflow = &reflow,
+          .layeralloc = layeralloc,
+          .chunk_objects = chunk_objects,
           .userdata = p,
           .on_progress = on_progress,
           .on_log_line = on_log_line,
       },
       &info);
-  if (p->params.on_create_exo) {
-    p->params.on_create_exo(p->params.userdata,
-                            &(struct processor_exo_info){
-                                .exo_path = exo_path,
-                                .length = info.frames,
-                                .layer_min = info.layer_min,
-                                .layer_max = info.layer_max,
-                            });
+  if (efailed(err)) {
+    err = ethru(err);
+    goto cleanup;
+  }
+  num_chunks = info.num_chunks;
+  m.bytes_in = metrics_get_file_size(json_path);
+  m.bytes_out = metrics_get_file_size(exo_path);
+  m.segments = info.num_segments;
+  m.words = info.num_words;
+  m.exo_objects = info.num_objects;
+  err = drop_exo(p, exo_path, &info, layeralloc ? &placement : NULL, layeralloc);
+  if (efailed(err)) {
+    err = ethru(err);
+    goto cleanup;
   }
 cleanup:
+  if (measuring) {
+    m.success = esucceeded(err) && !p->aborted;
+    report_metrics(p, &clock, &m);
+  }
+  if (num_chunks) {
+    json2exo_delete_chunks(exo_path, num_chunks);
+  }
+  layeralloc_destroy(&layeralloc);
+  layerindex_destroy(&placement.timeline);
+  OV_ARRAY_DESTROY(&sidecar_path);
+  OV_ARRAY_DESTROY(&lua_cache_directory);
   OV_ARRAY_DESTROY(&lua_directory);
   OV_ARRAY_DESTROY(&exo_path);
   OV_ARRAY_DESTROY(&json_path);
@@ -449,6 +1076,7 @@ static int run(void *userdata) {
   struct processor *const p = userdata;
   bool r;
   p->aborted = false;
+  start_run(p);
   r = run_raw2opus(p, false);
   if (!r || p->aborted) {
     goto cleanup;
@@ -465,7 +1093,7 @@ cleanup:
   if (p->params.on_complete) {
     p->params.on_complete(p->params.userdata, r && !p->aborted);
   }
-  ereport(remove_temporary_files(p->params.hinst));
+  ereport(remove_temporary_files(p));
   return 0;
 }
 
@@ -487,6 +1115,7 @@ static int run_solo(void *userdata) {
   bool r = false;
   p->aborted = false;
   p->progress = 0;
+  start_run(p);
   switch ((int)p->type) {
   case processor_type_raw2opus:
     r = run_raw2opus(p, true);
@@ -498,6 +1127,7 @@ static int run_solo(void *userdata) {
     r = run_json2exo(p, true);
     break;
   }
+  ereport(touch_solo_files(p));
   if (p->params.on_complete) {
     p->params.on_complete(p->params.userdata, r && !p->aborted);
   }
@@ -548,7 +1178,8 @@ static NODISCARD error test_module(lua_State *const L,
     err = emsg_i18nf(err_type_generic, err_lua, L"%1$hs", gettext("\"%1$hs\" is not a function."), "get_info");
     goto cleanup;
   }
-  if (lua_safecall(L, 0, 1)) {
+  err = lua_safecall(L, 0, 1);
+  if (efailed(err)) {
     err = ethru(err);
     goto cleanup;
   }
@@ -619,16 +1250,53 @@ static void report_error(struct processor *const p, error e) {
   efree(&e);
 }
 
+static NODISCARD error get_index_language(wchar_t **const language) {
+  struct wstr tmp = {0};
+  error err = mo_get_preferred_ui_languages(&tmp);
+  if (efailed(err)) {
+    err = ethru(err);
+    goto cleanup;
+  }
+  err = OV_ARRAY_GROW(language, tmp.len + 1);
+  if (efailed(err)) {
+    err = ethru(err);
+    goto cleanup;
+  }
+  // The list is separated by NUL, so join it with semicolons to make a single string.
+  size_t len = tmp.len;
+  while (len > 0 && tmp.ptr[len - 1] == L'\0') {
+    --len;
+  }
+  for (size_t i = 0; i < len; ++i) {
+    (*language)[i] = tmp.ptr[i] == L'\0' ? L';' : tmp.ptr[i];
+  }
+  (*language)[len] = L'\0';
+  OV_ARRAY_SET_LENGTH(*language, len);
+cleanup:
+  ereport(sfree(&tmp));
+  return err;
+}
+
+static inline uint64_t filetime_to_uint64(FILETIME const ft) {
+  return ((uint64_t)ft.dwHighDateTime << 32) | (uint64_t)ft.dwLowDateTime;
+}
+
 NODISCARD error processor_get_modules(struct processor *const p, struct processor_module **const pmpp) {
   if (!p || !pmpp) {
     return errg(err_invalid_arugment);
   }
 
   wchar_t *dir = NULL;
+  wchar_t *cache_dir = NULL;
+  wchar_t *path = NULL;
+  wchar_t *index_path = NULL;
+  wchar_t *language = NULL;
+  struct modindex *old_index = NULL;
+  struct modindex *new_index = NULL;
   struct processor_module *pm = NULL;
   wchar_t *strings = NULL;
-  wchar_t *name = NULL;
-  wchar_t *description = NULL;
+  wchar_t *probed_name = NULL;
+  wchar_t *probed_description = NULL;
   struct luactx *ctx = NULL;
   HANDLE h = INVALID_HANDLE_VALUE;
 
@@ -638,43 +1306,67 @@ NODISCARD error processor_get_modules(struct processor *const p, struct processo
     goto cleanup;
   }
   size_t const luadirlen = wcslen(dir);
-  err = OV_ARRAY_GROW(&dir, luadirlen + MAX_PATH + 32);
+  err = get_lua_cache_directory(&cache_dir, p->params.hinst);
+  if (efailed(err)) {
+    err = ethru(err);
+    goto cleanup;
+  }
+  err = OV_ARRAY_GROW(&path, luadirlen + MAX_PATH + 32);
   if (efailed(err)) {
     err = ethru(err);
     goto cleanup;
   }
-  err = luactx_create(&ctx,
-                      &(struct luactx_params){
-                          .lua_directory = dir,
-                          .userdata = p,
-                          .on_log_line = on_log_line,
-                      });
+  wcscpy(path, dir);
+  err = get_module_index_path(&index_path, p->params.hinst);
   if (efailed(err)) {
     err = ethru(err);
     goto cleanup;
   }
+  err = get_index_language(&language);
+  if (efailed(err)) {
+    err = ethru(err);
+    goto cleanup;
+  }
+  err = modindex_create(&old_index, language);
+  if (efailed(err)) {
+    err = ethru(err);
+    goto cleanup;
+  }
+  err = modindex_create(&new_index, language);
+  if (efailed(err)) {
+    err = ethru(err);
+    goto cleanup;
+  }
+  err = modindex_load_file(old_index, index_path);
+  if (efailed(err)) {
+    // The index is only a cache, so it will be rebuilt if it cannot be read.
+    efree(&err);
+  }
 
-  lua_State *L = luactx_get(ctx);
-  wcscpy(dir + luadirlen, L"\\*");
+  wcscpy(path + luadirlen, L"\\*");
   size_t num_modules = 0;
 
   WIN32_FIND_DATAW find_data;
-  h = FindFirstFileW(dir, &find_data);
+  h = FindFirstFileW(path, &find_data);
   if (h == INVALID_HANDLE_VALUE) {
     err = errhr(HRESULT_FROM_WIN32(GetLastError()));
     goto cleanup;
   }
   do {
+    uint64_t mtime, size;
     if (find_data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) {
       if (wcscmp(find_data.cFileName, L".") == 0 || wcscmp(find_data.cFileName, L"..") == 0) {
         continue;
       }
-      wcscpy(dir + luadirlen, L"\\");
-      wcscpy(dir + luadirlen + 1, find_data.cFileName);
-      wcscpy(dir + luadirlen + 1 + wcslen(find_data.cFileName), L"\\init.lua");
-      if (GetFileAttributesW(dir) == INVALID_FILE_ATTRIBUTES) {
+      wcscpy(path + luadirlen, L"\\");
+      wcscpy(path + luadirlen + 1, find_data.cFileName);
+      wcscpy(path + luadirlen + 1 + wcslen(find_data.cFileName), L"\\init.lua");
+      WIN32_FILE_ATTRIBUTE_DATA fad;
+      if (!GetFileAttributesExW(path, GetFileExInfoStandard, &fad)) {
         continue;
       }
+      mtime = filetime_to_uint64(fad.ftLastWriteTime);
+      size = ((uint64_t)fad.nFileSizeHigh << 32) | (uint64_t)fad.nFileSizeLow;
     } else {
       wchar_t *dot = wcsrchr(find_data.cFileName, L'.');
       if (!dot) {
@@ -684,17 +1376,47 @@ NODISCARD error processor_get_modules(struct processor *const p, struct processo
         continue;
       }
       *dot = L'\0';
+      mtime = filetime_to_uint64(find_data.ftLastWriteTime);
+      size = ((uint64_t)find_data.nFileSizeHigh << 32) | (uint64_t)find_data.nFileSizeLow;
     }
-    err = test_module(L, find_data.cFileName, &name, &description);
-    if (efailed(err)) {
-      if (eisg(err, err_lua)) {
-        wchar_t msg[2048];
-        mo_snprintf_wchar(
-            msg, 2048, L"%1$ls", gettext("[WARN] Package \"%1$ls\" cannot be used as a module."), find_data.cFileName);
-        p->params.on_log_line(p->params.userdata, p->type, msg);
-        report_error(p, err);
-        continue;
+    wchar_t const *name = NULL;
+    wchar_t const *description = NULL;
+    if (!modindex_find(old_index, find_data.cFileName, mtime, size, &name, &description)) {
+      // The module is new or has been changed, so it has to be loaded to get the details.
+      if (!ctx) {
+        err = luactx_create(&ctx,
+                            &(struct luactx_params){
+                                .lua_directory = dir,
+                                .cache_directory = cache_dir,
+                                .userdata = p,
+                                .on_log_line = on_log_line,
+                            });
+        if (efailed(err)) {
+          err = ethru(err);
+          goto cleanup;
+        }
+      }
+      err = test_module(luactx_get(ctx), find_data.cFileName, &probed_name, &probed_description);
+      if (efailed(err)) {
+        if (eisg(err, err_lua)) {
+          wchar_t msg[2048];
+          mo_snprintf_wchar(msg,
+                            2048,
+                            L"%1$ls",
+                            gettext("[WARN] Package \"%1$ls\" cannot be used as a module."),
+                            find_data.cFileName);
+          p->params.on_log_line(p->params.userdata, p->type, msg);
+          report_error(p, err);
+          continue;
+        }
+        err = ethru(err);
+        goto cleanup;
       }
+      name = probed_name;
+      description = probed_description;
+    }
+    err = modindex_add(new_index, find_data.cFileName, mtime, size, name, description);
+    if (efailed(err)) {
       err = ethru(err);
       goto cleanup;
     }
@@ -717,6 +1439,9 @@ NODISCARD error processor_get_modules(struct processor *const p, struct processo
     ++num_modules;
   } while (FindNextFileW(h, &find_data));
 
+  // Modules that failed to load are not indexed, so they will be reported again next time.
+  ereport(modindex_save_file(new_index, index_path));
+
   err = OV_ARRAY_GROW(&pm, num_modules);
   if (efailed(err)) {
     err = ethru(err);
@@ -743,13 +1468,54 @@ cleanup:
   if (ctx) {
     luactx_destroy(&ctx);
   }
-  OV_ARRAY_DESTROY(&name);
-  OV_ARRAY_DESTROY(&description);
+  if (old_index) {
+    modindex_destroy(&old_index);
+  }
+  if (new_index) {
+    modindex_destroy(&new_index);
+  }
+  OV_ARRAY_DESTROY(&probed_name);
+  OV_ARRAY_DESTROY(&probed_description);
+  OV_ARRAY_DESTROY(&language);
+  OV_ARRAY_DESTROY(&index_path);
+  OV_ARRAY_DESTROY(&path);
+  OV_ARRAY_DESTROY(&cache_dir);
   OV_ARRAY_DESTROY(&dir);
   OV_ARRAY_DESTROY(&strings);
   return err;
 }
 
+static int get_modules(void *userdata) {
+  struct processor *const p = userdata;
+  struct processor_module *pm = NULL;
+  error err = processor_get_modules(p, &pm);
+  if (p->params.on_get_modules) {
+    p->params.on_get_modules(p->params.userdata, pm, err);
+  } else {
+    processor_module_destroy(&pm);
+    ereport(err);
+  }
+  return 0;
+}
+
+NODISCARD error processor_get_modules_async(struct processor *const p) {
+  if (!p) {
+    return errg(err_invalid_arugment);
+  }
+  error err = eok();
+  if (p->modules_thread_started) {
+    thrd_join(p->modules_thread, NULL);
+    p->modules_thread_started = false;
+  }
+  if (thrd_create(&p->modules_thread, get_modules, p) != thrd_success) {
+    err = emsg_i18n(err_type_generic, err_fail, gettext("Unable to create thread."));
+    goto cleanup;
+  }
+  p->modules_thread_started = true;
+cleanup:
+  return err;
+}
+
 void processor_module_destroy(struct processor_module **const pmpp) {
   if (!pmpp || !*pmpp) {
     return;
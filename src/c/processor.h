@@ -4,6 +4,7 @@
 
 #include "aviutl.h"
 #include "config.h"
+#include "metrics.h"
 
 struct processor;
 
@@ -14,11 +15,39 @@ enum processor_type {
   processor_type_json2exo = 3,
 };
 
+struct processor_module;
+struct layeralloc;
+struct layerindex;
+
+/**
+ * @brief Where the *.exo is going to be dropped, taken before the *.exo is generated.
+ */
+struct processor_placement {
+  struct layerindex *timeline; /**< Occupancy of the timeline, NULL to search free layers when dropping. */
+  int frame;                   /**< Frame to drop the *.exo at. */
+  int layer;                   /**< Layer to drop the *.exo at, 0-based. */
+};
+
+/**
+ * @brief Where the chunks of the *.exo have been dropped, shared by the on_create_exo calls of the same *.exo.
+ */
+struct processor_drop {
+  int frame;   /**< Frame the first chunk was dropped at. */
+  int layer;   /**< Layer the first chunk was dropped at, 0-based. */
+  bool placed; /**< true once frame and layer are decided by the first chunk. */
+  bool failed; /**< Set by on_create_exo if the chunk could not be dropped, the remaining chunks are skipped. */
+};
+
 struct processor_exo_info {
-  wchar_t const *exo_path;
-  int length;
+  wchar_t const *exo_path;                     /**< The whole *.exo, or a chunk of it if num_chunks is not 0. */
+  int length;                                  /**< Length of the whole *.exo, chunks keep its frames. */
   int layer_min;
   int layer_max;
+  int chunk;                                   /**< Index of the chunk, 0-based. */
+  int num_chunks;                              /**< Number of chunks, 0 if the *.exo was not split. */
+  struct processor_drop *drop;                 /**< Updated by on_create_exo. */
+  struct processor_placement const *placement; /**< NULL if the placement was not taken. */
+  struct layeralloc *layeralloc;               /**< Layers taken by alloc_layer in Lua for the placement. */
 };
 
 struct processor_params {
@@ -30,9 +59,28 @@ struct processor_params {
   void (*on_start)(void *const userdata, enum processor_type const type);
   void (*on_progress)(void *const userdata, enum processor_type const type, int const progress);
   void (*on_log_line)(void *const userdata, enum processor_type const type, wchar_t const *const message);
-  void (*on_create_exo)(void *const userdata, struct processor_exo_info const *const info);
+  /**
+   * @brief Called before the *.exo is generated to take the placement, which is owned by the processor afterwards.
+   * If it is not set or leaves the timeline NULL, layers are allocated without considering the timeline.
+   * Returns false if the placement could not be taken, for example because the application is exiting, and the run
+   * is aborted.
+   */
+  bool (*on_get_placement)(void *const userdata, struct processor_placement *const placement);
+  /**
+   * @brief Called to drop the *.exo, or once for each chunk in order if it was split.
+   * The progress is reported by on_progress between the chunks, and the remaining chunks are skipped on abort.
+   * Returns false if the *.exo was not handled, for example because the application is exiting, and the run is
+   * aborted.
+   */
+  bool (*on_create_exo)(void *const userdata, struct processor_exo_info const *const info);
   void (*on_finish)(void *const userdata, enum processor_type const type, error err);
+  /**
+   * @brief Called after each stage with its measurements, just before on_finish.
+   * The measurements are also logged and appended to the *.metrics.jsonl file next to the config.
+   */
+  void (*on_metrics)(void *const userdata, struct metrics const *const metrics);
   void (*on_complete)(void *const userdata, bool const success);
+  void (*on_get_modules)(void *const userdata, struct processor_module *const pm, error err);
 };
 
 NODISCARD error processor_create(struct processor **const pp, struct processor_params const *const params);
@@ -61,6 +109,10 @@ struct processor_module {
  * processor_get_modules populates the provided pointer with a list of available Lua modules.
  * The length of the list can be obtained using the OV_ARRAY_LENGTH macro.
  *
+ * The name and description of each module are cached in an index file next to the configuration file.
+ * The index is keyed by the module path, the last write time and size of the module file, and the UI language,
+ * so only new or changed modules are loaded again.
+ *
  * This function internally executes Lua scripts to load the modules,
  * and the on_log_line callback may be invoked during this process.
  * The callback function is called on the same thread as the caller.
@@ -71,6 +123,19 @@ struct processor_module {
  */
 NODISCARD error processor_get_modules(struct processor *const p, struct processor_module **const pmpp);
 
+/**
+ * @brief Retrieves the list of available Lua modules on a background thread.
+ *
+ * The result is passed to the on_get_modules callback, which is called on the background thread.
+ * The callback takes ownership of the list and the error.
+ * If on_get_modules is NULL, the result is discarded.
+ * The on_log_line callback may also be invoked on the background thread.
+ *
+ * @param p A pointer to the processor.
+ * @return An error code indicating whether the thread has been started.
+ */
+NODISCARD error processor_get_modules_async(struct processor *const p);
+
 /**
  * @brief Destroys the list of Lua modules.
  *
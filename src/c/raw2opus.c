@@ -20,6 +20,7 @@
 
 #include "aviutl.h"
 #include "export_audio.h"
+#include "hash.h"
 #include "i18n.h"
 
 static size_t bytes_to_human_readable(char *const buf8, uint64_t const bytes, char const decimal_point) {
@@ -72,6 +73,8 @@ static size_t bytes_to_human_readable(char *const buf8, uint64_t const bytes, ch
 struct raw2opus_context {
   struct raw2opus_params const *const params;
   size_t samples;
+  int channels;
+  uint64_t hash;
   HANDLE dest;
   OggOpusEnc *enc;
   error err;
@@ -121,6 +124,7 @@ static bool export_audio_read(void *const userdata, void *const p, size_t const
     goto cleanup;
   }
   ctx->samples += samples;
+  ctx->hash = hash_fnv1a(p, samples * (size_t)ctx->channels * sizeof(int16_t), ctx->hash);
   if (ctx->params->on_progress) {
     if (!ctx->params->on_progress(ctx->params->userdata, progress)) {
       err = errg(err_abort);
@@ -169,6 +173,7 @@ NODISCARD error raw2opus(struct raw2opus_params const *const params, struct raw2
 
   struct raw2opus_context ctx = {
       .params = params,
+      .channels = fi.audio_ch,
       .dest = dest,
       .err = eok(),
   };
@@ -246,6 +251,7 @@ NODISCARD error raw2opus(struct raw2opus_params const *const params, struct raw2
         .sample_rate = fi.audio_rate,
         .channels = fi.audio_ch,
         .samples = ctx.samples,
+        .hash = ctx.hash,
     };
   }
 cleanup:
@@ -9,6 +9,7 @@ struct raw2opus_info {
   int sample_rate; /**< Sample rate of the audio. */
   int channels;    /**< Number of audio channels. */
   size_t samples;  /**< Number of audio samples. */
+  uint64_t hash;   /**< Hash of the 16-bit PCM audio, see hash_fnv1a. */
 };
 
 /**
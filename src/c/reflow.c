@@ -0,0 +1,372 @@
+#include "reflow.h"
+
+#include <ovarray.h>
+
+#include <string.h>
+
+#include "transcript.h"
+
+struct entry {
+  double start;
+  double end;
+  uint32_t first_word;
+  uint32_t num_words;
+  uint32_t text;     // valid only if whole
+  uint32_t text_len; // valid only if whole
+  bool whole;        // the entry is an original segment as it is
+};
+
+static uint32_t decode(unsigned char const *const s, size_t const len, size_t *const n) {
+  unsigned char const c = s[0];
+  size_t sz;
+  uint32_t cp;
+  if (c < 0x80) {
+    *n = 1;
+    return c;
+  }
+  if (c >= 0xf0 && c < 0xf8) {
+    sz = 4;
+    cp = c & 0x07;
+  } else if (c >= 0xe0) {
+    sz = 3;
+    cp = c & 0x0f;
+  } else if (c >= 0xc0) {
+    sz = 2;
+    cp = c & 0x1f;
+  } else {
+    *n = 1;
+    return 0xfffd;
+  }
+  if (sz > len) {
+    *n = 1;
+    return 0xfffd;
+  }
+  for (size_t i = 1; i < sz; ++i) {
+    if ((s[i] & 0xc0) != 0x80) {
+      *n = 1;
+      return 0xfffd;
+    }
+    cp = (cp << 6) | (s[i] & 0x3f);
+  }
+  *n = sz;
+  return cp;
+}
+
+static size_t char_width(uint32_t const c) {
+  if (c < 0x20 || (c >= 0x7f && c < 0xa0)) {
+    return 0;
+  }
+  if ((c >= 0x1100 && c <= 0x115f) || (c >= 0x2e80 && c <= 0xa4cf && c != 0x303f) || (c >= 0xac00 && c <= 0xd7a3) ||
+      (c >= 0xf900 && c <= 0xfaff) || (c >= 0xfe30 && c <= 0xfe4f) || (c >= 0xff00 && c <= 0xff60) ||
+      (c >= 0xffe0 && c <= 0xffe6) || (c >= 0x1f300 && c <= 0x1f64f) || (c >= 0x1f900 && c <= 0x1f9ff) ||
+      (c >= 0x20000 && c <= 0x3fffd)) {
+    return 2;
+  }
+  return 1;
+}
+
+size_t reflow_get_width(char const *const s, size_t const len) {
+  unsigned char const *const u = (unsigned char const *)s;
+  size_t width = 0;
+  size_t pos = 0;
+  while (pos < len) {
+    size_t n;
+    width += char_width(decode(u + pos, len - pos, &n));
+    pos += n;
+  }
+  return width;
+}
+
+static bool is_space(char const c) { return c == ' ' || c == '\t' || c == '\r' || c == '\n'; }
+
+static size_t word_width(struct transcript const *const t, size_t const index, bool const first) {
+  struct transcript_word const *const w = &t->words[index];
+  char const *s = t->strings + w->word;
+  size_t len = w->word_len;
+  if (first) {
+    // The leading space separates the word from the previous one, which is not in the same line.
+    while (len && is_space(*s)) {
+      ++s;
+      --len;
+    }
+  }
+  return reflow_get_width(s, len);
+}
+
+static size_t range_width(struct transcript const *const t, size_t const first, size_t const count) {
+  size_t width = 0;
+  for (size_t i = 0; i < count; ++i) {
+    width += word_width(t, first + i, i == 0);
+  }
+  return width;
+}
+
+static bool ends_with_punctuation(struct transcript const *const t, size_t const index) {
+  struct transcript_word const *const w = &t->words[index];
+  unsigned char const *const s = (unsigned char const *)t->strings + w->word;
+  size_t len = w->word_len;
+  while (len && is_space((char)s[len - 1])) {
+    --len;
+  }
+  if (!len) {
+    return false;
+  }
+  size_t pos = len - 1;
+  while (pos > 0 && len - pos < 4 && (s[pos] & 0xc0) == 0x80) {
+    --pos;
+  }
+  size_t n;
+  switch (decode(s + pos, len - pos, &n)) {
+  case '.':
+  case ',':
+  case '!':
+  case '?':
+  case ';':
+  case ':':
+  case 0x2026: // HORIZONTAL ELLIPSIS
+  case 0x3001: // IDEOGRAPHIC COMMA
+  case 0x3002: // IDEOGRAPHIC FULL STOP
+  case 0xff01: // FULLWIDTH EXCLAMATION MARK
+  case 0xff0c: // FULLWIDTH COMMA
+  case 0xff0e: // FULLWIDTH FULL STOP
+  case 0xff1a: // FULLWIDTH COLON
+  case 0xff1b: // FULLWIDTH SEMICOLON
+  case 0xff1f: // FULLWIDTH QUESTION MARK
+    return true;
+  }
+  return false;
+}
+
+struct splitter {
+  struct transcript const *t;
+  struct reflow_params const *params;
+  struct transcript_segment const *seg;
+  struct entry *entries;
+  size_t num_entries;
+};
+
+static void emit(struct splitter *const sp, size_t const start, size_t const end) {
+  struct transcript_segment const *const seg = sp->seg;
+  struct transcript_word const *const words = sp->t->words + seg->first_word;
+  bool const whole = start == 0 && end == seg->num_words;
+  // A part of a split segment does not include the silence before the first word or after the last word.
+  sp->entries[sp->num_entries++] = (struct entry){
+      .start = whole ? seg->start : words[start].start,
+      .end = whole ? seg->end : words[end - 1].end,
+      .first_word = seg->first_word + (uint32_t)start,
+      .num_words = (uint32_t)(end - start),
+      .text = whole ? seg->text : 0,
+      .text_len = whole ? seg->text_len : 0,
+      .whole = whole,
+  };
+}
+
+static bool exceeds(struct splitter const *const sp, size_t const start, size_t const end, size_t const width) {
+  struct reflow_params const *const p = sp->params;
+  struct transcript_word const *const words = sp->t->words + sp->seg->first_word;
+  if (p->max_width > 0 && width > (size_t)p->max_width) {
+    return true;
+  }
+  if (p->max_duration > 0 && words[end - 1].end - words[start].start > p->max_duration) {
+    return true;
+  }
+  return false;
+}
+
+static void split_segment(struct splitter *const sp) {
+  struct transcript_segment const *const seg = sp->seg;
+  size_t const fw = seg->first_word;
+  size_t start = 0;
+  size_t width = 0;
+  for (size_t j = 0; j < seg->num_words; ++j) {
+    while (j > start && exceeds(sp, start, j + 1, width + word_width(sp->t, fw + j, false))) {
+      // Prefer the last punctuation in the latter half of the current part.
+      size_t brk = j;
+      for (size_t k = j - 1; k > start && (k - start) * 2 >= j - start; --k) {
+        if (ends_with_punctuation(sp->t, fw + k - 1)) {
+          brk = k;
+          break;
+        }
+      }
+      emit(sp, start, brk);
+      start = brk;
+      width = range_width(sp->t, fw + start, j - start);
+    }
+    width += word_width(sp->t, fw + j, j == start);
+  }
+  emit(sp, start, seg->num_words);
+}
+
+static bool can_merge(struct transcript const *const t,
+                      struct reflow_params const *const p,
+                      struct entry const *const a,
+                      struct entry const *const b) {
+  if (!(p->min_duration > 0) || !a->num_words || !b->num_words || a->first_word + a->num_words != b->first_word) {
+    return false;
+  }
+  if (a->end - a->start >= p->min_duration && b->end - b->start >= p->min_duration) {
+    return false;
+  }
+  // Merging across a long pause would keep the text on the screen while nobody is speaking.
+  if (p->max_merge_gap > 0 && b->start - a->end > p->max_merge_gap) {
+    return false;
+  }
+  double const end = b->end > a->end ? b->end : a->end;
+  if (p->max_duration > 0 && end - a->start > p->max_duration) {
+    return false;
+  }
+  if (p->max_width > 0 && range_width(t, a->first_word, a->num_words + b->num_words) > (size_t)p->max_width) {
+    return false;
+  }
+  return true;
+}
+
+NODISCARD error reflow_apply(struct transcript *const t, struct reflow_params const *const params) {
+  if (!t || !params || t->segment_index || t->segment_frames) {
+    return errg(err_invalid_arugment);
+  }
+  if (params->max_width <= 0 && !(params->max_duration > 0) && !(params->min_duration > 0) &&
+      !(params->min_gap > 0)) {
+    return eok();
+  }
+  struct entry *entries = NULL;
+  struct transcript_segment *segments = NULL;
+  char *strings = NULL;
+  error err = mem(&entries, t->num_segments + t->num_words + 1, sizeof(struct entry));
+  if (efailed(err)) {
+    err = ethru(err);
+    goto cleanup;
+  }
+
+  struct splitter sp = {
+      .t = t,
+      .params = params,
+      .entries = entries,
+  };
+  for (size_t i = 0; i < t->num_segments; ++i) {
+    sp.seg = &t->segments[i];
+    if (!sp.seg->num_words) {
+      entries[sp.num_entries++] = (struct entry){
+          .start = sp.seg->start,
+          .end = sp.seg->end,
+          .first_word = sp.seg->first_word,
+          .text = sp.seg->text,
+          .text_len = sp.seg->text_len,
+          .whole = true,
+      };
+      continue;
+    }
+    split_segment(&sp);
+  }
+
+  size_t n = 0;
+  for (size_t i = 0; i < sp.num_entries; ++i) {
+    if (n > 0 && can_merge(t, params, &entries[n - 1], &entries[i])) {
+      struct entry *const e = &entries[n - 1];
+      if (entries[i].end > e->end) {
+        e->end = entries[i].end;
+      }
+      e->num_words += entries[i].num_words;
+      e->whole = false;
+      continue;
+    }
+    entries[n++] = entries[i];
+  }
+
+  if (params->min_gap > 0) {
+    for (size_t i = 0; i + 1 < n; ++i) {
+      double const limit = entries[i + 1].start - params->min_gap;
+      if (entries[i].end > limit) {
+        entries[i].end = limit > entries[i].start ? limit : entries[i].start;
+      }
+    }
+  }
+
+  size_t strings_len = t->strings_len;
+  for (size_t i = 0; i < n; ++i) {
+    if (entries[i].whole) {
+      continue;
+    }
+    for (size_t j = 0; j < entries[i].num_words; ++j) {
+      strings_len += t->words[entries[i].first_word + j].word_len;
+    }
+    ++strings_len;
+  }
+  if (strings_len > UINT32_MAX) {
+    err = errg(err_not_sufficient_buffer);
+    goto cleanup;
+  }
+  err = OV_ARRAY_GROW(&strings, strings_len + 1);
+  if (efailed(err)) {
+    err = ethru(err);
+    goto cleanup;
+  }
+  err = OV_ARRAY_GROW(&segments, n + 1);
+  if (efailed(err)) {
+    err = ethru(err);
+    goto cleanup;
+  }
+  if (t->strings_len) {
+    memcpy(strings, t->strings, t->strings_len);
+  }
+  size_t pos = t->strings_len;
+  double max_time = 0;
+  for (size_t i = 0; i < n; ++i) {
+    struct entry const *const e = &entries[i];
+    uint32_t text = e->text;
+    uint32_t text_len = e->text_len;
+    if (!e->whole) {
+      size_t const begin = pos;
+      for (size_t j = 0; j < e->num_words; ++j) {
+        struct transcript_word const *const w = &t->words[e->first_word + j];
+        memcpy(strings + pos, t->strings + w->word, w->word_len);
+        pos += w->word_len;
+      }
+      size_t first = begin;
+      while (first < pos && is_space(strings[first])) {
+        ++first;
+      }
+      while (pos > first && is_space(strings[pos - 1])) {
+        --pos;
+      }
+      memmove(strings + begin, strings + first, pos - first);
+      pos = begin + (pos - first);
+      strings[pos++] = '\0';
+      text = (uint32_t)begin;
+      text_len = (uint32_t)(pos - begin - 1);
+    }
+    segments[i] = (struct transcript_segment){
+        .start = e->start,
+        .end = e->end,
+        .text = text,
+        .text_len = text_len,
+        .first_word = e->first_word,
+        .num_words = e->num_words,
+    };
+    if (e->end > max_time) {
+      max_time = e->end;
+    }
+  }
+  OV_ARRAY_SET_LENGTH(strings, pos);
+  OV_ARRAY_SET_LENGTH(segments, n);
+
+  OV_ARRAY_DESTROY(&t->reflowed_segments);
+  OV_ARRAY_DESTROY(&t->reflowed_strings);
+  t->reflowed_segments = segments;
+  t->reflowed_strings = strings;
+  t->segments = segments;
+  t->num_segments = n;
+  t->strings = strings;
+  t->strings_len = pos;
+  t->max_time = max_time;
+  segments = NULL;
+  strings = NULL;
+
+cleanup:
+  OV_ARRAY_DESTROY(&strings);
+  OV_ARRAY_DESTROY(&segments);
+  if (entries) {
+    ereport(mem_free(&entries));
+  }
+  return err;
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <ovbase.h>
+
+struct transcript;
+
+/**
+ * @brief Limits applied by reflow_apply. A zero disables the limit.
+ */
+struct reflow_params {
+  int max_width;        /**< Maximum width of a segment, where full-width characters count as 2. */
+  double max_duration;  /**< Maximum duration of a segment in seconds. */
+  double min_duration;  /**< Segments shorter than this are merged with the next one if the limits allow it. */
+  double min_gap;       /**< Minimum gap between segments in seconds, made by moving the end of the earlier one. */
+  double max_merge_gap; /**< Short segments are not merged across a gap longer than this in seconds. */
+};
+
+/**
+ * @brief Gets the display width of UTF-8 text, where full-width characters count as 2.
+ */
+size_t reflow_get_width(char const *const s, size_t const len);
+
+/**
+ * @brief Splits and merges the segments of the transcript at word boundaries to fit the limits.
+ *
+ * Long segments are split before the word that exceeds max_width or max_duration, or after an earlier word that
+ * ends with punctuation if it does not make the first part too short. The parts of a split segment start and end
+ * at their words. Short segments are merged with the next one unless they are apart by more than max_merge_gap.
+ * Segments without words are left as they are.
+ * The segments and the string pool of the transcript are replaced with reflowed ones owned by the transcript.
+ * The words are not changed, and each segment still refers to its words with first_word and num_words.
+ * @note This must be called before transcript_build_index and frametiming_compute.
+ * @param t The transcript.
+ * @param params The limits.
+ * @return An error code indicating success or failure.
+ */
+NODISCARD error reflow_apply(struct transcript *const t, struct reflow_params const *const params);
@@ -0,0 +1,257 @@
+#include <ovtest.h>
+
+#include <ovarray.h>
+
+#include "reflow.h"
+#include "transcript.h"
+
+#include <string.h>
+
+struct builder {
+  struct transcript_segment segments[16];
+  struct transcript_word words[64];
+  char strings[1024];
+  size_t num_segments;
+  size_t num_words;
+  size_t strings_len;
+};
+
+static uint32_t add_string(struct builder *const b, char const *const s) {
+  uint32_t const offset = (uint32_t)b->strings_len;
+  size_t const len = strlen(s);
+  memcpy(b->strings + b->strings_len, s, len + 1);
+  b->strings_len += len + 1;
+  return offset;
+}
+
+/**
+ * Adds a segment with NULL-terminated words, and their start and end times in pairs.
+ */
+static void add_segment(struct builder *const b,
+                        double const start,
+                        double const end,
+                        char const *const *const words,
+                        double const *const times) {
+  struct transcript_segment *const seg = &b->segments[b->num_segments++];
+  char text[256] = {0};
+  size_t n = 0;
+  for (; words[n]; ++n) {
+    strcat(text, words[n]);
+  }
+  *seg = (struct transcript_segment){
+      .start = start,
+      .end = end,
+      .text_len = (uint32_t)strlen(text),
+      .first_word = (uint32_t)b->num_words,
+      .num_words = (uint32_t)n,
+  };
+  seg->text = add_string(b, text);
+  for (size_t i = 0; i < n; ++i) {
+    struct transcript_word *const w = &b->words[b->num_words++];
+    *w = (struct transcript_word){
+        .start = times[i * 2],
+        .end = times[i * 2 + 1],
+        .word_len = (uint32_t)strlen(words[i]),
+    };
+    w->word = add_string(b, words[i]);
+  }
+}
+
+static struct transcript to_transcript(struct builder const *const b) {
+  return (struct transcript){
+      .segments = b->segments,
+      .num_segments = b->num_segments,
+      .words = b->words,
+      .num_words = b->num_words,
+      .strings = b->strings,
+      .strings_len = b->strings_len,
+  };
+}
+
+static void destroy(struct transcript *const t) {
+  OV_ARRAY_DESTROY(&t->reflowed_segments);
+  OV_ARRAY_DESTROY(&t->reflowed_strings);
+}
+
+static bool near(double const a, double const b) { return a - b < 1e-9 && b - a < 1e-9; }
+
+static bool text_is(struct transcript const *const t, size_t const index, char const *const expected) {
+  struct transcript_segment const *const s = &t->segments[index];
+  return s->text_len == strlen(expected) && strcmp(t->strings + s->text, expected) == 0;
+}
+
+static void test_reflow_get_width(void) {
+  TEST_CHECK(reflow_get_width("", 0) == 0);
+  TEST_CHECK(reflow_get_width("abc", 3) == 3);
+  TEST_CHECK(reflow_get_width("\xe3\x81\x82\xe3\x81\x84", 6) == 4);  // あい
+  TEST_CHECK(reflow_get_width("\xef\xbd\xb1", 3) == 1);              // half-width ｱ
+  TEST_CHECK(reflow_get_width("\xef\xbc\xa1" "a", 4) == 3);          // full-width Ａ
+  TEST_CHECK(reflow_get_width("\xf0\xa0\xae\xb7", 4) == 2);          // 𠮷
+  TEST_CHECK(reflow_get_width("\xe3\x81", 2) == 2);                  // broken sequence
+}
+
+static void test_reflow_split_by_width(void) {
+  struct builder b = {0};
+  add_segment(&b,
+              0.0,
+              6.0,
+              (char const *const[]){" Hello", " world,", " this", " is", " a", " test.", NULL},
+              (double const[]){0.0, 1.0, 1.0, 2.0, 2.0, 3.0, 3.0, 4.0, 4.0, 5.0, 5.0, 6.0});
+  struct transcript t = to_transcript(&b);
+  if (!TEST_SUCCEEDED_F(reflow_apply(&t, &(struct reflow_params){.max_width = 20}))) {
+    return;
+  }
+  // "Hello world, this is a" is 22 columns, and it is split after the comma rather than before "a".
+  TEST_CHECK(t.num_segments == 2);
+  TEST_CHECK(text_is(&t, 0, "Hello world,"));
+  TEST_CHECK(text_is(&t, 1, "this is a test."));
+  TEST_CHECK(near(t.segments[0].start, 0.0) && near(t.segments[0].end, 2.0));
+  TEST_CHECK(near(t.segments[1].start, 2.0) && near(t.segments[1].end, 6.0));
+  TEST_CHECK(t.segments[0].first_word == 0 && t.segments[0].num_words == 2);
+  TEST_CHECK(t.segments[1].first_word == 2 && t.segments[1].num_words == 4);
+  // The words still point to the original strings.
+  TEST_CHECK(strcmp(t.strings + t.words[3].word, " is") == 0);
+  destroy(&t);
+}
+
+static void test_reflow_split_cjk(void) {
+  struct builder b = {0};
+  // あいう、えおかきく
+  add_segment(&b,
+              0.0,
+              4.0,
+              (char const *const[]){"\xe3\x81\x82\xe3\x81\x84",
+                                    "\xe3\x81\x86\xe3\x80\x81",
+                                    "\xe3\x81\x88\xe3\x81\x8a",
+                                    "\xe3\x81\x8b\xe3\x81\x8d\xe3\x81\x8f",
+                                    NULL},
+              (double const[]){0.0, 1.0, 1.0, 2.0, 2.0, 3.0, 3.0, 4.0});
+  struct transcript t = to_transcript(&b);
+  if (!TEST_SUCCEEDED_F(reflow_apply(&t, &(struct reflow_params){.max_width = 12}))) {
+    return;
+  }
+  TEST_CHECK(t.num_segments == 2);
+  TEST_CHECK(text_is(&t, 0, "\xe3\x81\x82\xe3\x81\x84\xe3\x81\x86\xe3\x80\x81"));
+  TEST_CHECK(text_is(&t, 1, "\xe3\x81\x88\xe3\x81\x8a\xe3\x81\x8b\xe3\x81\x8d\xe3\x81\x8f"));
+  destroy(&t);
+}
+
+static void test_reflow_split_by_duration(void) {
+  struct builder b = {0};
+  add_segment(&b,
+              0.0,
+              9.0,
+              (char const *const[]){" a", " b", " c", " d", NULL},
+              (double const[]){0.0, 2.0, 2.0, 4.0, 4.0, 7.0, 7.0, 9.0});
+  struct transcript t = to_transcript(&b);
+  if (!TEST_SUCCEEDED_F(reflow_apply(&t, &(struct reflow_params){.max_duration = 5.0}))) {
+    return;
+  }
+  TEST_CHECK(t.num_segments == 2);
+  TEST_CHECK(text_is(&t, 0, "a b"));
+  TEST_CHECK(text_is(&t, 1, "c d"));
+  TEST_CHECK(near(t.max_time, 9.0));
+  destroy(&t);
+}
+
+static void test_reflow_merge(void) {
+  struct builder b = {0};
+  add_segment(&b, 0.0, 0.5, (char const *const[]){" Oh", NULL}, (double const[]){0.0, 0.5});
+  add_segment(&b, 0.6, 2.0, (char const *const[]){" really?", NULL}, (double const[]){0.6, 2.0});
+  add_segment(&b, 3.0, 5.0, (char const *const[]){" Yes.", NULL}, (double const[]){3.0, 5.0});
+  // A segment without words is kept as it is.
+  b.segments[b.num_segments++] = (struct transcript_segment){
+      .start = 5.0,
+      .end = 5.2,
+      .text = add_string(&b, " ..."),
+      .text_len = 4,
+      .first_word = (uint32_t)b.num_words,
+  };
+  struct transcript t = to_transcript(&b);
+  if (!TEST_SUCCEEDED_F(reflow_apply(&t, &(struct reflow_params){.max_width = 20, .min_duration = 1.0}))) {
+    return;
+  }
+  TEST_CHECK(t.num_segments == 3);
+  TEST_CHECK(text_is(&t, 0, "Oh really?"));
+  TEST_CHECK(near(t.segments[0].start, 0.0) && near(t.segments[0].end, 2.0) && t.segments[0].num_words == 2);
+  TEST_CHECK(text_is(&t, 1, " Yes."));
+  TEST_CHECK(text_is(&t, 2, " ..."));
+  destroy(&t);
+}
+
+static void test_reflow_split_bounds(void) {
+  struct builder b = {0};
+  add_segment(&b,
+              0.0,
+              10.0,
+              (char const *const[]){" a", " b", " c", " d", NULL},
+              (double const[]){1.0, 2.0, 2.0, 3.0, 3.0, 4.0, 7.0, 8.5});
+  struct transcript t = to_transcript(&b);
+  if (!TEST_SUCCEEDED_F(reflow_apply(&t, &(struct reflow_params){.max_duration = 4.0}))) {
+    return;
+  }
+  // The silence at both ends of the original segment is not a part of the split segments.
+  TEST_CHECK(t.num_segments == 2);
+  TEST_CHECK(near(t.segments[0].start, 1.0) && near(t.segments[0].end, 4.0));
+  TEST_CHECK(near(t.segments[1].start, 7.0) && near(t.segments[1].end, 8.5));
+  TEST_CHECK(near(t.max_time, 8.5));
+  destroy(&t);
+}
+
+static void test_reflow_merge_gap(void) {
+  struct builder b = {0};
+  add_segment(&b, 0.0, 0.5, (char const *const[]){" a", NULL}, (double const[]){0.0, 0.5});
+  add_segment(&b, 10.0, 10.5, (char const *const[]){" b", NULL}, (double const[]){10.0, 10.5});
+  add_segment(&b, 11.0, 11.5, (char const *const[]){" c", NULL}, (double const[]){11.0, 11.5});
+  struct transcript t = to_transcript(&b);
+  if (!TEST_SUCCEEDED_F(reflow_apply(&t, &(struct reflow_params){.min_duration = 1.0, .max_merge_gap = 2.0}))) {
+    return;
+  }
+  // "a" is short, but it is too far from "b" to be merged.
+  TEST_CHECK(t.num_segments == 2);
+  TEST_CHECK(text_is(&t, 0, " a"));
+  TEST_CHECK(near(t.segments[0].start, 0.0) && near(t.segments[0].end, 0.5));
+  TEST_CHECK(text_is(&t, 1, "b c"));
+  TEST_CHECK(near(t.segments[1].start, 10.0) && near(t.segments[1].end, 11.5));
+  destroy(&t);
+}
+
+static void test_reflow_min_gap(void) {
+  struct builder b = {0};
+  add_segment(&b, 0.0, 2.0, (char const *const[]){" a", NULL}, (double const[]){0.0, 2.0});
+  add_segment(&b, 2.05, 3.0, (char const *const[]){" b", NULL}, (double const[]){2.05, 3.0});
+  add_segment(&b, 3.5, 4.0, (char const *const[]){" c", NULL}, (double const[]){3.5, 4.0});
+  struct transcript t = to_transcript(&b);
+  if (!TEST_SUCCEEDED_F(reflow_apply(&t, &(struct reflow_params){.min_gap = 0.25}))) {
+    return;
+  }
+  TEST_CHECK(t.num_segments == 3);
+  TEST_CHECK(near(t.segments[0].end, 1.8));
+  TEST_CHECK(near(t.segments[1].end, 3.0));
+  destroy(&t);
+}
+
+static void test_reflow_disabled(void) {
+  struct builder b = {0};
+  add_segment(&b, 0.0, 2.0, (char const *const[]){" a", NULL}, (double const[]){0.0, 2.0});
+  struct transcript t = to_transcript(&b);
+  if (TEST_SUCCEEDED_F(reflow_apply(&t, &(struct reflow_params){0}))) {
+    TEST_CHECK(t.segments == b.segments);
+    TEST_CHECK(t.reflowed_segments == NULL);
+  }
+  TEST_EISG_F(reflow_apply(NULL, &(struct reflow_params){0}), err_invalid_arugment);
+  TEST_EISG_F(reflow_apply(&t, NULL), err_invalid_arugment);
+}
+
+TEST_LIST = {
+    {"test_reflow_get_width", test_reflow_get_width},
+    {"test_reflow_split_by_width", test_reflow_split_by_width},
+    {"test_reflow_split_cjk", test_reflow_split_cjk},
+    {"test_reflow_split_by_duration", test_reflow_split_by_duration},
+    {"test_reflow_split_bounds", test_reflow_split_bounds},
+    {"test_reflow_merge", test_reflow_merge},
+    {"test_reflow_merge_gap", test_reflow_merge_gap},
+    {"test_reflow_min_gap", test_reflow_min_gap},
+    {"test_reflow_disabled", test_reflow_disabled},
+    {NULL, NULL},
+};
@@ -0,0 +1,64 @@
+#include "strutil.h"
+
+#include <ovarray.h>
+#include <ovutil/win32.h>
+
+NODISCARD error strutil_wide_to_utf8(wchar_t const *const src, char **const dest) {
+  if (!src || !dest) {
+    return errg(err_invalid_arugment);
+  }
+  error err = eok();
+  size_t const slen = wcslen(src);
+  int const dlen = slen == 0 ? 0 : WideCharToMultiByte(CP_UTF8, 0, src, (int)slen, NULL, 0, NULL, NULL);
+  err = OV_ARRAY_GROW(dest, (size_t)(dlen + 1));
+  if (efailed(err)) {
+    err = ethru(err);
+    goto cleanup;
+  }
+  if (slen != 0) {
+    if (WideCharToMultiByte(CP_UTF8, 0, src, (int)slen, *dest, dlen, NULL, NULL) == 0) {
+      err = errhr(HRESULT_FROM_WIN32(GetLastError()));
+      goto cleanup;
+    }
+  }
+  (*dest)[dlen] = '\0';
+cleanup:
+  return err;
+}
+
+NODISCARD error strutil_utf8_to_wide(char const *const src, wchar_t **const dest) {
+  if (!src || !dest) {
+    return errg(err_invalid_arugment);
+  }
+  error err = eok();
+  size_t const slen = strlen(src);
+  int const dlen = slen == 0 ? 0 : MultiByteToWideChar(CP_UTF8, 0, src, (int)slen, NULL, 0);
+  err = OV_ARRAY_GROW(dest, (size_t)(dlen + 1));
+  if (efailed(err)) {
+    err = ethru(err);
+    goto cleanup;
+  }
+  if (slen != 0) {
+    if (MultiByteToWideChar(CP_UTF8, 0, src, (int)slen, *dest, dlen) == 0) {
+      err = errhr(HRESULT_FROM_WIN32(GetLastError()));
+      goto cleanup;
+    }
+  }
+  (*dest)[dlen] = L'\0';
+cleanup:
+  return err;
+}
+
+NODISCARD error strutil_copy(wchar_t **const dest, wchar_t const *const src) {
+  if (!dest || !src) {
+    return errg(err_invalid_arugment);
+  }
+  size_t const len = wcslen(src);
+  error err = OV_ARRAY_GROW(dest, len + 1);
+  if (efailed(err)) {
+    return ethru(err);
+  }
+  wcscpy(*dest, src);
+  OV_ARRAY_SET_LENGTH(*dest, len);
+  return eok();
+}
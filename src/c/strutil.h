@@ -0,0 +1,30 @@
+#pragma once
+
+#include <ovbase.h>
+
+/**
+ * @brief Converts a NUL-terminated UTF-16 string to UTF-8.
+ *
+ * @param src The string to convert.
+ * @param dest A pointer to an ovarray to receive the NUL-terminated result.
+ * @return An error code indicating success or failure.
+ */
+NODISCARD error strutil_wide_to_utf8(wchar_t const *const src, char **const dest);
+
+/**
+ * @brief Converts a NUL-terminated UTF-8 string to UTF-16.
+ *
+ * @param src The string to convert.
+ * @param dest A pointer to an ovarray to receive the NUL-terminated result.
+ * @return An error code indicating success or failure.
+ */
+NODISCARD error strutil_utf8_to_wide(char const *const src, wchar_t **const dest);
+
+/**
+ * @brief Copies a NUL-terminated string into an ovarray, reusing its buffer.
+ *
+ * @param dest A pointer to an ovarray to receive the copy.
+ * @param src The string to copy.
+ * @return An error code indicating success or failure.
+ */
+NODISCARD error strutil_copy(wchar_t **const dest, wchar_t const *const src);
@@ -0,0 +1,53 @@
+#include <ovtest.h>
+
+#include <ovarray.h>
+
+#include <string.h>
+
+#include "strutil.h"
+
+static void test_strutil_wide_to_utf8(void) {
+  char *s = NULL;
+  if (TEST_SUCCEEDED_F(strutil_wide_to_utf8(L"a\x3042", &s))) {
+    TEST_CHECK(strcmp(s, "a\xe3\x81\x82") == 0);
+  }
+  if (TEST_SUCCEEDED_F(strutil_wide_to_utf8(L"", &s))) {
+    TEST_CHECK(strcmp(s, "") == 0);
+  }
+  TEST_EISG_F(strutil_wide_to_utf8(NULL, &s), err_invalid_arugment);
+  OV_ARRAY_DESTROY(&s);
+}
+
+static void test_strutil_utf8_to_wide(void) {
+  wchar_t *s = NULL;
+  if (TEST_SUCCEEDED_F(strutil_utf8_to_wide("a\xe3\x81\x82", &s))) {
+    TEST_CHECK(wcscmp(s, L"a\x3042") == 0);
+  }
+  if (TEST_SUCCEEDED_F(strutil_utf8_to_wide("", &s))) {
+    TEST_CHECK(wcscmp(s, L"") == 0);
+  }
+  TEST_EISG_F(strutil_utf8_to_wide(NULL, &s), err_invalid_arugment);
+  OV_ARRAY_DESTROY(&s);
+}
+
+static void test_strutil_copy(void) {
+  wchar_t *s = NULL;
+  if (TEST_SUCCEEDED_F(strutil_copy(&s, L"hello"))) {
+    TEST_CHECK(wcscmp(s, L"hello") == 0);
+    TEST_CHECK(OV_ARRAY_LENGTH(s) == 5);
+  }
+  // The buffer is reused for a shorter string.
+  if (TEST_SUCCEEDED_F(strutil_copy(&s, L"hi"))) {
+    TEST_CHECK(wcscmp(s, L"hi") == 0);
+    TEST_CHECK(OV_ARRAY_LENGTH(s) == 2);
+  }
+  TEST_EISG_F(strutil_copy(&s, NULL), err_invalid_arugment);
+  OV_ARRAY_DESTROY(&s);
+}
+
+TEST_LIST = {
+    {"test_strutil_wide_to_utf8", test_strutil_wide_to_utf8},
+    {"test_strutil_utf8_to_wide", test_strutil_utf8_to_wide},
+    {"test_strutil_copy", test_strutil_copy},
+    {NULL, NULL},
+};
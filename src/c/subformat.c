@@ -0,0 +1,478 @@
+#include "subformat.h"
+
+#include <ovarray.h>
+#include <ovprintf.h>
+#include <ovutil/win32.h>
+
+#include "i18n.h"
+#include "transcript.h"
+
+#include <string.h>
+
+enum {
+  num_types = 3,
+  buffer_size = 64 * 1024,
+  default_width = 1920,
+  default_height = 1080,
+};
+
+struct sink {
+  enum subformat_type type;
+  char *buf;
+  size_t len;
+};
+
+struct writer {
+  struct sink sinks[num_types];
+  size_t num_sinks;
+  NODISCARD error (*write)(void *const userdata,
+                           enum subformat_type const type,
+                           char const *const data,
+                           size_t const len);
+  void *userdata;
+};
+
+static NODISCARD error flush(struct writer *const w, struct sink *const s) {
+  if (!s->len) {
+    return eok();
+  }
+  error err = w->write(w->userdata, s->type, s->buf, s->len);
+  if (efailed(err)) {
+    return ethru(err);
+  }
+  s->len = 0;
+  return eok();
+}
+
+static NODISCARD error put(struct writer *const w, struct sink *const s, char const *const p, size_t const n) {
+  if (s->len + n > buffer_size) {
+    error err = flush(w, s);
+    if (efailed(err)) {
+      return ethru(err);
+    }
+    if (n > buffer_size) {
+      err = w->write(w->userdata, s->type, p, n);
+      if (efailed(err)) {
+        return ethru(err);
+      }
+      return eok();
+    }
+  }
+  memcpy(s->buf + s->len, p, n);
+  s->len += n;
+  return eok();
+}
+
+#define PUT_LITERAL(W, S, STR) put((W), (S), (STR), sizeof(STR) - 1)
+
+static uint64_t to_units(double const t, double const units_per_second) {
+  if (!(t > 0.0)) {
+    return 0;
+  }
+  return (uint64_t)(t * units_per_second + 0.5);
+}
+
+static char *put_digits(char *p, uint64_t v, int const min_digits) {
+  char tmp[24];
+  int n = 0;
+  do {
+    tmp[n++] = (char)('0' + v % 10);
+    v /= 10;
+  } while (v);
+  while (n < min_digits) {
+    tmp[n++] = '0';
+  }
+  while (n) {
+    *p++ = tmp[--n];
+  }
+  return p;
+}
+
+/**
+ * Formats the time as "HH:MM:SS,mmm" for SRT, "HH:MM:SS.mmm" for WebVTT and "H:MM:SS.cc" for ASS.
+ */
+static size_t format_time(enum subformat_type const type, double const t, char *const buf) {
+  bool const ass = type == subformat_ass;
+  uint64_t const v = to_units(t, ass ? 100.0 : 1000.0);
+  uint64_t const frac_units = ass ? 100 : 1000;
+  uint64_t const s = v / frac_units;
+  char *p = put_digits(buf, s / 3600, ass ? 1 : 2);
+  *p++ = ':';
+  p = put_digits(p, (s / 60) % 60, 2);
+  *p++ = ':';
+  p = put_digits(p, s % 60, 2);
+  *p++ = type == subformat_srt ? ',' : '.';
+  p = put_digits(p, v % frac_units, ass ? 2 : 3);
+  return (size_t)(p - buf);
+}
+
+static NODISCARD error put_time(struct writer *const w, struct sink *const s, double const t) {
+  char buf[32];
+  return put(w, s, buf, format_time(s->type, t, buf));
+}
+
+static bool is_space(char const c) { return c == ' ' || c == '\t' || c == '\r' || c == '\n'; }
+
+static bool is_line_break(char const c) { return c == '\r' || c == '\n'; }
+
+/**
+ * Writes the text with line breaks normalized. Consecutive line breaks are merged because a blank line ends the
+ * cue in SRT and WebVTT. Characters that would be read as markup are escaped.
+ */
+static NODISCARD error put_text(struct writer *const w, struct sink *const s, char const *const text, size_t const len) {
+  error err = eok();
+  size_t pos = 0, run = 0;
+  while (pos < len) {
+    char const c = text[pos];
+    char const *repl = NULL;
+    size_t repl_len = 0;
+    size_t skip = 1;
+    if (is_line_break(c)) {
+      while (pos + skip < len && is_space(text[pos + skip])) {
+        ++skip;
+      }
+      if (s->type == subformat_ass) {
+        repl = "\\N";
+        repl_len = 2;
+      } else {
+        repl = "\r\n";
+        repl_len = 2;
+      }
+    } else if (s->type == subformat_vtt && (c == '&' || c == '<' || c == '>')) {
+      repl = c == '&' ? "&amp;" : c == '<' ? "&lt;" : "&gt;";
+      repl_len = c == '&' ? 5 : 4;
+    } else if (s->type == subformat_ass && (c == '{' || c == '}' || c == '\\')) {
+      // Braces start and end override tags, and a backslash starts an escape such as \N.
+      repl = c == '{' ? "\\{" : c == '}' ? "\\}" : "\\\\";
+      repl_len = 2;
+    }
+    if (!repl) {
+      ++pos;
+      continue;
+    }
+    err = put(w, s, text + run, pos - run);
+    if (efailed(err)) {
+      return ethru(err);
+    }
+    err = put(w, s, repl, repl_len);
+    if (efailed(err)) {
+      return ethru(err);
+    }
+    pos += skip;
+    run = pos;
+  }
+  err = put(w, s, text + run, pos - run);
+  if (efailed(err)) {
+    return ethru(err);
+  }
+  return eok();
+}
+
+static NODISCARD error put_header(struct writer *const w, struct sink *const s, int const width, int const height) {
+  switch (s->type) {
+  case subformat_srt:
+    return PUT_LITERAL(w, s, "\xef\xbb\xbf");
+  case subformat_vtt:
+    return PUT_LITERAL(w, s, "WEBVTT\r\n\r\n");
+  case subformat_ass: {
+    char buf[1024];
+    ov_snprintf(buf,
+                sizeof(buf),
+                NULL,
+                "\xef\xbb\xbf"
+                "[Script Info]\r\n"
+                "ScriptType: v4.00+\r\n"
+                "PlayResX: %d\r\n"
+                "PlayResY: %d\r\n"
+                "WrapStyle: 0\r\n"
+                "ScaledBorderAndShadow: yes\r\n"
+                "\r\n"
+                "[V4+ Styles]\r\n"
+                "Format: Name, Fontname, Fontsize, PrimaryColour, SecondaryColour, OutlineColour, "
+                "BackColour, Bold, Italic, Underline, StrikeOut, ScaleX, ScaleY, Spacing, Angle, "
+                "BorderStyle, Outline, Shadow, Alignment, MarginL, MarginR, MarginV, Encoding\r\n"
+                "Style: Default,Arial,%d,&H00FFFFFF,&H000000FF,&H00000000,&H80000000,"
+                "0,0,0,0,100,100,0,0,1,%d,0,2,%d,%d,%d,1\r\n"
+                "\r\n"
+                "[Events]\r\n"
+                "Format: Layer, Start, End, Style, Name, MarginL, MarginR, MarginV, Effect, Text\r\n",
+                width,
+                height,
+                height / 15,
+                height / 360 > 1 ? height / 360 : 1,
+                width / 32,
+                width / 32,
+                height / 20);
+    return put(w, s, buf, strlen(buf));
+  }
+  case subformat_all:
+    break;
+  }
+  return errg(err_invalid_arugment);
+}
+
+static NODISCARD error put_cue(struct writer *const w,
+                               struct sink *const s,
+                               size_t const number,
+                               double const start,
+                               double const end,
+                               char const *const text,
+                               size_t const text_len) {
+  error err = eok();
+  char buf[32];
+  switch (s->type) {
+  case subformat_srt:
+  case subformat_vtt:
+    if (s->type == subformat_srt) {
+      char *const p = put_digits(buf, number, 1);
+      *p = '\r';
+      p[1] = '\n';
+      err = put(w, s, buf, (size_t)(p + 2 - buf));
+      if (efailed(err)) {
+        return ethru(err);
+      }
+    }
+    err = put_time(w, s, start);
+    if (efailed(err)) {
+      return ethru(err);
+    }
+    err = PUT_LITERAL(w, s, " --> ");
+    if (efailed(err)) {
+      return ethru(err);
+    }
+    err = put_time(w, s, end);
+    if (efailed(err)) {
+      return ethru(err);
+    }
+    err = PUT_LITERAL(w, s, "\r\n");
+    if (efailed(err)) {
+      return ethru(err);
+    }
+    err = put_text(w, s, text, text_len);
+    if (efailed(err)) {
+      return ethru(err);
+    }
+    err = PUT_LITERAL(w, s, "\r\n\r\n");
+    if (efailed(err)) {
+      return ethru(err);
+    }
+    break;
+  case subformat_ass:
+    err = PUT_LITERAL(w, s, "Dialogue: 0,");
+    if (efailed(err)) {
+      return ethru(err);
+    }
+    err = put_time(w, s, start);
+    if (efailed(err)) {
+      return ethru(err);
+    }
+    err = PUT_LITERAL(w, s, ",");
+    if (efailed(err)) {
+      return ethru(err);
+    }
+    err = put_time(w, s, end);
+    if (efailed(err)) {
+      return ethru(err);
+    }
+    err = PUT_LITERAL(w, s, ",Default,,0,0,0,,");
+    if (efailed(err)) {
+      return ethru(err);
+    }
+    err = put_text(w, s, text, text_len);
+    if (efailed(err)) {
+      return ethru(err);
+    }
+    err = PUT_LITERAL(w, s, "\r\n");
+    if (efailed(err)) {
+      return ethru(err);
+    }
+    break;
+  case subformat_all:
+    return errg(err_invalid_arugment);
+  }
+  return eok();
+}
+
+NODISCARD error subformat_write(struct transcript const *const t,
+                                int const formats,
+                                int const width,
+                                int const height,
+                                NODISCARD error (*write)(void *const userdata,
+                                                         enum subformat_type const type,
+                                                         char const *const data,
+                                                         size_t const len),
+                                void *const userdata) {
+  if (!t || !write || (formats & ~subformat_all)) {
+    return errg(err_invalid_arugment);
+  }
+  static enum subformat_type const types[num_types] = {subformat_srt, subformat_vtt, subformat_ass};
+  struct writer w = {
+      .write = write,
+      .userdata = userdata,
+  };
+  error err = eok();
+  for (size_t i = 0; i < num_types; ++i) {
+    if (!(formats & (int)types[i])) {
+      continue;
+    }
+    struct sink *const s = &w.sinks[w.num_sinks++];
+    *s = (struct sink){.type = types[i]};
+    err = mem(&s->buf, buffer_size, sizeof(char));
+    if (efailed(err)) {
+      err = ethru(err);
+      goto cleanup;
+    }
+    err = put_header(&w, s, width > 0 ? width : default_width, height > 0 ? height : default_height);
+    if (efailed(err)) {
+      err = ethru(err);
+      goto cleanup;
+    }
+  }
+
+  size_t number = 0;
+  for (size_t i = 0; w.num_sinks && i < t->num_segments; ++i) {
+    struct transcript_segment const *const seg = &t->segments[i];
+    char const *text = t->strings + seg->text;
+    size_t len = seg->text_len;
+    while (len && is_space(*text)) {
+      ++text;
+      --len;
+    }
+    while (len && is_space(text[len - 1])) {
+      --len;
+    }
+    if (!len) {
+      continue;
+    }
+    ++number;
+    double const end = seg->end > seg->start ? seg->end : seg->start;
+    for (size_t j = 0; j < w.num_sinks; ++j) {
+      err = put_cue(&w, &w.sinks[j], number, seg->start, end, text, len);
+      if (efailed(err)) {
+        err = ethru(err);
+        goto cleanup;
+      }
+    }
+  }
+  for (size_t i = 0; i < w.num_sinks; ++i) {
+    err = flush(&w, &w.sinks[i]);
+    if (efailed(err)) {
+      err = ethru(err);
+      goto cleanup;
+    }
+  }
+
+cleanup:
+  for (size_t i = 0; i < w.num_sinks; ++i) {
+    if (w.sinks[i].buf) {
+      ereport(mem_free(&w.sinks[i].buf));
+    }
+  }
+  return err;
+}
+
+static wchar_t const *get_extension(enum subformat_type const type) {
+  switch (type) {
+  case subformat_srt:
+    return L".srt";
+  case subformat_vtt:
+    return L".vtt";
+  case subformat_ass:
+    return L".ass";
+  case subformat_all:
+    break;
+  }
+  return NULL;
+}
+
+NODISCARD error subformat_get_path(wchar_t const *const base_path, enum subformat_type const type, wchar_t **const dest) {
+  wchar_t const *const ext = get_extension(type);
+  if (!base_path || !ext || !dest) {
+    return errg(err_invalid_arugment);
+  }
+  wchar_t const *const sep = wcsrchr(base_path, L'\\');
+  wchar_t const *const dot = wcsrchr(sep ? sep : base_path, L'.');
+  size_t const base_len = dot ? (size_t)(dot - base_path) : wcslen(base_path);
+  size_t const ext_len = wcslen(ext);
+  error err = OV_ARRAY_GROW(dest, base_len + ext_len + 1);
+  if (efailed(err)) {
+    return ethru(err);
+  }
+  memcpy(*dest, base_path, base_len * sizeof(wchar_t));
+  memcpy(*dest + base_len, ext, (ext_len + 1) * sizeof(wchar_t));
+  OV_ARRAY_SET_LENGTH(*dest, base_len + ext_len);
+  return eok();
+}
+
+struct files {
+  HANDLE handles[num_types];
+};
+
+static size_t type_to_index(enum subformat_type const type) {
+  return type == subformat_srt ? 0 : type == subformat_vtt ? 1 : 2;
+}
+
+static NODISCARD error write_file(void *const userdata,
+                                  enum subformat_type const type,
+                                  char const *const data,
+                                  size_t const len) {
+  struct files const *const f = userdata;
+  HANDLE const h = f->handles[type_to_index(type)];
+  DWORD written = 0;
+  if (!WriteFile(h, data, (DWORD)len, &written, NULL)) {
+    return errhr(HRESULT_FROM_WIN32(GetLastError()));
+  }
+  if (written != (DWORD)len) {
+    return emsg_i18n(err_type_generic, err_fail, gettext("Unable to write the entire file."));
+  }
+  return eok();
+}
+
+NODISCARD error subformat_write_files(struct transcript const *const t,
+                                      int const formats,
+                                      int const width,
+                                      int const height,
+                                      wchar_t const *const base_path) {
+  if (!t || !base_path || (formats & ~subformat_all)) {
+    return errg(err_invalid_arugment);
+  }
+  static enum subformat_type const types[num_types] = {subformat_srt, subformat_vtt, subformat_ass};
+  struct files f;
+  wchar_t *paths[num_types] = {0};
+  for (size_t i = 0; i < num_types; ++i) {
+    f.handles[i] = INVALID_HANDLE_VALUE;
+  }
+  error err = eok();
+  for (size_t i = 0; i < num_types; ++i) {
+    if (!(formats & (int)types[i])) {
+      continue;
+    }
+    err = subformat_get_path(base_path, types[i], &paths[i]);
+    if (efailed(err)) {
+      err = ethru(err);
+      goto cleanup;
+    }
+    f.handles[i] = CreateFileW(paths[i], GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (f.handles[i] == INVALID_HANDLE_VALUE) {
+      err = errhr(HRESULT_FROM_WIN32(GetLastError()));
+      goto cleanup;
+    }
+  }
+  err = subformat_write(t, formats, width, height, write_file, &f);
+  if (efailed(err)) {
+    err = ethru(err);
+    goto cleanup;
+  }
+
+cleanup:
+  for (size_t i = 0; i < num_types; ++i) {
+    if (f.handles[i] != INVALID_HANDLE_VALUE) {
+      CloseHandle(f.handles[i]);
+      if (efailed(err)) {
+        DeleteFileW(paths[i]);
+      }
+    }
+    OV_ARRAY_DESTROY(&paths[i]);
+  }
+  return err;
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <ovbase.h>
+
+struct transcript;
+
+/**
+ * @brief Subtitle formats written next to the *.exo, combined as a bit set.
+ */
+enum subformat_type {
+  subformat_srt = 1, /**< SubRip, *.srt */
+  subformat_vtt = 2, /**< WebVTT, *.vtt */
+  subformat_ass = 4, /**< Advanced SubStation Alpha, *.ass */
+  subformat_all = subformat_srt | subformat_vtt | subformat_ass,
+};
+
+/**
+ * @brief Writes the segments of the transcript in the given formats.
+ *
+ * All formats are generated in a single pass over the segments, and each format is buffered separately so that
+ * the callback receives large chunks. Segments with empty text are skipped.
+ * @param t The transcript.
+ * @param formats A bit set of enum subformat_type.
+ * @param width Width of the video, used as PlayResX of *.ass. 0 to use 1920.
+ * @param height Height of the video, used as PlayResY of *.ass. 0 to use 1080.
+ * @param write Callback function that receives the UTF-8 encoded text of each format.
+ * @param userdata User-defined data passed to the callback.
+ * @return An error object indicating the success or failure of the process.
+ */
+NODISCARD error subformat_write(struct transcript const *const t,
+                                int const formats,
+                                int const width,
+                                int const height,
+                                NODISCARD error (*write)(void *const userdata,
+                                                         enum subformat_type const type,
+                                                         char const *const data,
+                                                         size_t const len),
+                                void *const userdata);
+
+/**
+ * @brief Gets the path of the subtitle file by replacing the extension of base_path.
+ *
+ * @param base_path Path of the *.exo file.
+ * @param type One of enum subformat_type.
+ * @param dest A pointer to an ovarray to receive the path.
+ * @return An error object indicating the success or failure of the process.
+ */
+NODISCARD error subformat_get_path(wchar_t const *const base_path, enum subformat_type const type, wchar_t **const dest);
+
+/**
+ * @brief Writes the subtitle files next to base_path, see subformat_write and subformat_get_path.
+ *
+ * If an error occurs, the files created by this function are deleted.
+ */
+NODISCARD error subformat_write_files(struct transcript const *const t,
+                                      int const formats,
+                                      int const width,
+                                      int const height,
+                                      wchar_t const *const base_path);
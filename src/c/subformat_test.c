@@ -0,0 +1,185 @@
+#include <ovtest.h>
+
+#include <ovarray.h>
+
+#include "subformat.h"
+#include "transcript.h"
+
+#include <string.h>
+
+struct outputs {
+  char *text[3];
+};
+
+static size_t type_index(enum subformat_type const type) {
+  return type == subformat_srt ? 0 : type == subformat_vtt ? 1 : 2;
+}
+
+static NODISCARD error
+collect(void *const userdata, enum subformat_type const type, char const *const data, size_t const len) {
+  struct outputs *const o = userdata;
+  char **const dest = &o->text[type_index(type)];
+  size_t const cur = OV_ARRAY_LENGTH(*dest);
+  error err = OV_ARRAY_GROW(dest, cur + len + 1);
+  if (efailed(err)) {
+    return ethru(err);
+  }
+  memcpy(*dest + cur, data, len);
+  (*dest)[cur + len] = '\0';
+  OV_ARRAY_SET_LENGTH(*dest, cur + len);
+  return eok();
+}
+
+static void destroy_outputs(struct outputs *const o) {
+  for (size_t i = 0; i < 3; ++i) {
+    OV_ARRAY_DESTROY(&o->text[i]);
+  }
+}
+
+static char const g_strings[] = " Hello & <world>\0"
+                                "\0"
+                                "line1\r\n\r\n line2 \0"
+                                "late";
+
+static struct transcript_segment const g_segments[] = {
+    {.start = 0.5, .end = 1.2346, .text = 0, .text_len = 16},
+    {.start = 2.0, .end = 3.0, .text = 17, .text_len = 0},
+    {.start = 3.0, .end = 2.0, .text = 18, .text_len = 16},
+    {.start = 3725.999, .end = 3726.0, .text = 35, .text_len = 4},
+};
+
+static struct transcript const g_transcript = {
+    .segments = g_segments,
+    .num_segments = sizeof(g_segments) / sizeof(g_segments[0]),
+    .strings = g_strings,
+    .strings_len = sizeof(g_strings),
+};
+
+static void test_subformat_srt(void) {
+  struct outputs o = {0};
+  if (TEST_SUCCEEDED_F(subformat_write(&g_transcript, subformat_srt, 0, 0, collect, &o))) {
+    static char const expected[] = "\xef\xbb\xbf"
+                                   "1\r\n00:00:00,500 --> 00:00:01,235\r\nHello & <world>\r\n\r\n"
+                                   "2\r\n00:00:03,000 --> 00:00:03,000\r\nline1\r\nline2\r\n\r\n"
+                                   "3\r\n01:02:05,999 --> 01:02:06,000\r\nlate\r\n\r\n";
+    TEST_CHECK(o.text[0] && strcmp(o.text[0], expected) == 0);
+    TEST_MSG("got %s", o.text[0]);
+    TEST_CHECK(o.text[1] == NULL && o.text[2] == NULL);
+  }
+  destroy_outputs(&o);
+}
+
+static void test_subformat_vtt(void) {
+  struct outputs o = {0};
+  if (TEST_SUCCEEDED_F(subformat_write(&g_transcript, subformat_vtt, 0, 0, collect, &o))) {
+    static char const expected[] = "WEBVTT\r\n\r\n"
+                                   "00:00:00.500 --> 00:00:01.235\r\nHello &amp; &lt;world&gt;\r\n\r\n"
+                                   "00:00:03.000 --> 00:00:03.000\r\nline1\r\nline2\r\n\r\n"
+                                   "01:02:05.999 --> 01:02:06.000\r\nlate\r\n\r\n";
+    TEST_CHECK(o.text[1] && strcmp(o.text[1], expected) == 0);
+    TEST_MSG("got %s", o.text[1]);
+  }
+  destroy_outputs(&o);
+}
+
+static void test_subformat_ass(void) {
+  struct outputs o = {0};
+  if (TEST_SUCCEEDED_F(subformat_write(&g_transcript, subformat_ass, 1280, 720, collect, &o))) {
+    TEST_CHECK(o.text[2] && strstr(o.text[2], "PlayResX: 1280\r\nPlayResY: 720\r\n") != NULL);
+    static char const events[] = "Dialogue: 0,0:00:00.50,0:00:01.23,Default,,0,0,0,,Hello & <world>\r\n"
+                                 "Dialogue: 0,0:00:03.00,0:00:03.00,Default,,0,0,0,,line1\\Nline2\r\n"
+                                 "Dialogue: 0,1:02:06.00,1:02:06.00,Default,,0,0,0,,late\r\n";
+    char const *const p = o.text[2] ? strstr(o.text[2], "Dialogue: ") : NULL;
+    TEST_CHECK(p && strcmp(p, events) == 0);
+    TEST_MSG("got %s", p);
+  }
+  destroy_outputs(&o);
+}
+
+static void test_subformat_ass_escape(void) {
+  static char const strings[] = "{\\i1}a\\Nb}\0";
+  static struct transcript_segment const segments[] = {
+      {.start = 0.0, .end = 1.0, .text = 0, .text_len = sizeof(strings) - 2},
+  };
+  struct transcript const t = {
+      .segments = segments,
+      .num_segments = 1,
+      .strings = strings,
+      .strings_len = sizeof(strings),
+  };
+  struct outputs o = {0};
+  if (TEST_SUCCEEDED_F(subformat_write(&t, subformat_ass, 1280, 720, collect, &o))) {
+    // The text is shown as is instead of being read as override tags and a line break.
+    static char const events[] = "Dialogue: 0,0:00:00.00,0:00:01.00,Default,,0,0,0,,\\{\\\\i1\\}a\\\\Nb\\}\r\n";
+    char const *const p = o.text[2] ? strstr(o.text[2], "Dialogue: ") : NULL;
+    TEST_CHECK(p && strcmp(p, events) == 0);
+    TEST_MSG("got %s", p);
+  }
+  destroy_outputs(&o);
+}
+
+static void test_subformat_all(void) {
+  struct outputs o = {0};
+  if (TEST_SUCCEEDED_F(subformat_write(&g_transcript, subformat_all, 0, 0, collect, &o))) {
+    TEST_CHECK(o.text[0] && o.text[1] && o.text[2]);
+    TEST_CHECK(o.text[2] && strstr(o.text[2], "PlayResX: 1920\r\nPlayResY: 1080\r\n") != NULL);
+  }
+  destroy_outputs(&o);
+}
+
+static void test_subformat_large(void) {
+  // Enough cues to flush the buffers several times.
+  enum { n = 20000 };
+  struct transcript_segment *segments = NULL;
+  struct outputs o = {0};
+  if (!TEST_SUCCEEDED_F(mem(&segments, n, sizeof(struct transcript_segment)))) {
+    return;
+  }
+  for (size_t i = 0; i < n; ++i) {
+    segments[i] = (struct transcript_segment){.start = (double)i, .end = (double)i + 0.5, .text = 35, .text_len = 4};
+  }
+  struct transcript t = g_transcript;
+  t.segments = segments;
+  t.num_segments = n;
+  if (TEST_SUCCEEDED_F(subformat_write(&t, subformat_srt, 0, 0, collect, &o))) {
+    TEST_CHECK(o.text[0] && strstr(o.text[0], "\r\n20000\r\n05:33:19,000 --> 05:33:19,500\r\nlate\r\n\r\n") != NULL);
+  }
+  destroy_outputs(&o);
+  ereport(mem_free(&segments));
+}
+
+static void test_subformat_get_path(void) {
+  static struct {
+    wchar_t const *input;
+    enum subformat_type type;
+    wchar_t const *expected;
+  } const tests[] = {
+      {L"C:\\temp\\a.exo", subformat_srt, L"C:\\temp\\a.srt"},
+      {L"C:\\temp\\a.exo", subformat_vtt, L"C:\\temp\\a.vtt"},
+      {L"C:\\temp\\a.exo", subformat_ass, L"C:\\temp\\a.ass"},
+      {L"C:\\temp.dir\\a", subformat_srt, L"C:\\temp.dir\\a.srt"},
+  };
+  for (size_t i = 0; i < sizeof(tests) / sizeof(tests[0]); ++i) {
+    wchar_t *path = NULL;
+    if (TEST_SUCCEEDED_F(subformat_get_path(tests[i].input, tests[i].type, &path))) {
+      TEST_CHECK(wcscmp(path, tests[i].expected) == 0);
+      TEST_MSG("expected %ls, got %ls", tests[i].expected, path);
+      TEST_CHECK(OV_ARRAY_LENGTH(path) == wcslen(tests[i].expected));
+    }
+    OV_ARRAY_DESTROY(&path);
+  }
+  wchar_t *path = NULL;
+  TEST_EISG_F(subformat_get_path(L"a.exo", subformat_all, &path), err_invalid_arugment);
+  TEST_EISG_F(subformat_write(&g_transcript, 8, 0, 0, collect, NULL), err_invalid_arugment);
+}
+
+TEST_LIST = {
+    {"test_subformat_srt", test_subformat_srt},
+    {"test_subformat_vtt", test_subformat_vtt},
+    {"test_subformat_ass", test_subformat_ass},
+    {"test_subformat_ass_escape", test_subformat_ass_escape},
+    {"test_subformat_all", test_subformat_all},
+    {"test_subformat_large", test_subformat_large},
+    {"test_subformat_get_path", test_subformat_get_path},
+    {NULL, NULL},
+};
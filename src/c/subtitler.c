@@ -1,5 +1,7 @@
 #include <ovbase.h>
 
+#include <stdatomic.h>
+
 #include <ovarray.h>
 #include <ovprintf.h>
 #include <ovthreads.h>
@@ -9,13 +11,19 @@
 #include "aviutl.h"
 #include "i18n.h"
 #include "json2exo.h"
+#include "layeralloc.h"
+#include "layerindex.h"
+#include "logring.h"
+#include "logstore.h"
 #include "luactx.h"
 #include "opus2json.h"
 #include "path.h"
 #include "processor.h"
+#include "subformat.h"
 #include "version.h"
 
 #include <commctrl.h>
+#include <windowsx.h>
 
 enum {
   id_btn_start = 1,
@@ -29,14 +37,21 @@ enum {
   id_btn_model_dir = 9,
   id_tab = 100,
   id_tmr_progress = 101,
+  id_mnu_save_log = 102,
+
+  log_ring_capacity = 4096,
+  log_store_lines = 128 * 1024,
+  log_store_chars = 8 * 1024 * 1024,
 
   WM_PROCESS_START = WM_USER + 0x1000,
   WM_PROCESS_PROGRESS = WM_USER + 0x1001,
-  WM_PROCESS_LOG_LINE = WM_USER + 0x1002,
+  WM_PROCESS_LOG = WM_USER + 0x1002,
   WM_PROCESS_CREATE_EXO = WM_USER + 0x1003,
   WM_PROCESS_FINISHED = WM_USER + 0x1004,
   WM_PROCESS_COMPLETE = WM_USER + 0x1005,
   WM_PROCESS_UPDATED = WM_USER + 0x1006,
+  WM_PROCESS_MODULES = WM_USER + 0x1007,
+  WM_PROCESS_GET_PLACEMENT = WM_USER + 0x1008,
 };
 
 enum gui_state {
@@ -78,6 +93,10 @@ static HWND g_lbl_insert_mode = NULL;
 static HWND g_cmb_insert_mode = NULL;
 static HWND g_lbl_module = NULL;
 static HWND g_cmb_module = NULL;
+static HWND g_lbl_sidecar = NULL;
+static HWND g_chk_srt = NULL;
+static HWND g_chk_vtt = NULL;
+static HWND g_chk_ass = NULL;
 static HWND g_btn_start = NULL;
 
 static HWND g_lbl_exe_path = NULL;
@@ -102,10 +121,14 @@ static HWND g_logview = NULL;
 static mtx_t g_mtx;
 static cnd_t g_cnd;
 static struct mo *g_mp = NULL;
-static bool g_log_processed = false;
+static struct logring *g_log_ring = NULL;
+static atomic_bool g_log_posted;
 static bool g_exo_processed = false;
+static bool g_exiting = false;
 static DWORD g_gui_thread_id = 0;
-static wchar_t *g_log_buffer = NULL;
+static struct logstore *g_log_store = NULL;
+static size_t g_log_view_count = 0;
+static uint64_t g_log_view_evicted = 0;
 
 static struct progress {
   ULONGLONG started_at;
@@ -120,6 +143,7 @@ static struct progress {
 
 static struct processor *g_processor = NULL;
 static struct processor_module *g_modules = NULL;
+static bool g_modules_requested = false;
 static HWND *g_disabled_windows = NULL;
 
 static void update_state(enum gui_state const s);
@@ -148,6 +172,10 @@ static NODISCARD error config_to_gui(struct config const *const cfg, bool const
     v = 1;
   }
   SendMessageW(g_cmb_insert_mode, CB_SETCURSEL, (WPARAM)(v - 1), 0);
+  v = config_get_sidecar_formats(cfg);
+  SendMessageW(g_chk_srt, BM_SETCHECK, (v & subformat_srt) ? BST_CHECKED : BST_UNCHECKED, 0);
+  SendMessageW(g_chk_vtt, BM_SETCHECK, (v & subformat_vtt) ? BST_CHECKED : BST_UNCHECKED, 0);
+  SendMessageW(g_chk_ass, BM_SETCHECK, (v & subformat_ass) ? BST_CHECKED : BST_UNCHECKED, 0);
 
   if (!apply_to_main_cfg) {
     goto cleanup;
@@ -175,6 +203,7 @@ static NODISCARD error config_to_gui(struct config const *const cfg, bool const
   SET_STRING_ITEM(initial_prompt);
   SET_INT_ITEM(insert_position);
   SET_INT_ITEM(insert_mode);
+  SET_INT_ITEM(sidecar_formats);
 #undef SET_STRING_ITEM
 #undef SET_INT_ITEM
 cleanup:
@@ -221,6 +250,15 @@ static NODISCARD error gui_to_config(struct config *const cfg) {
   SET_INT_ITEM(g_cmb_insert_mode, config_set_insert_mode);
 #undef SET_STRING_ITEM
 #undef SET_INT_ITEM
+  err = config_set_sidecar_formats(
+      cfg,
+      (SendMessageW(g_chk_srt, BM_GETCHECK, 0, 0) == BST_CHECKED ? subformat_srt : 0) |
+          (SendMessageW(g_chk_vtt, BM_GETCHECK, 0, 0) == BST_CHECKED ? subformat_vtt : 0) |
+          (SendMessageW(g_chk_ass, BM_GETCHECK, 0, 0) == BST_CHECKED ? subformat_ass : 0));
+  if (efailed(err)) {
+    err = ethru(err);
+    goto cleanup;
+  }
   int const index = SendMessageW(g_cmb_module, CB_GETCURSEL, 0, 0);
   if (index != CB_ERR) {
     err = config_set_module(cfg, g_modules[index].module);
@@ -343,32 +381,66 @@ static void update_title(void) {
   SetWindowTextW(aviutl_get_my_window(), buf);
 }
 
-static void add_log(wchar_t const *const message) {
-  size_t len = wcslen(message);
-  error err = OV_ARRAY_GROW(&g_log_buffer, len + 32);
+static void insert_log(void *const userdata, SYSTEMTIME const *const st, wchar_t const *const message) {
+  (void)userdata;
+  if (!g_log_store) {
+    return;
+  }
+  error err = logstore_add(g_log_store, st, message);
   if (efailed(err)) {
     ereport(err);
+  }
+}
+
+/**
+ * Tells the virtual list view about new lines, and follows the end only if the last line was visible.
+ */
+static void refresh_log(void) {
+  size_t const count = logstore_count(g_log_store);
+  uint64_t const evicted = logstore_evicted(g_log_store);
+  if (count == g_log_view_count && evicted == g_log_view_evicted) {
     return;
   }
+  int const top = ListView_GetTopIndex(g_logview);
+  int const per_page = ListView_GetCountPerPage(g_logview);
+  bool const follow = (size_t)(top + per_page) >= g_log_view_count;
+  // Evicted lines shift every index, so only appends can keep the rows already drawn.
+  ListView_SetItemCountEx(
+      g_logview, (int)count, evicted == g_log_view_evicted ? LVSICF_NOINVALIDATEALL | LVSICF_NOSCROLL : 0);
+  if (follow && count) {
+    ListView_EnsureVisible(g_logview, (int)count - 1, FALSE);
+  }
+  g_log_view_count = count;
+  g_log_view_evicted = evicted;
+}
+
+static void add_log(wchar_t const *const message) {
   SYSTEMTIME st;
   GetLocalTime(&st);
-  int n = wsprintfW(g_log_buffer,
-                    L"%04d-%02d-%02d %02d:%02d:%02d.%03d  ",
-                    st.wYear,
-                    st.wMonth,
-                    st.wDay,
-                    st.wHour,
-                    st.wMinute,
-                    st.wSecond,
-                    st.wMilliseconds);
-  wcscpy(g_log_buffer + n, message);
-  SendMessageW(g_logview, LB_ADDSTRING, 0, (LPARAM)g_log_buffer);
-  int count = SendMessageW(g_logview, LB_GETCOUNT, 0, 0);
-  if (count > 1024) {
-    SendMessageW(g_logview, LB_DELETESTRING, 0, 0);
-    --count;
-  }
-  SendMessageW(g_logview, LB_SETCURSEL, (WPARAM)(count - 1), 0);
+  insert_log(NULL, &st, message);
+  refresh_log();
+}
+
+/**
+ * Inserts the lines queued by the worker threads in one batch.
+ */
+static void drain_log(void) {
+  // Clear the flag first so that a line queued during the drain posts another message.
+  atomic_store(&g_log_posted, false);
+  logring_drain(g_log_ring, insert_log, NULL);
+  size_t const dropped = logring_take_dropped(g_log_ring);
+  if (dropped) {
+    wchar_t buf[256];
+    mo_snprintf_wchar(buf,
+                      sizeof(buf) / sizeof(buf[0]),
+                      L"%1$d",
+                      gettext("%1$d log lines were dropped because they were written faster than they could be shown."),
+                      (int)dropped);
+    SYSTEMTIME st;
+    GetLocalTime(&st);
+    insert_log(NULL, &st, buf);
+  }
+  refresh_log();
 }
 
 static void on_start(void *const userdata, enum processor_type const type) {
@@ -395,32 +467,46 @@ static void on_progress(void *const userdata, enum processor_type const type, in
   mtx_unlock(&g_mtx);
 }
 
-static void on_create_exo(void *const userdata, struct processor_exo_info const *const info) {
+static bool on_get_placement(void *const userdata, struct processor_placement *const placement) {
+  mtx_lock(&g_mtx);
+  g_exo_processed = false;
+  PostMessageW(aviutl_get_my_window(), WM_PROCESS_GET_PLACEMENT, (WPARAM)userdata, (LPARAM)placement);
+  while (!g_exo_processed && !g_exiting) {
+    cnd_wait(&g_cnd, &g_mtx);
+  }
+  bool const processed = g_exo_processed;
+  mtx_unlock(&g_mtx);
+  return processed;
+}
+
+static bool on_create_exo(void *const userdata, struct processor_exo_info const *const info) {
   mtx_lock(&g_mtx);
   g_exo_processed = false;
   PostMessageW(aviutl_get_my_window(), WM_PROCESS_CREATE_EXO, (WPARAM)userdata, (LPARAM)info);
-  while (!g_exo_processed) {
+  while (!g_exo_processed && !g_exiting) {
     cnd_wait(&g_cnd, &g_mtx);
   }
+  bool const processed = g_exo_processed;
   mtx_unlock(&g_mtx);
+  return processed;
 }
 
 static void on_log_line(void *const userdata, enum processor_type const type, wchar_t const *const message) {
+  (void)userdata;
   (void)type;
+  // Lines are queued without waiting for the GUI thread, and a line that does not fit is counted as dropped.
+  SYSTEMTIME st;
+  GetLocalTime(&st);
+  logring_push(g_log_ring, &st, message);
   if (g_gui_thread_id == GetCurrentThreadId()) {
-    // When creating a list of Lua modules, this callback function is called from the calling thread.
-    // In that case, it is not possible to wait for the completion of PostMessage with cnd_wait,
-    // so process it with SendMessage.
-    SendMessageW(aviutl_get_my_window(), WM_PROCESS_LOG_LINE, (WPARAM)userdata, (LPARAM)message);
+    // When creating a list of Lua modules, this callback function may be called from the GUI thread.
+    drain_log();
     return;
   }
-  mtx_lock(&g_mtx);
-  g_log_processed = false;
-  PostMessageW(aviutl_get_my_window(), WM_PROCESS_LOG_LINE, (WPARAM)userdata, (LPARAM)message);
-  while (!g_log_processed) {
-    cnd_wait(&g_cnd, &g_mtx);
+  // Only the first line since the last drain posts a message, the rest are picked up by the same drain.
+  if (!atomic_exchange(&g_log_posted, true)) {
+    PostMessageW(aviutl_get_my_window(), WM_PROCESS_LOG, 0, 0);
   }
-  mtx_unlock(&g_mtx);
 }
 
 static void on_finish(void *const userdata, enum processor_type const type, error e) {
@@ -432,26 +518,94 @@ static void on_complete(void *const userdata, bool const success) {
   PostMessageW(aviutl_get_my_window(), WM_PROCESS_COMPLETE, (WPARAM)userdata, (LPARAM)success);
 }
 
-static void
-create_exo(void *const userdata, struct processor_exo_info const *const info, FILTER *const fp, void *const editp) {
+static void on_get_modules(void *const userdata, struct processor_module *pm, error err) {
+  (void)userdata;
+  // The message owns pm and err, so they are freed here if it cannot be delivered.
+  if (!PostMessageW(aviutl_get_my_window(), WM_PROCESS_MODULES, (WPARAM)pm, (LPARAM)err)) {
+    processor_module_destroy(&pm);
+    efree(&err);
+  }
+}
+
+static void get_placement(void *const userdata,
+                          struct processor_placement *const placement,
+                          FILTER *const fp,
+                          void *const editp) {
   (void)userdata;
+  struct config const *const cfg = processor_get_config(g_processor);
+  if (config_get_insert_mode(cfg) == 2) {
+    // Layers are allocated from the top, which does not go with searching the last available space.
+    return;
+  }
   int s, e;
   if (!fp->exfunc->get_select_frame(editp, &s, &e)) {
     s = 0;
   }
-  struct config const *const cfg = processor_get_config(g_processor);
-  char *str = NULL;
-  int layer;
-  error err = aviutl_find_space(s,
-                                s + info->length - 1,
-                                info->layer_max,
-                                config_get_insert_position(cfg) - 1,
-                                config_get_insert_mode(cfg) == 2,
-                                &layer);
+  error err = aviutl_create_layerindex(&placement->timeline);
   if (efailed(err)) {
     ereport(err);
     return;
   }
+  placement->frame = s;
+  placement->layer = config_get_insert_position(cfg) - 1;
+}
+
+/**
+ * Returns true if the module has allocated its layers and they are still free on the timeline.
+ */
+static bool can_drop_at_placement(struct processor_exo_info const *const info,
+                                  struct layerindex const *const timeline) {
+  if (!info->placement || !info->layeralloc) {
+    return false;
+  }
+  struct layeralloc_stats stats;
+  layeralloc_get_stats(info->layeralloc, &stats);
+  if (!stats.allocations) {
+    return false;
+  }
+  return layeralloc_fits(info->layeralloc, timeline);
+}
+
+static void
+create_exo(void *const userdata, struct processor_exo_info const *const info, FILTER *const fp, void *const editp) {
+  (void)userdata;
+  int s, e;
+  char *str = NULL;
+  struct layerindex *timeline = NULL;
+  int layer;
+  error err = eok();
+  if (info->drop->placed) {
+    // The later chunks go to the same place as the first one, they keep the frames and layers of the whole *.exo.
+    s = info->drop->frame;
+    layer = info->drop->layer;
+  } else {
+    // The fits check and the space search share one index of the current timeline.
+    err = aviutl_create_layerindex(&timeline);
+    if (efailed(err)) {
+      err = ethru(err);
+      goto cleanup;
+    }
+    if (can_drop_at_placement(info, timeline)) {
+      s = info->placement->frame;
+      layer = info->placement->layer;
+    } else {
+      if (!fp->exfunc->get_select_frame(editp, &s, &e)) {
+        s = 0;
+      }
+      struct config const *const cfg = processor_get_config(g_processor);
+      err = aviutl_find_space_in_index(timeline,
+                                       s,
+                                       s + info->length - 1,
+                                       info->layer_max,
+                                       config_get_insert_position(cfg) - 1,
+                                       config_get_insert_mode(cfg) == 2,
+                                       &layer);
+      if (efailed(err)) {
+        err = ethru(err);
+        goto cleanup;
+      }
+    }
+  }
   int len = WideCharToMultiByte(CP_ACP, 0, info->exo_path, -1, NULL, 0, NULL, NULL);
   if (len == 0) {
     err = errhr(HRESULT_FROM_WIN32(GetLastError()));
@@ -471,9 +625,16 @@ create_exo(void *const userdata, struct processor_exo_info const *const info, FI
     err = ethru(err);
     goto cleanup;
   }
+  info->drop->frame = s;
+  info->drop->layer = layer;
+  info->drop->placed = true;
   PostMessageW(aviutl_get_my_window(), WM_PROCESS_UPDATED, 0, 0);
 cleanup:
-  ereport(err);
+  if (efailed(err)) {
+    info->drop->failed = true;
+    ereport(err);
+  }
+  layerindex_destroy(&timeline);
   OV_ARRAY_DESTROY(&str);
 }
 
@@ -724,6 +885,65 @@ cleanup:
   ereport(err);
 }
 
+static void save_log(void) {
+  static GUID const save_log_tag = {0x5d0e8d0b, 0x3c6f, 0x4d8e, {0x9a, 0x1e, 0x62, 0x0b, 0x4f, 0x7d, 0x21, 0xc3}};
+  wchar_t title[512];
+  wchar_t *path = NULL;
+  HWND *windows = NULL;
+  error err = disable_family_windows(aviutl_get_my_window(), &windows);
+  if (efailed(err)) {
+    err = ethru(err);
+    goto cleanup;
+  }
+  mo_snprintf_wchar(title, sizeof(title) / sizeof(wchar_t), L"%1$hs", gettext("Save log"));
+  err = path_select_save_file(
+      aviutl_get_my_window(), title, L"Text file (*.txt)\0*.txt\0", L"txt", &save_log_tag, &path);
+  if (efailed(err)) {
+    if (eis_hr(err, HRESULT_FROM_WIN32(ERROR_CANCELLED))) {
+      efree(&err);
+      goto cleanup;
+    }
+    err = ethru(err);
+    goto cleanup;
+  }
+  err = logstore_save_file(g_log_store, path);
+  if (efailed(err)) {
+    err = ethru(err);
+    goto cleanup;
+  }
+cleanup:
+  restore_disabled_family_windows(windows);
+  if (path) {
+    OV_ARRAY_DESTROY(&path);
+  }
+  if (efailed(err)) {
+    error_to_log(err);
+  }
+}
+
+static void show_log_menu(LPARAM const lparam) {
+  HMENU const menu = CreatePopupMenu();
+  if (!menu) {
+    return;
+  }
+  wchar_t buf[256];
+  mo_snprintf_wchar(buf, sizeof(buf) / sizeof(wchar_t), L"%1$hs", gettext("Save log..."));
+  AppendMenuW(menu, MF_STRING | (logstore_count(g_log_store) ? 0 : MF_GRAYED), id_mnu_save_log, buf);
+  POINT pt = {.x = GET_X_LPARAM(lparam), .y = GET_Y_LPARAM(lparam)};
+  if (pt.x == -1 && pt.y == -1) {
+    // Opened from the keyboard.
+    RECT r;
+    GetWindowRect(g_logview, &r);
+    pt = (POINT){.x = r.left, .y = r.top};
+  }
+  int const cmd = TrackPopupMenu(
+      menu, TPM_RETURNCMD | TPM_NONOTIFY | TPM_RIGHTBUTTON, pt.x, pt.y, 0, aviutl_get_my_window(), NULL);
+  DestroyMenu(menu);
+  if (cmd == id_mnu_save_log) {
+    save_log();
+  }
+}
+
 static LRESULT CALLBACK
 subclass_proc(HWND window, UINT message, WPARAM wparam, LPARAM lparam, UINT_PTR subclass_id, DWORD_PTR ref_data) {
   (void)subclass_id;
@@ -809,6 +1029,10 @@ static void update_state(enum gui_state s) {
   EnableWindow(g_cmb_insert_mode, s == gui_state_ready);
   EnableWindow(g_lbl_module, s == gui_state_ready);
   EnableWindow(g_cmb_module, s == gui_state_ready);
+  EnableWindow(g_lbl_sidecar, s == gui_state_ready);
+  EnableWindow(g_chk_srt, s == gui_state_ready);
+  EnableWindow(g_chk_vtt, s == gui_state_ready);
+  EnableWindow(g_chk_ass, s == gui_state_ready);
 
   EnableWindow(g_btn_start, s == gui_state_ready || s == gui_state_running);
 
@@ -930,6 +1154,15 @@ static void filter_gui_init(HWND const window, void *const editp, FILTER *const
                     NULL,
                     hInstance);
 
+  mo_snprintf_wchar(buf, sizeof(buf) / sizeof(wchar_t), L"%1$hs", "%1$hs", gettext("Subtitle files:"));
+  g_lbl_sidecar = create_window(0, WC_STATICW, buf, WS_CHILD | WS_VISIBLE, g_pane_main, NULL, hInstance);
+  g_chk_srt =
+      create_window(0, WC_BUTTONW, L"SRT", WS_CHILD | WS_VISIBLE | BS_AUTOCHECKBOX, g_pane_main, NULL, hInstance);
+  g_chk_vtt =
+      create_window(0, WC_BUTTONW, L"WebVTT", WS_CHILD | WS_VISIBLE | BS_AUTOCHECKBOX, g_pane_main, NULL, hInstance);
+  g_chk_ass =
+      create_window(0, WC_BUTTONW, L"ASS", WS_CHILD | WS_VISIBLE | BS_AUTOCHECKBOX, g_pane_main, NULL, hInstance);
+
   mo_snprintf_wchar(buf, sizeof(buf) / sizeof(wchar_t), L"%1$hs", "%1$hs", gettext("Start"));
   g_btn_start = create_window(
       0, WC_BUTTONW, buf, WS_CHILD | WS_VISIBLE | BS_PUSHBUTTON, g_pane_main, (HMENU)id_btn_start, hInstance);
@@ -1000,12 +1233,15 @@ static void filter_gui_init(HWND const window, void *const editp, FILTER *const
   g_progress = create_window(0, PROGRESS_CLASSW, NULL, WS_CHILD | WS_VISIBLE | PBS_SMOOTH, window, NULL, hInstance);
   SendMessageW(g_progress, PBM_SETRANGE, 0, MAKELPARAM(0, 10000));
   g_logview = create_window(WS_EX_CLIENTEDGE,
-                            WC_LISTBOXW,
+                            WC_LISTVIEWW,
                             NULL,
-                            WS_CHILD | WS_VISIBLE | WS_VSCROLL | LBS_NOINTEGRALHEIGHT | LBS_DISABLENOSCROLL,
+                            WS_CHILD | WS_VISIBLE | LVS_REPORT | LVS_NOCOLUMNHEADER | LVS_OWNERDATA | LVS_SINGLESEL |
+                                LVS_SHOWSELALWAYS,
                             window,
                             NULL,
                             hInstance);
+  ListView_SetExtendedListViewStyle(g_logview, LVS_EX_FULLROWSELECT | LVS_EX_DOUBLEBUFFER);
+  ListView_InsertColumn(g_logview, 0, (&(LVCOLUMNW){.mask = LVCF_WIDTH, .cx = 0}));
 
   SYS_INFO si;
   HFONT font = NULL;
@@ -1038,6 +1274,10 @@ static void filter_gui_init(HWND const window, void *const editp, FILTER *const
       g_cmb_insert_mode,
       g_lbl_module,
       g_cmb_module,
+      g_lbl_sidecar,
+      g_chk_srt,
+      g_chk_vtt,
+      g_chk_ass,
 
       g_btn_start,
 
@@ -1151,8 +1391,16 @@ static void filter_gui_resize(HWND const window, void *const editp, FILTER *cons
   x += item_width4_static;
   MoveWindow(g_cmb_module, x, y, (tab.right - tab.left) - item_width4_static * 2, item_height * 8, TRUE);
 
-  x = (tab.right - tab.left) - item_width4_static;
+  x = 0;
   y += item_height + padding;
+  MoveWindow(g_lbl_sidecar, x, y + (item_height - tm.tmHeight) / 2, item_width4_static - padding, tm.tmHeight, TRUE);
+  x += item_width4_static;
+  MoveWindow(g_chk_srt, x, y, item_width4_static * 2 / 3 - padding, item_height, TRUE);
+  x += item_width4_static * 2 / 3;
+  MoveWindow(g_chk_vtt, x, y, item_width4_static * 2 / 3 - padding, item_height, TRUE);
+  x += item_width4_static * 2 / 3;
+  MoveWindow(g_chk_ass, x, y, item_width4_static * 2 / 3 - padding, item_height, TRUE);
+  x = (tab.right - tab.left) - item_width4_static;
   MoveWindow(g_btn_start, x, y, item_width4_static, item_height, TRUE);
 
   // Global Settings tab
@@ -1199,36 +1447,38 @@ static void filter_gui_resize(HWND const window, void *const editp, FILTER *cons
   y += 8;
   MoveWindow(
       g_logview, x, y, (client.right - client.left) - padding * 2, (client.bottom - client.top) - y - padding, TRUE);
+  GetClientRect(g_logview, &r);
+  ListView_SetColumnWidth(g_logview, 0, r.right - r.left);
 }
 
-static void filter_activate(HWND const window, void *const editp, FILTER *const fp) {
-  (void)window;
-  (void)editp;
-  (void)fp;
+static void set_modules(struct processor_module *const pm, error e) {
   error err = eok();
   wchar_t *buf = NULL;
-  if (!g_modules) {
-    wchar_t const *const module = config_get_module(processor_get_config(g_processor));
-    err = processor_get_modules(g_processor, &g_modules);
+  if (efailed(e)) {
+    // Allow retrying on the next activation.
+    g_modules_requested = false;
+    error_to_log(e);
+    goto cleanup;
+  }
+  if (g_modules) {
+    processor_module_destroy(&g_modules);
+  }
+  g_modules = pm;
+  wchar_t const *const module = config_get_module(processor_get_config(g_processor));
+  SendMessageW(g_cmb_module, CB_RESETCONTENT, 0, 0);
+  size_t const n = OV_ARRAY_LENGTH(g_modules);
+  for (size_t i = 0; i < n; ++i) {
+    err = OV_ARRAY_GROW(&buf, wcslen(g_modules[i].name) + wcslen(g_modules[i].description) + 4);
     if (efailed(err)) {
       err = ethru(err);
       goto cleanup;
     }
-    SendMessageW(g_cmb_module, CB_RESETCONTENT, 0, 0);
-    size_t const n = OV_ARRAY_LENGTH(g_modules);
-    for (size_t i = 0; i < n; ++i) {
-      err = OV_ARRAY_GROW(&buf, wcslen(g_modules[i].name) + wcslen(g_modules[i].description) + 4);
-      if (efailed(err)) {
-        err = ethru(err);
-        goto cleanup;
-      }
-      wcscpy(buf, g_modules[i].name);
-      wcscat(buf, L" - ");
-      wcscat(buf, g_modules[i].description);
-      SendMessageW(g_cmb_module, CB_ADDSTRING, 0, (LPARAM)buf);
-      if (wcscmp(g_modules[i].module, module) == 0) {
-        SendMessageW(g_cmb_module, CB_SETCURSEL, i, 0);
-      }
+    wcscpy(buf, g_modules[i].name);
+    wcscat(buf, L" - ");
+    wcscat(buf, g_modules[i].description);
+    SendMessageW(g_cmb_module, CB_ADDSTRING, 0, (LPARAM)buf);
+    if (wcscmp(g_modules[i].module, module) == 0) {
+      SendMessageW(g_cmb_module, CB_SETCURSEL, i, 0);
     }
   }
 cleanup:
@@ -1236,10 +1486,30 @@ cleanup:
   ereport(err);
 }
 
+static void filter_activate(HWND const window, void *const editp, FILTER *const fp) {
+  (void)window;
+  (void)editp;
+  (void)fp;
+  if (g_modules || g_modules_requested) {
+    return;
+  }
+  // Loading modules may take a while, so the list is built on a background thread
+  // and delivered with WM_PROCESS_MODULES.
+  error err = processor_get_modules_async(g_processor);
+  if (efailed(err)) {
+    err = ethru(err);
+    goto cleanup;
+  }
+  g_modules_requested = true;
+cleanup:
+  ereport(err);
+}
+
 static bool filter_init(HWND const window, void *const editp, FILTER *const fp) {
   (void)window;
   mtx_init(&g_mtx, mtx_plain);
   cnd_init(&g_cnd);
+  atomic_init(&g_log_posted, false);
   g_gui_thread_id = GetCurrentThreadId();
   error err = mo_parse_from_resource(&g_mp, get_hinstance());
   if (efailed(err)) {
@@ -1248,6 +1518,16 @@ static bool filter_init(HWND const window, void *const editp, FILTER *const fp)
     mo_set_default(g_mp);
   }
   filter_gui_init(window, editp, fp);
+  err = logstore_create(&g_log_store, log_store_lines, log_store_chars);
+  if (efailed(err)) {
+    err = ethru(err);
+    goto cleanup;
+  }
+  err = logring_create(&g_log_ring, log_ring_capacity);
+  if (efailed(err)) {
+    err = ethru(err);
+    goto cleanup;
+  }
   err = aviutl_init();
   if (efailed(err)) {
     err = ethru(err);
@@ -1262,9 +1542,11 @@ static bool filter_init(HWND const window, void *const editp, FILTER *const fp)
                              .on_start = on_start,
                              .on_progress = on_progress,
                              .on_log_line = on_log_line,
+                             .on_get_placement = on_get_placement,
                              .on_create_exo = on_create_exo,
                              .on_finish = on_finish,
                              .on_complete = on_complete,
+                             .on_get_modules = on_get_modules,
                          });
   if (efailed(err)) {
     err = ethru(err);
@@ -1307,14 +1589,23 @@ static void filter_exit(HWND const window, void *const editp, FILTER *const fp)
     RemoveWindowSubclass(g_pane_advanced, subclass_proc, (UINT_PTR)subclass_proc);
   }
 
+  // Release the threads waiting for the placement or the drop on the GUI thread,
+  // otherwise processor_destroy cannot join them. The run is aborted instead.
+  mtx_lock(&g_mtx);
+  g_exiting = true;
+  cnd_broadcast(&g_cnd);
+  mtx_unlock(&g_mtx);
   if (g_modules) {
     processor_module_destroy(&g_modules);
   }
   if (g_processor) {
     processor_destroy(&g_processor);
   }
-  if (g_log_buffer) {
-    OV_ARRAY_DESTROY(&g_log_buffer);
+  if (g_log_ring) {
+    logring_destroy(&g_log_ring);
+  }
+  if (g_log_store) {
+    logstore_destroy(&g_log_store);
   }
   ereport(aviutl_exit());
   mo_set_default(NULL);
@@ -1364,8 +1655,20 @@ static BOOL filter_wndproc(HWND const window,
       ShowWindow(g_pane_main, index == 0 ? SW_SHOW : SW_HIDE);
       ShowWindow(g_pane_settings, index == 1 ? SW_SHOW : SW_HIDE);
       ShowWindow(g_pane_advanced, index == 2 ? SW_SHOW : SW_HIDE);
+    } else if (hdr->hwndFrom == g_logview && hdr->code == LVN_GETDISPINFOW) {
+      static wchar_t text[1024];
+      NMLVDISPINFOW *const di = (NMLVDISPINFOW *)lparam;
+      if (di->item.mask & LVIF_TEXT) {
+        logstore_format(g_log_store, (size_t)di->item.iItem, text, sizeof(text) / sizeof(text[0]));
+        di->item.pszText = text;
+      }
     }
   } break;
+  case WM_CONTEXTMENU:
+    if ((HWND)wparam == g_logview) {
+      show_log_menu(lparam);
+    }
+    break;
   case WM_TIMER:
     if (wparam == id_tmr_progress) {
       update_title();
@@ -1419,14 +1722,26 @@ static BOOL filter_wndproc(HWND const window,
   case WM_PROCESS_PROGRESS:
     update_title();
     break;
-  case WM_PROCESS_LOG_LINE:
-    add_log((wchar_t *)lparam);
+  case WM_PROCESS_LOG:
+    if (g_exiting) {
+      break;
+    }
+    drain_log();
+    break;
+  case WM_PROCESS_GET_PLACEMENT: {
+    if (g_exiting) {
+      break;
+    }
+    get_placement((void *)wparam, (struct processor_placement *)lparam, fp, editp);
     mtx_lock(&g_mtx);
-    g_log_processed = true;
+    g_exo_processed = true;
     cnd_signal(&g_cnd);
     mtx_unlock(&g_mtx);
-    break;
+  } break;
   case WM_PROCESS_CREATE_EXO: {
+    if (g_exiting) {
+      break;
+    }
     create_exo((void *)wparam, (struct processor_exo_info *)lparam, fp, editp);
     mtx_lock(&g_mtx);
     g_exo_processed = true;
@@ -1441,6 +1756,16 @@ static BOOL filter_wndproc(HWND const window,
     break;
   case WM_PROCESS_UPDATED:
     return TRUE;
+  case WM_PROCESS_MODULES: {
+    struct processor_module *pm = (struct processor_module *)wparam;
+    error err = (error)lparam;
+    if (g_exiting) {
+      processor_module_destroy(&pm);
+      efree(&err);
+      break;
+    }
+    set_modules(pm, err);
+  } break;
   default:
     break;
   }
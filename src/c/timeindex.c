@@ -0,0 +1,192 @@
+#include "timeindex.h"
+
+#include <ovarray.h>
+
+#include <stdlib.h>
+#include <string.h>
+
+struct entry {
+  double start;
+  double end;
+  size_t index;
+};
+
+struct timeindex {
+  size_t n;
+  struct entry *entries; // sorted by start
+  double *max_end;       // maximum end of the subtree rooted at the same position
+};
+
+static int compare_entry(void const *const a, void const *const b) {
+  struct entry const *const ea = a;
+  struct entry const *const eb = b;
+  if (ea->start < eb->start) {
+    return -1;
+  }
+  if (ea->start > eb->start) {
+    return 1;
+  }
+  return ea->index < eb->index ? -1 : ea->index > eb->index ? 1 : 0;
+}
+
+static int compare_size_t(void const *const a, void const *const b) {
+  size_t const va = *(size_t const *)a;
+  size_t const vb = *(size_t const *)b;
+  return va < vb ? -1 : va > vb ? 1 : 0;
+}
+
+/**
+ * The node of [lo, hi) is at the middle, and its children are the middles of [lo, mid) and [mid + 1, hi).
+ */
+static double build(struct timeindex *const ti, size_t const lo, size_t const hi) {
+  size_t const mid = lo + (hi - lo) / 2;
+  double m = ti->entries[mid].end;
+  if (lo < mid) {
+    double const l = build(ti, lo, mid);
+    if (l > m) {
+      m = l;
+    }
+  }
+  if (mid + 1 < hi) {
+    double const r = build(ti, mid + 1, hi);
+    if (r > m) {
+      m = r;
+    }
+  }
+  ti->max_end[mid] = m;
+  return m;
+}
+
+NODISCARD error timeindex_create(struct timeindex **const tipp,
+                                 void const *const records,
+                                 size_t const count,
+                                 size_t const stride) {
+  if (!tipp || *tipp || (count && (!records || stride < sizeof(double) * 2))) {
+    return errg(err_invalid_arugment);
+  }
+  struct timeindex *ti = NULL;
+  error err = mem(&ti, 1, sizeof(struct timeindex));
+  if (efailed(err)) {
+    err = ethru(err);
+    goto cleanup;
+  }
+  *ti = (struct timeindex){.n = count};
+  if (count) {
+    err = mem(&ti->entries, count, sizeof(struct entry));
+    if (efailed(err)) {
+      err = ethru(err);
+      goto cleanup;
+    }
+    err = mem(&ti->max_end, count, sizeof(double));
+    if (efailed(err)) {
+      err = ethru(err);
+      goto cleanup;
+    }
+    char const *p = records;
+    for (size_t i = 0; i < count; ++i, p += stride) {
+      double times[2];
+      memcpy(times, p, sizeof(times));
+      ti->entries[i] = (struct entry){
+          .start = times[0],
+          .end = times[1],
+          .index = i,
+      };
+    }
+    qsort(ti->entries, count, sizeof(struct entry), compare_entry);
+    build(ti, 0, count);
+  }
+  *tipp = ti;
+  ti = NULL;
+cleanup:
+  if (ti) {
+    timeindex_destroy(&ti);
+  }
+  return err;
+}
+
+void timeindex_destroy(struct timeindex **const tipp) {
+  if (!tipp || !*tipp) {
+    return;
+  }
+  struct timeindex *const ti = *tipp;
+  if (ti->max_end) {
+    ereport(mem_free(&ti->max_end));
+  }
+  if (ti->entries) {
+    ereport(mem_free(&ti->entries));
+  }
+  ereport(mem_free(tipp));
+}
+
+struct query {
+  struct timeindex const *ti;
+  double t0;
+  double t1;
+  size_t **dest;
+  size_t len;
+  size_t cap;
+};
+
+static NODISCARD error push(struct query *const q, size_t const index) {
+  if (q->len == q->cap) {
+    size_t const cap = q->cap ? q->cap * 2 : 16;
+    error err = OV_ARRAY_GROW(q->dest, cap);
+    if (efailed(err)) {
+      return ethru(err);
+    }
+    q->cap = cap;
+  }
+  (*q->dest)[q->len++] = index;
+  return eok();
+}
+
+static NODISCARD error visit(struct query *const q, size_t const lo, size_t const hi) {
+  if (lo >= hi) {
+    return eok();
+  }
+  size_t const mid = lo + (hi - lo) / 2;
+  if (q->ti->max_end[mid] < q->t0) {
+    return eok();
+  }
+  error err = visit(q, lo, mid);
+  if (efailed(err)) {
+    return ethru(err);
+  }
+  struct entry const *const e = &q->ti->entries[mid];
+  if (e->start > q->t1) {
+    // Everything on the right starts even later.
+    return eok();
+  }
+  if (e->end >= q->t0) {
+    err = push(q, e->index);
+    if (efailed(err)) {
+      return ethru(err);
+    }
+  }
+  err = visit(q, mid + 1, hi);
+  if (efailed(err)) {
+    return ethru(err);
+  }
+  return eok();
+}
+
+NODISCARD error timeindex_query(struct timeindex const *const ti, double const t0, double const t1, size_t **const dest) {
+  if (!ti || !dest) {
+    return errg(err_invalid_arugment);
+  }
+  struct query q = {
+      .ti = ti,
+      .t0 = t0,
+      .t1 = t1,
+      .dest = dest,
+  };
+  error err = visit(&q, 0, ti->n);
+  if (efailed(err)) {
+    return ethru(err);
+  }
+  if (*dest) {
+    qsort(*dest, q.len, sizeof(size_t), compare_size_t);
+    OV_ARRAY_SET_LENGTH(*dest, q.len);
+  }
+  return eok();
+}
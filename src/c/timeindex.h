@@ -0,0 +1,34 @@
+#pragma once
+
+#include <ovbase.h>
+
+struct timeindex;
+
+/**
+ * @brief Builds an index to find the time ranges that overlap a given range.
+ *
+ * The ranges are sorted by start time and an implicit interval tree, augmented with the maximum end time of each
+ * subtree, is laid over the sorted array. A query visits O((k + 1) log n) nodes for k results.
+ *
+ * @param tipp A pointer to receive the index.
+ * @param records The first record. Each record must begin with "double start; double end;".
+ * @param count Number of records.
+ * @param stride Size of a record in bytes.
+ * @return An error code indicating success or failure.
+ */
+NODISCARD error timeindex_create(struct timeindex **const tipp,
+                                 void const *const records,
+                                 size_t const count,
+                                 size_t const stride);
+void timeindex_destroy(struct timeindex **const tipp);
+
+/**
+ * @brief Finds the records that overlap [t0, t1], that is start <= t1 and end >= t0.
+ *
+ * @param ti The index.
+ * @param t0 Start of the range.
+ * @param t1 End of the range. If it equals t0, the records that cover the point are found.
+ * @param dest A pointer to an ovarray to receive the indices of the records in ascending order.
+ * @return An error code indicating success or failure.
+ */
+NODISCARD error timeindex_query(struct timeindex const *const ti, double const t0, double const t1, size_t **const dest);
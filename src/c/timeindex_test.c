@@ -0,0 +1,139 @@
+#include <ovtest.h>
+
+#include <ovarray.h>
+
+#include "timeindex.h"
+
+struct range {
+  double start;
+  double end;
+  int payload;
+};
+
+static uint32_t xorshift32(uint32_t *const state) {
+  uint32_t x = *state;
+  x ^= x << 13;
+  x ^= x >> 17;
+  x ^= x << 5;
+  *state = x;
+  return x;
+}
+
+static double random_time(uint32_t *const state, double const max) {
+  // Quantize to 1/100 seconds like Whisper does, so that equal times are common.
+  return (double)(xorshift32(state) % (uint32_t)(max * 100.0 + 1.0)) / 100.0;
+}
+
+static void test_timeindex_simple(void) {
+  static struct range const ranges[] = {
+      {0.0, 1.0, 0},
+      {1.0, 2.0, 0},
+      {0.5, 3.0, 0},
+      {5.0, 6.0, 0},
+  };
+  struct timeindex *ti = NULL;
+  size_t *r = NULL;
+  if (!TEST_SUCCEEDED_F(timeindex_create(&ti, ranges, sizeof(ranges) / sizeof(ranges[0]), sizeof(struct range)))) {
+    return;
+  }
+  if (TEST_SUCCEEDED_F(timeindex_query(ti, 1.0, 1.0, &r))) {
+    TEST_CHECK(OV_ARRAY_LENGTH(r) == 3);
+    TEST_CHECK(r[0] == 0 && r[1] == 1 && r[2] == 2);
+  }
+  if (TEST_SUCCEEDED_F(timeindex_query(ti, 3.5, 4.5, &r))) {
+    TEST_CHECK(OV_ARRAY_LENGTH(r) == 0);
+  }
+  if (TEST_SUCCEEDED_F(timeindex_query(ti, 2.5, 10.0, &r))) {
+    TEST_CHECK(OV_ARRAY_LENGTH(r) == 2);
+    TEST_CHECK(r[0] == 2 && r[1] == 3);
+  }
+  OV_ARRAY_DESTROY(&r);
+  timeindex_destroy(&ti);
+}
+
+static void test_timeindex_empty(void) {
+  struct timeindex *ti = NULL;
+  size_t *r = NULL;
+  if (!TEST_SUCCEEDED_F(timeindex_create(&ti, NULL, 0, sizeof(struct range)))) {
+    return;
+  }
+  if (TEST_SUCCEEDED_F(timeindex_query(ti, 0.0, 100.0, &r))) {
+    TEST_CHECK(OV_ARRAY_LENGTH(r) == 0);
+  }
+  OV_ARRAY_DESTROY(&r);
+  timeindex_destroy(&ti);
+}
+
+static void test_timeindex_random(void) {
+  enum {
+    max_ranges = 500,
+    rounds = 50,
+    queries = 200,
+  };
+  static struct range ranges[max_ranges];
+  uint32_t state = 0x12345678;
+  size_t *r = NULL;
+  size_t *expected = NULL;
+  for (int round = 0; round < rounds; ++round) {
+    size_t const n = xorshift32(&state) % max_ranges;
+    double const length = 1.0 + (double)(xorshift32(&state) % 600);
+    for (size_t i = 0; i < n; ++i) {
+      double const start = random_time(&state, length);
+      // Mostly short ranges like words, sometimes long ones like segments, and sometimes reversed ones.
+      double const duration = random_time(&state, xorshift32(&state) % 8 ? 2.0 : length);
+      ranges[i] = (struct range){
+          .start = start,
+          .end = xorshift32(&state) % 50 ? start + duration : start - duration,
+          .payload = (int)i,
+      };
+    }
+    struct timeindex *ti = NULL;
+    if (!TEST_SUCCEEDED_F(timeindex_create(&ti, ranges, n, sizeof(struct range)))) {
+      goto cleanup;
+    }
+    for (int q = 0; q < queries; ++q) {
+      double t0 = random_time(&state, length + 2.0) - 1.0;
+      double t1 = xorshift32(&state) % 4 ? t0 : t0 + random_time(&state, length / 4.0);
+      if (!TEST_SUCCEEDED_F(timeindex_query(ti, t0, t1, &r))) {
+        timeindex_destroy(&ti);
+        goto cleanup;
+      }
+      size_t ne = 0;
+      if (!TEST_SUCCEEDED_F(OV_ARRAY_GROW(&expected, n + 1))) {
+        timeindex_destroy(&ti);
+        goto cleanup;
+      }
+      for (size_t i = 0; i < n; ++i) {
+        if (ranges[i].start <= t1 && ranges[i].end >= t0) {
+          expected[ne++] = i;
+        }
+      }
+      bool same = OV_ARRAY_LENGTH(r) == ne;
+      for (size_t i = 0; same && i < ne; ++i) {
+        same = r[i] == expected[i];
+      }
+      TEST_CHECK(same);
+      TEST_MSG("round %d, query [%f, %f]: expected %zu results, got %zu", round, t0, t1, ne, OV_ARRAY_LENGTH(r));
+    }
+    timeindex_destroy(&ti);
+  }
+cleanup:
+  OV_ARRAY_DESTROY(&expected);
+  OV_ARRAY_DESTROY(&r);
+}
+
+static void test_timeindex_invalid_argument(void) {
+  struct timeindex *ti = NULL;
+  size_t *r = NULL;
+  TEST_EISG_F(timeindex_create(NULL, NULL, 0, sizeof(struct range)), err_invalid_arugment);
+  TEST_EISG_F(timeindex_create(&ti, NULL, 1, sizeof(struct range)), err_invalid_arugment);
+  TEST_EISG_F(timeindex_query(NULL, 0.0, 1.0, &r), err_invalid_arugment);
+}
+
+TEST_LIST = {
+    {"test_timeindex_simple", test_timeindex_simple},
+    {"test_timeindex_empty", test_timeindex_empty},
+    {"test_timeindex_random", test_timeindex_random},
+    {"test_timeindex_invalid_argument", test_timeindex_invalid_argument},
+    {NULL, NULL},
+};
@@ -0,0 +1,622 @@
+#include "transcript.h"
+
+#include <ovarray.h>
+#include <ovutil/win32.h>
+
+#include <string.h>
+
+#include "frametiming.h"
+#include "i18n.h"
+#include "jsoncommon.h"
+#include "timeindex.h"
+
+enum {
+  transcript_magic = 0x4e525453, // "STRN"
+  transcript_version = 1,
+  transcript_header_size = 48,
+};
+
+// The records are read in place, so their layout is a part of the file format.
+_Static_assert(sizeof(struct transcript_segment) == 32, "unexpected size of struct transcript_segment");
+_Static_assert(sizeof(struct transcript_word) == 24, "unexpected size of struct transcript_word");
+
+struct header {
+  uint32_t magic;
+  uint32_t version;
+  uint64_t source_size;
+  uint64_t source_time;
+  double max_time;
+  uint32_t num_segments;
+  uint32_t num_words;
+  uint32_t strings_len;
+  uint32_t reserved;
+};
+_Static_assert(sizeof(struct header) == transcript_header_size, "unexpected size of struct header");
+
+#define VERIFY(obj, key, context, yytype, type)                                                                        \
+  do {                                                                                                                 \
+    struct yyjson_val *val = yyjson_obj_get(obj, key);                                                                 \
+    if (!(val) || !(yyjson_is_##yytype(val))) {                                                                        \
+      err = emsg_i18nf(err_type_generic,                                                                               \
+                       err_fail,                                                                                       \
+                       L"%1$hs%2$hs%3$hs",                                                                             \
+                       gettext("%1$hs must contain a \"%2$hs\" (type: %3$hs)."),                                       \
+                       context,                                                                                        \
+                       key,                                                                                            \
+                       type);                                                                                          \
+      goto cleanup;                                                                                                    \
+    }                                                                                                                  \
+  } while (0)
+#define VERIFY_NUMBER(obj, key, context) VERIFY(obj, key, context, num, "number")
+#define VERIFY_STRING(obj, key, context) VERIFY(obj, key, context, str, "string")
+
+static uint32_t add_string(char *const strings, uint32_t *const pos, struct yyjson_val *const val) {
+  uint32_t const offset = *pos;
+  size_t const len = yyjson_get_len(val);
+  memcpy(strings + offset, yyjson_get_str(val), len);
+  strings[offset + len] = '\0';
+  *pos += (uint32_t)len + 1;
+  return offset;
+}
+
+NODISCARD error transcript_convert_json(char *const json,
+                                        size_t const json_len,
+                                        uint64_t const source_size,
+                                        uint64_t const source_time,
+                                        char **const dest) {
+  if (!json || !dest) {
+    return errg(err_invalid_arugment);
+  }
+  error err = eok();
+  struct jsoncommon_arena arena = {0};
+  struct yyjson_doc *doc = NULL;
+  char *buf = NULL;
+
+  // The document takes several times the file size in many small blocks, so carve them out of a few large chunks.
+  err = jsoncommon_arena_init(&arena, json_len, YYJSON_READ_INSITU);
+  if (efailed(err)) {
+    err = ethru(err);
+    goto cleanup;
+  }
+  struct yyjson_read_err read_err;
+  doc = yyjson_read_opts(json, json_len, YYJSON_READ_INSITU, &arena.alc, &read_err);
+  if (!doc) {
+    err = emsg_i18nf(err_type_generic,
+                     err_fail,
+                     L"%1$hs%2$d",
+                     gettext("Unable to parse JSON: %1$hs (line: %2$d)"),
+                     read_err.msg,
+                     read_err.pos);
+    goto cleanup;
+  }
+  struct yyjson_val *root = yyjson_doc_get_root(doc);
+  if (!root || !yyjson_is_obj(root)) {
+    err = emsg_i18n(err_type_generic, err_fail, gettext("The root of the JSON must be an object."));
+    goto cleanup;
+  }
+
+  struct yyjson_val *segments = yyjson_obj_get(root, "segments");
+  if (!segments || !yyjson_is_arr(segments)) {
+    err = emsg_i18nf(err_type_generic,
+                     err_fail,
+                     L"%1$hs",
+                     gettext("The root of the JSON must contain a \"%1$hs\" array."),
+                     "segments");
+    goto cleanup;
+  }
+
+  // Validate everything and measure the output first, so that the records can be written without reallocation.
+  size_t i, num_segments;
+  struct yyjson_val *elem;
+  uint64_t total_words = 0;
+  uint64_t strings_len = 0;
+  yyjson_arr_foreach(segments, i, num_segments, elem) {
+    if (!yyjson_is_obj(elem)) {
+      err = emsg_i18nf(
+          err_type_generic, err_fail, L"%1$hs", gettext("\"%1$hs\" array must contain objects."), "segments");
+      goto cleanup;
+    }
+    struct yyjson_val *words = yyjson_obj_get(elem, "words");
+    if (!words || !yyjson_is_arr(words)) {
+      err = emsg_i18nf(err_type_generic,
+                       err_fail,
+                       L"%1$hs%2$hs%3$hs",
+                       gettext("%1$hs must contain a \"%2$hs\" (type: %3$hs)."),
+                       gettext("\"segment\" object"),
+                       "words",
+                       "array");
+      goto cleanup;
+    }
+    {
+      char const *const context = gettext("\"segment\" object");
+      VERIFY_NUMBER(elem, "start", context);
+      VERIFY_NUMBER(elem, "end", context);
+      VERIFY_STRING(elem, "text", context);
+      strings_len += yyjson_get_len(yyjson_obj_get(elem, "text")) + 1;
+    }
+    size_t j, num_words;
+    struct yyjson_val *elem2;
+    yyjson_arr_foreach(words, j, num_words, elem2) {
+      if (!yyjson_is_obj(elem2)) {
+        err =
+            emsg_i18nf(err_type_generic, err_fail, L"%1$hs", gettext("\"%1$hs\" array must contain objects."), "words");
+        goto cleanup;
+      }
+      char const *const context = gettext("\"word\" object");
+      VERIFY_NUMBER(elem2, "start", context);
+      VERIFY_NUMBER(elem2, "end", context);
+      VERIFY_STRING(elem2, "word", context);
+      strings_len += yyjson_get_len(yyjson_obj_get(elem2, "word")) + 1;
+    }
+    total_words += num_words;
+  }
+  num_segments = yyjson_arr_size(segments);
+  if (num_segments > UINT32_MAX || total_words > UINT32_MAX || strings_len > UINT32_MAX) {
+    err = emsg_i18n(err_type_generic, err_fail, gettext("The transcript is too large."));
+    goto cleanup;
+  }
+
+  size_t const len = transcript_header_size + num_segments * sizeof(struct transcript_segment) +
+                     (size_t)total_words * sizeof(struct transcript_word) + (size_t)strings_len;
+  err = OV_ARRAY_GROW(&buf, len);
+  if (efailed(err)) {
+    err = ethru(err);
+    goto cleanup;
+  }
+  struct transcript_segment *const segs = (void *)(buf + transcript_header_size);
+  struct transcript_word *const words = (void *)(segs + num_segments);
+  char *const strings = (char *)(words + total_words);
+  uint32_t word_index = 0;
+  uint32_t string_pos = 0;
+  double max_time = 0;
+  yyjson_arr_foreach(segments, i, num_segments, elem) {
+    struct yyjson_val *const w = yyjson_obj_get(elem, "words");
+    struct transcript_segment *const seg = &segs[i];
+    *seg = (struct transcript_segment){
+        .start = yyjson_get_num(yyjson_obj_get(elem, "start")),
+        .end = yyjson_get_num(yyjson_obj_get(elem, "end")),
+        .text_len = (uint32_t)yyjson_get_len(yyjson_obj_get(elem, "text")),
+        .first_word = word_index,
+        .num_words = (uint32_t)yyjson_arr_size(w),
+    };
+    seg->text = add_string(strings, &string_pos, yyjson_obj_get(elem, "text"));
+    if (seg->end > max_time) {
+      max_time = seg->end;
+    }
+    size_t j, num_words;
+    struct yyjson_val *elem2;
+    yyjson_arr_foreach(w, j, num_words, elem2) {
+      struct transcript_word *const word = &words[word_index++];
+      *word = (struct transcript_word){
+          .start = yyjson_get_num(yyjson_obj_get(elem2, "start")),
+          .end = yyjson_get_num(yyjson_obj_get(elem2, "end")),
+          .word_len = (uint32_t)yyjson_get_len(yyjson_obj_get(elem2, "word")),
+      };
+      word->word = add_string(strings, &string_pos, yyjson_obj_get(elem2, "word"));
+    }
+  }
+  struct header const h = {
+      .magic = transcript_magic,
+      .version = transcript_version,
+      .source_size = source_size,
+      .source_time = source_time,
+      .max_time = max_time,
+      .num_segments = (uint32_t)num_segments,
+      .num_words = (uint32_t)total_words,
+      .strings_len = (uint32_t)strings_len,
+  };
+  memcpy(buf, &h, sizeof(h));
+  OV_ARRAY_SET_LENGTH(buf, len);
+  *dest = buf;
+  buf = NULL;
+cleanup:
+  OV_ARRAY_DESTROY(&buf);
+  if (doc) {
+    yyjson_doc_free(doc);
+    doc = NULL;
+  }
+  jsoncommon_arena_destroy(&arena);
+  return err;
+}
+
+static bool is_valid_string(char const *const strings, size_t const strings_len, uint32_t const pos, uint32_t const len) {
+  return (uint64_t)pos + len < strings_len && strings[pos + len] == '\0';
+}
+
+NODISCARD error transcript_view(void const *const data, size_t const len, struct transcript *const t) {
+  if (!data || !t) {
+    return errg(err_invalid_arugment);
+  }
+  struct header h;
+  if (len < sizeof(h)) {
+    goto broken;
+  }
+  memcpy(&h, data, sizeof(h));
+  if (h.magic != transcript_magic || h.version != transcript_version) {
+    goto broken;
+  }
+  if ((uint64_t)transcript_header_size + (uint64_t)h.num_segments * sizeof(struct transcript_segment) +
+          (uint64_t)h.num_words * sizeof(struct transcript_word) + h.strings_len !=
+      len) {
+    goto broken;
+  }
+  char const *const p = data;
+  struct transcript_segment const *const segs = (void const *)(p + transcript_header_size);
+  struct transcript_word const *const words = (void const *)(segs + h.num_segments);
+  char const *const strings = (char const *)(words + h.num_words);
+  for (size_t i = 0; i < h.num_segments; ++i) {
+    struct transcript_segment const *const seg = &segs[i];
+    if ((uint64_t)seg->first_word + seg->num_words > h.num_words ||
+        !is_valid_string(strings, h.strings_len, seg->text, seg->text_len)) {
+      goto broken;
+    }
+  }
+  for (size_t i = 0; i < h.num_words; ++i) {
+    if (!is_valid_string(strings, h.strings_len, words[i].word, words[i].word_len)) {
+      goto broken;
+    }
+  }
+  *t = (struct transcript){
+      .segments = segs,
+      .num_segments = h.num_segments,
+      .words = words,
+      .num_words = h.num_words,
+      .strings = strings,
+      .strings_len = h.strings_len,
+      .max_time = h.max_time,
+      .source_size = h.source_size,
+      .source_time = h.source_time,
+  };
+  return eok();
+broken:
+  return emsg_i18n(err_type_generic, err_fail, gettext("The transcript file is broken."));
+}
+
+NODISCARD error transcript_get_path(wchar_t const *const json_path, wchar_t **const dest) {
+  if (!json_path || !dest) {
+    return errg(err_invalid_arugment);
+  }
+  static wchar_t const ext[] = L".transcript";
+  size_t const len = wcslen(json_path);
+  size_t base_len = len;
+  wchar_t const *const dot = wcsrchr(json_path, L'.');
+  if (dot && !wcschr(dot, L'\\') && _wcsicmp(dot, L".json") == 0) {
+    base_len = (size_t)(dot - json_path);
+  }
+  error err = OV_ARRAY_GROW(dest, base_len + sizeof(ext) / sizeof(ext[0]));
+  if (efailed(err)) {
+    return ethru(err);
+  }
+  wcsncpy(*dest, json_path, base_len);
+  wcscpy(*dest + base_len, ext);
+  OV_ARRAY_SET_LENGTH(*dest, base_len + sizeof(ext) / sizeof(ext[0]) - 1);
+  return eok();
+}
+
+static inline uint64_t filetime_to_uint64(FILETIME const *const ft) {
+  return ((uint64_t)ft->dwHighDateTime << 32) | ft->dwLowDateTime;
+}
+
+static NODISCARD error get_source_info(wchar_t const *const json_path,
+                                       uint64_t *const source_size,
+                                       uint64_t *const source_time) {
+  WIN32_FILE_ATTRIBUTE_DATA fad;
+  if (!GetFileAttributesExW(json_path, GetFileExInfoStandard, &fad)) {
+    HRESULT const hr = HRESULT_FROM_WIN32(GetLastError());
+    if (hr == HRESULT_FROM_WIN32(ERROR_FILE_NOT_FOUND) || hr == HRESULT_FROM_WIN32(ERROR_PATH_NOT_FOUND)) {
+      return emsg_i18nf(
+          err_type_generic, err_not_found, L"%1$ls", gettext("The file \"%1$ls\" is not found."), json_path);
+    }
+    return errhr(hr);
+  }
+  *source_size = ((uint64_t)fad.nFileSizeHigh << 32) | fad.nFileSizeLow;
+  *source_time = filetime_to_uint64(&fad.ftLastWriteTime);
+  return eok();
+}
+
+static NODISCARD error convert_file(wchar_t const *const json_path, char **const dest) {
+  error err = eok();
+  char *json = NULL;
+  HANDLE h = INVALID_HANDLE_VALUE;
+  uint64_t source_size, source_time;
+
+  h = CreateFileW(json_path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+  if (h == INVALID_HANDLE_VALUE) {
+    HRESULT const hr = HRESULT_FROM_WIN32(GetLastError());
+    if (hr == HRESULT_FROM_WIN32(ERROR_FILE_NOT_FOUND)) {
+      err = emsg_i18nf(
+          err_type_generic, err_not_found, L"%1$ls", gettext("The file \"%1$ls\" is not found."), json_path);
+    } else {
+      err = errhr(hr);
+    }
+    goto cleanup;
+  }
+  BY_HANDLE_FILE_INFORMATION fi;
+  if (!GetFileInformationByHandle(h, &fi)) {
+    err = errhr(HRESULT_FROM_WIN32(GetLastError()));
+    goto cleanup;
+  }
+  source_size = ((uint64_t)fi.nFileSizeHigh << 32) | fi.nFileSizeLow;
+  source_time = filetime_to_uint64(&fi.ftLastWriteTime);
+  if (fi.nFileSizeHigh) {
+    err = emsg_i18n(err_type_generic, err_fail, gettext("The transcript is too large."));
+    goto cleanup;
+  }
+  DWORD const size = fi.nFileSizeLow;
+  err = mem(&json, size + YYJSON_PADDING_SIZE, sizeof(char));
+  if (efailed(err)) {
+    err = ethru(err);
+    goto cleanup;
+  }
+  DWORD read = 0;
+  if (!ReadFile(h, json, size, &read, NULL)) {
+    err = errhr(HRESULT_FROM_WIN32(GetLastError()));
+    goto cleanup;
+  }
+  if (read != size) {
+    err = emsg_i18n(err_type_generic, err_fail, gettext("Unable to read the entire file."));
+    goto cleanup;
+  }
+  memset(json + read, 0, YYJSON_PADDING_SIZE);
+  err = transcript_convert_json(json, read, source_size, source_time, dest);
+  if (efailed(err)) {
+    err = ethru(err);
+    goto cleanup;
+  }
+cleanup:
+  if (json) {
+    ereport(mem_free(&json));
+  }
+  if (h != INVALID_HANDLE_VALUE) {
+    CloseHandle(h);
+    h = INVALID_HANDLE_VALUE;
+  }
+  return err;
+}
+
+static NODISCARD error write_file(wchar_t const *const path, char const *const data, size_t const len) {
+  wchar_t *tmp = NULL;
+  HANDLE h = INVALID_HANDLE_VALUE;
+  error err = OV_ARRAY_GROW(&tmp, wcslen(path) + 32);
+  if (efailed(err)) {
+    err = ethru(err);
+    goto cleanup;
+  }
+  // The file is replaced only after it is complete, so a reader never sees a partial transcript.
+  wsprintfW(tmp, L"%s.%lu.tmp", path, GetCurrentProcessId());
+  h = CreateFileW(tmp, GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+  if (h == INVALID_HANDLE_VALUE) {
+    err = errhr(HRESULT_FROM_WIN32(GetLastError()));
+    goto cleanup;
+  }
+  DWORD written;
+  if (!WriteFile(h, data, (DWORD)len, &written, NULL)) {
+    err = errhr(HRESULT_FROM_WIN32(GetLastError()));
+    goto cleanup;
+  }
+  if (written != len) {
+    err = emsg_i18n(err_type_generic, err_fail, gettext("Unable to write the entire file."));
+    goto cleanup;
+  }
+  CloseHandle(h);
+  h = INVALID_HANDLE_VALUE;
+  if (!MoveFileExW(tmp, path, MOVEFILE_REPLACE_EXISTING)) {
+    err = errhr(HRESULT_FROM_WIN32(GetLastError()));
+    goto cleanup;
+  }
+cleanup:
+  if (h != INVALID_HANDLE_VALUE) {
+    CloseHandle(h);
+    h = INVALID_HANDLE_VALUE;
+  }
+  if (efailed(err) && tmp) {
+    DeleteFileW(tmp);
+  }
+  OV_ARRAY_DESTROY(&tmp);
+  return err;
+}
+
+NODISCARD error transcript_build_file(wchar_t const *const json_path, struct transcript_summary *const summary) {
+  if (!json_path) {
+    return errg(err_invalid_arugment);
+  }
+  char *bin = NULL;
+  wchar_t *path = NULL;
+  error err = convert_file(json_path, &bin);
+  if (efailed(err)) {
+    err = ethru(err);
+    goto cleanup;
+  }
+  err = transcript_get_path(json_path, &path);
+  if (efailed(err)) {
+    err = ethru(err);
+    goto cleanup;
+  }
+  err = write_file(path, bin, OV_ARRAY_LENGTH(bin));
+  if (efailed(err)) {
+    err = ethru(err);
+    goto cleanup;
+  }
+  if (summary) {
+    struct header h;
+    memcpy(&h, bin, sizeof(h));
+    *summary = (struct transcript_summary){
+        .num_segments = h.num_segments,
+        .num_words = h.num_words,
+        .max_time = h.max_time,
+    };
+  }
+cleanup:
+  OV_ARRAY_DESTROY(&path);
+  OV_ARRAY_DESTROY(&bin);
+  return err;
+}
+
+/**
+ * Maps the binary transcript if it has been built from the current *.json file.
+ * Returns false if it cannot be used for any reason.
+ */
+static bool map_file(wchar_t const *const path,
+                     uint64_t const source_size,
+                     uint64_t const source_time,
+                     struct transcript *const t) {
+  bool r = false;
+  HANDLE mapping = NULL;
+  void const *view = NULL;
+  HANDLE h = CreateFileW(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+  if (h == INVALID_HANDLE_VALUE) {
+    goto cleanup;
+  }
+  LARGE_INTEGER size;
+  if (!GetFileSizeEx(h, &size) || size.QuadPart < transcript_header_size || (uint64_t)size.QuadPart > SIZE_MAX) {
+    goto cleanup;
+  }
+  mapping = CreateFileMappingW(h, NULL, PAGE_READONLY, 0, 0, NULL);
+  if (!mapping) {
+    goto cleanup;
+  }
+  view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+  if (!view) {
+    goto cleanup;
+  }
+  struct transcript tr;
+  error err = transcript_view(view, (size_t)size.QuadPart, &tr);
+  if (efailed(err)) {
+    efree(&err);
+    goto cleanup;
+  }
+  if (tr.source_size != source_size || tr.source_time != source_time) {
+    goto cleanup;
+  }
+  tr.mapping = mapping;
+  tr.view = view;
+  *t = tr;
+  mapping = NULL;
+  view = NULL;
+  r = true;
+cleanup:
+  if (view) {
+    UnmapViewOfFile(view);
+  }
+  if (mapping) {
+    CloseHandle(mapping);
+  }
+  if (h != INVALID_HANDLE_VALUE) {
+    CloseHandle(h);
+  }
+  return r;
+}
+
+NODISCARD error transcript_load_file(wchar_t const *const json_path, struct transcript *const t) {
+  if (!json_path || !t) {
+    return errg(err_invalid_arugment);
+  }
+  error err = eok();
+  wchar_t *path = NULL;
+  char *bin = NULL;
+  uint64_t source_size, source_time;
+  err = get_source_info(json_path, &source_size, &source_time);
+  if (efailed(err)) {
+    err = ethru(err);
+    goto cleanup;
+  }
+  err = transcript_get_path(json_path, &path);
+  if (efailed(err)) {
+    err = ethru(err);
+    goto cleanup;
+  }
+  if (map_file(path, source_size, source_time, t)) {
+    goto cleanup;
+  }
+
+  // The binary transcript is missing or outdated, such as when the *.json file has been edited by hand.
+  err = convert_file(json_path, &bin);
+  if (efailed(err)) {
+    err = ethru(err);
+    goto cleanup;
+  }
+  err = transcript_view(bin, OV_ARRAY_LENGTH(bin), t);
+  if (efailed(err)) {
+    err = ethru(err);
+    goto cleanup;
+  }
+  t->buffer = bin;
+  bin = NULL;
+  // The binary transcript only saves time on the next run, so failing to write it is not an error.
+  error e = write_file(path, t->buffer, OV_ARRAY_LENGTH(t->buffer));
+  if (efailed(e)) {
+    efree(&e);
+  }
+cleanup:
+  OV_ARRAY_DESTROY(&bin);
+  OV_ARRAY_DESTROY(&path);
+  return err;
+}
+
+NODISCARD error transcript_build_index(struct transcript *const t) {
+  if (!t) {
+    return errg(err_invalid_arugment);
+  }
+  error err = eok();
+  if (!t->segment_index) {
+    err = timeindex_create(&t->segment_index, t->segments, t->num_segments, sizeof(struct transcript_segment));
+    if (efailed(err)) {
+      return ethru(err);
+    }
+  }
+  if (!t->word_index) {
+    err = timeindex_create(&t->word_index, t->words, t->num_words, sizeof(struct transcript_word));
+    if (efailed(err)) {
+      return ethru(err);
+    }
+  }
+  return eok();
+}
+
+NODISCARD error transcript_query_segments(struct transcript const *const t,
+                                          double const t0,
+                                          double const t1,
+                                          size_t **const dest) {
+  if (!t || !t->segment_index || !dest) {
+    return errg(err_invalid_arugment);
+  }
+  error err = timeindex_query(t->segment_index, t0, t1, dest);
+  if (efailed(err)) {
+    return ethru(err);
+  }
+  return eok();
+}
+
+NODISCARD error transcript_query_words(struct transcript const *const t,
+                                       double const t0,
+                                       double const t1,
+                                       size_t **const dest) {
+  if (!t || !t->word_index || !dest) {
+    return errg(err_invalid_arugment);
+  }
+  error err = timeindex_query(t->word_index, t0, t1, dest);
+  if (efailed(err)) {
+    return ethru(err);
+  }
+  return eok();
+}
+
+void transcript_destroy(struct transcript *const t) {
+  if (!t) {
+    return;
+  }
+  OV_ARRAY_DESTROY(&t->word_frames);
+  OV_ARRAY_DESTROY(&t->segment_frames);
+  OV_ARRAY_DESTROY(&t->reflowed_strings);
+  OV_ARRAY_DESTROY(&t->reflowed_segments);
+  timeindex_destroy(&t->word_index);
+  timeindex_destroy(&t->segment_index);
+  if (t->view) {
+    UnmapViewOfFile(t->view);
+  }
+  if (t->mapping) {
+    CloseHandle(t->mapping);
+  }
+  OV_ARRAY_DESTROY(&t->buffer);
+  *t = (struct transcript){0};
+}
@@ -0,0 +1,142 @@
+#pragma once
+
+#include <ovbase.h>
+
+struct timeindex;
+struct frametiming_range;
+
+/**
+ * @brief A word record of the binary transcript.
+ */
+struct transcript_word {
+  double start;      /**< Start time in seconds. */
+  double end;        /**< End time in seconds. */
+  uint32_t word;     /**< Offset of the word in the string pool. */
+  uint32_t word_len; /**< Length of the word in bytes, excluding the terminating NUL. */
+};
+
+/**
+ * @brief A segment record of the binary transcript.
+ */
+struct transcript_segment {
+  double start;        /**< Start time in seconds. */
+  double end;          /**< End time in seconds. */
+  uint32_t text;       /**< Offset of the text in the string pool. */
+  uint32_t text_len;   /**< Length of the text in bytes, excluding the terminating NUL. */
+  uint32_t first_word; /**< Index of the first word of the segment. */
+  uint32_t num_words;  /**< Number of words in the segment. */
+};
+
+/**
+ * @brief A transcript ready to be iterated.
+ *
+ * The records point directly into the binary transcript, which is either mapped from a file or held in memory.
+ * Strings in the pool are UTF-8 and NUL-terminated.
+ */
+struct transcript {
+  struct transcript_segment const *segments;
+  size_t num_segments;
+  struct transcript_word const *words;
+  size_t num_words;
+  char const *strings;
+  size_t strings_len;
+  double max_time;      /**< The largest end time of the segments. */
+  uint64_t source_size; /**< Size of the *.json file the transcript was converted from. */
+  uint64_t source_time; /**< Last write time of the *.json file the transcript was converted from. */
+
+  char *buffer;
+  void *mapping;
+  void const *view;
+  struct timeindex *segment_index;
+  struct timeindex *word_index;
+  struct transcript_segment *reflowed_segments; /**< Segments made by reflow_apply. */
+  char *reflowed_strings;                       /**< String pool made by reflow_apply. */
+  struct frametiming_range *segment_frames;     /**< Frames of the segments, set by frametiming_compute. */
+  struct frametiming_range *word_frames;        /**< Frames of the words, set by frametiming_compute. */
+};
+
+/**
+ * @brief Converts Whisper's verbose JSON to the binary transcript.
+ *
+ * @param json The JSON. It is modified because it is parsed in place, and must have YYJSON_PADDING_SIZE bytes
+ *             of zero padding after json_len.
+ * @param json_len Length of the JSON.
+ * @param source_size Size of the source file, stored to detect changes.
+ * @param source_time Last write time of the source file, stored to detect changes.
+ * @param dest A pointer to receive the binary transcript as an ovarray.
+ * @return An error code indicating success or failure.
+ */
+NODISCARD error transcript_convert_json(char *const json,
+                                        size_t const json_len,
+                                        uint64_t const source_size,
+                                        uint64_t const source_time,
+                                        char **const dest);
+
+/**
+ * @brief Validates the binary transcript and sets up the transcript to iterate it without copying.
+ *
+ * The data must stay valid while the transcript is used. The transcript does not own the data.
+ */
+NODISCARD error transcript_view(void const *const data, size_t const len, struct transcript *const t);
+
+/**
+ * @brief Counts of a transcript, as reported by transcript_build_file.
+ */
+struct transcript_summary {
+  size_t num_segments;
+  size_t num_words;
+  double max_time; /**< The largest end time of the segments. */
+};
+
+/**
+ * @brief Converts the *.json file and writes the binary transcript next to it.
+ *
+ * @param json_path Path of the *.json file.
+ * @param summary A pointer to receive the counts of the transcript, can be NULL.
+ * @return An error code indicating success or failure.
+ */
+NODISCARD error transcript_build_file(wchar_t const *const json_path, struct transcript_summary *const summary);
+
+/**
+ * @brief Loads the transcript for the *.json file.
+ *
+ * If the binary transcript built by transcript_build_file exists and matches the *.json file, it is mapped into
+ * memory. Otherwise the *.json file is converted in memory, and the binary transcript is written for the next time.
+ */
+NODISCARD error transcript_load_file(wchar_t const *const json_path, struct transcript *const t);
+
+/**
+ * @brief Gets the path of the binary transcript for the *.json file.
+ */
+NODISCARD error transcript_get_path(wchar_t const *const json_path, wchar_t **const dest);
+
+/**
+ * @brief Builds the time range indexes used by transcript_query_segments and transcript_query_words.
+ *
+ * Once built, the transcript can be queried from multiple threads at the same time.
+ */
+NODISCARD error transcript_build_index(struct transcript *const t);
+
+/**
+ * @brief Finds the segments that overlap [t0, t1].
+ *
+ * @param t The transcript with the index built.
+ * @param t0 Start time in seconds.
+ * @param t1 End time in seconds.
+ * @param dest A pointer to an ovarray to receive the indices of the segments in ascending order.
+ * @return An error code indicating success or failure.
+ */
+NODISCARD error transcript_query_segments(struct transcript const *const t,
+                                          double const t0,
+                                          double const t1,
+                                          size_t **const dest);
+
+/**
+ * @brief Finds the words that overlap [t0, t1], see transcript_query_segments.
+ */
+NODISCARD error transcript_query_words(struct transcript const *const t,
+                                       double const t0,
+                                       double const t1,
+                                       size_t **const dest);
+
+void transcript_destroy(struct transcript *const t);
@@ -0,0 +1,156 @@
+#include <ovarray.h>
+#include <ovbase.h>
+#include <ovutil/win32.h>
+
+#include <stdio.h>
+#include <string.h>
+
+#include "jsoncommon.h"
+#include "transcript.h"
+
+enum {
+  iterations = 20,
+  num_segments = 20000,
+  words_per_segment = 12,
+};
+
+static double now(void) {
+  static LARGE_INTEGER freq;
+  if (!freq.QuadPart) {
+    QueryPerformanceFrequency(&freq);
+  }
+  LARGE_INTEGER c;
+  QueryPerformanceCounter(&c);
+  return (double)c.QuadPart / (double)freq.QuadPart;
+}
+
+static NODISCARD error build_json(char **const dest) {
+  static char const word[] = "{\"start\":12.34,\"end\":12.56,\"word\":\" word\",\"probability\":0.987}";
+  static char const head[] =
+      "{\"id\":0,\"start\":12.34,\"end\":15.67,\"text\":\" The quick brown fox jumps over the lazy dog.\",\"words\":[";
+  size_t const len = 32 + num_segments * (sizeof(head) + words_per_segment * sizeof(word) + 8);
+  error err = OV_ARRAY_GROW(dest, len);
+  if (efailed(err)) {
+    return ethru(err);
+  }
+  char *p = *dest;
+  p += sprintf(p, "{\"language\":\"en\",\"segments\":[");
+  for (size_t i = 0; i < num_segments; ++i) {
+    p += sprintf(p, "%s%s", i ? "," : "", head);
+    for (size_t j = 0; j < words_per_segment; ++j) {
+      p += sprintf(p, "%s%s", j ? "," : "", word);
+    }
+    p += sprintf(p, "]}");
+  }
+  p += sprintf(p, "]}");
+  OV_ARRAY_SET_LENGTH(*dest, (size_t)(p - *dest));
+  return eok();
+}
+
+/**
+ * Parses the JSON and visits every value json2exo reads, as json2exo did before the binary transcript.
+ */
+static double load_json(char *const json, size_t const len) {
+  double sum = 0;
+  struct jsoncommon_arena arena = {0};
+  error err = jsoncommon_arena_init(&arena, len, YYJSON_READ_INSITU);
+  if (efailed(err)) {
+    ereport(err);
+    return 0;
+  }
+  struct yyjson_doc *doc = yyjson_read_opts(json, len, YYJSON_READ_INSITU, &arena.alc, NULL);
+  struct yyjson_val *segments = yyjson_obj_get(yyjson_doc_get_root(doc), "segments");
+  size_t i, n;
+  struct yyjson_val *seg;
+  yyjson_arr_foreach(segments, i, n, seg) {
+    size_t const text_len = yyjson_get_len(yyjson_obj_get(seg, "text"));
+    sum += yyjson_get_num(yyjson_obj_get(seg, "start")) + yyjson_get_num(yyjson_obj_get(seg, "end")) +
+           (double)text_len;
+    size_t j, m;
+    struct yyjson_val *word;
+    yyjson_arr_foreach(yyjson_obj_get(seg, "words"), j, m, word) {
+      size_t const word_len = yyjson_get_len(yyjson_obj_get(word, "word"));
+      sum += yyjson_get_num(yyjson_obj_get(word, "start")) + yyjson_get_num(yyjson_obj_get(word, "end")) +
+             (double)word_len;
+    }
+  }
+  yyjson_doc_free(doc);
+  jsoncommon_arena_destroy(&arena);
+  return sum;
+}
+
+static double load_binary(char const *const bin, size_t const len) {
+  double sum = 0;
+  struct transcript t = {0};
+  error err = transcript_view(bin, len, &t);
+  if (efailed(err)) {
+    ereport(err);
+    return 0;
+  }
+  for (size_t i = 0; i < t.num_segments; ++i) {
+    struct transcript_segment const *const seg = &t.segments[i];
+    sum += seg->start + seg->end + (double)seg->text_len;
+    struct transcript_word const *const words = t.words + seg->first_word;
+    for (size_t j = 0; j < seg->num_words; ++j) {
+      sum += words[j].start + words[j].end + (double)words[j].word_len;
+    }
+  }
+  return sum;
+}
+
+int main(void) {
+  char *json = NULL;
+  char *work = NULL;
+  char *bin = NULL;
+  error err = build_json(&json);
+  if (efailed(err)) {
+    ereport(err);
+    goto cleanup;
+  }
+  size_t const len = OV_ARRAY_LENGTH(json);
+  err = OV_ARRAY_GROW(&work, len + YYJSON_PADDING_SIZE);
+  if (efailed(err)) {
+    ereport(err);
+    goto cleanup;
+  }
+  memcpy(work, json, len);
+  memset(work + len, 0, YYJSON_PADDING_SIZE);
+  err = transcript_convert_json(work, len, 0, 0, &bin);
+  if (efailed(err)) {
+    ereport(err);
+    goto cleanup;
+  }
+
+  double elapsed_json = 0, sum_json = 0;
+  for (int i = 0; i < iterations; ++i) {
+    memcpy(work, json, len);
+    double const start = now();
+    sum_json += load_json(work, len);
+    elapsed_json += now() - start;
+  }
+  double elapsed_bin = 0, sum_bin = 0;
+  for (int i = 0; i < iterations; ++i) {
+    double const start = now();
+    sum_bin += load_binary(bin, OV_ARRAY_LENGTH(bin));
+    elapsed_bin += now() - start;
+  }
+
+  size_t const bin_len = OV_ARRAY_LENGTH(bin);
+  // Both loaders add the same values in the same order, so the checksums only differ if the data differs.
+  double const checksum_diff = sum_json > sum_bin ? sum_json - sum_bin : sum_bin - sum_json;
+  printf("transcript: %d segments, json %.2f MiB, binary %.2f MiB\n",
+         num_segments,
+         (double)len / (1024.0 * 1024.0),
+         (double)bin_len / (1024.0 * 1024.0));
+  printf("yyjson: %8.3fms/load\n", elapsed_json * 1000.0 / iterations);
+  printf("binary: %8.3fms/load, x%.2f%s\n",
+         elapsed_bin * 1000.0 / iterations,
+         elapsed_bin > 0 ? elapsed_json / elapsed_bin : 0.0,
+         checksum_diff > 0 ? " (checksum mismatch)" : "");
+
+cleanup:
+  OV_ARRAY_DESTROY(&bin);
+  OV_ARRAY_DESTROY(&work);
+  OV_ARRAY_DESTROY(&json);
+  return 0;
+}
@@ -0,0 +1,205 @@
+#include <ovtest.h>
+
+#include <ovarray.h>
+
+#include "jsoncommon.h"
+#include "path.h"
+#include "transcript.h"
+
+#include <string.h>
+
+static NODISCARD error convert(char const *const json, char **const dest) {
+  size_t const len = strlen(json);
+  char *buf = NULL;
+  error err = mem(&buf, len + YYJSON_PADDING_SIZE, sizeof(char));
+  if (efailed(err)) {
+    return ethru(err);
+  }
+  memcpy(buf, json, len);
+  memset(buf + len, 0, YYJSON_PADDING_SIZE);
+  err = transcript_convert_json(buf, len, 1234, 5678, dest);
+  ereport(mem_free(&buf));
+  return err;
+}
+
+static bool near(double const a, double const b) { return a - b < 1e-9 && b - a < 1e-9; }
+
+static void test_transcript_convert(void) {
+  static char const json[] = "{\"language\":\"ja\",\"segments\":["
+                             "{\"start\":0.5,\"end\":1.25,\"text\":\"hello world\",\"words\":["
+                             "{\"start\":0.5,\"end\":0.75,\"word\":\"hello\"},"
+                             "{\"start\":0.75,\"end\":1.25,\"word\":\" world\"}]},"
+                             "{\"start\":2,\"end\":3.5,\"text\":\"\",\"words\":[]},"
+                             "{\"start\":4,\"end\":3,\"text\":\"\\u3042\",\"words\":["
+                             "{\"start\":4,\"end\":4.5,\"word\":\"\\u3042\"}]}"
+                             "]}";
+  char *bin = NULL;
+  if (!TEST_SUCCEEDED_F(convert(json, &bin))) {
+    return;
+  }
+  struct transcript t = {0};
+  if (!TEST_SUCCEEDED_F(transcript_view(bin, OV_ARRAY_LENGTH(bin), &t))) {
+    goto cleanup;
+  }
+  TEST_CHECK(t.num_segments == 3);
+  TEST_CHECK(t.num_words == 3);
+  TEST_CHECK(near(t.max_time, 3.5));
+  TEST_CHECK(t.source_size == 1234);
+  TEST_CHECK(t.source_time == 5678);
+
+  struct transcript_segment const *s = &t.segments[0];
+  TEST_CHECK(near(s->start, 0.5) && near(s->end, 1.25));
+  TEST_CHECK(s->text_len == 11 && strcmp(t.strings + s->text, "hello world") == 0);
+  TEST_CHECK(s->first_word == 0 && s->num_words == 2);
+  TEST_CHECK(strcmp(t.strings + t.words[0].word, "hello") == 0);
+  TEST_CHECK(near(t.words[1].start, 0.75) && near(t.words[1].end, 1.25));
+  TEST_CHECK(strcmp(t.strings + t.words[1].word, " world") == 0);
+
+  s = &t.segments[1];
+  TEST_CHECK(s->text_len == 0 && t.strings[s->text] == '\0');
+  TEST_CHECK(s->num_words == 0);
+
+  s = &t.segments[2];
+  TEST_CHECK(strcmp(t.strings + s->text, "\xe3\x81\x82") == 0);
+  TEST_CHECK(s->first_word == 2 && s->num_words == 1);
+  TEST_CHECK(t.words[2].word_len == 3);
+
+  size_t *r = NULL;
+  if (TEST_SUCCEEDED_F(transcript_build_index(&t))) {
+    if (TEST_SUCCEEDED_F(transcript_query_segments(&t, 2.5, 2.5, &r))) {
+      TEST_CHECK(OV_ARRAY_LENGTH(r) == 1 && r[0] == 1);
+    }
+    if (TEST_SUCCEEDED_F(transcript_query_words(&t, 0.7, 4.0, &r))) {
+      TEST_CHECK(OV_ARRAY_LENGTH(r) == 3 && r[0] == 0 && r[1] == 1 && r[2] == 2);
+    }
+  }
+  OV_ARRAY_DESTROY(&r);
+
+cleanup:
+  transcript_destroy(&t);
+  OV_ARRAY_DESTROY(&bin);
+}
+
+static void test_transcript_convert_error(void) {
+  static char const *const tests[] = {
+      "{",
+      "[]",
+      "{\"segments\":{}}",
+      "{\"segments\":[1]}",
+      "{\"segments\":[{\"start\":0,\"end\":1,\"text\":\"a\"}]}",
+      "{\"segments\":[{\"start\":0,\"end\":1,\"words\":[]}]}",
+      "{\"segments\":[{\"start\":\"0\",\"end\":1,\"text\":\"a\",\"words\":[]}]}",
+      "{\"segments\":[{\"start\":0,\"end\":1,\"text\":\"a\",\"words\":[1]}]}",
+      "{\"segments\":[{\"start\":0,\"end\":1,\"text\":\"a\",\"words\":[{\"start\":0,\"end\":1}]}]}",
+  };
+  for (size_t i = 0; i < sizeof(tests) / sizeof(tests[0]); ++i) {
+    char *bin = NULL;
+    TEST_EISG_F(convert(tests[i], &bin), err_fail);
+    TEST_MSG("json: %s", tests[i]);
+    TEST_CHECK(bin == NULL);
+    OV_ARRAY_DESTROY(&bin);
+  }
+}
+
+static void test_transcript_view_broken(void) {
+  static char const json[] = "{\"segments\":[{\"start\":0,\"end\":1,\"text\":\"ab\",\"words\":["
+                             "{\"start\":0,\"end\":1,\"word\":\"ab\"}]}]}";
+  char *bin = NULL;
+  if (!TEST_SUCCEEDED_F(convert(json, &bin))) {
+    return;
+  }
+  size_t const len = OV_ARRAY_LENGTH(bin);
+  struct transcript t = {0};
+  for (size_t i = 0; i < len; ++i) {
+    TEST_EISG_F(transcript_view(bin, i, &t), err_fail);
+    TEST_MSG("truncated to %zu", i);
+  }
+  // Header fields, record offsets and the string terminators are validated.
+  size_t const offsets[] = {0, 4, 32, 36, 40, 48 + 16, 48 + 24, 48 + 28, 48 + 32 + 16, len - 1};
+  for (size_t i = 0; i < sizeof(offsets) / sizeof(offsets[0]); ++i) {
+    bin[offsets[i]] ^= 0x41;
+    TEST_EISG_F(transcript_view(bin, len, &t), err_fail);
+    TEST_MSG("flipped byte at %zu", offsets[i]);
+    bin[offsets[i]] ^= 0x41;
+  }
+  TEST_SUCCEEDED_F(transcript_view(bin, len, &t));
+  OV_ARRAY_DESTROY(&bin);
+}
+
+static void test_transcript_get_path(void) {
+  static struct {
+    wchar_t const *input;
+    wchar_t const *expected;
+  } const tests[] = {
+      {L"C:\\temp\\a.json", L"C:\\temp\\a.transcript"},
+      {L"C:\\temp\\a.JSON", L"C:\\temp\\a.transcript"},
+      {L"C:\\temp\\a.txt", L"C:\\temp\\a.txt.transcript"},
+      {L"C:\\temp.json\\a", L"C:\\temp.json\\a.transcript"},
+  };
+  for (size_t i = 0; i < sizeof(tests) / sizeof(tests[0]); ++i) {
+    wchar_t *path = NULL;
+    if (TEST_SUCCEEDED_F(transcript_get_path(tests[i].input, &path))) {
+      TEST_CHECK(wcscmp(path, tests[i].expected) == 0);
+      TEST_MSG("expected %ls, got %ls", tests[i].expected, path);
+      TEST_CHECK(OV_ARRAY_LENGTH(path) == wcslen(tests[i].expected));
+    }
+    OV_ARRAY_DESTROY(&path);
+  }
+}
+
+static void test_transcript_build_file(void) {
+  static char const json[] = "{\"segments\":["
+                             "{\"start\":0,\"end\":1.5,\"text\":\"a b\",\"words\":["
+                             "{\"start\":0,\"end\":0.5,\"word\":\"a\"},{\"start\":0.5,\"end\":1.5,\"word\":\" b\"}]},"
+                             "{\"start\":2,\"end\":2.5,\"text\":\"c\",\"words\":[]}"
+                             "]}";
+  wchar_t *json_path = NULL;
+  wchar_t *bin_path = NULL;
+  struct transcript t = {0};
+  if (!TEST_SUCCEEDED_F(path_get_temp_file(&json_path, L"transcript_test.json")) ||
+      !TEST_SUCCEEDED_F(transcript_get_path(json_path, &bin_path))) {
+    goto cleanup;
+  }
+  HANDLE h = CreateFileW(json_path, GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+  if (!TEST_CHECK(h != INVALID_HANDLE_VALUE)) {
+    goto cleanup;
+  }
+  DWORD written = 0;
+  TEST_CHECK(WriteFile(h, json, sizeof(json) - 1, &written, NULL) && written == sizeof(json) - 1);
+  CloseHandle(h);
+
+  // The counts come from the conversion, without loading the transcript again.
+  struct transcript_summary summary = {0};
+  if (!TEST_SUCCEEDED_F(transcript_build_file(json_path, &summary))) {
+    goto cleanup;
+  }
+  TEST_CHECK(summary.num_segments == 2);
+  TEST_CHECK(summary.num_words == 2);
+  TEST_CHECK(near(summary.max_time, 2.5));
+  TEST_CHECK(GetFileAttributesW(bin_path) != INVALID_FILE_ATTRIBUTES);
+  TEST_SUCCEEDED_F(transcript_build_file(json_path, NULL));
+
+  if (TEST_SUCCEEDED_F(transcript_load_file(json_path, &t))) {
+    TEST_CHECK(t.num_segments == summary.num_segments);
+    TEST_CHECK(t.num_words == summary.num_words);
+  }
+cleanup:
+  transcript_destroy(&t);
+  if (bin_path) {
+    DeleteFileW(bin_path);
+    OV_ARRAY_DESTROY(&bin_path);
+  }
+  if (json_path) {
+    DeleteFileW(json_path);
+    OV_ARRAY_DESTROY(&json_path);
+  }
+}
+
+TEST_LIST = {
+    {"test_transcript_convert", test_transcript_convert},
+    {"test_transcript_convert_error", test_transcript_convert_error},
+    {"test_transcript_view_broken", test_transcript_view_broken},
+    {"test_transcript_get_path", test_transcript_get_path},
+    {"test_transcript_build_file", test_transcript_build_file},
+    {NULL, NULL},
+};
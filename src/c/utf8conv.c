@@ -0,0 +1,132 @@
+#include "utf8conv.h"
+
+#include <emmintrin.h>
+
+#include <ovarray.h>
+#include <ovutil/win32.h>
+
+/**
+ * Decodes one multi-byte sequence at src[0], returns the number of bytes consumed or 0 if it is invalid.
+ */
+static size_t decode_sequence(uint8_t const *const src, size_t const len, wchar_t *const dst, size_t *const written) {
+  uint32_t c = src[0];
+  size_t n;
+  uint32_t min;
+  if ((c & 0xe0) == 0xc0) {
+    n = 1;
+    c &= 0x1f;
+    min = 0x80;
+  } else if ((c & 0xf0) == 0xe0) {
+    n = 2;
+    c &= 0x0f;
+    min = 0x800;
+  } else if ((c & 0xf8) == 0xf0) {
+    n = 3;
+    c &= 0x07;
+    min = 0x10000;
+  } else {
+    return 0;
+  }
+  if (len <= n) {
+    return 0;
+  }
+  for (size_t i = 1; i <= n; ++i) {
+    if ((src[i] & 0xc0) != 0x80) {
+      return 0;
+    }
+    c = (c << 6) | (src[i] & 0x3f);
+  }
+  if (c < min || c > 0x10ffff || (c >= 0xd800 && c <= 0xdfff)) {
+    return 0;
+  }
+  if (c >= 0x10000) {
+    c -= 0x10000;
+    dst[0] = (wchar_t)(0xd800 | (c >> 10));
+    dst[1] = (wchar_t)(0xdc00 | (c & 0x3ff));
+    *written = 2;
+  } else {
+    dst[0] = (wchar_t)c;
+    *written = 1;
+  }
+  return n + 1;
+}
+
+ptrdiff_t utf8conv_decode_scalar(char const *const src, size_t const len, wchar_t *const dst) {
+  uint8_t const *const s = (uint8_t const *)src;
+  size_t i = 0, o = 0;
+  while (i < len) {
+    if (s[i] < 0x80) {
+      dst[o++] = (wchar_t)s[i++];
+      continue;
+    }
+    size_t written = 0;
+    size_t const n = decode_sequence(s + i, len - i, dst + o, &written);
+    if (!n) {
+      return utf8conv_invalid;
+    }
+    i += n;
+    o += written;
+  }
+  return (ptrdiff_t)o;
+}
+
+ptrdiff_t utf8conv_decode(char const *const src, size_t const len, wchar_t *const dst) {
+  uint8_t const *const s = (uint8_t const *)src;
+  __m128i const zero = _mm_setzero_si128();
+  size_t i = 0, o = 0;
+  // The output never has more code units than the input has bytes, so o + 16 <= i + 16 <= len and the full stores
+  // below stay in the buffer even if only a part of them is kept.
+  while (i + 16 <= len) {
+    __m128i const v = _mm_loadu_si128((__m128i const *)(void const *)(s + i));
+    _mm_storeu_si128((__m128i *)(void *)(dst + o), _mm_unpacklo_epi8(v, zero));
+    _mm_storeu_si128((__m128i *)(void *)(dst + o + 8), _mm_unpackhi_epi8(v, zero));
+    unsigned int const mask = (unsigned int)_mm_movemask_epi8(v);
+    if (!mask) {
+      i += 16;
+      o += 16;
+      continue;
+    }
+    size_t const ascii = (size_t)__builtin_ctz(mask);
+    i += ascii;
+    o += ascii;
+    size_t written = 0;
+    size_t const n = decode_sequence(s + i, len - i, dst + o, &written);
+    if (!n) {
+      return utf8conv_invalid;
+    }
+    i += n;
+    o += written;
+  }
+  ptrdiff_t const r = utf8conv_decode_scalar(src + i, len - i, dst + o);
+  if (r == utf8conv_invalid) {
+    return utf8conv_invalid;
+  }
+  return (ptrdiff_t)o + r;
+}
+
+NODISCARD error utf8conv_to_wchar(char const *const src, size_t const len, wchar_t **const dest, bool *const fallback) {
+  if ((!src && len) || !dest || len > INT_MAX) {
+    return errg(err_invalid_arugment);
+  }
+  error err = OV_ARRAY_GROW(dest, len + 1);
+  if (efailed(err)) {
+    return ethru(err);
+  }
+  bool used_fallback = false;
+  ptrdiff_t n = utf8conv_decode(src, len, *dest);
+  if (n == utf8conv_invalid) {
+    // Each byte becomes at most one code unit in the ANSI code pages too, so one call is enough.
+    int const r = MultiByteToWideChar(CP_ACP, 0, src, (int)len, *dest, (int)len);
+    if (r == 0) {
+      return errhr(HRESULT_FROM_WIN32(GetLastError()));
+    }
+    n = r;
+    used_fallback = true;
+  }
+  (*dest)[n] = L'\0';
+  OV_ARRAY_SET_LENGTH(*dest, (size_t)n);
+  if (fallback) {
+    *fallback = used_fallback;
+  }
+  return eok();
+}
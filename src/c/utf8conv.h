@@ -0,0 +1,39 @@
+#pragma once
+
+#include <ovbase.h>
+
+enum {
+  /**
+   * @brief Returned by utf8conv_decode if the input is not valid UTF-8.
+   */
+  utf8conv_invalid = -1,
+};
+
+/**
+ * @brief Validates UTF-8 and converts it to UTF-16 in one pass.
+ *
+ * ASCII runs are widened 16 bytes at a time with SSE2, and other sequences are decoded one by one.
+ * Overlong forms, surrogates and code points above U+10FFFF are rejected.
+ * @param src UTF-8 string.
+ * @param len Length of src in bytes.
+ * @param dst Destination buffer, must have room for len code units.
+ * @return Number of code units written, or utf8conv_invalid.
+ */
+ptrdiff_t utf8conv_decode(char const *const src, size_t const len, wchar_t *const dst);
+
+/**
+ * @brief The reference implementation of utf8conv_decode.
+ */
+ptrdiff_t utf8conv_decode_scalar(char const *const src, size_t const len, wchar_t *const dst);
+
+/**
+ * @brief Converts a line from a child process or a Lua script to a NUL-terminated UTF-16 string.
+ *
+ * The line is decoded as UTF-8, and as the ANSI code page if it is not valid UTF-8.
+ * @param src The line.
+ * @param len Length of src in bytes.
+ * @param dest A pointer to an ovarray that is reused as the scratch buffer between calls.
+ * @param fallback A pointer to receive whether the ANSI code page was used, can be NULL.
+ * @return An error code indicating success or failure.
+ */
+NODISCARD error utf8conv_to_wchar(char const *const src, size_t const len, wchar_t **const dest, bool *const fallback);
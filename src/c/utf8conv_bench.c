@@ -0,0 +1,102 @@
+#include <ovarray.h>
+#include <ovbase.h>
+#include <ovutf.h>
+#include <ovutil/win32.h>
+
+#include <stdio.h>
+#include <string.h>
+
+#include "utf8conv.h"
+
+enum {
+  iterations = 200000,
+};
+
+static double now(void) {
+  static LARGE_INTEGER freq;
+  if (!freq.QuadPart) {
+    QueryPerformanceFrequency(&freq);
+  }
+  LARGE_INTEGER c;
+  QueryPerformanceCounter(&c);
+  return (double)c.QuadPart / (double)freq.QuadPart;
+}
+
+/**
+ * What process_line in opus2json.c used to do for each line.
+ */
+static void convert_legacy(char const *const src, size_t const len, wchar_t **const dest) {
+  UINT const cp = len && ov_utf8_to_wchar_len(src, strlen(src)) == 0 ? CP_ACP : CP_UTF8;
+  int const n = MultiByteToWideChar(cp, 0, src, -1, NULL, 0);
+  if (n == 0 || efailed(OV_ARRAY_GROW(dest, (size_t)n))) {
+    return;
+  }
+  MultiByteToWideChar(cp, 0, src, -1, *dest, n);
+}
+
+static void convert(char const *const src, size_t const len, wchar_t **const dest) {
+  error err = utf8conv_to_wchar(src, len, dest, NULL);
+  if (efailed(err)) {
+    ereport(err);
+  }
+}
+
+static double run_decode(ptrdiff_t (*decode)(char const *const, size_t const, wchar_t *const),
+                         char const *const src,
+                         size_t const len,
+                         wchar_t *const dst) {
+  double const start = now();
+  for (int i = 0; i < iterations; ++i) {
+    if (decode(src, len, dst) == utf8conv_invalid) {
+      return 0;
+    }
+  }
+  return now() - start;
+}
+
+static double run_convert(void (*fn)(char const *const, size_t const, wchar_t **const),
+                          char const *const src,
+                          size_t const len,
+                          wchar_t **const dest) {
+  double const start = now();
+  for (int i = 0; i < iterations; ++i) {
+    fn(src, len, dest);
+  }
+  return now() - start;
+}
+
+static double mbps(size_t const len, double const elapsed) {
+  return elapsed > 0 ? (double)len * iterations / elapsed / (1024.0 * 1024.0) : 0.0;
+}
+
+int main(void) {
+  static struct {
+    char const *name;
+    char const *line;
+  } const lines[] = {
+      {"segment", "[00:12.340 --> 00:15.670]  And so, my fellow Americans, ask not what your country can do for you."},
+      {"progress", " 87% | 20/23 | 00:06<00:00 |  3.11 audio seconds/s"},
+      {"japanese",
+       "[00:12.340 --> 00:15.670] \xe3\x81\x93\xe3\x82\x93\xe3\x81\xab\xe3\x81\xa1\xe3\x81\xaf\xe3\x80\x81\xe4\xbb"
+       "\x8a\xe6\x97\xa5\xe3\x81\xaf\xe8\x89\xaf\xe3\x81\x84\xe5\xa4\xa9\xe6\xb0\x97\xe3\x81\xa7\xe3\x81\x99\xe3\x81"
+       "\xad\xe3\x80\x82"},
+  };
+  static wchar_t dst[1024];
+  wchar_t *buf = NULL;
+  for (size_t i = 0; i < sizeof(lines) / sizeof(lines[0]); ++i) {
+    size_t const len = strlen(lines[i].line);
+    double const scalar = run_decode(utf8conv_decode_scalar, lines[i].line, len, dst);
+    double const simd = run_decode(utf8conv_decode, lines[i].line, len, dst);
+    double const legacy = run_convert(convert_legacy, lines[i].line, len, &buf);
+    double const fused = run_convert(convert, lines[i].line, len, &buf);
+    printf("%-8s %3d bytes: decode scalar %8.1fMB/s, sse2 %8.1fMB/s | line legacy %8.1fMB/s, fused %8.1fMB/s\n",
+           lines[i].name,
+           (int)len,
+           mbps(len, scalar),
+           mbps(len, simd),
+           mbps(len, legacy),
+           mbps(len, fused));
+  }
+  OV_ARRAY_DESTROY(&buf);
+  return 0;
+}
@@ -0,0 +1,111 @@
+#include <ovtest.h>
+
+#include <ovarray.h>
+
+#include <string.h>
+
+#include "utf8conv.h"
+
+static void test_utf8conv_decode(void) {
+  static struct {
+    char const *input;
+    wchar_t const *expected;
+  } const tests[] = {
+      {"", L""},
+      {"hello", L"hello"},
+      {"\xc3\xa9", L"\u00e9"},
+      {"\xe3\x81\x82\xe3\x81\x84", L"\u3042\u3044"},
+      {"a\xf0\x9f\x98\x80z", L"a\U0001f600z"},
+      {"\xef\xbf\xbf", L"\uffff"},
+      {"\xf4\x8f\xbf\xbf", L"\U0010ffff"},
+  };
+  wchar_t buf[64];
+  for (size_t i = 0; i < sizeof(tests) / sizeof(tests[0]); ++i) {
+    size_t const len = strlen(tests[i].input);
+    ptrdiff_t const n = utf8conv_decode(tests[i].input, len, buf);
+    if (!TEST_CHECK(n == (ptrdiff_t)wcslen(tests[i].expected))) {
+      TEST_MSG("#%zu: got %d", i, (int)n);
+      continue;
+    }
+    TEST_CHECK(memcmp(buf, tests[i].expected, (size_t)n * sizeof(wchar_t)) == 0);
+    TEST_CHECK(utf8conv_decode_scalar(tests[i].input, len, buf) == n);
+  }
+}
+
+static void test_utf8conv_decode_invalid(void) {
+  static char const *const tests[] = {
+      "\x80",             // continuation byte without a lead byte
+      "\xc0\x80",         // overlong
+      "\xe0\x80\x80",     // overlong
+      "\xf0\x80\x80\x80", // overlong
+      "\xed\xa0\x80",     // surrogate
+      "\xf4\x90\x80\x80", // above U+10FFFF
+      "\xe3\x81",         // truncated
+      "\xe3\x81z",        // not a continuation byte
+      "\xff",
+      "\x82\xa0\x82\xa2", // Shift_JIS
+  };
+  wchar_t buf[64];
+  for (size_t i = 0; i < sizeof(tests) / sizeof(tests[0]); ++i) {
+    TEST_CHECK(utf8conv_decode(tests[i], strlen(tests[i]), buf) == utf8conv_invalid);
+    TEST_MSG("#%zu", i);
+    TEST_CHECK(utf8conv_decode_scalar(tests[i], strlen(tests[i]), buf) == utf8conv_invalid);
+    TEST_MSG("#%zu", i);
+  }
+}
+
+static void test_utf8conv_decode_same_as_scalar(void) {
+  // Put the multi-byte sequences at every offset around the 16-byte blocks.
+  static char const *const pieces[] = {"\xc3\xa9", "\xe3\x81\x82", "\xf0\x9f\x98\x80", "\xe3\x81"};
+  char src[96];
+  wchar_t expected[96], got[96];
+  for (size_t p = 0; p < sizeof(pieces) / sizeof(pieces[0]); ++p) {
+    size_t const plen = strlen(pieces[p]);
+    for (size_t pos = 0; pos + plen <= 64; ++pos) {
+      memset(src, 'x', sizeof(src));
+      memcpy(src + pos, pieces[p], plen);
+      for (size_t len = pos; len <= 64; len += 5) {
+        ptrdiff_t const e = utf8conv_decode_scalar(src, len, expected);
+        ptrdiff_t const g = utf8conv_decode(src, len, got);
+        if (!TEST_CHECK(e == g)) {
+          TEST_MSG("piece %zu at %zu, len %zu: expected %d, got %d", p, pos, len, (int)e, (int)g);
+          return;
+        }
+        if (e > 0 && !TEST_CHECK(memcmp(expected, got, (size_t)e * sizeof(wchar_t)) == 0)) {
+          TEST_MSG("piece %zu at %zu, len %zu", p, pos, len);
+          return;
+        }
+      }
+    }
+  }
+}
+
+static void test_utf8conv_to_wchar(void) {
+  wchar_t *buf = NULL;
+  bool fallback = true;
+  if (TEST_SUCCEEDED_F(utf8conv_to_wchar("[00:00.000 --> 00:01.000] \xe3\x81\x82", 29, &buf, &fallback))) {
+    TEST_CHECK(wcscmp(buf, L"[00:00.000 --> 00:01.000] \u3042") == 0);
+    TEST_CHECK(OV_ARRAY_LENGTH(buf) == 27);
+    TEST_CHECK(!fallback);
+  }
+  if (TEST_SUCCEEDED_F(utf8conv_to_wchar("", 0, &buf, &fallback))) {
+    TEST_CHECK(buf[0] == L'\0');
+    TEST_CHECK(!fallback);
+  }
+  if (TEST_SUCCEEDED_F(utf8conv_to_wchar("abc\x82\xa0", 5, &buf, &fallback))) {
+    // The result depends on the ANSI code page, but the ASCII part is always kept.
+    TEST_CHECK(wcsncmp(buf, L"abc", 3) == 0);
+    TEST_CHECK(fallback);
+  }
+  TEST_EISG_F(utf8conv_to_wchar(NULL, 1, &buf, NULL), err_invalid_arugment);
+  TEST_EISG_F(utf8conv_to_wchar("a", 1, NULL, NULL), err_invalid_arugment);
+  OV_ARRAY_DESTROY(&buf);
+}
+
+TEST_LIST = {
+    {"test_utf8conv_decode", test_utf8conv_decode},
+    {"test_utf8conv_decode_invalid", test_utf8conv_decode_invalid},
+    {"test_utf8conv_decode_same_as_scalar", test_utf8conv_decode_same_as_scalar},
+    {"test_utf8conv_to_wchar", test_utf8conv_to_wchar},
+    {NULL, NULL},
+};
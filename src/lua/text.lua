@@ -1,7 +1,10 @@
 local P = {}
 
 -- モジュールについての情報を返す
--- @return {name=モジュール名, description=モジュールの説明}
+-- @return {name=モジュール名, description=モジュールの説明, parallel=並列処理を許可するか}
+--   parallel を true にすると、セグメントを複数のスレッドに分けて処理する
+--   on_segment が他のセグメントの処理結果に依存せず、exo.* で EXO を書き出すモジュールでのみ有効にできる
+--   並列処理ではレイヤーの割り当てがスレッドの実行順で変わってしまうため、alloc_layer は使えない
 function P.get_info()
   return {
     name = i18n({
@@ -17,72 +20,47 @@ function P.get_info()
   }
 end
 
-local exo = {}
 local fileinfo = nil
-local num_objs = 0
 
 local function add_item(layer, st, ed, text)
-  table.insert(
-    exo,
-    string.format(
-      "[%d]\r\n"
-        .. "start=%d\r\n"
-        .. "end=%d\r\n"
-        .. "layer=%d\r\n"
-        .. "group=1\r\n"
-        .. "overlay=1\r\n"
-        .. "camera=0\r\n",
-      num_objs,
-      st,
-      ed,
-      layer
-    )
-  )
-  table.insert(
-    exo,
-    string.format(
-      "[%d.0]\r\n"
-        .. "_name=テキスト\r\n"
-        .. "サイズ=34\r\n"
-        .. "表示速度=0.0\r\n"
-        .. "文字毎に個別オブジェクト=0\r\n"
-        .. "移動座標上に表示する=0\r\n"
-        .. "自動スクロール=0\r\n"
-        .. "B=0\r\n"
-        .. "I=0\r\n"
-        .. "type=0\r\n"
-        .. "autoadjust=0\r\n"
-        .. "soft=1\r\n"
-        .. "monospace=0\r\n"
-        .. "align=4\r\n"
-        .. "spacing_x=0\r\n"
-        .. "spacing_y=0\r\n"
-        .. "precision=1\r\n"
-        .. "color=ffffff\r\n"
-        .. "color2=000000\r\n"
-        .. "font=MS UI Gothic\r\n"
-        .. "text=",
-      num_objs
-    )
-  )
-  table.insert(exo, exotext(text))
-  table.insert(
-    exo,
-    string.format(
-      "\r\n"
-        .. "[%d.1]\r\n"
-        .. "_name=標準描画\r\n"
-        .. "X=0.0\r\n"
-        .. "Y=0.0\r\n"
-        .. "Z=0.0\r\n"
-        .. "拡大率=100.00\r\n"
-        .. "透明度=0.0\r\n"
-        .. "回転=0.00\r\n"
-        .. "blend=0\r\n",
-      num_objs
-    )
-  )
-  num_objs = num_objs + 1
+  exo.object({ start = st, ["end"] = ed, layer = layer, group = 1, overlay = 1, camera = 0 })
+  exo.filter("テキスト", {
+    { "サイズ", "34" },
+    { "表示速度", "0.0" },
+    { "文字毎に個別オブジェクト", "0" },
+    { "移動座標上に表示する", "0" },
+    { "自動スクロール", "0" },
+    { "B", "0" },
+    { "I", "0" },
+    { "type", "0" },
+    { "autoadjust", "0" },
+    { "soft", "1" },
+    { "monospace", "0" },
+    { "align", "4" },
+    { "spacing_x", "0" },
+    { "spacing_y", "0" },
+    { "precision", "1" },
+    { "color", "ffffff" },
+    { "color2", "000000" },
+    { "font", "MS UI Gothic" },
+    { "text", exotext(text) },
+  })
+  exo.filter("標準描画", {
+    { "X", "0.0" },
+    { "Y", "0.0" },
+    { "Z", "0.0" },
+    { "拡大率", "100.00" },
+    { "透明度", "0.0" },
+    { "回転", "0.00" },
+    { "blend", "0" },
+  })
+end
+
+-- 読み込み済みのモジュールで変換処理を繰り返すときに、on_start の前に呼ばれる
+-- モジュール内で保持している状態をここで初期化する
+-- 定義しない場合は、変換処理のたびにモジュールが読み込み直される
+function P.on_reset()
+  fileinfo = nil
 end
 
 -- 変換処理の最初に呼ばれる
@@ -98,26 +76,7 @@ function P.on_start(fi)
   --   audio_rate = 48000,
   --   audio_ch = 2,
   -- }
-  table.insert(
-    exo,
-    string.format(
-      "[exedit]\r\n"
-        .. "width=%d\r\n"
-        .. "height=%d\r\n"
-        .. "rate=%d\r\n"
-        .. "scale=%d\r\n"
-        .. "length=%d\r\n"
-        .. "audio_rate=%d\r\n"
-        .. "audio_ch=%d\r\n",
-      fi.width,
-      fi.height,
-      fi.rate,
-      fi.scale,
-      fi.length,
-      fi.audio_rate,
-      fi.audio_ch
-    )
-  )
+  exo.header(fi)
   fileinfo = fi
   return true
 end
@@ -127,18 +86,25 @@ end
 -- @return 中断したいときは false を返す
 function P.on_segment(seg)
   -- seg = {
+  --   index = 1,
   --   start = 1.23,
   --   end = 4.56,
+  --   start_frame = 74,
+  --   end_frame = 273,
   --   text = "Hello!",
   --   words = {
-  --     {start = 1.23, end = 2.34, word = "He"},
-  --     {start = 2.34, end = 3.0, word = "llo!"},
+  --     {start = 1.23, end = 2.34, start_frame = 74, end_frame = 140, word = "He"},
+  --     {start = 2.34, end = 3.0, start_frame = 141, end_frame = 273, word = "llo!"},
   --   },
   -- }
+  -- start_frame / end_frame はフレーム番号に変換済みの表示範囲
+  -- 単語の end_frame は次の単語の開始まで（最後の単語は文章の終わりまで）延長され、重なりも解消されている
+  -- alloc_layer(開始フレーム, 終了フレーム[, 数]) はタイムライン上の既存のオブジェクトと書き出し済みのオブジェクトを避けて
+  -- 空いているレイヤーを上から探し、確保したレイヤー番号を返す（数を指定すると連続したレイヤーを確保して先頭を返す）
   add_item(
-    1,
-    math.floor(seg.start * fileinfo.rate / fileinfo.scale) + 1,
-    math.floor(seg["end"] * fileinfo.rate / fileinfo.scale),
+    alloc_layer(seg.start_frame, seg.end_frame),
+    seg.start_frame,
+    seg.end_frame,
     seg.text
   )
   debug_print(string.format("%7.2fs - %7.2fs %s", seg.start, seg["end"], seg.text))
@@ -146,10 +112,11 @@ function P.on_segment(seg)
 end
 
 -- 変換処理の最後に呼ばれる
--- ここでUTF8でエンコードされたEXOファイルの内容を返すと、最終的に Shift_JIS に変換されて読み込まれる
--- @return EXO ファイルの内容
-function P.on_finalize()
-  return table.concat(exo)
-end
+-- exo.header / exo.object / exo.filter / exo.text で書き出した内容が、最終的に Shift_JIS に変換されて読み込まれる
+-- 代わりにUTF8でエンコードされたEXOファイルの内容を文字列で返すこともできる
+-- その場合は2つ目の戻り値で統計情報を返すと、EXO ファイルの再走査を省略できる
+-- @return 何も返さないか、EXO ファイルの内容と統計情報
+--   {num_objects=オブジェクト数, layer_min=最小レイヤー, layer_max=最大レイヤー, frames=最終フレーム}
+function P.on_finalize() end
 
 return P